@@ -20,16 +20,34 @@
  */
 
 
+#include <string.h>
 #include <glib.h>
 #include <glib-object.h>
+#include <dbus/dbus-glib-lowlevel.h>
 #include <NetworkManager.h>
-#include <nm-remote-settings.h>
-#include <nm-remote-settings-system.h>
-#include <nm-settings-interface.h>
-#include <nm-client.h>
 #include <nm-device.h>
 
 #include "NMConfig.h"
+#include "NMConfigCommand.h"
+#include "NMConfigConnections.h"
+#include "NMConfigDaemon.h"
+#include "NMConfigIfaceMatch.h"
+#include "NMConfigOutput.h"
+#include "NMConfigPrint.h"
+#include "NMConfigSettings.h"
+#include "NMConfigSnapshot.h"
+#include "NMConfigSnapshotFile.h"
+#include "NMConfigStats.h"
+#include "NMConfigWaitOnline.h"
+#include "NMConfigActivate.h"
+#include "NMConfigExport.h"
+#include "NMConfigImport.h"
+#include "NMConfigWatch.h"
+#include "NMConfigTop.h"
+#include "NMConfigSample.h"
+#include "NMConfigHistory.h"
+#include "NMConfigScan.h"
+#include "NMConfigFleet.h"
 #include "NMConfigDevicePrintHelper.h"
 #include "NMConfigConnectionPrintHelper.h"
 
@@ -38,20 +56,64 @@ G_DEFINE_TYPE (NMConfig, nm_config, G_TYPE_OBJECT)
 #define NM_CONFIG_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), NM_TYPE_CONFIG, NMConfigPrivate))
 
 typedef struct {
-	GPtrArray * args;
-
-	NMClient * client;
-	GPtrArray * devices; /* array with NMDevice objects */
+	NMConfigCommand * command;
 
 	DBusGConnection * bus;
-	NMRemoteSettingsSystem * system_settings;
-	NMRemoteSettings * user_settings;
-	GSList * system_connections;
-	GSList * user_connections;
+
+	/* bootstrap, see load_sources() */
+	DBusGProxy * bus_proxy;
+	guint probes_pending;
+	gboolean nm_running;
+	gboolean user_settings_running;
+	guint deadline_id;
+	gboolean timed_out;
+	guint finish_id;
+	gboolean finished;
+
+	NMConfigSettings * system_settings;
+	NMConfigSettings * user_settings;
 
 	guint parse_id;
+	gboolean parsed;
+
+	/* streamed output, see device_ready_cb() */
+	NMConfigOutput * output;
+	NMConfigIfaceMatch * match; /* interfaces asked for, NULL for all */
+	gboolean header_shown;
+	gboolean devices_done;
+	gint exit_code;
+
+	/* --details, see fetch_details() */
+	gboolean details_pending;
+	NMConfigConnections * connections;
+	GArray * entries;
+
+	/* daemon mode, and --dump-snapshot */
+	NMConfigDaemon * daemon;
+	NMConfigSnapshot * snapshot; /* kept up to date from signals */
+	gboolean snapshot_stale;
+	gboolean fetching;
+	GSList * pending_signals;    /* DBusMessage, arrived while fetching */
+	GSList * waiting_queries;    /* WaitingQuery, wait for a fresh snapshot */
+	guint refresh_id;
+	gboolean filter_added;
+
+	NMConfigWatch * watch;
+	NMConfigWaitOnline * wait_online;
+	NMConfigActivate * activate;
+	NMConfigExport * export;
+	NMConfigImport * import;
+	NMConfigTop * top;
+	NMConfigSample * sample;
+	NMConfigScan * scan;
+	NMConfigFleet * fleet;
 } NMConfigPrivate;
 
+typedef struct {
+	NMConfigDaemonQuery * query;
+	NMConfigCommand * command;
+} WaitingQuery;
+
 enum {
 	PROP_0,
 
@@ -66,130 +128,825 @@ enum {
 
 static guint signals[LAST_SIGNAL] = { 0 };
 
-static gchar *
-state_to_string (NMState state)
+static void
+list_devices (const NMConfigSnapshot * snapshot, NMConfigOutput * output)
+{
+    GPtrArray * devices = snapshot->devices;
+    int i;
+
+    for (i = 0; i < devices->len; i++)
+    	nm_config_output_device (output, g_ptr_array_index (devices, i));
+}
+
+static gint
+compare_positions (gconstpointer a, gconstpointer b)
 {
-    switch (state) {
-    case NM_STATE_UNKNOWN:
-        return "Unknown";
-    case NM_STATE_ASLEEP:
-        return "Asleep";
-    case NM_STATE_CONNECTING:
-        return "Connecting";
-    case NM_STATE_CONNECTED:
-        return "Connected";
-    case NM_STATE_DISCONNECTED:
-        return "Disconnected";
-    default:
-        return "State not recognized";
-    }
+	guint position1 = *(const guint *) a;
+	guint position2 = *(const guint *) b;
 
+	return position1 < position2 ? -1 : (position1 > position2);
 }
 
-static GPtrArray *
-get_devices_list (NMConfig * self) {
-    NMConfigPrivate * priv = NM_CONFIG_GET_PRIVATE (self);
+/* Devices matching the command line, in NetworkManager's order */
+static void
+list_matching_devices (const NMConfigSnapshot * snapshot,
+		const NMConfigIfaceMatch * match, NMConfigOutput * output)
+{
+	const GPtrArray * names = nm_config_iface_match_get_names (match);
+	GArray * positions;
+	int i;
+
+	if (nm_config_iface_match_get_patterns (match)->len > 0) {
+		for (i = 0; i < snapshot->devices->len; i++) {
+			const NMConfigDeviceInfo * device = g_ptr_array_index (snapshot->devices, i);
+
+			if (nm_config_iface_match_test (match, device->iface))
+				nm_config_output_device (output, device);
+		}
+		return;
+	}
 
-    g_return_val_if_fail (NM_IS_CONFIG (self), NULL);
-    g_return_val_if_fail (priv->client, NULL);
+	/* Plain names only: no need to look at every device */
+	positions = g_array_sized_new (FALSE, FALSE, sizeof (guint), names->len);
+	for (i = 0; i < names->len; i++) {
+		guint position;
+
+		if (nm_config_snapshot_lookup_iface (snapshot,
+				g_ptr_array_index (names, i), &position))
+			g_array_append_val (positions, position);
+	}
+	g_array_sort (positions, compare_positions);
 
-    if (! priv->devices) {
-        priv->devices = (GPtrArray *) nm_client_get_devices (priv->client);
-    }
+	for (i = 0; i < positions->len; i++)
+		nm_config_output_device (output, g_ptr_array_index (snapshot->devices,
+				g_array_index (positions, guint, i)));
 
-    return priv->devices;
+	g_array_free (positions, TRUE);
 }
 
-static NMDevice *
-get_device_by_ifname (NMConfig * self, const char * ifname)
+/* Complain about names and patterns no device matches, returns TRUE if
+ * there were any.
+ */
+static gboolean
+report_unmatched (const NMConfigSnapshot * snapshot,
+		const NMConfigIfaceMatch * match)
 {
-    GPtrArray * devices;
-    int i;
+	const GPtrArray * names = nm_config_iface_match_get_names (match);
+	const GPtrArray * patterns = nm_config_iface_match_get_patterns (match);
+	gboolean unmatched = FALSE;
+	int i, j;
+
+	for (i = 0; i < names->len; i++) {
+		const char * name = g_ptr_array_index (names, i);
 
-	g_return_val_if_fail (NM_IS_CONFIG (self), NULL);
-	g_return_val_if_fail (ifname, NULL);
+		if (!nm_config_snapshot_lookup_iface (snapshot, name, NULL)) {
+			g_printerr("NetworkManager dosn't know device: %s\n", name);
+			unmatched = TRUE;
+		}
+	}
 
-	devices = get_devices_list (self);
-	for (i = 0; i < devices->len; i++) {
-		NMDevice * device = NM_DEVICE (g_ptr_array_index (devices, i));
+	for (i = 0; i < patterns->len; i++) {
+		const char * pattern = g_ptr_array_index (patterns, i);
 
-		if(!g_strcmp0 (nm_device_get_iface(device), ifname)) {
-			return device;
+		for (j = 0; j < snapshot->devices->len; j++) {
+			const NMConfigDeviceInfo * device = g_ptr_array_index (snapshot->devices, j);
+
+			if (nm_config_iface_match_pattern (pattern, device->iface))
+				break;
+		}
+		if (j == snapshot->devices->len) {
+			g_printerr("No device matches: %s\n", pattern);
+			unmatched = TRUE;
 		}
 	}
 
-	return NULL;
+	return unmatched;
 }
 
 static void
-show_nm_info (NMConfig * self)
+command_filter (const NMConfigCommand * command, NMConfigConnectionFilter * filter)
 {
-	NMConfigPrivate * priv = NM_CONFIG_GET_PRIVATE (self);
-	NMClient * client = priv->client;
+	filter->id = command->connection_id;
+	filter->uuid = command->connection_uuid;
+	filter->type = command->connection_type;
+}
 
-	NMState nm_state;
-	gboolean is_wireless_enabled, is_wireless_hw_enabled;
+/* entries are NMConfigConnectionEntry, details is NULL or holds the
+ * settings of each entry.
+ */
+static void
+write_connections (NMConfigOutput * output, const GArray * entries,
+		const GPtrArray * details, gboolean user_available)
+{
+	GPtrArray * system_connections = g_ptr_array_new ();
+	GPtrArray * user_connections = g_ptr_array_new ();
+	GPtrArray * system_details = g_ptr_array_new ();
+	GPtrArray * user_details = g_ptr_array_new ();
+	int i;
 
-	g_return_if_fail (NM_IS_CONFIG (self));
+	for (i = 0; i < entries->len; i++) {
+		const NMConfigConnectionEntry * entry = &g_array_index (entries,
+				NMConfigConnectionEntry, i);
+		gboolean user = entry->scope == NM_CONNECTION_SCOPE_USER;
 
-	is_wireless_enabled = nm_client_wireless_get_enabled (client);
-	is_wireless_hw_enabled = nm_client_wireless_hardware_get_enabled (client);
-	nm_state = nm_client_get_state (client);
+		g_ptr_array_add (user ? user_connections : system_connections,
+				(gpointer) entry->info);
+		if (details)
+			g_ptr_array_add (user ? user_details : system_details,
+					g_ptr_array_index (details, i));
+	}
 
-	g_print ("NetworkManager state:      %s\n", state_to_string(nm_state));
-	g_print ("Wireless enabled:          %s\n", (is_wireless_enabled ? "Yes" : "No"));
-	g_print ("Wireless hardware enabled: %s\n", (is_wireless_hw_enabled ? "Yes" : "No"));
+	nm_config_output_connections (output, NM_CONNECTION_SCOPE_SYSTEM,
+			system_connections, details ? system_details : NULL, TRUE);
+	nm_config_output_connections (output, NM_CONNECTION_SCOPE_USER,
+			user_connections, details ? user_details : NULL, user_available);
 
-	g_print ("\n");
+	g_ptr_array_free (system_connections, TRUE);
+	g_ptr_array_free (user_connections, TRUE);
+	g_ptr_array_free (system_details, TRUE);
+	g_ptr_array_free (user_details, TRUE);
 }
 
+/* Connections the command asks for, sorted by id */
+static void
+output_connections (NMConfigOutput * output, const NMConfigCommand * command,
+		const GPtrArray * system_connections, const GPtrArray * user_connections,
+		gboolean user_available)
+{
+	NMConfigConnections * connections;
+	NMConfigConnectionFilter filter;
+	GArray * entries;
+
+	connections = nm_config_connections_new (system_connections, user_connections);
+	command_filter (command, &filter);
+	entries = nm_config_connections_query (connections, &filter);
+
+	write_connections (output, entries, NULL, user_available);
+
+	g_array_free (entries, TRUE);
+	nm_config_connections_free (connections);
+}
 
+/* From the settings services, or from file if it's given */
 static void
-list_devices (NMConfig * self)
+list_connections (NMConfig * self, const NMConfigCommand * command,
+		const NMConfigSnapshotFile * file, NMConfigOutput * output)
 {
-    GPtrArray * devices;
-    int i;
+	NMConfigPrivate *priv;
+
+	if (file) {
+		output_connections (output, command, file->system_connections,
+				file->user_connections, file->user_connections != NULL);
+		return;
+	}
 
-    g_return_if_fail (NM_IS_CONFIG (self));
+	/* Ask every time, the libnm-glib backend follows changes */
+	priv = NM_CONFIG_GET_PRIVATE (self);
+	output_connections (output, command,
+			priv->system_settings ?
+				nm_config_settings_get_connections (priv->system_settings) : NULL,
+			priv->user_settings ?
+				nm_config_settings_get_connections (priv->user_settings) : NULL,
+			priv->user_settings != NULL);
+}
 
-    devices = get_devices_list (self);
+/* Print what the command asks for, returns the exit code. Connections
+ * come from the settings services, or from file if it's given.
+ */
+static gint
+run_command (NMConfig * self, const NMConfigCommand * command,
+		const NMConfigSnapshot * snapshot, const NMConfigSnapshotFile * file)
+{
+	GPtrArray * args = command->args;
+	NMConfigOutput * output;
+	gint exit_code = 0;
+
+	nm_config_stats_phase_begin (NM_CONFIG_PHASE_RENDER);
+	output = nm_config_output_new (command->output_format, &command->print_options);
+
+	if (command->connections)
+		list_connections (self, command, file, output);
+	else if (args->len == 0) {
+		nm_config_output_manager (output, snapshot);
+		list_devices (snapshot, output);
+		list_connections (self, command, file, output);
+	}
+	else {
+		NMConfigIfaceMatch * match = nm_config_iface_match_new (args);
 
-    for (i = 0; i < devices->len; i++) {
-    	NMDevice * device = NM_DEVICE (g_ptr_array_index (devices, i));
-    	nm_config_device_show_full_info (device);
-    }
+		list_matching_devices (snapshot, match, output);
+		if (report_unmatched (snapshot, match))
+			exit_code = 1;
+		nm_config_iface_match_free (match);
+	}
+
+	nm_config_output_finish (output);
+	nm_config_output_free (output);
+	nm_config_stats_phase_end (NM_CONFIG_PHASE_RENDER);
+
+	return exit_code;
 }
 
+/* Emits the finished signal once, whatever finishes first */
 static void
-connection_show_cb (gpointer object, gpointer user_data)
+emit_finished (NMConfig * self, gint exit_code)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	if (priv->finished)
+		return;
+	priv->finished = TRUE;
+
+	if (priv->deadline_id) {
+		g_source_remove (priv->deadline_id);
+		priv->deadline_id = 0;
+	}
+
+	g_signal_emit(self, signals[FINISHED], 0, exit_code);
+}
+
+/*
+ * Local commands stream their output: the manager's state and each
+ * device are printed as soon as they're read, in NetworkManager's order,
+ * while the settings services may still be listing connections. The
+ * output is the same as run_command() prints.
+ */
+
+static gboolean
+connections_ready (NMConfigPrivate * priv)
 {
-	nm_config_connection_show (NM_SETTINGS_CONNECTION_INTERFACE (object));
+	return (!priv->system_settings || nm_config_settings_is_ready (priv->system_settings)) &&
+		(!priv->user_settings || nm_config_settings_is_ready (priv->user_settings));
 }
 
+/* --dump-snapshot writes once devices and connections are read */
 static void
-list_connections (NMConfig * self)
+save_snapshot (NMConfig * self)
 {
 	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	GError * err = NULL;
+
+	/* Devices couldn't be read in time */
+	if (!priv->snapshot) {
+		g_printerr ("%s was not written\n", priv->command->dump_path);
+		return;
+	}
+
+	if (!nm_config_snapshot_file_save (priv->command->dump_path, priv->snapshot,
+			priv->system_settings ?
+				nm_config_settings_get_connections (priv->system_settings) : NULL,
+			priv->user_settings ?
+				nm_config_settings_get_connections (priv->user_settings) : NULL,
+			&err)) {
+		g_printerr ("Could not save the snapshot: %s\n", err->message);
+		g_error_free (err);
+		priv->exit_code = 1;
+	}
+}
+
+static void
+details_cb (const GPtrArray * details, gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	if (priv->finished)
+		return;
+
+	nm_config_stats_phase_begin (NM_CONFIG_PHASE_RENDER);
+	write_connections (priv->output, priv->entries, details, priv->user_settings != NULL);
+	nm_config_output_finish (priv->output);
+	nm_config_print_flush ();
+	nm_config_stats_phase_end (NM_CONFIG_PHASE_RENDER);
+
+	emit_finished (self, priv->exit_code);
+}
+
+/* --details: the connections to show are picked first, and only their
+ * settings are read.
+ */
+static void
+fetch_details (NMConfig * self)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	NMConfigConnectionFilter filter;
+
+	priv->details_pending = TRUE;
+	priv->connections = nm_config_connections_new (
+			priv->system_settings ?
+				nm_config_settings_get_connections (priv->system_settings) : NULL,
+			priv->user_settings ?
+				nm_config_settings_get_connections (priv->user_settings) : NULL);
+	command_filter (priv->command, &filter);
+	priv->entries = nm_config_connections_query (priv->connections, &filter);
+
+	nm_config_connections_fetch_details (priv->bus, priv->entries,
+			priv->command->window, priv->command->timeout * 1000, details_cb, self);
+}
+
+/* up and down, once the connections the targets may name are read */
+
+static void
+activate_cb (gint exit_code, gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+
+	emit_finished (self, exit_code);
+}
+
+static void
+start_activation (NMConfig * self)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	if (priv->activate)
+		return;
+
+	priv->activate = nm_config_activate_new (priv->bus,
+			priv->command->action == NM_CONFIG_ACTION_UP,
+			priv->command->args, priv->command->window,
+			priv->system_settings ?
+				nm_config_settings_get_connections (priv->system_settings) : NULL,
+			priv->user_settings ?
+				nm_config_settings_get_connections (priv->user_settings) : NULL,
+			priv->command->timeout * 1000, activate_cb, self);
+}
+
+/* export and import */
+
+static void
+transfer_cb (gint exit_code, gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	/* A settings service timing out is reported too */
+	emit_finished (self, exit_code ? exit_code : priv->exit_code);
+}
+
+static void
+start_export (NMConfig * self)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	GError * err = NULL;
+
+	if (priv->export)
+		return;
+
+	/* Every GetSettings call is bounded on its own */
+	if (priv->deadline_id) {
+		g_source_remove (priv->deadline_id);
+		priv->deadline_id = 0;
+	}
+
+	priv->connections = nm_config_connections_new (
+			priv->system_settings ?
+				nm_config_settings_get_connections (priv->system_settings) : NULL,
+			priv->user_settings ?
+				nm_config_settings_get_connections (priv->user_settings) : NULL);
+	priv->entries = nm_config_connections_query (priv->connections, NULL);
+
+	priv->export = nm_config_export_new (priv->bus, priv->entries,
+			priv->command->output_format, priv->command->out_path,
+			priv->command->window, priv->command->timeout * 1000,
+			transfer_cb, self, &err);
+	if (!priv->export) {
+		g_printerr ("%s\n", err->message);
+		g_error_free (err);
+		emit_finished (self, 1);
+	}
+}
+
+static void
+finish_listing (NMConfig * self)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	gboolean settings;
+
+	if (priv->finished || !priv->devices_done || priv->details_pending)
+		return;
+
+	settings = nm_config_command_get_sources (priv->command) & NM_CONFIG_SOURCE_SETTINGS;
+
+	/* After the deadline, connections read so far are listed */
+	if (settings && !connections_ready (priv) && !priv->timed_out)
+		return;
 
-	if (priv->system_connections) {
-		g_print("System scope connections:\n");
-		g_slist_foreach (priv->system_connections,
-				connection_show_cb, NULL);
+	if (priv->command->action == NM_CONFIG_ACTION_UP
+		|| priv->command->action == NM_CONFIG_ACTION_DOWN) {
+		start_activation (self);
+		return;
+	}
+
+	if (priv->command->action == NM_CONFIG_ACTION_EXPORT) {
+		start_export (self);
+		return;
+	}
+
+	if (priv->command->details) {
+		fetch_details (self);
+		return;
+	}
+
+	nm_config_stats_phase_begin (NM_CONFIG_PHASE_RENDER);
+	if (priv->command->dump_path)
+		save_snapshot (self);
+	else {
+		if (settings)
+			list_connections (self, priv->command, NULL, priv->output);
+		nm_config_output_finish (priv->output);
+		nm_config_print_flush ();
+	}
+	nm_config_stats_phase_end (NM_CONFIG_PHASE_RENDER);
+
+	emit_finished (self, priv->exit_code);
+}
+
+static void
+device_ready_cb (const NMConfigSnapshot * snapshot,
+		const NMConfigDeviceInfo * device, gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	if (priv->finished)
+		return;
+
+	nm_config_stats_phase_begin (NM_CONFIG_PHASE_RENDER);
+
+	if (priv->command->args->len == 0 && !priv->header_shown) {
+		nm_config_output_manager (priv->output, snapshot);
+		priv->header_shown = TRUE;
+	}
+
+	nm_config_output_device (priv->output, device);
+
+	/* Show each device as soon as it's complete */
+	nm_config_print_flush ();
+	nm_config_stats_phase_end (NM_CONFIG_PHASE_RENDER);
+}
+
+static void
+snapshot_ready_cb (NMConfigSnapshot * snapshot, GError * error,
+		gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	GPtrArray * args = priv->command->args;
+
+	nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+
+	/* Gave up at the deadline already */
+	if (priv->finished) {
+		if (snapshot)
+			nm_config_snapshot_free (snapshot);
+		return;
+	}
+
+	/* Devices shown so far stay, connections are still listed */
+	if (!snapshot && g_error_matches (error, DBUS_GERROR, DBUS_GERROR_NO_REPLY)) {
+		g_printerr ("Timed out reading devices from NetworkManager\n");
+		priv->exit_code = NM_CONFIG_EXIT_TIMEOUT;
+		priv->devices_done = TRUE;
+		finish_listing (self);
+		return;
+	}
+
+	if (!snapshot) {
+		g_printerr ("Could not read NetworkManager state: %s\n",
+				error->message);
+		emit_finished (self, 1);
+		return;
+	}
+
+	if (args->len == 0 && !priv->header_shown) {
+		nm_config_stats_phase_begin (NM_CONFIG_PHASE_RENDER);
+		nm_config_output_manager (priv->output, snapshot);
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_RENDER);
+		priv->header_shown = TRUE;
+	}
+	else if (priv->match && report_unmatched (snapshot, priv->match))
+		priv->exit_code = 1;
+
+	nm_config_snapshot_free (snapshot);
+
+	priv->devices_done = TRUE;
+	finish_listing (self);
+}
+
+static void
+dump_snapshot_cb (NMConfigSnapshot * snapshot, GError * error,
+		gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+
+	if (priv->finished) {
+		if (snapshot)
+			nm_config_snapshot_free (snapshot);
+		return;
+	}
+
+	if (!snapshot) {
+		g_printerr ("Could not read NetworkManager state: %s\n",
+				error->message);
+		emit_finished (self, g_error_matches (error, DBUS_GERROR, DBUS_GERROR_NO_REPLY) ?
+				NM_CONFIG_EXIT_TIMEOUT : 1);
+		return;
+	}
+
+	priv->snapshot = snapshot;
+	priv->devices_done = TRUE;
+	finish_listing (self);
+}
+
+/* Daemon mode */
+
+static GString * captured_err = NULL;
+
+static void
+capture_printerr (const gchar * string)
+{
+	g_string_append (captured_err, string);
+}
+
+static void
+daemon_answer (NMConfig * self, NMConfigDaemonQuery * query,
+		const NMConfigCommand * command)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	GPrintFunc old_printerr;
+	GString * out;
+	gint exit_code;
+
+	out = g_string_new (NULL);
+	captured_err = g_string_new (NULL);
+	nm_config_print_capture (out);
+	old_printerr = g_set_printerr_handler (capture_printerr);
+
+	exit_code = run_command (self, command, priv->snapshot, NULL);
+
+	nm_config_print_capture (NULL);
+	g_set_printerr_handler (old_printerr);
+
+	nm_config_daemon_query_reply (query, exit_code, out, captured_err);
+
+	g_string_free (out, TRUE);
+	g_string_free (captured_err, TRUE);
+	captured_err = NULL;
+}
+
+static void daemon_refresh (NMConfig * self);
+
+static gboolean
+daemon_refresh_cb (gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	priv->refresh_id = 0;
+	daemon_refresh (self);
+
+	return FALSE;
+}
+
+static void
+daemon_apply_signal (NMConfig * self, DBusMessage * message)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	if (nm_config_snapshot_apply_signal (priv->snapshot, message)
+		!= NM_CONFIG_SNAPSHOT_STALE)
+		return;
+
+	/* Refetch soon, so bursts of changes cost one fetch */
+	priv->snapshot_stale = TRUE;
+	if (!priv->refresh_id)
+		priv->refresh_id = g_timeout_add (100, daemon_refresh_cb, self);
+}
+
+static void
+daemon_snapshot_cb (NMConfigSnapshot * snapshot, GError * error,
+		gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	GSList * signals_list, * iter;
+
+	priv->fetching = FALSE;
+
+	signals_list = g_slist_reverse (priv->pending_signals);
+	priv->pending_signals = NULL;
+
+	if (snapshot) {
+		nm_config_snapshot_free (priv->snapshot);
+		priv->snapshot = snapshot;
+		priv->snapshot_stale = FALSE;
+
+		/* Catch up with changes made while the snapshot was read */
+		for (iter = signals_list; iter; iter = g_slist_next (iter))
+			daemon_apply_signal (self, iter->data);
 	}
 	else
-		g_print ("No system scope connections\n");
-	g_print("\n");
+		g_warning ("Could not read NetworkManager state: %s", error->message);
+
+	g_slist_foreach (signals_list, (GFunc) dbus_message_unref, NULL);
+	g_slist_free (signals_list);
 
-	if (priv->user_connections) {
-		g_print("User scope connections:\n");
-		g_slist_foreach (priv->user_connections,
-				connection_show_cb, NULL);
+	while (priv->waiting_queries) {
+		WaitingQuery * waiting = priv->waiting_queries->data;
+
+		priv->waiting_queries = g_slist_delete_link (priv->waiting_queries,
+				priv->waiting_queries);
+
+		if (priv->snapshot)
+			daemon_answer (self, waiting->query, waiting->command);
+		else {
+			GString * err = g_string_new (NULL);
+
+			g_string_printf (err, "Could not read NetworkManager state: %s\n",
+					error->message);
+			nm_config_daemon_query_reply (waiting->query, 1, NULL, err);
+			g_string_free (err, TRUE);
+		}
+
+		nm_config_command_free (waiting->command);
+		g_free (waiting);
+	}
+}
+
+static void
+daemon_refresh (NMConfig * self)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	if (priv->fetching)
+		return;
+
+	priv->fetching = TRUE;
+	nm_config_snapshot_fetch (priv->bus, NULL, daemon_snapshot_cb, self);
+}
+
+static DBusHandlerResult
+daemon_signal_filter (DBusConnection * connection, DBusMessage * message,
+		void * user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	const char * iface;
+
+	iface = dbus_message_get_interface (message);
+	if (dbus_message_get_type (message) != DBUS_MESSAGE_TYPE_SIGNAL
+		|| !iface || !g_str_has_prefix (iface, NM_DBUS_INTERFACE))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	if (priv->fetching)
+		priv->pending_signals = g_slist_prepend (priv->pending_signals,
+				dbus_message_ref (message));
+	else if (priv->snapshot)
+		daemon_apply_signal (self, message);
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+static void
+daemon_query_cb (NMConfigDaemonQuery * query, gint argc, gchar ** argv,
+		gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	NMConfigCommand * command;
+	WaitingQuery * waiting;
+	GError * err = NULL;
+
+	command = nm_config_command_parse (argc, argv, TRUE, &err);
+	if (!command) {
+		GString * message = g_string_new (err->message);
+
+		g_string_append_c (message, '\n');
+		nm_config_daemon_query_reply (query, 1, NULL, message);
+		g_string_free (message, TRUE);
+		g_error_free (err);
+		return;
 	}
-	else if (priv->user_settings)
-		g_print ("No user scope connections\n");
+
+	if (priv->snapshot && !priv->snapshot_stale) {
+		daemon_answer (self, query, command);
+		nm_config_command_free (command);
+		return;
+	}
+
+	waiting = g_new0 (WaitingQuery, 1);
+	waiting->query = query;
+	waiting->command = command;
+	priv->waiting_queries = g_slist_append (priv->waiting_queries, waiting);
+
+	daemon_refresh (self);
+}
+
+static void
+start_daemon (NMConfig * self)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	DBusConnection * connection;
+	GError * err = NULL;
+
+	priv->daemon = nm_config_daemon_new (priv->command->socket_path,
+			daemon_query_cb, self, &err);
+	if (!priv->daemon) {
+		g_printerr ("%s\n", err->message);
+		g_error_free (err);
+		emit_finished (self, 1);
+		return;
+	}
+
+	/* Follow every change NetworkManager announces */
+	connection = dbus_g_connection_get_connection (priv->bus);
+	dbus_bus_add_match (connection,
+			"type='signal',sender='" NM_DBUS_SERVICE "'", NULL);
+	dbus_connection_add_filter (connection, daemon_signal_filter, self, NULL);
+	priv->filter_added = TRUE;
+
+	daemon_refresh (self);
+}
+
+/* Watch mode */
+
+static void
+watch_failed_cb (GError * error, gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+
+	g_printerr ("Could not read NetworkManager state: %s\n", error->message);
+	emit_finished (self, 1);
+}
+
+/* top, until q is pressed */
+
+static void
+top_cb (GError * error, gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+
+	if (error) {
+		g_printerr ("Could not read NetworkManager state: %s\n", error->message);
+		emit_finished (self, 1);
+	}
+	else
+		emit_finished (self, 0);
+}
+
+/* sample, until nmconfig is interrupted */
+
+static void
+sample_failed_cb (GError * error, gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+
+	g_printerr ("%s\n", error->message);
+	emit_finished (self, 1);
+}
+
+/* scan, until it's quiet or the --timeout deadline */
+
+static void
+scan_cb (GError * error, gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	if (error) {
+		g_printerr ("%s\n", error->message);
+		emit_finished (self, g_error_matches (error, DBUS_GERROR, DBUS_GERROR_NO_REPLY) ?
+				NM_CONFIG_EXIT_TIMEOUT : 1);
+		return;
+	}
+
+	nm_config_scan_report (priv->scan);
+	emit_finished (self, 0);
+}
+
+/* wait-online, bounded by the --timeout deadline */
+
+static void
+wait_online_cb (gdouble waited, GError * error, gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	if (error) {
+		g_printerr ("Could not read NetworkManager state: %s\n", error->message);
+		emit_finished (self, 1);
+		return;
+	}
+
+	if (priv->command->device)
+		nm_config_print ("%s activated after %.3fs\n", priv->command->device, waited);
 	else
-		g_print ("User scope settings service is unavailable\n");
-	g_print("\n");
+		nm_config_print ("Connected after %.3fs\n", waited);
+	emit_finished (self, 0);
 }
 
 static gboolean
@@ -197,90 +954,473 @@ parse_command_line (gpointer user_data)
 {
 	NMConfig *self = NM_CONFIG (user_data);
 	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
-	GPtrArray * args = priv->args;
-
-	if (args->len == 0) {
-		show_nm_info (self);
-		list_devices (self);
-		list_connections (self);
-	}
-	else if (args->len == 1) {
-		NMDevice * device;
-		const char * ifname = g_ptr_array_index(args, 0);
-
-		device = get_device_by_ifname (self, ifname);
-		if (!device) {
-			g_printerr("NetworkManager dosn't know device: %s\n", ifname);
-			g_signal_emit(self, signals[FINISHED], 0, 1);
-			goto out;
+	GPtrArray * args = priv->command->args;
+
+	priv->parse_id = 0;
+	priv->parsed = TRUE;
+	nm_config_stats_phase_begin (NM_CONFIG_PHASE_COMMAND);
+
+	/* The deadline bounds one-shot listings and startup only */
+	if ((priv->command->daemon || priv->command->watch
+		 || priv->command->action == NM_CONFIG_ACTION_TOP
+		 || priv->command->action == NM_CONFIG_ACTION_SAMPLE) && priv->deadline_id) {
+		g_source_remove (priv->deadline_id);
+		priv->deadline_id = 0;
+	}
+
+	if (priv->command->daemon) {
+		start_daemon (self);
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+		return FALSE;
+	}
+
+	/* Runs until nmconfig is interrupted */
+	if (priv->command->watch) {
+		priv->watch = nm_config_watch_new (priv->bus, args, watch_failed_cb, self);
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+		return FALSE;
+	}
+
+	if (priv->command->action == NM_CONFIG_ACTION_TOP) {
+		GError * err = NULL;
+
+		priv->top = nm_config_top_new (priv->bus, args, &priv->command->print_options,
+				top_cb, self, &err);
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+		if (!priv->top) {
+			g_printerr ("%s\n", err->message);
+			g_error_free (err);
+			emit_finished (self, 1);
+		}
+		return FALSE;
+	}
+
+	if (priv->command->action == NM_CONFIG_ACTION_SAMPLE) {
+		GError * err = NULL;
+
+		priv->sample = nm_config_sample_new (priv->bus, g_ptr_array_index (args, 0),
+				priv->command->history_path, priv->command->slots,
+				priv->command->rate, sample_failed_cb, self, &err);
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+		if (!priv->sample) {
+			g_printerr ("%s\n", err->message);
+			g_error_free (err);
+			emit_finished (self, 1);
 		}
-		nm_config_device_show_full_info (device);
+		return FALSE;
 	}
 
+	if (priv->command->action == NM_CONFIG_ACTION_SCAN) {
+		priv->scan = nm_config_scan_new (priv->bus, g_ptr_array_index (args, 0),
+				priv->command->quiet * 1000, priv->command->timeout * 1000,
+				scan_cb, self);
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+		return FALSE;
+	}
 
+	if (priv->command->action == NM_CONFIG_ACTION_WAIT_ONLINE) {
+		priv->wait_online = nm_config_wait_online_new (priv->bus,
+				priv->command->device, wait_online_cb, self);
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+		return FALSE;
+	}
 
+	/* Runs as long as AddConnection calls are answered in time */
+	if (priv->command->action == NM_CONFIG_ACTION_IMPORT) {
+		GError * err = NULL;
 
-	g_signal_emit(self, signals[FINISHED], 0, 0);
+		if (priv->deadline_id) {
+			g_source_remove (priv->deadline_id);
+			priv->deadline_id = 0;
+		}
+
+		priv->import = nm_config_import_new (priv->bus,
+				g_ptr_array_index (args, 0), priv->command->window,
+				priv->command->timeout * 1000, transfer_cb, self, &err);
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+		if (!priv->import) {
+			g_printerr ("%s\n", err->message);
+			g_error_free (err);
+			emit_finished (self, 1);
+		}
+		return FALSE;
+	}
+
+	/* Started once the connections are read, see finish_listing() */
+	if (priv->command->action == NM_CONFIG_ACTION_UP
+		|| priv->command->action == NM_CONFIG_ACTION_DOWN
+		|| priv->command->action == NM_CONFIG_ACTION_EXPORT) {
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+		priv->devices_done = TRUE;
+		finish_listing (self);
+		return FALSE;
+	}
+
+	/* Saved together with the connections, see finish_listing() */
+	if (priv->command->dump_path) {
+		nm_config_snapshot_fetch (priv->bus, NULL, dump_snapshot_cb, self);
+		return FALSE;
+	}
+
+	/* Nothing to print before the connections are read */
+	if (!(nm_config_command_get_sources (priv->command) & NM_CONFIG_SOURCE_DEVICES)) {
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_COMMAND);
+		priv->output = nm_config_output_new (priv->command->output_format,
+				&priv->command->print_options);
+		priv->devices_done = TRUE;
+		finish_listing (self);
+		return FALSE;
+	}
+
+	/* Devices are printed as they are read, see device_ready_cb() */
+	if (args->len > 0)
+		priv->match = nm_config_iface_match_new (args);
+	priv->output = nm_config_output_new (priv->command->output_format,
+			&priv->command->print_options);
+	nm_config_snapshot_fetch_streaming (priv->bus, priv->match,
+			nm_config_fields_to_plan (&priv->command->print_options.fields),
+			device_ready_cb, snapshot_ready_cb, self);
 
-out:
-	priv->parse_id = 0;
 	return FALSE;
 }
 
 static void
-connections_read_cb (NMSettingsInterface * settings, gpointer user_data) {
+connections_read_cb (NMConfigSettings * settings, gpointer user_data) {
 	NMConfig *self = NM_CONFIG (user_data);
 	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
 
-	if (NM_IS_REMOTE_SETTINGS_SYSTEM (settings))
-		priv->system_connections =
-			nm_settings_interface_list_connections (settings);
+	if (!connections_ready (priv))
+		return;
+	nm_config_stats_phase_end (NM_CONFIG_PHASE_SETTINGS);
+
+	/* the daemon starts once all connections are read */
+	if (priv->command->daemon) {
+		if (!priv->parse_id && !priv->parsed)
+			priv->parse_id = g_idle_add (parse_command_line, self);
+	}
+	else
+		finish_listing (self);
+}
+
+/*
+ * Bootstrap. The bus daemon is asked in parallel whether NetworkManager
+ * and the user settings service are running; settings services are then
+ * contacted only for commands listing connections, and only the daemon
+ * waits for them before starting.
+ *
+ * The whole run is bounded by --timeout: every call NetworkManager or the
+ * bus daemon doesn't answer in time fails, and deadline_cb() prints what
+ * was read by then and exits with NM_CONFIG_EXIT_TIMEOUT.
+ */
+
+typedef struct {
+	NMConfig * self;
+	const char * name;
+	gboolean * running;
+	gdouble started;
+} NameProbe;
+
+static void
+start_sources (NMConfig * self)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	nm_config_stats_phase_end (NM_CONFIG_PHASE_BOOTSTRAP);
+
+	if (!priv->nm_running) {
+		if (!priv->exit_code) {
+			g_printerr("NetworkManager is not running\n");
+			priv->exit_code = 1;
+		}
+		emit_finished (self, priv->exit_code);
+		return;
+	}
+
+	if (!priv->command->daemon)
+		priv->parse_id = g_idle_add (parse_command_line, self);
+
+	if (!(nm_config_command_get_sources (priv->command) & NM_CONFIG_SOURCE_SETTINGS))
+		return;
 
-	if (NM_IS_REMOTE_SETTINGS (settings))
-		priv->user_connections =
-			nm_settings_interface_list_connections (settings);
+	nm_config_stats_phase_begin (NM_CONFIG_PHASE_SETTINGS);
+
+	/* get system scope settings service */
+	priv->system_settings = nm_config_settings_new (priv->bus,
+			NM_CONNECTION_SCOPE_SYSTEM, priv->command->timeout * 1000,
+			connections_read_cb, self);
+
+	/* get user scope settings service if it's running */
+	if (priv->user_settings_running)
+		priv->user_settings = nm_config_settings_new (priv->bus,
+				NM_CONNECTION_SCOPE_USER, priv->command->timeout * 1000,
+				connections_read_cb, self);
 
-	/* start parsing command line if all connections are read */
-	if ((!priv->system_settings || priv->system_connections) &&
-		(!priv->user_settings || priv->user_connections))
+	/* Start the daemon now if there are no connections to wait for */
+	if (priv->command->daemon && !priv->system_settings && !priv->user_settings)
 		priv->parse_id = g_idle_add (parse_command_line, self);
 }
 
+static void
+name_has_owner_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	NameProbe * probe = user_data;
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (probe->self);
+	gboolean has_owner = FALSE;
+	GError * err = NULL;
+
+	nm_config_stats_call (DBUS_INTERFACE_DBUS, "NameHasOwner", probe->started);
+
+	if (!dbus_g_proxy_end_call (proxy, call, &err,
+			G_TYPE_BOOLEAN, &has_owner,
+			G_TYPE_INVALID)) {
+		g_printerr ("Could not find out whether %s is running: %s\n",
+				probe->name, err->message);
+		if (g_error_matches (err, DBUS_GERROR, DBUS_GERROR_NO_REPLY))
+			priv->exit_code = NM_CONFIG_EXIT_TIMEOUT;
+		g_error_free (err);
+	}
+	*probe->running = has_owner;
+
+	if (--priv->probes_pending == 0 && !priv->finished)
+		start_sources (probe->self);
+}
+
+static void
+probe_name (NMConfig * self, const char * name, gboolean * running)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	NameProbe * probe = g_new0 (NameProbe, 1);
+
+	probe->self = self;
+	probe->name = name;
+	probe->running = running;
+	probe->started = nm_config_stats_now ();
+	priv->probes_pending++;
+
+	dbus_g_proxy_begin_call_with_timeout (priv->bus_proxy, "NameHasOwner",
+			name_has_owner_cb, probe, g_free, priv->command->timeout * 1000,
+			G_TYPE_STRING, name,
+			G_TYPE_INVALID);
+}
+
+static gboolean
+deadline_cb (gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	priv->deadline_id = 0;
+	priv->timed_out = TRUE;
+
+	if (priv->probes_pending) {
+		g_printerr ("Timed out waiting for the system bus\n");
+		emit_finished (self, NM_CONFIG_EXIT_TIMEOUT);
+		return FALSE;
+	}
+
+	if (priv->command->action == NM_CONFIG_ACTION_WAIT_ONLINE) {
+		if (priv->command->device)
+			g_printerr ("%s not activated after %ds\n", priv->command->device,
+					priv->command->timeout);
+		else
+			g_printerr ("Not connected after %ds\n", priv->command->timeout);
+		emit_finished (self, NM_CONFIG_EXIT_TIMEOUT);
+		return FALSE;
+	}
+
+	/* What was found so far is the result, nothing at all a timeout */
+	if (priv->command->action == NM_CONFIG_ACTION_SCAN) {
+		if (priv->scan && nm_config_scan_report (priv->scan))
+			emit_finished (self, 0);
+		else {
+			g_printerr ("Timed out scanning %s after %ds\n",
+					(char *) g_ptr_array_index (priv->command->args, 0),
+					priv->command->timeout);
+			emit_finished (self, NM_CONFIG_EXIT_TIMEOUT);
+		}
+		return FALSE;
+	}
+
+	if (priv->system_settings && !nm_config_settings_is_ready (priv->system_settings))
+		g_printerr ("Timed out reading system connections\n");
+	if (priv->user_settings && !nm_config_settings_is_ready (priv->user_settings))
+		g_printerr ("Timed out reading user connections\n");
+
+	if (priv->command->action == NM_CONFIG_ACTION_UP
+		|| priv->command->action == NM_CONFIG_ACTION_DOWN) {
+		if (priv->activate)
+			nm_config_activate_report_unfinished (priv->activate);
+		emit_finished (self, NM_CONFIG_EXIT_TIMEOUT);
+		return FALSE;
+	}
+
+	/* The daemon starts anyway, it asks for connections on every query */
+	if (priv->command->daemon) {
+		if (!priv->parse_id && !priv->parsed)
+			priv->parse_id = g_idle_add (parse_command_line, self);
+		return FALSE;
+	}
+
+	if (!priv->devices_done)
+		g_printerr ("Timed out reading devices from NetworkManager\n");
+
+	priv->exit_code = NM_CONFIG_EXIT_TIMEOUT;
+	priv->devices_done = TRUE;
+	finish_listing (self);
+
+	return FALSE;
+}
+
+/* --bus, every bus answers within --timeout or fails on its own */
+
+static void
+fleet_cb (guint failed, gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	if (failed)
+		g_printerr ("%u of %u buses failed\n", failed, priv->command->buses->len);
+
+	emit_finished (self, failed ? 1 : 0);
+}
+
+static void
+load_fleet (NMConfig * self)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	nm_config_stats_phase_end (NM_CONFIG_PHASE_BOOTSTRAP);
+	nm_config_snapshot_set_timeout (priv->command->timeout * 1000);
+
+	if (priv->command->args->len > 0)
+		priv->match = nm_config_iface_match_new (priv->command->args);
+
+	priv->fleet = nm_config_fleet_new (priv->command->buses, priv->match,
+			priv->command->output_format, &priv->command->print_options,
+			priv->command->window, priv->command->timeout * 1000, fleet_cb, self);
+}
+
+static gboolean
+bus_failed_cb (gpointer user_data)
+{
+	NMConfig *self = NM_CONFIG (user_data);
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+
+	priv->finish_id = 0;
+	emit_finished (self, 1);
+
+	return FALSE;
+}
+
+static void
+load_sources (NMConfig * self)
+{
+	NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
+	gint timeout_ms = priv->command->timeout * 1000;
+
+	/* The system bus isn't asked at all */
+	if (priv->command->buses) {
+		load_fleet (self);
+		return;
+	}
+
+	/* Not from the constructor: nobody listens to the signal yet */
+	if (!priv->bus) {
+		priv->finish_id = g_idle_add (bus_failed_cb, self);
+		return;
+	}
+
+	nm_config_snapshot_set_timeout (timeout_ms);
+	priv->deadline_id = g_timeout_add (timeout_ms, deadline_cb, self);
+
+	priv->bus_proxy = dbus_g_proxy_new_for_name (priv->bus,
+			DBUS_SERVICE_DBUS, DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS);
+
+	probe_name (self, NM_DBUS_SERVICE, &priv->nm_running);
+	if (nm_config_command_get_sources (priv->command) & NM_CONFIG_SOURCE_SETTINGS)
+		probe_name (self, NM_DBUS_SERVICE_USER_SETTINGS, &priv->user_settings_running);
+}
+
 NMConfig *
-nm_config_new (guint argc, gchar *argv[])
+nm_config_new (NMConfigCommand * command)
 {
 	NMConfig * nm_config;
 	NMConfigPrivate *priv;
-	GPtrArray * args;
-	int i;
-
-	g_assert (argv);
 
-	args = g_ptr_array_sized_new (argc-1);
-	for (i = 1; i < argc; i++) {
-		g_ptr_array_add(args, argv[i]);
-	}
+	g_return_val_if_fail (command != NULL, NULL);
 
+	/* Ends once the running services are known, see start_sources() */
+	nm_config_stats_phase_begin (NM_CONFIG_PHASE_BOOTSTRAP);
 	nm_config = (NMConfig *) g_object_new (NM_TYPE_CONFIG, NULL);
 
 	if (nm_config) {
 		priv = NM_CONFIG_GET_PRIVATE (nm_config);
-		priv->args = args;
+		priv->command = command;
+		load_sources (nm_config);
 	}
 
 	return nm_config;
 }
 
+gint
+nm_config_run_offline (NMConfigCommand * command)
+{
+	NMConfigSnapshotFile * file, * new_file = NULL;
+	GError * err = NULL;
+	gint exit_code = 0;
+
+	g_return_val_if_fail (nm_config_command_is_offline (command), 1);
+
+	if (command->action == NM_CONFIG_ACTION_HISTORY) {
+		nm_config_stats_phase_begin (NM_CONFIG_PHASE_RENDER);
+		if (!nm_config_history_report (g_ptr_array_index (command->args, 0),
+				command->last, &err)) {
+			g_printerr ("%s\n", err->message);
+			g_error_free (err);
+			exit_code = 1;
+		}
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_RENDER);
+		nm_config_command_free (command);
+		return exit_code;
+	}
+
+	file = nm_config_snapshot_file_load (command->show_path ?
+			command->show_path : command->diff_path, &err);
+	if (file && command->diff_path)
+		new_file = nm_config_snapshot_file_load (g_ptr_array_index (command->args, 0),
+				&err);
+
+	if (err) {
+		g_printerr ("%s\n", err->message);
+		g_error_free (err);
+		exit_code = 1;
+	}
+	else if (command->show_path)
+		exit_code = run_command (NULL, command, file->snapshot, file);
+	else {
+		nm_config_stats_phase_begin (NM_CONFIG_PHASE_RENDER);
+		nm_config_snapshot_file_diff (file, new_file);
+		nm_config_stats_phase_end (NM_CONFIG_PHASE_RENDER);
+	}
+
+	nm_config_snapshot_file_free (file);
+	nm_config_snapshot_file_free (new_file);
+	nm_config_command_free (command);
+
+	return exit_code;
+}
+
 static void
 nm_config_init (NMConfig *self)
 {
     NMConfigPrivate *priv = NM_CONFIG_GET_PRIVATE (self);
 
-    priv->devices = NULL;
     priv->system_settings = NULL;
     priv->user_settings = NULL;
-    priv->system_connections = NULL;
-    priv->user_connections = NULL;
+    priv->snapshot = NULL;
+    priv->daemon = NULL;
+    priv->watch = NULL;
 }
 
 static GObject *
@@ -290,8 +1430,6 @@ constructor (GType type,
 {
 	GObject *object;
 	NMConfigPrivate *priv;
-
-	gboolean is_nm_running, is_user_service_running;
 	GError * err = NULL;
 
 	object = G_OBJECT_CLASS (nm_config_parent_class)->constructor (type, n_construct_params, construct_params);
@@ -300,55 +1438,18 @@ constructor (GType type,
 
 	priv = NM_CONFIG_GET_PRIVATE (object);
 
-	priv->client = nm_client_new ();
-	is_nm_running = nm_client_get_manager_running (priv->client);
-
-	if (!is_nm_running) {
-		g_printerr("NetworkManager is not running\n");
-		g_signal_emit(object, signals[FINISHED], 0, 1);
-
-		return object;
-	}
-
+	/* Whether NetworkManager runs is found out in load_sources() */
 	priv->bus = dbus_g_bus_get (DBUS_BUS_SYSTEM, &err);
 	if (! priv->bus) {
 		g_warning ("Could not get the system bus.  Make sure "
 				   "the message bus daemon is running!  Message: %s",
 				   err->message);
 		g_error_free (err);
-		g_signal_emit(object, signals[FINISHED], 0, 1);
 
 		return object;
 	}
 
-	/* get system scope settings service */
-	priv->system_settings = nm_remote_settings_system_new (priv->bus);
-	g_signal_connect (priv->system_settings,
-			NM_SETTINGS_INTERFACE_CONNECTIONS_READ,
-			G_CALLBACK (connections_read_cb), object);
-
-	/* get user scope settings service if it's running */
-	priv->user_settings = nm_remote_settings_new (priv->bus,
-			NM_CONNECTION_SCOPE_USER);
-	g_object_get (priv->user_settings,
-			NM_REMOTE_SETTINGS_SERVICE_RUNNING, &is_user_service_running,
-			NULL);
-
-	if (is_user_service_running) {
-		g_signal_connect (priv->user_settings,
-				NM_SETTINGS_INTERFACE_CONNECTIONS_READ,
-				G_CALLBACK (connections_read_cb), object);
-	}
-	else  {
-		g_object_unref(priv->user_settings);
-		priv->user_settings = NULL;
-	}
-
-	/* Start parsing command line parameters if there is no
-	 * connections to wait for.
-	 */
-	if (!priv->system_settings && !priv->user_settings)
-		priv->parse_id = g_idle_add (parse_command_line, object);
+	nm_config_stats_watch_connection (dbus_g_connection_get_connection (priv->bus));
 
 	return object;
 }
@@ -361,17 +1462,109 @@ dispose (GObject *object)
 	if (priv->parse_id)
 		g_source_remove (priv->parse_id);
 
-	if (priv->client)
-		g_object_unref(priv->client);
+	if (priv->deadline_id) {
+		g_source_remove (priv->deadline_id);
+		priv->deadline_id = 0;
+	}
+
+	if (priv->finish_id) {
+		g_source_remove (priv->finish_id);
+		priv->finish_id = 0;
+	}
+
+	/* Pending probes are cancelled with the proxy */
+	if (priv->bus_proxy) {
+		g_object_unref (priv->bus_proxy);
+		priv->bus_proxy = NULL;
+	}
+
+	if (priv->refresh_id)
+		g_source_remove (priv->refresh_id);
+
+	if (priv->filter_added) {
+		dbus_connection_remove_filter (dbus_g_connection_get_connection (priv->bus),
+				daemon_signal_filter, object);
+		priv->filter_added = FALSE;
+	}
+
+	while (priv->waiting_queries) {
+		WaitingQuery * waiting = priv->waiting_queries->data;
+
+		priv->waiting_queries = g_slist_delete_link (priv->waiting_queries,
+				priv->waiting_queries);
+		nm_config_command_free (waiting->command);
+		g_free (waiting);
+	}
+
+	if (priv->watch) {
+		nm_config_watch_free (priv->watch);
+		priv->watch = NULL;
+	}
+
+	nm_config_wait_online_free (priv->wait_online);
+	priv->wait_online = NULL;
+
+	nm_config_activate_free (priv->activate);
+	priv->activate = NULL;
+
+	nm_config_export_free (priv->export);
+	priv->export = NULL;
+
+	nm_config_import_free (priv->import);
+	priv->import = NULL;
+
+	nm_config_top_free (priv->top);
+	priv->top = NULL;
 
-	if (priv->args)
-		g_ptr_array_free (priv->args, TRUE);
+	nm_config_sample_free (priv->sample);
+	priv->sample = NULL;
+
+	nm_config_fleet_free (priv->fleet);
+	priv->fleet = NULL;
+
+	nm_config_scan_free (priv->scan);
+	priv->scan = NULL;
+
+	if (priv->daemon) {
+		nm_config_daemon_free (priv->daemon);
+		priv->daemon = NULL;
+	}
+
+	g_slist_foreach (priv->pending_signals, (GFunc) dbus_message_unref, NULL);
+	g_slist_free (priv->pending_signals);
+	priv->pending_signals = NULL;
+
+	if (priv->snapshot) {
+		nm_config_snapshot_free (priv->snapshot);
+		priv->snapshot = NULL;
+	}
+
+	if (priv->output) {
+		nm_config_output_free (priv->output);
+		priv->output = NULL;
+	}
+
+	nm_config_iface_match_free (priv->match);
+	priv->match = NULL;
+
+	if (priv->entries) {
+		g_array_free (priv->entries, TRUE);
+		priv->entries = NULL;
+	}
+
+	nm_config_connections_free (priv->connections);
+	priv->connections = NULL;
+
+	if (priv->command) {
+		nm_config_command_free (priv->command);
+		priv->command = NULL;
+	}
 
-	if (priv->system_settings)
-			g_object_unref (priv->system_settings);
+	nm_config_settings_free (priv->system_settings);
+	priv->system_settings = NULL;
 
-	if (priv->user_settings)
-			g_object_unref (priv->user_settings);
+	nm_config_settings_free (priv->user_settings);
+	priv->user_settings = NULL;
 
 	if (priv->bus)
 		dbus_g_connection_unref(priv->bus);
@@ -24,6 +24,8 @@
 
 #include <glib-object.h>
 
+#include "NMConfigCommand.h"
+
 G_BEGIN_DECLS
 
 #define NM_TYPE_CONFIG            (nm_config_get_type ())
@@ -35,6 +37,11 @@ G_BEGIN_DECLS
 
 #define NM_CONFIG_FINISHED "finished"
 
+/* Exit code when NetworkManager or a settings service didn't answer
+ * within --timeout; whatever was read by then has been printed.
+ */
+#define NM_CONFIG_EXIT_TIMEOUT 2
+
 typedef struct {
 	GObject parent;
 } NMConfig;
@@ -48,7 +55,13 @@ typedef struct {
 
 GType nm_config_get_type (void);
 
-NMConfig *nm_config_new (guint argc, gchar* argv[]);
+/* Takes ownership of command */
+NMConfig *nm_config_new (NMConfigCommand * command);
+
+/* Runs a command nm_config_command_is_offline() accepts, without a main
+ * loop. Takes ownership of command and returns the exit code.
+ */
+gint nm_config_run_offline (NMConfigCommand * command);
 
 G_END_DECLS
 
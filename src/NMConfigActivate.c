@@ -0,0 +1,846 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#include <string.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <dbus/dbus-glib-lowlevel.h>
+#include <NetworkManager.h>
+
+#include "NMConfigActivate.h"
+#include "NMConfigConnections.h"
+#include "NMConfigDevicePrintHelper.h"
+#include "NMConfigPrint.h"
+#include "NMConfigSnapshot.h"
+
+typedef enum {
+	TARGET_QUEUED,    /* waiting for a slot in the window */
+	TARGET_REQUESTED, /* the call is in flight */
+	TARGET_WAITING,   /* accepted, waiting for the device's state */
+	TARGET_DONE,
+	TARGET_FAILED
+} TargetState;
+
+/* What picking a device or a connection needs of a connection's settings */
+typedef struct {
+	NMConfigConnectionEntry entry;
+	gchar * mac_address; /* the only device it may use, NULL for any */
+	GByteArray * ssid;   /* wireless connections */
+	guint64 timestamp;   /* last activation, 0 if never */
+} Candidate;
+
+typedef struct {
+	NMConfigActivate * activate;
+	gchar * label;    /* printed with every line about the target */
+	TargetState state;
+	gdouble started;
+	NMDeviceState device_state; /* last one seen */
+
+	/* a target names either, the other one is picked for "up" */
+	const NMConfigDeviceInfo * device;
+	const Candidate * connection;
+} Target;
+
+struct _NMConfigActivate {
+	DBusGConnection * bus;
+	gboolean up;
+	guint window;
+	gint timeout_ms;
+	GTimer * timer;
+
+	NMConfigConnections * connections;
+	GHashTable * candidates; /* NMConfigConnectionInfo -> Candidate */
+	GArray * candidate_entries;
+	NMConfigSnapshot * snapshot;
+
+	GPtrArray * names;       /* as given on the command line */
+	GPtrArray * targets;     /* Target, in command line order */
+	GHashTable * named;      /* device paths and uuids named by targets */
+	GHashTable * by_device;  /* device path -> Target in progress */
+	guint next;              /* first target not yet started */
+	guint in_progress;
+
+	DBusGProxy * manager;
+	GSList * proxies;
+	gboolean fetching;
+	gboolean filter_added;
+	guint done_id;
+	gint exit_code;
+
+	NMConfigActivateFunc callback;
+	gpointer user_data;
+};
+
+static void run_window (NMConfigActivate * activate);
+
+static void
+print_target (const Target * target, const char * format, ...) G_GNUC_PRINTF (2, 3);
+
+static void
+print_target (const Target * target, const char * format, ...)
+{
+	gchar * text;
+	va_list args;
+
+	va_start (args, format);
+	text = g_strdup_vprintf (format, args);
+	va_end (args);
+
+	nm_config_print ("%s: %s\n", target->label, text);
+	nm_config_print_flush ();
+	g_free (text);
+}
+
+static Target *
+target_new (NMConfigActivate * activate, const char * label)
+{
+	Target * target = g_new0 (Target, 1);
+
+	target->activate = activate;
+	target->label = g_strdup (label);
+	target->state = TARGET_QUEUED;
+	g_ptr_array_add (activate->targets, target);
+
+	return target;
+}
+
+/* Connection targets get their device when they are resolved */
+static void
+target_set_device (Target * target, const NMConfigDeviceInfo * device)
+{
+	gchar * label;
+
+	target->device = device;
+	target->device_state = device->state;
+
+	if (target->connection) {
+		label = g_strdup_printf ("%s (%s)", target->label, device->iface);
+		g_free (target->label);
+		target->label = label;
+	}
+}
+
+static void
+target_free (Target * target)
+{
+	g_free (target->label);
+	g_free (target);
+}
+
+static void
+candidate_free (Candidate * candidate)
+{
+	g_free (candidate->mac_address);
+	if (candidate->ssid)
+		g_byte_array_free (candidate->ssid, TRUE);
+	g_free (candidate);
+}
+
+/* Device and connection types which go together */
+
+static const struct {
+	NMDeviceType device_type;
+	const char * connection_type;
+} compatible_types[] = {
+	{ NM_DEVICE_TYPE_ETHERNET, "802-3-ethernet" },
+	{ NM_DEVICE_TYPE_ETHERNET, "pppoe" },
+	{ NM_DEVICE_TYPE_WIFI, "802-11-wireless" },
+	{ NM_DEVICE_TYPE_GSM, "gsm" },
+	{ NM_DEVICE_TYPE_CDMA, "cdma" },
+	{ NM_DEVICE_TYPE_BT, "bluetooth" },
+	{ NM_DEVICE_TYPE_UNKNOWN, NULL }
+};
+
+static gboolean
+types_compatible (NMDeviceType device_type, const char * connection_type)
+{
+	int i;
+
+	for (i = 0; compatible_types[i].connection_type; i++) {
+		if (compatible_types[i].device_type == device_type
+			&& !g_strcmp0 (compatible_types[i].connection_type, connection_type))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+device_sees_ssid (const NMConfigDeviceInfo * device, const GByteArray * ssid)
+{
+	int i;
+
+	for (i = 0; device->aps && i < device->aps->len; i++) {
+		const NMConfigAPInfo * ap = g_ptr_array_index (device->aps, i);
+
+		if (ap->ssid->len == ssid->len && !memcmp (ap->ssid->data, ssid->data, ssid->len))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Whether connection may be activated on device, as NetworkManager
+ * would decide from the connection's type, its hardware address and,
+ * for wifi, the access points in range.
+ */
+static gboolean
+fits (const NMConfigDeviceInfo * device, const Candidate * connection)
+{
+	if (!device->managed || device->state <= NM_DEVICE_STATE_UNAVAILABLE)
+		return FALSE;
+
+	if (!types_compatible (device->type, connection->entry.info->type))
+		return FALSE;
+
+	if (connection->mac_address
+		&& (!device->hw_address
+			|| g_ascii_strcasecmp (connection->mac_address, device->hw_address)))
+		return FALSE;
+
+	if (device->type == NM_DEVICE_TYPE_WIFI
+		&& (!connection->ssid || !device_sees_ssid (device, connection->ssid)))
+		return FALSE;
+
+	return TRUE;
+}
+
+static gboolean
+is_disconnected (NMDeviceState state)
+{
+	return state == NM_DEVICE_STATE_DISCONNECTED || state == NM_DEVICE_STATE_UNAVAILABLE
+		|| state == NM_DEVICE_STATE_UNMANAGED || state == NM_DEVICE_STATE_FAILED;
+}
+
+/* Finishing */
+
+static gboolean
+done_cb (gpointer user_data)
+{
+	NMConfigActivate * activate = user_data;
+
+	activate->done_id = 0;
+
+	/* The callback may free the activation */
+	activate->callback (activate->exit_code, activate->user_data);
+
+	return FALSE;
+}
+
+/* Not from the signal filter or a reply: the callback may free everything */
+static void
+finish (NMConfigActivate * activate, gint exit_code)
+{
+	if (activate->done_id)
+		return;
+
+	activate->exit_code = exit_code;
+	activate->done_id = g_idle_add (done_cb, activate);
+}
+
+static void
+target_finish (Target * target, TargetState state, const char * reason)
+{
+	NMConfigActivate * activate = target->activate;
+	gboolean in_progress = target->state == TARGET_REQUESTED
+		|| target->state == TARGET_WAITING;
+
+	if (target->state == TARGET_DONE || target->state == TARGET_FAILED)
+		return;
+
+	target->state = state;
+	if (state == TARGET_FAILED) {
+		print_target (target, "failed: %s", reason);
+		activate->exit_code = 1;
+	}
+	else if (in_progress)
+		print_target (target, "%s after %.3fs", reason,
+				g_timer_elapsed (activate->timer, NULL) - target->started);
+	else
+		print_target (target, "%s", reason);
+
+	if (in_progress) {
+		if (target->device)
+			g_hash_table_remove (activate->by_device, target->device->path);
+		activate->in_progress--;
+		run_window (activate);
+	}
+}
+
+/* Device state, from StateChanged signals */
+
+static void
+target_device_state (Target * target, NMDeviceState state)
+{
+	target->device_state = state;
+	print_target (target, "%s", nm_config_device_state_to_string (state));
+
+	if (target->activate->up) {
+		if (state == NM_DEVICE_STATE_ACTIVATED)
+			target_finish (target, TARGET_DONE, "connected");
+		else if (state == NM_DEVICE_STATE_FAILED)
+			target_finish (target, TARGET_FAILED,
+					nm_config_device_state_to_string (state));
+	}
+	else if (is_disconnected (state))
+		target_finish (target, TARGET_DONE, "disconnected");
+}
+
+static void
+handle_signal (NMConfigActivate * activate, DBusMessage * message)
+{
+	const char * path = dbus_message_get_path (message);
+	dbus_uint32_t state;
+	Target * target;
+
+	if (!path || !dbus_message_is_signal (message, NM_DBUS_INTERFACE_DEVICE, "StateChanged"))
+		return;
+
+	target = g_hash_table_lookup (activate->by_device, path);
+	if (target && dbus_message_get_args (message, NULL,
+			DBUS_TYPE_UINT32, &state, DBUS_TYPE_INVALID))
+		target_device_state (target, state);
+}
+
+static DBusHandlerResult
+signal_filter (DBusConnection * connection, DBusMessage * message,
+		void * user_data)
+{
+	NMConfigActivate * activate = user_data;
+
+	if (dbus_message_get_type (message) != DBUS_MESSAGE_TYPE_SIGNAL)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	/* Only the targets' devices matter, and none is known while fetching */
+	if (!activate->fetching)
+		handle_signal (activate, message);
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+/* Requests */
+
+static void
+request_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	Target * target = user_data;
+	GError * err = NULL;
+	gchar * active_path = NULL;
+	gboolean ok;
+
+	if (target->activate->up)
+		ok = dbus_g_proxy_end_call (proxy, call, &err,
+				DBUS_TYPE_G_OBJECT_PATH, &active_path,
+				G_TYPE_INVALID);
+	else
+		ok = dbus_g_proxy_end_call (proxy, call, &err, G_TYPE_INVALID);
+	g_free (active_path);
+
+	if (!ok) {
+		target_finish (target, TARGET_FAILED, err->message);
+		g_error_free (err);
+	}
+	else if (target->state == TARGET_REQUESTED)
+		target->state = TARGET_WAITING;
+}
+
+static void
+start_target (Target * target)
+{
+	NMConfigActivate * activate = target->activate;
+	const NMConfigConnectionEntry * entry;
+	DBusGProxy * proxy;
+
+	target->state = TARGET_REQUESTED;
+	target->started = g_timer_elapsed (activate->timer, NULL);
+	activate->in_progress++;
+	g_hash_table_insert (activate->by_device, target->device->path, target);
+
+	if (activate->up) {
+		entry = &target->connection->entry;
+		print_target (target, "activating %s", entry->info->id);
+		dbus_g_proxy_begin_call_with_timeout (activate->manager,
+				"ActivateConnection", request_cb, target, NULL, activate->timeout_ms,
+				G_TYPE_STRING, entry->scope == NM_CONNECTION_SCOPE_USER ?
+					NM_DBUS_SERVICE_USER_SETTINGS : NM_DBUS_SERVICE_SYSTEM_SETTINGS,
+				DBUS_TYPE_G_OBJECT_PATH, entry->info->path,
+				DBUS_TYPE_G_OBJECT_PATH, target->device->path,
+				DBUS_TYPE_G_OBJECT_PATH, "/",
+				G_TYPE_INVALID);
+	}
+	else {
+		print_target (target, "disconnecting");
+		proxy = dbus_g_proxy_new_for_name (activate->bus, NM_DBUS_SERVICE,
+				target->device->path, NM_DBUS_INTERFACE_DEVICE);
+		activate->proxies = g_slist_prepend (activate->proxies, proxy);
+		dbus_g_proxy_begin_call_with_timeout (proxy, "Disconnect", request_cb,
+				target, NULL, activate->timeout_ms, G_TYPE_INVALID);
+	}
+}
+
+/* Start queued targets while there is room in the window */
+static void
+run_window (NMConfigActivate * activate)
+{
+	GPtrArray * targets = activate->targets;
+
+	while (activate->in_progress < activate->window && activate->next < targets->len) {
+		Target * target = g_ptr_array_index (targets, activate->next++);
+
+		if (target->state == TARGET_QUEUED)
+			start_target (target);
+	}
+
+	if (activate->in_progress == 0 && activate->next == targets->len)
+		finish (activate, activate->exit_code);
+}
+
+/* Resolving the targets */
+
+static const NMConfigDeviceInfo *
+device_of_connection (const NMConfigActivate * activate, const char * uuid)
+{
+	GPtrArray * devices = activate->snapshot->devices;
+	int i;
+
+	/* Devices without an active connection have no uuid either */
+	if (!uuid)
+		return NULL;
+
+	for (i = 0; i < devices->len; i++) {
+		const NMConfigDeviceInfo * device = g_ptr_array_index (devices, i);
+
+		if (!g_strcmp0 (device->connection_uuid, uuid))
+			return device;
+	}
+
+	return NULL;
+}
+
+/* The connection NetworkManager would pick itself: the most recently
+ * used one which fits.
+ */
+static const Candidate *
+pick_connection (NMConfigActivate * activate, const NMConfigDeviceInfo * device)
+{
+	const Candidate * best = NULL;
+	int i;
+
+	for (i = 0; i < activate->candidate_entries->len; i++) {
+		const NMConfigConnectionEntry * entry = &g_array_index (activate->candidate_entries,
+				NMConfigConnectionEntry, i);
+		const Candidate * candidate = g_hash_table_lookup (activate->candidates, entry->info);
+
+		if (fits (device, candidate) && (!best || candidate->timestamp > best->timestamp))
+			best = candidate;
+	}
+
+	return best;
+}
+
+/* A device no other target uses, preferably an idle one */
+static const NMConfigDeviceInfo *
+pick_device (NMConfigActivate * activate, const Candidate * connection,
+		GHashTable * claimed)
+{
+	GPtrArray * devices = activate->snapshot->devices;
+	const NMConfigDeviceInfo * best = NULL;
+	int i;
+
+	for (i = 0; i < devices->len; i++) {
+		const NMConfigDeviceInfo * device = g_ptr_array_index (devices, i);
+
+		if (g_hash_table_lookup (claimed, device) || !fits (device, connection))
+			continue;
+
+		if (!best || (is_disconnected (device->state) && !is_disconnected (best->state)))
+			best = device;
+	}
+
+	return best;
+}
+
+/* Device targets are given a connection first, so connection targets
+ * don't take their devices.
+ */
+static void
+resolve_up (NMConfigActivate * activate)
+{
+	GHashTable * claimed = g_hash_table_new (g_direct_hash, g_direct_equal);
+	int i;
+
+	for (i = 0; i < activate->targets->len; i++) {
+		Target * target = g_ptr_array_index (activate->targets, i);
+
+		if (target->state != TARGET_QUEUED || !target->device)
+			continue;
+
+		g_hash_table_insert (claimed, (gpointer) target->device, target);
+		if (target->device->state == NM_DEVICE_STATE_ACTIVATED)
+			target_finish (target, TARGET_DONE, "already connected");
+		else if (!(target->connection = pick_connection (activate, target->device)))
+			target_finish (target, TARGET_FAILED, "no connection fits the device");
+	}
+
+	for (i = 0; i < activate->targets->len; i++) {
+		Target * target = g_ptr_array_index (activate->targets, i);
+		const NMConfigDeviceInfo * device;
+
+		if (target->state != TARGET_QUEUED || target->device)
+			continue;
+
+		device = device_of_connection (activate, target->connection->entry.info->uuid);
+		if (device && device->state == NM_DEVICE_STATE_ACTIVATED) {
+			target_finish (target, TARGET_DONE, "already active");
+			continue;
+		}
+
+		device = pick_device (activate, target->connection, claimed);
+		if (!device) {
+			target_finish (target, TARGET_FAILED, "no available device fits the connection");
+			continue;
+		}
+
+		target_set_device (target, device);
+
+		g_hash_table_insert (claimed, (gpointer) target->device, target);
+	}
+
+	g_hash_table_destroy (claimed);
+}
+
+static void
+resolve_down (NMConfigActivate * activate)
+{
+	GHashTable * claimed = g_hash_table_new (g_direct_hash, g_direct_equal);
+	const NMConfigDeviceInfo * device;
+	Target * other;
+	int i;
+
+	for (i = 0; i < activate->targets->len; i++) {
+		Target * target = g_ptr_array_index (activate->targets, i);
+
+		if (target->state != TARGET_QUEUED)
+			continue;
+
+		if (!target->device) {
+			device = device_of_connection (activate, target->connection->entry.info->uuid);
+			if (!device) {
+				target_finish (target, TARGET_DONE, "not active");
+				continue;
+			}
+			target_set_device (target, device);
+		}
+
+		/* A device and its connection may both be given */
+		other = g_hash_table_lookup (claimed, target->device);
+		if (other)
+			target_finish (target, TARGET_DONE, "skipped, same device as above");
+		else if (is_disconnected (target->device->state))
+			target_finish (target, TARGET_DONE, "already disconnected");
+		else
+			g_hash_table_insert (claimed, (gpointer) target->device, target);
+	}
+
+	g_hash_table_destroy (claimed);
+}
+
+static Candidate *
+add_candidate (NMConfigActivate * activate, const NMConfigConnectionEntry * entry)
+{
+	Candidate * candidate = g_hash_table_lookup (activate->candidates, entry->info);
+
+	if (!candidate) {
+		candidate = g_new0 (Candidate, 1);
+		candidate->entry = *entry;
+		g_hash_table_insert (activate->candidates, (gpointer) entry->info, candidate);
+		g_array_append_val (activate->candidate_entries, *entry);
+	}
+
+	return candidate;
+}
+
+static void
+add_connection_target (NMConfigActivate * activate, const NMConfigConnectionEntry * entry)
+{
+	Target * target;
+
+	/* It couldn't be told apart from others, nor activated */
+	if (!entry->info->uuid) {
+		target = target_new (activate, entry->info->id);
+		target_finish (target, TARGET_FAILED, "connection has no uuid");
+		return;
+	}
+
+	if (g_hash_table_lookup (activate->named, entry->info->uuid))
+		return;
+	g_hash_table_insert (activate->named, entry->info->uuid, (gpointer) entry);
+
+	target = target_new (activate, entry->info->id);
+	target->connection = add_candidate (activate, entry);
+}
+
+/* Interface names first, then uuids, then id patterns. Targets named
+ * more than once are run once.
+ */
+static void
+add_target (NMConfigActivate * activate, const char * name)
+{
+	const NMConfigDeviceInfo * device;
+	const NMConfigConnectionEntry * entry;
+	NMConfigConnectionFilter filter = { NULL, NULL, NULL };
+	GArray * entries;
+	Target * target;
+	int i, j;
+
+	device = nm_config_snapshot_lookup_iface (activate->snapshot, name, NULL);
+	if (device) {
+		if (g_hash_table_lookup (activate->named, device->path))
+			return;
+		g_hash_table_insert (activate->named, device->path, (gpointer) device);
+
+		target = target_new (activate, name);
+		target_set_device (target, device);
+		if (!activate->up)
+			return;
+
+		/* Any connection of the device's type may be picked */
+		for (i = 0; compatible_types[i].connection_type; i++) {
+			if (compatible_types[i].device_type != device->type)
+				continue;
+
+			filter.type = compatible_types[i].connection_type;
+			entries = nm_config_connections_query (activate->connections, &filter);
+			for (j = 0; j < entries->len; j++)
+				add_candidate (activate, &g_array_index (entries, NMConfigConnectionEntry, j));
+			g_array_free (entries, TRUE);
+		}
+		return;
+	}
+
+	entry = nm_config_connections_lookup_uuid (activate->connections, name);
+	if (entry) {
+		add_connection_target (activate, entry);
+		return;
+	}
+
+	filter.id = name;
+	entries = nm_config_connections_query (activate->connections, &filter);
+	for (i = 0; i < entries->len; i++)
+		add_connection_target (activate, &g_array_index (entries, NMConfigConnectionEntry, i));
+
+	if (entries->len == 0) {
+		target = target_new (activate, name);
+		target_finish (target, TARGET_FAILED, "no such device or connection");
+	}
+	g_array_free (entries, TRUE);
+}
+
+static void
+read_candidate (Candidate * candidate, GHashTable * groups)
+{
+	GHashTable * setting;
+	const GValue * value;
+	const char * type = candidate->entry.info->type;
+	GArray * bytes;
+
+	setting = g_hash_table_lookup (groups, "connection");
+	value = setting ? g_hash_table_lookup (setting, "timestamp") : NULL;
+	if (value && G_VALUE_HOLDS (value, G_TYPE_UINT64))
+		candidate->timestamp = g_value_get_uint64 (value);
+
+	/* The hardware address is kept with the device type's setting */
+	setting = type ? g_hash_table_lookup (groups, type) : NULL;
+	if (!setting)
+		return;
+
+	value = g_hash_table_lookup (setting, "mac-address");
+	if (value && G_VALUE_HOLDS (value, DBUS_TYPE_G_UCHAR_ARRAY)) {
+		bytes = g_value_get_boxed (value);
+		if (bytes && bytes->len == 6)
+			candidate->mac_address = g_strdup_printf ("%02X:%02X:%02X:%02X:%02X:%02X",
+					bytes->data[0] & 0xff, bytes->data[1] & 0xff, bytes->data[2] & 0xff,
+					bytes->data[3] & 0xff, bytes->data[4] & 0xff, bytes->data[5] & 0xff);
+	}
+
+	value = g_hash_table_lookup (setting, "ssid");
+	if (value && G_VALUE_HOLDS (value, DBUS_TYPE_G_UCHAR_ARRAY)) {
+		bytes = g_value_get_boxed (value);
+		candidate->ssid = g_byte_array_sized_new (bytes->len);
+		g_byte_array_append (candidate->ssid, (const guint8 *) bytes->data, bytes->len);
+	}
+}
+
+static void
+details_cb (const GPtrArray * details, gpointer user_data)
+{
+	NMConfigActivate * activate = user_data;
+	int i;
+
+	for (i = 0; i < details->len; i++) {
+		const NMConfigConnectionEntry * entry = &g_array_index (activate->candidate_entries,
+				NMConfigConnectionEntry, i);
+		GHashTable * groups = g_ptr_array_index (details, i);
+
+		if (groups)
+			read_candidate (g_hash_table_lookup (activate->candidates, entry->info), groups);
+	}
+
+	resolve_up (activate);
+	run_window (activate);
+}
+
+static void
+snapshot_ready_cb (NMConfigSnapshot * snapshot, GError * error,
+		gpointer user_data)
+{
+	NMConfigActivate * activate = user_data;
+	int i;
+
+	activate->fetching = FALSE;
+
+	if (!snapshot) {
+		g_printerr ("Could not read NetworkManager state: %s\n", error->message);
+		finish (activate, 1);
+		return;
+	}
+	activate->snapshot = snapshot;
+
+	for (i = 0; i < activate->names->len; i++)
+		add_target (activate, g_ptr_array_index (activate->names, i));
+
+	if (!activate->up) {
+		resolve_down (activate);
+		run_window (activate);
+		return;
+	}
+
+	/* Devices and connections are picked from the connections' settings */
+	nm_config_connections_fetch_details (activate->bus, activate->candidate_entries,
+			activate->window, activate->timeout_ms, details_cb, activate);
+}
+
+NMConfigActivate *
+nm_config_activate_new (DBusGConnection * bus, gboolean up,
+		const GPtrArray * targets, guint window,
+		const GPtrArray * system_connections, const GPtrArray * user_connections,
+		gint timeout_ms, NMConfigActivateFunc callback, gpointer user_data)
+{
+	NMConfigActivate * activate;
+	DBusConnection * connection;
+	int i;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (targets != NULL, NULL);
+	g_return_val_if_fail (window > 0, NULL);
+	g_return_val_if_fail (callback != NULL, NULL);
+
+	activate = g_new0 (NMConfigActivate, 1);
+	activate->bus = bus;
+	activate->up = up;
+	activate->window = window;
+	activate->timeout_ms = timeout_ms;
+	activate->timer = g_timer_new ();
+	activate->callback = callback;
+	activate->user_data = user_data;
+
+	activate->names = g_ptr_array_sized_new (targets->len);
+	for (i = 0; i < targets->len; i++)
+		g_ptr_array_add (activate->names, g_strdup (g_ptr_array_index (targets, i)));
+	activate->targets = g_ptr_array_new ();
+	activate->by_device = g_hash_table_new (g_str_hash, g_str_equal);
+	activate->named = g_hash_table_new (g_str_hash, g_str_equal);
+
+	activate->connections = nm_config_connections_new (system_connections,
+			user_connections);
+	activate->candidates = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+			NULL, (GDestroyNotify) candidate_free);
+	activate->candidate_entries = g_array_new (FALSE, FALSE,
+			sizeof (NMConfigConnectionEntry));
+
+	activate->manager = dbus_g_proxy_new_for_name (bus, NM_DBUS_SERVICE,
+			NM_DBUS_PATH, NM_DBUS_INTERFACE);
+
+	/* Subscribe before anything is requested, so no state is missed */
+	connection = dbus_g_connection_get_connection (bus);
+	dbus_bus_add_match (connection,
+			"type='signal',sender='" NM_DBUS_SERVICE "',"
+			"interface='" NM_DBUS_INTERFACE_DEVICE "',member='StateChanged'", NULL);
+	dbus_connection_add_filter (connection, signal_filter, activate, NULL);
+	activate->filter_added = TRUE;
+
+	activate->fetching = TRUE;
+	nm_config_snapshot_fetch (bus, NULL, snapshot_ready_cb, activate);
+
+	return activate;
+}
+
+void
+nm_config_activate_report_unfinished (const NMConfigActivate * activate)
+{
+	int i;
+
+	g_return_if_fail (activate != NULL);
+
+	for (i = 0; i < activate->targets->len; i++) {
+		const Target * target = g_ptr_array_index (activate->targets, i);
+
+		if (target->state == TARGET_QUEUED)
+			g_printerr ("%s: not started\n", target->label);
+		else if (target->state == TARGET_REQUESTED || target->state == TARGET_WAITING)
+			g_printerr ("%s: unfinished, %s\n", target->label,
+					nm_config_device_state_to_string (target->device_state));
+	}
+}
+
+void
+nm_config_activate_free (NMConfigActivate * activate)
+{
+	if (!activate)
+		return;
+
+	if (activate->done_id)
+		g_source_remove (activate->done_id);
+
+	if (activate->filter_added)
+		dbus_connection_remove_filter (dbus_g_connection_get_connection (activate->bus),
+				signal_filter, activate);
+
+	/* Calls still in flight are cancelled with their proxies */
+	g_object_unref (activate->manager);
+	g_slist_foreach (activate->proxies, (GFunc) g_object_unref, NULL);
+	g_slist_free (activate->proxies);
+
+	g_ptr_array_foreach (activate->targets, (GFunc) target_free, NULL);
+	g_ptr_array_free (activate->targets, TRUE);
+	g_ptr_array_foreach (activate->names, (GFunc) g_free, NULL);
+	g_ptr_array_free (activate->names, TRUE);
+	g_hash_table_destroy (activate->by_device);
+	g_hash_table_destroy (activate->named);
+
+	g_hash_table_destroy (activate->candidates);
+	g_array_free (activate->candidate_entries, TRUE);
+	nm_config_connections_free (activate->connections);
+	nm_config_snapshot_free (activate->snapshot);
+	g_timer_destroy (activate->timer);
+	g_free (activate);
+}
@@ -0,0 +1,64 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_ACTIVATE_H
+#define NM_CONFIG_ACTIVATE_H
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+
+/*
+ * `nmconfig up|down TARGET...`: activates or deactivates devices and
+ * connections. A target is an interface name, a connection uuid or a
+ * connection id pattern, which may name several connections.
+ *
+ * Targets are resolved against one snapshot and one read of the
+ * connections' settings, then at most window of them are in progress at
+ * a time. Each goes through queued, requested and waiting for the
+ * device's state, which is followed from NetworkManager's StateChanged
+ * signals, to done or failed.
+ */
+
+typedef struct _NMConfigActivate NMConfigActivate;
+
+/* Called from the main loop once every target is done or failed; exit
+ * code is 0 if all of them are done. The activation may be freed from
+ * the callback.
+ */
+typedef void (*NMConfigActivateFunc) (gint exit_code, gpointer user_data);
+
+/* targets are the names given on the command line. The connections are
+ * NMConfigConnectionInfo of each settings service, either may be NULL;
+ * they must stay valid as long as the activation runs. Calls not
+ * answered within timeout_ms fail.
+ */
+NMConfigActivate * nm_config_activate_new (DBusGConnection * bus, gboolean up,
+		const GPtrArray * targets, guint window,
+		const GPtrArray * system_connections, const GPtrArray * user_connections,
+		gint timeout_ms, NMConfigActivateFunc callback, gpointer user_data);
+
+/* Print the targets which haven't finished, e.g. at a deadline */
+void nm_config_activate_report_unfinished (const NMConfigActivate * activate);
+
+void nm_config_activate_free (NMConfigActivate * activate);
+
+#endif /* NM_CONFIG_ACTIVATE_H */
@@ -0,0 +1,548 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#include <string.h>
+#include <glib.h>
+
+#include "NMConfigCommand.h"
+#include "NMConfigDaemon.h"
+#include "NMConfigHistory.h"
+
+static const struct {
+	const char * name;
+	NMConfigAction action;
+} actions[] = {
+	{ "wait-online", NM_CONFIG_ACTION_WAIT_ONLINE },
+	{ "up", NM_CONFIG_ACTION_UP },
+	{ "down", NM_CONFIG_ACTION_DOWN },
+	{ "export", NM_CONFIG_ACTION_EXPORT },
+	{ "import", NM_CONFIG_ACTION_IMPORT },
+	{ "top", NM_CONFIG_ACTION_TOP },
+	{ "sample", NM_CONFIG_ACTION_SAMPLE },
+	{ "history", NM_CONFIG_ACTION_HISTORY },
+	{ "scan", NM_CONFIG_ACTION_SCAN },
+	{ NULL }
+};
+
+#define ACTIONS_SUMMARY \
+	"Commands:\n" \
+	"  wait-online    Wait until NetworkManager is connected, or the device\n" \
+	"                 given with --device is activated, at most --timeout seconds\n" \
+	"  up TARGET...   Activate devices and connections, given by interface name,\n" \
+	"                 uuid or name pattern, --window at a time\n" \
+	"  down TARGET... Disconnect devices, or the devices of active connections\n" \
+	"  export         Write all settings of every connection, to --out or the\n" \
+	"                 standard output, in nmconfig's key file format or the\n" \
+	"                 --output format\n" \
+	"  import FILE    Add the connections of a file written by export to\n" \
+	"                 the system settings, --window at a time\n" \
+	"  top [INTERFACE...]\n" \
+	"                 Full screen view of the devices and their strongest\n" \
+	"                 access points, updated as they change; q quits\n" \
+	"  sample INTERFACE\n" \
+	"                 Record the signal of every access point INTERFACE sees\n" \
+	"                 into the --history file, on each change and --rate times\n" \
+	"                 a second\n" \
+	"  history FILE   Print signal statistics per access point from a history\n" \
+	"                 written by sample, of the --last seconds\n" \
+	"  scan INTERFACE Request a scan and print access points as they're found,\n" \
+	"                 until none was for --quiet seconds, at most --timeout"
+
+const char *
+nm_config_action_to_string (NMConfigAction action)
+{
+	int i;
+
+	for (i = 0; actions[i].name; i++) {
+		if (actions[i].action == action)
+			return actions[i].name;
+	}
+
+	return "show";
+}
+
+static NMConfigAction
+action_from_string (const char * name)
+{
+	int i;
+
+	for (i = 0; actions[i].name; i++) {
+		if (!strcmp (actions[i].name, name))
+			return actions[i].action;
+	}
+
+	return NM_CONFIG_ACTION_SHOW;
+}
+
+/* One address per line, # starts a comment */
+static gboolean
+read_bus_list (const char * path, GPtrArray * buses, GError ** error)
+{
+	gchar * contents;
+	gchar ** lines;
+	int i;
+
+	if (!g_file_get_contents (path, &contents, NULL, error))
+		return FALSE;
+
+	lines = g_strsplit (contents, "\n", -1);
+	for (i = 0; lines[i]; i++) {
+		gchar * line = g_strstrip (lines[i]);
+
+		if (*line && *line != '#')
+			g_ptr_array_add (buses, g_strdup (line));
+	}
+
+	g_strfreev (lines);
+	g_free (contents);
+
+	return TRUE;
+}
+
+static void
+free_buses (GPtrArray * buses)
+{
+	if (!buses)
+		return;
+
+	g_ptr_array_foreach (buses, (GFunc) g_free, NULL);
+	g_ptr_array_free (buses, TRUE);
+}
+
+NMConfigCommand *
+nm_config_command_parse (gint argc, gchar ** argv, gboolean remote,
+		GError ** error)
+{
+	NMConfigCommand * command;
+	GOptionContext * context;
+	gchar ** args;
+	gint max_aps = 0;
+	gint timeout = NM_CONFIG_DEFAULT_TIMEOUT;
+	gboolean daemon = FALSE, no_daemon = FALSE, watch = FALSE, stats = FALSE;
+	gchar * socket_path = NULL;
+	gchar * dump_path = NULL, * show_path = NULL, * diff_path = NULL;
+	gboolean connections = FALSE, details = FALSE;
+	gchar * connection_id = NULL, * connection_uuid = NULL, * connection_type = NULL;
+	gchar * device = NULL;
+	gint window = -1;
+	gchar ** bus = NULL;
+	gchar * bus_list_path = NULL;
+	GPtrArray * buses = NULL;
+	gchar * fields = NULL;
+	gchar * out_path = NULL;
+	gchar * history_path = NULL;
+	gdouble rate = 0;
+	gint slots = 0, last = 0;
+	gint quiet = 0;
+	NMConfigAction action = NM_CONFIG_ACTION_SHOW;
+	gint first_arg = 1;
+	gchar * output = NULL;
+	NMConfigOutputFormat output_format = NM_CONFIG_OUTPUT_TEXT;
+	NMConfigFields print_fields = { { 0 }, 0, 0 };
+	GError * err = NULL;
+	int i;
+
+	GOptionEntry entries[] = {
+		{ "max-aps", 0, 0, G_OPTION_ARG_INT, &max_aps,
+		  "Show at most N strongest access points per device", "N" },
+		{ "output", 'o', 0, G_OPTION_ARG_STRING, &output,
+		  "Output format: text (default), json or ndjson", "FORMAT" },
+		{ "fields", 0, 0, G_OPTION_ARG_STRING, &fields,
+		  "List devices only, with just the comma separated FIELDS, and read "
+		  "nothing else from NetworkManager: iface, type, managed, state, "
+		  "connection, ip4, ip6, driver, udi, hw_address, carrier, speed, mode, "
+		  "bitrate, capabilities, and of access points ap.bssid, ap.ssid, "
+		  "ap.active, ap.frequency, ap.mode, ap.strength, ap.max_bitrate, "
+		  "ap.security. Text is one tab separated line per device, led by "
+		  "iface if it isn't selected, and per usable access point starting "
+		  "with a tab", "FIELDS" },
+		{ "daemon", 0, 0, G_OPTION_ARG_NONE, &daemon,
+		  "Keep running and answer other nmconfig calls over a local socket", NULL },
+		{ "no-daemon", 0, 0, G_OPTION_ARG_NONE, &no_daemon,
+		  "Don't ask a running nmconfig daemon", NULL },
+		{ "watch", 0, 0, G_OPTION_ARG_NONE, &watch,
+		  "Keep running and print a line for every change of the given interfaces, or of everything", NULL },
+		{ "socket", 0, 0, G_OPTION_ARG_FILENAME, &socket_path,
+		  "Daemon socket (default " NM_CONFIG_DAEMON_SOCKET ")", "PATH" },
+		{ "timeout", 0, 0, G_OPTION_ARG_INT, &timeout,
+		  "Give up waiting for NetworkManager and the settings services after "
+		  "SECONDS and print what was read (default 10)", "SECONDS" },
+		{ "stats", 0, 0, G_OPTION_ARG_NONE, &stats,
+		  "Print D-Bus call and phase timings to stderr at exit, implies --no-daemon", NULL },
+		{ "dump-snapshot", 0, 0, G_OPTION_ARG_FILENAME, &dump_path,
+		  "Save the state of NetworkManager and its connections to FILE", "FILE" },
+		{ "show-snapshot", 0, 0, G_OPTION_ARG_FILENAME, &show_path,
+		  "Print the state saved in FILE instead of asking NetworkManager", "FILE" },
+		{ "diff", 0, 0, G_OPTION_ARG_FILENAME, &diff_path,
+		  "Print what changed from the state saved in OLD to the one saved in "
+		  "the file given as argument", "OLD" },
+		{ "connections", 0, 0, G_OPTION_ARG_NONE, &connections,
+		  "List stored connections only, sorted by name", NULL },
+		{ "id", 0, 0, G_OPTION_ARG_STRING, &connection_id,
+		  "Only connections named PATTERN, implies --connections", "PATTERN" },
+		{ "uuid", 0, 0, G_OPTION_ARG_STRING, &connection_uuid,
+		  "Only the connection with UUID, implies --connections", "UUID" },
+		{ "type", 0, 0, G_OPTION_ARG_STRING, &connection_type,
+		  "Only connections of TYPE, e.g. vpn or 802-3-ethernet, implies --connections", "TYPE" },
+		{ "details", 0, 0, G_OPTION_ARG_NONE, &details,
+		  "Show all settings of the listed connections, implies --connections", NULL },
+		{ "device", 0, 0, G_OPTION_ARG_STRING, &device,
+		  "wait-online: wait for INTERFACE to be activated", "INTERFACE" },
+		{ "window", 0, 0, G_OPTION_ARG_INT, &window,
+		  "up, down, export, import and --details: work on at most N targets "
+		  "or connections at a time (default 16); --bus: read at most N buses "
+		  "at a time (default 64)", "N" },
+		{ "bus", 0, 0, G_OPTION_ARG_STRING_ARRAY, &bus,
+		  "List the devices of the NetworkManager on the D-Bus at ADDRESS "
+		  "instead of the system bus; may be given many times", "ADDRESS" },
+		{ "bus-list", 0, 0, G_OPTION_ARG_FILENAME, &bus_list_path,
+		  "Like --bus, for every address listed in FILE, one per line", "FILE" },
+		{ "out", 0, 0, G_OPTION_ARG_FILENAME, &out_path,
+		  "export: write to FILE instead of the standard output", "FILE" },
+		{ "history", 0, 0, G_OPTION_ARG_FILENAME, &history_path,
+		  "sample: record into FILE, created if it doesn't exist", "FILE" },
+		{ "rate", 0, 0, G_OPTION_ARG_DOUBLE, &rate,
+		  "sample: also record every access point HZ times a second", "HZ" },
+		{ "slots", 0, 0, G_OPTION_ARG_INT, &slots,
+		  "sample: number of samples a new history keeps (default 65536)", "N" },
+		{ "last", 0, 0, G_OPTION_ARG_INT, &last,
+		  "history: only the samples of the last SECONDS before the newest one", "SECONDS" },
+		{ "quiet", 0, 0, G_OPTION_ARG_INT, &quiet,
+		  "scan: stop once no access point was found for SECONDS (default 2)", "SECONDS" },
+		{ NULL }
+	};
+
+	g_return_val_if_fail (argv != NULL, NULL);
+
+	/* GOptionContext removes parsed options from the array it gets */
+	args = g_new0 (gchar *, argc + 1);
+	for (i = 0; i < argc; i++)
+		args[i] = argv[i];
+
+	context = g_option_context_new ("[INTERFACE...] | COMMAND");
+	g_option_context_set_summary (context, ACTIONS_SUMMARY);
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (remote)
+		g_option_context_set_help_enabled (context, FALSE);
+
+	if (!g_option_context_parse (context, &argc, &args, error)) {
+		g_option_context_free (context);
+		g_free (args);
+		g_free (socket_path);
+		g_free (dump_path);
+		g_free (show_path);
+		g_free (diff_path);
+		g_free (connection_id);
+		g_free (connection_uuid);
+		g_free (connection_type);
+		g_free (device);
+		g_free (out_path);
+		g_free (history_path);
+		g_strfreev (bus);
+		g_free (bus_list_path);
+		g_free (fields);
+		g_free (output);
+		return NULL;
+	}
+	g_option_context_free (context);
+
+	if (bus || bus_list_path) {
+		buses = g_ptr_array_new ();
+		for (i = 0; bus && bus[i]; i++)
+			g_ptr_array_add (buses, g_strdup (bus[i]));
+		g_strfreev (bus);
+	}
+
+	if (connection_id || connection_uuid || connection_type || details)
+		connections = TRUE;
+
+	if (argc > 1) {
+		action = action_from_string (args[1]);
+		if (action != NM_CONFIG_ACTION_SHOW)
+			first_arg = 2;
+	}
+
+	if (max_aps < 0)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+				"--max-aps must not be negative");
+	else if (timeout <= 0)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+				"--timeout must be positive");
+	else if (window != -1 && window <= 0)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+				"--window must be positive");
+	else if (buses && (action != NM_CONFIG_ACTION_SHOW || daemon || watch || remote
+			|| dump_path || show_path || diff_path || connections))
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--bus lists devices only, it can't be used with commands, "
+				"--daemon, --watch, snapshot files or --connections");
+	else if (fields && (action != NM_CONFIG_ACTION_SHOW || daemon || watch
+			|| dump_path || diff_path || connections))
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--fields lists devices only, it can't be used with commands, "
+				"--daemon, --watch, --dump-snapshot, --diff or --connections");
+	else if (output && !nm_config_output_format_from_string (output, &output_format))
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+				"Unknown output format: %s", output);
+	else if (action != NM_CONFIG_ACTION_SHOW && remote)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"%s can't be served by a daemon", nm_config_action_to_string (action));
+	else if (action != NM_CONFIG_ACTION_SHOW
+		&& (daemon || watch || dump_path || show_path || diff_path || connections))
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"%s can't be used with --daemon, --watch, snapshot files "
+				"or --connections", nm_config_action_to_string (action));
+	else if (action == NM_CONFIG_ACTION_WAIT_ONLINE && argc > first_arg)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"wait-online takes no arguments, give the interface with --device");
+	else if ((action == NM_CONFIG_ACTION_UP || action == NM_CONFIG_ACTION_DOWN)
+		&& argc <= first_arg)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"%s needs at least one device or connection",
+				nm_config_action_to_string (action));
+	else if (action == NM_CONFIG_ACTION_EXPORT && argc > first_arg)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"export takes no arguments, give the file to write with --out");
+	else if (action == NM_CONFIG_ACTION_IMPORT && argc != first_arg + 1)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"import needs the file to read as the only argument");
+	else if (rate < 0 || rate > 1000)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+				"--rate must be between 0 and 1000");
+	else if (slots < 0)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+				"--slots must be positive");
+	else if (last < 0)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+				"--last must not be negative");
+	else if (quiet < 0)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+				"--quiet must be positive");
+	else if (action == NM_CONFIG_ACTION_SCAN && argc != first_arg + 1)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"scan needs the wireless interface as the only argument");
+	else if (quiet && action != NM_CONFIG_ACTION_SCAN)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--quiet is only used by scan");
+	else if (action == NM_CONFIG_ACTION_SAMPLE && argc != first_arg + 1)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"sample needs the wireless interface as the only argument");
+	else if (action == NM_CONFIG_ACTION_SAMPLE && !history_path)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"sample needs the file to record into, give it with --history");
+	else if ((history_path || rate > 0 || slots) && action != NM_CONFIG_ACTION_SAMPLE)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--history, --rate and --slots are only used by sample");
+	else if (action == NM_CONFIG_ACTION_HISTORY && argc != first_arg + 1)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"history needs the file to read as the only argument");
+	else if (last && action != NM_CONFIG_ACTION_HISTORY)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--last is only used by history");
+	else if ((action == NM_CONFIG_ACTION_TOP || action == NM_CONFIG_ACTION_HISTORY
+			|| action == NM_CONFIG_ACTION_SCAN)
+		&& output_format != NM_CONFIG_OUTPUT_TEXT)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"%s prints text only", nm_config_action_to_string (action));
+	else if (out_path && action != NM_CONFIG_ACTION_EXPORT)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--out is only used by export");
+	else if (device && action != NM_CONFIG_ACTION_WAIT_ONLINE)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--device is only used by wait-online");
+	else if (watch && (daemon || remote))
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--watch can't be served by a daemon");
+	else if (stats && remote)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--stats can't be served by a daemon");
+	else if ((dump_path != NULL) + (show_path != NULL) + (diff_path != NULL) > 1)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"Only one of --dump-snapshot, --show-snapshot and --diff may be given");
+	else if ((dump_path || show_path || diff_path) && (daemon || watch || remote))
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"Snapshot files can't be used with --daemon or --watch");
+	else if (dump_path && argc > 1)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--dump-snapshot saves all devices, no interface may be given");
+	else if (diff_path && argc != 2)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--diff needs the newer snapshot as the only argument");
+	else if (diff_path && output_format != NM_CONFIG_OUTPUT_TEXT)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--diff prints text only");
+	else if (connections && (daemon || watch || dump_path || diff_path))
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--connections can't be used with --daemon, --watch, "
+				"--dump-snapshot or --diff");
+	else if (connections && argc > 1)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--connections lists no devices, no interface may be given");
+	else if (details && (remote || show_path))
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"--details reads connections from the settings services, "
+				"it can't be served by a daemon or from a snapshot");
+	g_free (output);
+
+	if (!err && bus_list_path && read_bus_list (bus_list_path, buses, &err)
+		&& buses->len == 0)
+		g_set_error (&err, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+				"%s names no bus", bus_list_path);
+	g_free (bus_list_path);
+
+	if (!err && fields)
+		nm_config_fields_parse (&print_fields, fields, &err);
+	g_free (fields);
+
+	if (err) {
+		g_propagate_error (error, err);
+		g_free (args);
+		g_free (socket_path);
+		g_free (dump_path);
+		g_free (show_path);
+		g_free (diff_path);
+		g_free (connection_id);
+		g_free (connection_uuid);
+		g_free (connection_type);
+		g_free (device);
+		g_free (out_path);
+		g_free (history_path);
+		free_buses (buses);
+		return NULL;
+	}
+
+	command = g_new0 (NMConfigCommand, 1);
+	command->argv = g_strdupv (argv);
+	command->action = action;
+	command->args = g_ptr_array_sized_new (argc);
+	for (i = first_arg; i < argc; i++)
+		g_ptr_array_add (command->args, g_strdup (args[i]));
+	g_free (args);
+
+	command->print_options.max_aps = max_aps;
+	command->print_options.fields = print_fields;
+	command->output_format = output_format;
+	command->timeout = timeout;
+	command->daemon = daemon;
+	command->no_daemon = no_daemon;
+	command->watch = watch;
+	command->stats = stats;
+	command->socket_path = socket_path ? socket_path : g_strdup (NM_CONFIG_DAEMON_SOCKET);
+	command->dump_path = dump_path;
+	command->show_path = show_path;
+	command->diff_path = diff_path;
+	command->connections = connections;
+	command->details = details;
+	command->connection_id = connection_id;
+	command->connection_uuid = connection_uuid;
+	command->connection_type = connection_type;
+	command->device = device;
+	if (window > 0)
+		command->window = window;
+	else
+		command->window = buses ? NM_CONFIG_DEFAULT_BUS_WINDOW : NM_CONFIG_DEFAULT_WINDOW;
+	command->buses = buses;
+	command->out_path = out_path;
+	command->history_path = history_path;
+	command->rate = rate;
+	command->slots = slots ? slots : NM_CONFIG_HISTORY_DEFAULT_SLOTS;
+	command->last = last;
+	command->quiet = quiet ? quiet : NM_CONFIG_DEFAULT_QUIET;
+
+	return command;
+}
+
+NMConfigSources
+nm_config_command_get_sources (const NMConfigCommand * command)
+{
+	g_return_val_if_fail (command != NULL, NM_CONFIG_SOURCE_NONE);
+
+	/* A daemon answers any query, full listings included */
+	if (command->daemon)
+		return NM_CONFIG_SOURCE_DEVICES | NM_CONFIG_SOURCE_SETTINGS;
+
+	if (nm_config_command_is_offline (command))
+		return NM_CONFIG_SOURCE_NONE;
+
+	/* Everything is saved */
+	if (command->dump_path)
+		return NM_CONFIG_SOURCE_DEVICES | NM_CONFIG_SOURCE_SETTINGS;
+
+	/* Only devices are listed from other buses, and with --fields */
+	if (command->buses || command->print_options.fields.len)
+		return NM_CONFIG_SOURCE_DEVICES;
+
+	if (command->watch || command->action == NM_CONFIG_ACTION_WAIT_ONLINE
+		|| command->action == NM_CONFIG_ACTION_TOP
+		|| command->action == NM_CONFIG_ACTION_SAMPLE
+		|| command->action == NM_CONFIG_ACTION_SCAN)
+		return NM_CONFIG_SOURCE_DEVICES;
+
+	/* Targets of up and down may name connections */
+	if (command->action == NM_CONFIG_ACTION_UP || command->action == NM_CONFIG_ACTION_DOWN
+		|| command->action == NM_CONFIG_ACTION_EXPORT)
+		return NM_CONFIG_SOURCE_SETTINGS;
+
+	/* Only the file is read */
+	if (command->action == NM_CONFIG_ACTION_IMPORT)
+		return NM_CONFIG_SOURCE_NONE;
+
+	if (command->connections)
+		return NM_CONFIG_SOURCE_SETTINGS;
+
+	if (command->args->len == 0)
+		return NM_CONFIG_SOURCE_DEVICES | NM_CONFIG_SOURCE_SETTINGS;
+
+	return NM_CONFIG_SOURCE_DEVICES;
+}
+
+gboolean
+nm_config_command_is_offline (const NMConfigCommand * command)
+{
+	g_return_val_if_fail (command != NULL, FALSE);
+
+	return command->show_path || command->diff_path
+		|| command->action == NM_CONFIG_ACTION_HISTORY;
+}
+
+void
+nm_config_command_free (NMConfigCommand * command)
+{
+	if (!command)
+		return;
+
+	g_strfreev (command->argv);
+	g_ptr_array_foreach (command->args, (GFunc) g_free, NULL);
+	g_ptr_array_free (command->args, TRUE);
+	g_free (command->socket_path);
+	g_free (command->dump_path);
+	g_free (command->show_path);
+	g_free (command->diff_path);
+	g_free (command->connection_id);
+	g_free (command->connection_uuid);
+	g_free (command->connection_type);
+	g_free (command->device);
+	g_free (command->out_path);
+	g_free (command->history_path);
+	free_buses (command->buses);
+	g_free (command);
+}
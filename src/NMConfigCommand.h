@@ -0,0 +1,134 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#ifndef NM_CONFIG_COMMAND_H
+#define NM_CONFIG_COMMAND_H
+
+#include <glib.h>
+
+#include "NMConfigDevicePrintHelper.h"
+#include "NMConfigOutput.h"
+
+/* Seconds to wait for NetworkManager and the settings services */
+#define NM_CONFIG_DEFAULT_TIMEOUT 10
+
+/* Seconds scan waits for another access point */
+#define NM_CONFIG_DEFAULT_QUIET 2
+
+/* Targets up and down, or connections export and import, work on at once */
+#define NM_CONFIG_DEFAULT_WINDOW 16
+
+/* Buses --bus reads at once */
+#define NM_CONFIG_DEFAULT_BUS_WINDOW 64
+
+/* Command given as the first argument; without one devices and
+ * connections are listed.
+ */
+typedef enum {
+	NM_CONFIG_ACTION_SHOW = 0,
+	NM_CONFIG_ACTION_WAIT_ONLINE, /* see NMConfigWaitOnline.h */
+	NM_CONFIG_ACTION_UP,          /* see NMConfigActivate.h */
+	NM_CONFIG_ACTION_DOWN,
+	NM_CONFIG_ACTION_EXPORT,      /* see NMConfigExport.h */
+	NM_CONFIG_ACTION_IMPORT,      /* see NMConfigImport.h, args holds the file */
+	NM_CONFIG_ACTION_TOP,         /* see NMConfigTop.h, args are the interfaces */
+	NM_CONFIG_ACTION_SAMPLE,      /* see NMConfigSample.h, args holds the interface */
+	NM_CONFIG_ACTION_HISTORY,     /* see NMConfigHistory.h, args holds the file */
+	NM_CONFIG_ACTION_SCAN         /* see NMConfigScan.h, args holds the interface */
+} NMConfigAction;
+
+/* Parsed nmconfig command line */
+typedef struct {
+	gchar ** argv;     /* as given, including the program name */
+	NMConfigAction action;
+	GPtrArray * args;  /* non-option arguments, but the command */
+
+	NMConfigDevicePrintOptions print_options;
+	NMConfigOutputFormat output_format;
+	gint timeout;      /* seconds */
+
+	gboolean daemon;
+	gboolean no_daemon;
+	gboolean watch;    /* args are the interfaces to watch */
+	gboolean stats;    /* report timings at exit, see NMConfigStats.h */
+	gchar * socket_path;
+
+	/* saved state, see NMConfigSnapshotFile.h */
+	gchar * dump_path;
+	gchar * show_path;
+	gchar * diff_path; /* args holds the newer snapshot */
+
+	/* stored connections only, see NMConfigConnections.h */
+	gboolean connections;
+	gboolean details;
+	gchar * connection_id; /* glob pattern */
+	gchar * connection_uuid;
+	gchar * connection_type;
+
+	/* wait-online */
+	gchar * device;    /* NULL to wait for NetworkManager */
+
+	/* up, down, export and import, and --bus */
+	guint window;
+
+	/* D-Bus addresses to list the devices of, see NMConfigFleet.h; NULL
+	 * for the system bus
+	 */
+	GPtrArray * buses;
+
+	/* export, NULL for the standard output */
+	gchar * out_path;
+
+	/* sample */
+	gchar * history_path;
+	gdouble rate;      /* samples per second, 0 for changes only */
+	guint slots;
+
+	/* history */
+	guint last;        /* seconds, 0 for all samples */
+
+	/* scan */
+	guint quiet;       /* seconds */
+} NMConfigCommand;
+
+/* Data a command needs to be read from NetworkManager */
+typedef enum {
+	NM_CONFIG_SOURCE_NONE     = 0,
+	NM_CONFIG_SOURCE_DEVICES  = 1 << 0,
+	NM_CONFIG_SOURCE_SETTINGS = 1 << 1  /* stored connections */
+} NMConfigSources;
+
+const char * nm_config_action_to_string (NMConfigAction action);
+
+/* Remote commands are the ones forwarded to a daemon; --help is disabled
+ * for them, so a client can't make the daemon exit.
+ */
+NMConfigCommand * nm_config_command_parse (gint argc, gchar ** argv,
+		gboolean remote, GError ** error);
+
+NMConfigSources nm_config_command_get_sources (const NMConfigCommand * command);
+
+/* Commands which only read saved snapshots or histories and never use D-Bus */
+gboolean nm_config_command_is_offline (const NMConfigCommand * command);
+
+void nm_config_command_free (NMConfigCommand * command);
+
+#endif /* NM_CONFIG_COMMAND_H */
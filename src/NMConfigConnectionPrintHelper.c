@@ -20,24 +20,168 @@
  */
 
 
+#include <string.h>
 #include <glib.h>
 #include <glib-object.h>
-#include <nm-settings-connection-interface.h>
-#include <nm-connection.h>
-#include <nm-setting-connection.h>
+#include <dbus/dbus-glib.h>
 
 
 #include "NMConfigConnectionPrintHelper.h"
+#include "NMConfigJson.h"
+#include "NMConfigPrint.h"
 
+static gint
+compare_strings (gconstpointer a, gconstpointer b)
+{
+	return strcmp (*(const char **) a, *(const char **) b);
+}
+
+/* Keys of a settings table in alphabetical order, for stable output */
+static GPtrArray *
+sorted_keys (GHashTable * table)
+{
+	GPtrArray * keys = g_ptr_array_sized_new (g_hash_table_size (table));
+	GHashTableIter iter;
+	gpointer key;
+
+	g_hash_table_iter_init (&iter, table);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		g_ptr_array_add (keys, key);
+	g_ptr_array_sort (keys, compare_strings);
+
+	return keys;
+}
+
+/* Setting values as nmconfig prints them; byte arrays in hex */
+static gchar *
+setting_value_to_string (const GValue * value)
+{
+	GString * string;
+	int i;
+
+	if (G_VALUE_HOLDS_STRING (value))
+		return g_value_dup_string (value);
+	if (G_VALUE_HOLDS_BOOLEAN (value))
+		return g_strdup (g_value_get_boolean (value) ? "yes" : "no");
+	if (G_VALUE_HOLDS_UINT (value))
+		return g_strdup_printf ("%u", g_value_get_uint (value));
+	if (G_VALUE_HOLDS_INT (value))
+		return g_strdup_printf ("%d", g_value_get_int (value));
+	if (G_VALUE_HOLDS_UINT64 (value))
+		return g_strdup_printf ("%" G_GUINT64_FORMAT, g_value_get_uint64 (value));
+	if (G_VALUE_HOLDS_UCHAR (value))
+		return g_strdup_printf ("%u", g_value_get_uchar (value));
+	if (G_VALUE_HOLDS (value, DBUS_TYPE_G_OBJECT_PATH))
+		return g_strdup (g_value_get_boxed (value));
+
+	if (G_VALUE_HOLDS (value, G_TYPE_STRV)) {
+		gchar ** strv = g_value_get_boxed (value);
+
+		return strv ? g_strjoinv (",", strv) : g_strdup ("");
+	}
+
+	if (G_VALUE_HOLDS (value, DBUS_TYPE_G_UCHAR_ARRAY)) {
+		GArray * bytes = g_value_get_boxed (value);
+
+		string = g_string_new (NULL);
+		for (i = 0; bytes && i < bytes->len; i++)
+			g_string_append_printf (string, "%s%02x", i ? ":" : "",
+					g_array_index (bytes, guchar, i));
+		return g_string_free (string, FALSE);
+	}
+
+	if (G_VALUE_HOLDS (value, DBUS_TYPE_G_UINT_ARRAY)) {
+		GArray * uints = g_value_get_boxed (value);
+
+		string = g_string_new (NULL);
+		for (i = 0; uints && i < uints->len; i++)
+			g_string_append_printf (string, "%s%u", i ? "," : "",
+					g_array_index (uints, guint, i));
+		return g_string_free (string, FALSE);
+	}
+
+	return g_strdup_printf ("<%s>", G_VALUE_TYPE_NAME (value));
+}
+
+static void
+show_settings (GHashTable * groups)
+{
+	GPtrArray * names = sorted_keys (groups);
+	int i, j;
+
+	for (i = 0; i < names->len; i++) {
+		const char * name = g_ptr_array_index (names, i);
+		GHashTable * settings = g_hash_table_lookup (groups, name);
+		GPtrArray * keys = sorted_keys (settings);
+
+		for (j = 0; j < keys->len; j++) {
+			const char * key = g_ptr_array_index (keys, j);
+			gchar * value = setting_value_to_string (g_hash_table_lookup (settings, key));
+
+			nm_config_print ("%-9s %s.%s: %s\n", "", name, key, value);
+			g_free (value);
+		}
+		g_ptr_array_free (keys, TRUE);
+	}
+	g_ptr_array_free (names, TRUE);
+}
 
 void
-nm_config_connection_show (NMSettingsConnectionInterface * connection) {
-	NMSettingConnection * s_con;
-	const char * id;
+nm_config_connection_show (const NMConfigConnectionInfo * connection,
+		GHashTable * groups) {
+	nm_config_print ("%s\n", connection->id);
 
-	s_con = NM_SETTING_CONNECTION (nm_connection_get_setting (NM_CONNECTION (connection), NM_TYPE_SETTING_CONNECTION));
-	id = nm_setting_connection_get_id (s_con);
+	if (groups)
+		show_settings (groups);
+}
 
-	g_print("%s\n", id);
+static void
+write_settings_json (NMConfigJson * json, GHashTable * groups)
+{
+	GPtrArray * names = sorted_keys (groups);
+	int i, j;
+
+	nm_config_json_begin_object (json, "settings");
+	for (i = 0; i < names->len; i++) {
+		const char * name = g_ptr_array_index (names, i);
+		GHashTable * settings = g_hash_table_lookup (groups, name);
+		GPtrArray * keys = sorted_keys (settings);
+
+		nm_config_json_begin_object (json, name);
+		for (j = 0; j < keys->len; j++) {
+			const char * key = g_ptr_array_index (keys, j);
+			const GValue * value = g_hash_table_lookup (settings, key);
+			gchar * string;
+
+			if (G_VALUE_HOLDS_BOOLEAN (value)) {
+				nm_config_json_boolean (json, key, g_value_get_boolean (value));
+				continue;
+			}
+			if (G_VALUE_HOLDS_UINT (value)) {
+				nm_config_json_uint (json, key, g_value_get_uint (value));
+				continue;
+			}
+
+			string = setting_value_to_string (value);
+			nm_config_json_string (json, key, string);
+			g_free (string);
+		}
+		nm_config_json_end_object (json);
+		g_ptr_array_free (keys, TRUE);
+	}
+	nm_config_json_end_object (json);
+	g_ptr_array_free (names, TRUE);
 }
 
+void
+nm_config_connection_write_json (NMConfigJson * json, const char * key,
+		const NMConfigConnectionInfo * connection, GHashTable * groups)
+{
+	nm_config_json_begin_object (json, key);
+	nm_config_json_string (json, "id", connection->id);
+	nm_config_json_string (json, "uuid", connection->uuid);
+	nm_config_json_string (json, "type", connection->type);
+	if (groups)
+		write_settings_json (json, groups);
+	nm_config_json_end_object (json);
+}
@@ -22,8 +22,16 @@
 #ifndef NM_CONFIG_CONNECTION_PRINT_HELPER_H
 #define NM_CONFIG_CONNECTION_PRINT_HELPER_H
 
-#include <nm-settings-connection-interface.h>
+#include "NMConfigJson.h"
+#include "NMConfigSettings.h"
 
-void nm_config_connection_show (NMSettingsConnectionInterface * connection);
+/* groups, if given, are all settings of the connection: setting name ->
+ * GHashTable of key -> GValue, see nm_config_connections_fetch_details()
+ */
+void nm_config_connection_show (const NMConfigConnectionInfo * connection,
+		GHashTable * groups);
+
+void nm_config_connection_write_json (NMConfigJson * json, const char * key,
+		const NMConfigConnectionInfo * connection, GHashTable * groups);
 
 #endif /* NM_CONFIG_DEVICE_PRINT_HELPER_H */
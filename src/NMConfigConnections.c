@@ -0,0 +1,373 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#include <string.h>
+#include <fnmatch.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <dbus/dbus-glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigConnections.h"
+#include "NMConfigSnapshot.h"
+#include "NMConfigStats.h"
+
+#define DBUS_TYPE_G_MAP_OF_VARIANT \
+	(dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, G_TYPE_VALUE))
+#define DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT \
+	(dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, DBUS_TYPE_G_MAP_OF_VARIANT))
+
+struct _NMConfigConnections {
+	GArray * entries;     /* NMConfigConnectionEntry, sorted by id */
+
+	/* positions in entries, ascending */
+	GHashTable * by_id;   /* id -> GArray of guint */
+	GHashTable * by_type; /* type -> GArray of guint */
+	GHashTable * by_uuid; /* uuid -> position + 1 */
+};
+
+static gint
+compare_entries (gconstpointer a, gconstpointer b)
+{
+	const NMConfigConnectionEntry * entry1 = a;
+	const NMConfigConnectionEntry * entry2 = b;
+	gint result;
+
+	result = strcmp (entry1->info->id, entry2->info->id);
+	if (!result)
+		result = g_strcmp0 (entry1->info->uuid, entry2->info->uuid);
+	if (!result)
+		result = entry1->scope - entry2->scope;
+
+	return result;
+}
+
+static void
+free_positions (gpointer data)
+{
+	g_array_free (data, TRUE);
+}
+
+static void
+index_position (GHashTable * index, const char * key, guint position)
+{
+	GArray * positions;
+
+	if (!key)
+		return;
+
+	positions = g_hash_table_lookup (index, key);
+	if (!positions) {
+		positions = g_array_new (FALSE, FALSE, sizeof (guint));
+		g_hash_table_insert (index, (gpointer) key, positions);
+	}
+	g_array_append_val (positions, position);
+}
+
+static void
+add_entries (GArray * entries, NMConnectionScope scope, const GPtrArray * connections)
+{
+	int i;
+
+	for (i = 0; connections && i < connections->len; i++) {
+		NMConfigConnectionEntry entry;
+
+		entry.scope = scope;
+		entry.info = g_ptr_array_index (connections, i);
+
+		/* Both backends drop connections without an id */
+		if (entry.info->id)
+			g_array_append_val (entries, entry);
+	}
+}
+
+NMConfigConnections *
+nm_config_connections_new (const GPtrArray * system_connections,
+		const GPtrArray * user_connections)
+{
+	NMConfigConnections * connections;
+	guint len;
+	int i;
+
+	len = (system_connections ? system_connections->len : 0)
+		+ (user_connections ? user_connections->len : 0);
+
+	connections = g_new0 (NMConfigConnections, 1);
+	connections->entries = g_array_sized_new (FALSE, FALSE,
+			sizeof (NMConfigConnectionEntry), len);
+	add_entries (connections->entries, NM_CONNECTION_SCOPE_SYSTEM, system_connections);
+	add_entries (connections->entries, NM_CONNECTION_SCOPE_USER, user_connections);
+	g_array_sort (connections->entries, compare_entries);
+
+	/* Built in sorted order, so every position list is sorted too */
+	connections->by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+			NULL, free_positions);
+	connections->by_type = g_hash_table_new_full (g_str_hash, g_str_equal,
+			NULL, free_positions);
+	connections->by_uuid = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (i = 0; i < connections->entries->len; i++) {
+		const NMConfigConnectionEntry * entry = &g_array_index (connections->entries,
+				NMConfigConnectionEntry, i);
+
+		index_position (connections->by_id, entry->info->id, i);
+		index_position (connections->by_type, entry->info->type, i);
+		if (entry->info->uuid && !g_hash_table_lookup (connections->by_uuid, entry->info->uuid))
+			g_hash_table_insert (connections->by_uuid, (gpointer) entry->info->uuid,
+					GUINT_TO_POINTER (i + 1));
+	}
+
+	return connections;
+}
+
+static gboolean
+is_pattern (const char * string)
+{
+	return strpbrk (string, "*?[") != NULL;
+}
+
+static gboolean
+entry_matches (const NMConfigConnectionEntry * entry,
+		const NMConfigConnectionFilter * filter)
+{
+	if (filter->uuid && g_strcmp0 (entry->info->uuid, filter->uuid))
+		return FALSE;
+	if (filter->type && g_strcmp0 (entry->info->type, filter->type))
+		return FALSE;
+	if (filter->id && fnmatch (filter->id, entry->info->id, 0))
+		return FALSE;
+
+	return TRUE;
+}
+
+GArray *
+nm_config_connections_query (const NMConfigConnections * connections,
+		const NMConfigConnectionFilter * filter)
+{
+	GArray * result;
+	const GArray * candidates = NULL;
+	guint uuid_position;
+	int i;
+
+	g_return_val_if_fail (connections != NULL, NULL);
+
+	result = g_array_new (FALSE, FALSE, sizeof (NMConfigConnectionEntry));
+
+	if (!filter) {
+		g_array_append_vals (result, connections->entries->data,
+				connections->entries->len);
+		return result;
+	}
+
+	/* Only look at the entries of the most selective index */
+	if (filter->uuid) {
+		uuid_position = GPOINTER_TO_UINT (g_hash_table_lookup (connections->by_uuid,
+				filter->uuid));
+		if (uuid_position) {
+			const NMConfigConnectionEntry * entry = &g_array_index (connections->entries,
+					NMConfigConnectionEntry, uuid_position - 1);
+
+			if (entry_matches (entry, filter))
+				g_array_append_vals (result, entry, 1);
+		}
+		return result;
+	}
+
+	if (filter->id && !is_pattern (filter->id))
+		candidates = g_hash_table_lookup (connections->by_id, filter->id);
+	else if (filter->type)
+		candidates = g_hash_table_lookup (connections->by_type, filter->type);
+	else {
+		for (i = 0; i < connections->entries->len; i++) {
+			const NMConfigConnectionEntry * entry = &g_array_index (connections->entries,
+					NMConfigConnectionEntry, i);
+
+			if (entry_matches (entry, filter))
+				g_array_append_vals (result, entry, 1);
+		}
+		return result;
+	}
+
+	for (i = 0; candidates && i < candidates->len; i++) {
+		const NMConfigConnectionEntry * entry = &g_array_index (connections->entries,
+				NMConfigConnectionEntry, g_array_index (candidates, guint, i));
+
+		if (entry_matches (entry, filter))
+			g_array_append_vals (result, entry, 1);
+	}
+
+	return result;
+}
+
+const NMConfigConnectionEntry *
+nm_config_connections_lookup_uuid (const NMConfigConnections * connections,
+		const char * uuid)
+{
+	guint position;
+
+	g_return_val_if_fail (connections != NULL, NULL);
+	g_return_val_if_fail (uuid != NULL, NULL);
+
+	position = GPOINTER_TO_UINT (g_hash_table_lookup (connections->by_uuid, uuid));
+	if (!position)
+		return NULL;
+
+	return &g_array_index (connections->entries, NMConfigConnectionEntry, position - 1);
+}
+
+void
+nm_config_connections_free (NMConfigConnections * connections)
+{
+	if (!connections)
+		return;
+
+	g_hash_table_destroy (connections->by_id);
+	g_hash_table_destroy (connections->by_type);
+	g_hash_table_destroy (connections->by_uuid);
+	g_array_free (connections->entries, TRUE);
+	g_free (connections);
+}
+
+/* Details */
+
+typedef struct {
+	DBusGConnection * bus;
+	const GArray * entries;
+	GPtrArray * details; /* GHashTable or NULL, indexed like the entries */
+	guint next_call;
+	guint window;
+	guint in_flight;
+	gint timeout_ms;
+
+	NMConfigConnectionDetailsFunc callback;
+	gpointer user_data;
+} DetailsFetch;
+
+typedef struct {
+	DetailsFetch * fetch;
+	guint slot;
+	gdouble started;
+} DetailsCall;
+
+static gboolean
+details_done (gpointer user_data)
+{
+	DetailsFetch * fetch = user_data;
+	int i;
+
+	fetch->callback (fetch->details, fetch->user_data);
+
+	for (i = 0; i < fetch->details->len; i++) {
+		GHashTable * groups = g_ptr_array_index (fetch->details, i);
+
+		if (groups)
+			g_hash_table_destroy (groups);
+	}
+	g_ptr_array_free (fetch->details, TRUE);
+	dbus_g_connection_unref (fetch->bus);
+	g_free (fetch);
+
+	return FALSE;
+}
+
+static void start_calls (DetailsFetch * fetch);
+
+static void
+get_settings_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	DetailsCall * data = user_data;
+	DetailsFetch * fetch = data->fetch;
+	GHashTable * groups = NULL;
+	GError * err = NULL;
+
+	nm_config_stats_call (NM_DBUS_IFACE_SETTINGS_CONNECTION, "GetSettings",
+			data->started);
+
+	if (dbus_g_proxy_end_call (proxy, call, &err,
+			DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT, &groups,
+			G_TYPE_INVALID))
+		g_ptr_array_index (fetch->details, data->slot) = groups;
+	else {
+		g_printerr ("Could not read connection %s: %s\n",
+				dbus_g_proxy_get_path (proxy), err->message);
+		g_error_free (err);
+	}
+	nm_config_proxy_unref_later (proxy);
+	fetch->in_flight--;
+
+	start_calls (fetch);
+}
+
+/* At most window calls out at a time, as for export */
+static void
+start_calls (DetailsFetch * fetch)
+{
+	while (fetch->in_flight < fetch->window && fetch->next_call < fetch->entries->len) {
+		const NMConfigConnectionEntry * entry = &g_array_index (fetch->entries,
+				NMConfigConnectionEntry, fetch->next_call);
+		DetailsCall * data = g_new0 (DetailsCall, 1);
+		DBusGProxy * proxy;
+
+		proxy = dbus_g_proxy_new_for_name (fetch->bus,
+				entry->scope == NM_CONNECTION_SCOPE_USER ?
+					NM_DBUS_SERVICE_USER_SETTINGS : NM_DBUS_SERVICE_SYSTEM_SETTINGS,
+				entry->info->path, NM_DBUS_IFACE_SETTINGS_CONNECTION);
+
+		data->fetch = fetch;
+		data->slot = fetch->next_call++;
+		data->started = nm_config_stats_now ();
+		fetch->in_flight++;
+
+		dbus_g_proxy_begin_call_with_timeout (proxy, "GetSettings",
+				get_settings_cb, data, g_free, fetch->timeout_ms,
+				G_TYPE_INVALID);
+	}
+
+	/* Not from here: the callback may free the entries */
+	if (fetch->in_flight == 0)
+		g_idle_add (details_done, fetch);
+}
+
+void
+nm_config_connections_fetch_details (DBusGConnection * bus,
+		const GArray * entries, guint window, gint timeout_ms,
+		NMConfigConnectionDetailsFunc callback, gpointer user_data)
+{
+	DetailsFetch * fetch;
+
+	g_return_if_fail (bus != NULL);
+	g_return_if_fail (entries != NULL);
+	g_return_if_fail (window > 0);
+	g_return_if_fail (callback != NULL);
+
+	fetch = g_new0 (DetailsFetch, 1);
+	fetch->bus = dbus_g_connection_ref (bus);
+	fetch->entries = entries;
+	fetch->details = g_ptr_array_sized_new (entries->len);
+	g_ptr_array_set_size (fetch->details, entries->len);
+	fetch->window = window;
+	fetch->timeout_ms = timeout_ms;
+	fetch->callback = callback;
+	fetch->user_data = user_data;
+
+	start_calls (fetch);
+}
@@ -0,0 +1,84 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_CONNECTIONS_H
+#define NM_CONFIG_CONNECTIONS_H
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigSettings.h"
+
+/*
+ * Connections of both settings services in one array sorted by id, with
+ * hash indexes by id, uuid and type, for listings filtered on the
+ * command line. Settings beyond NMConfigConnectionInfo are fetched only
+ * for the connections shown, see nm_config_connections_fetch_details().
+ */
+
+typedef struct {
+	NMConnectionScope scope;
+	const NMConfigConnectionInfo * info;
+} NMConfigConnectionEntry;
+
+typedef struct {
+	const char * id;   /* glob pattern, NULL for any */
+	const char * uuid; /* NULL for any */
+	const char * type; /* NULL for any */
+} NMConfigConnectionFilter;
+
+typedef struct _NMConfigConnections NMConfigConnections;
+
+/* connections are NMConfigConnectionInfo, either may be NULL. They are
+ * not copied and must stay valid as long as the index is used.
+ */
+NMConfigConnections * nm_config_connections_new (const GPtrArray * system_connections,
+		const GPtrArray * user_connections);
+
+/* NMConfigConnectionEntry matching filter, sorted by id; filter may be
+ * NULL. Free with g_array_free().
+ */
+GArray * nm_config_connections_query (const NMConfigConnections * connections,
+		const NMConfigConnectionFilter * filter);
+
+const NMConfigConnectionEntry * nm_config_connections_lookup_uuid (const NMConfigConnections * connections,
+		const char * uuid);
+
+void nm_config_connections_free (NMConfigConnections * connections);
+
+/* details holds, for every entry, a GHashTable of setting name -> GHashTable
+ * of key -> GValue, or NULL if the connection couldn't be read. It's
+ * freed when the callback returns.
+ */
+typedef void (*NMConfigConnectionDetailsFunc) (const GPtrArray * details,
+		gpointer user_data);
+
+/* One GetSettings call per entry, at most window of them in flight;
+ * callback is called from the main loop once all of them are answered.
+ * entries must stay valid until then.
+ */
+void nm_config_connections_fetch_details (DBusGConnection * bus,
+		const GArray * entries, guint window, gint timeout_ms,
+		NMConfigConnectionDetailsFunc callback, gpointer user_data);
+
+#endif /* NM_CONFIG_CONNECTIONS_H */
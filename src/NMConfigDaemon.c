@@ -0,0 +1,432 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <glib.h>
+
+#include "NMConfigDaemon.h"
+#include "NMConfigPrint.h"
+
+#define MAX_REQUEST_SIZE (64 * 1024)
+#define CLIENT_TIMEOUT   30 /* seconds */
+#define IDLE_TIMEOUT     10 /* seconds a client may stay silent, or not read */
+
+struct _NMConfigDaemon {
+	gchar * path;
+	int fd;
+	GIOChannel * channel;
+	guint watch_id;
+
+	GSList * queries;
+
+	NMConfigDaemonQueryFunc func;
+	gpointer user_data;
+};
+
+struct _NMConfigDaemonQuery {
+	NMConfigDaemon * daemon;
+	int fd;
+	GIOChannel * channel;
+	guint watch_id;
+	guint idle_id;
+
+	GString * buffer; /* request while reading, reply while writing */
+	gsize written;
+	gchar ** argv;
+};
+
+static void
+query_free (NMConfigDaemonQuery * query)
+{
+	NMConfigDaemon * daemon = query->daemon;
+
+	daemon->queries = g_slist_remove (daemon->queries, query);
+
+	if (query->watch_id)
+		g_source_remove (query->watch_id);
+	if (query->idle_id)
+		g_source_remove (query->idle_id);
+	g_io_channel_unref (query->channel);
+	close (query->fd);
+
+	g_string_free (query->buffer, TRUE);
+	g_strfreev (query->argv);
+	g_free (query);
+}
+
+/* A client which neither sends its request nor reads the reply is
+ * dropped, so it can't hold a connection forever.
+ */
+static gboolean
+query_idle_cb (gpointer user_data)
+{
+	NMConfigDaemonQuery * query = user_data;
+
+	query->idle_id = 0;
+	query_free (query);
+
+	return FALSE;
+}
+
+/* Restart the idle timeout on progress, or stop it with stop */
+static void
+query_touch (NMConfigDaemonQuery * query, gboolean stop)
+{
+	if (query->idle_id)
+		g_source_remove (query->idle_id);
+	query->idle_id = stop ? 0 : g_timeout_add_seconds (IDLE_TIMEOUT, query_idle_cb, query);
+}
+
+static gchar **
+request_to_argv (const GString * request, gint * argc)
+{
+	GPtrArray * args;
+	const gchar * arg = request->str;
+	const gchar * end = request->str + request->len;
+
+	args = g_ptr_array_new ();
+	g_ptr_array_add (args, g_strdup ("nmconfig"));
+
+	while (arg < end) {
+		g_ptr_array_add (args, g_strdup (arg));
+		arg += strlen (arg) + 1;
+	}
+
+	*argc = args->len;
+	g_ptr_array_add (args, NULL);
+
+	return (gchar **) g_ptr_array_free (args, FALSE);
+}
+
+static gboolean
+query_write_cb (GIOChannel * channel, GIOCondition condition, gpointer user_data)
+{
+	NMConfigDaemonQuery * query = user_data;
+	ssize_t n;
+
+	while (query->written < query->buffer->len) {
+		n = send (query->fd, query->buffer->str + query->written,
+				query->buffer->len - query->written, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno == EAGAIN)
+			return TRUE;
+		if (n <= 0)
+			break;
+
+		query->written += n;
+		query_touch (query, FALSE);
+	}
+
+	/* Done, or the client went away */
+	query->watch_id = 0;
+	query_free (query);
+
+	return FALSE;
+}
+
+void
+nm_config_daemon_query_reply (NMConfigDaemonQuery * query, gint exit_code,
+		const GString * out, const GString * err)
+{
+	g_return_if_fail (query != NULL);
+
+	g_string_printf (query->buffer, "%d %lu %lu\n", exit_code,
+			(gulong) (out ? out->len : 0), (gulong) (err ? err->len : 0));
+	if (out)
+		g_string_append_len (query->buffer, out->str, out->len);
+	if (err)
+		g_string_append_len (query->buffer, err->str, err->len);
+	query->written = 0;
+	query_touch (query, FALSE);
+
+	query->watch_id = g_io_add_watch (query->channel, G_IO_OUT | G_IO_ERR | G_IO_HUP,
+			query_write_cb, query);
+}
+
+static gboolean
+query_read_cb (GIOChannel * channel, GIOCondition condition, gpointer user_data)
+{
+	NMConfigDaemonQuery * query = user_data;
+	NMConfigDaemon * daemon = query->daemon;
+	gchar buf[4096];
+	ssize_t n;
+	gint argc;
+
+	for (;;) {
+		n = read (query->fd, buf, sizeof (buf));
+		if (n > 0) {
+			g_string_append_len (query->buffer, buf, n);
+			if (query->buffer->len > MAX_REQUEST_SIZE)
+				break;
+			query_touch (query, FALSE);
+			continue;
+		}
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno == EAGAIN)
+			return TRUE;
+		if (n < 0)
+			break;
+
+		/* Whole request read, answering it is up to the daemon */
+		query->watch_id = 0;
+		query_touch (query, TRUE);
+		query->argv = request_to_argv (query->buffer, &argc);
+		g_string_truncate (query->buffer, 0);
+
+		daemon->func (query, argc, query->argv, daemon->user_data);
+		return FALSE;
+	}
+
+	query->watch_id = 0;
+	query_free (query);
+
+	return FALSE;
+}
+
+static gboolean
+accept_cb (GIOChannel * channel, GIOCondition condition, gpointer user_data)
+{
+	NMConfigDaemon * daemon = user_data;
+	NMConfigDaemonQuery * query;
+	int fd;
+
+	fd = accept (daemon->fd, NULL, NULL);
+	if (fd < 0)
+		return TRUE;
+
+	fcntl (fd, F_SETFL, O_NONBLOCK);
+	fcntl (fd, F_SETFD, FD_CLOEXEC);
+
+	query = g_new0 (NMConfigDaemonQuery, 1);
+	query->daemon = daemon;
+	query->fd = fd;
+	query->buffer = g_string_new (NULL);
+	query->channel = g_io_channel_unix_new (fd);
+	query->watch_id = g_io_add_watch (query->channel, G_IO_IN | G_IO_ERR | G_IO_HUP,
+			query_read_cb, query);
+	query_touch (query, FALSE);
+
+	daemon->queries = g_slist_prepend (daemon->queries, query);
+
+	return TRUE;
+}
+
+static gboolean
+fill_address (struct sockaddr_un * addr, const char * path, GError ** error)
+{
+	memset (addr, 0, sizeof (*addr));
+	addr->sun_family = AF_UNIX;
+
+	if (strlen (path) >= sizeof (addr->sun_path)) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_NAMETOOLONG,
+				"Socket path is too long: %s", path);
+		return FALSE;
+	}
+	strcpy (addr->sun_path, path);
+
+	return TRUE;
+}
+
+NMConfigDaemon *
+nm_config_daemon_new (const char * socket_path, NMConfigDaemonQueryFunc func,
+		gpointer user_data, GError ** error)
+{
+	NMConfigDaemon * daemon;
+	struct sockaddr_un addr;
+	mode_t old_umask;
+	int fd, bound = -1;
+
+	g_return_val_if_fail (socket_path != NULL, NULL);
+	g_return_val_if_fail (func != NULL, NULL);
+
+	if (!fill_address (&addr, socket_path, error))
+		return NULL;
+
+	/* Refuse to take over the socket of a running daemon, but remove
+	 * one left behind by a daemon which is gone.
+	 */
+	fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (fd >= 0 && connect (fd, (struct sockaddr *) &addr, sizeof (addr)) == 0) {
+		close (fd);
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_EXIST,
+				"An nmconfig daemon is already running on %s", socket_path);
+		return NULL;
+	}
+	if (fd >= 0)
+		close (fd);
+	unlink (socket_path);
+
+	/* Only the daemon's user may connect and have commands run */
+	fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (fd >= 0) {
+		old_umask = umask (0077);
+		bound = bind (fd, (struct sockaddr *) &addr, sizeof (addr));
+		umask (old_umask);
+	}
+	if (fd < 0 || bound < 0 || listen (fd, 16) < 0) {
+		int errsv = errno;
+
+		if (fd >= 0)
+			close (fd);
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errsv),
+				"Could not listen on %s: %s", socket_path, g_strerror (errsv));
+		return NULL;
+	}
+
+	fcntl (fd, F_SETFL, O_NONBLOCK);
+	fcntl (fd, F_SETFD, FD_CLOEXEC);
+
+	daemon = g_new0 (NMConfigDaemon, 1);
+	daemon->path = g_strdup (socket_path);
+	daemon->fd = fd;
+	daemon->func = func;
+	daemon->user_data = user_data;
+	daemon->channel = g_io_channel_unix_new (fd);
+	daemon->watch_id = g_io_add_watch (daemon->channel, G_IO_IN, accept_cb, daemon);
+
+	return daemon;
+}
+
+void
+nm_config_daemon_free (NMConfigDaemon * daemon)
+{
+	if (!daemon)
+		return;
+
+	while (daemon->queries)
+		query_free (daemon->queries->data);
+
+	g_source_remove (daemon->watch_id);
+	g_io_channel_unref (daemon->channel);
+	close (daemon->fd);
+	unlink (daemon->path);
+
+	g_free (daemon->path);
+	g_free (daemon);
+}
+
+/* Client side */
+
+static gboolean
+send_all (int fd, const gchar * data, gsize len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		n = send (fd, data, len, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return FALSE;
+
+		data += n;
+		len -= n;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Let a running daemon answer the command. Returns FALSE, having printed
+ * nothing, if no daemon answered; the caller then does the work itself.
+ */
+gboolean
+nm_config_daemon_forward (const char * socket_path, gchar ** argv,
+		gint * exit_code)
+{
+	struct sockaddr_un addr;
+	struct timeval timeout = { CLIENT_TIMEOUT, 0 };
+	GString * buffer;
+	gchar buf[4096];
+	gchar * body;
+	gulong out_len, err_len;
+	gint code;
+	ssize_t n;
+	int fd, i;
+
+	g_return_val_if_fail (argv != NULL, FALSE);
+	g_return_val_if_fail (exit_code != NULL, FALSE);
+
+	if (!socket_path || !fill_address (&addr, socket_path, NULL))
+		return FALSE;
+
+	fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return FALSE;
+
+	if (connect (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+		close (fd);
+		return FALSE;
+	}
+	setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout));
+
+	buffer = g_string_new (NULL);
+	for (i = 1; argv[0] && argv[i]; i++)
+		g_string_append_len (buffer, argv[i], strlen (argv[i]) + 1);
+
+	if (!send_all (fd, buffer->str, buffer->len)) {
+		g_string_free (buffer, TRUE);
+		close (fd);
+		return FALSE;
+	}
+	shutdown (fd, SHUT_WR);
+
+	g_string_truncate (buffer, 0);
+	for (;;) {
+		n = read (fd, buf, sizeof (buf));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		g_string_append_len (buffer, buf, n);
+	}
+	close (fd);
+
+	/* A truncated or garbled answer counts as no answer */
+	body = memchr (buffer->str, '\n', buffer->len);
+	if (n < 0 || !body
+		|| sscanf (buffer->str, "%d %lu %lu", &code, &out_len, &err_len) != 3
+		|| (gsize) (body + 1 - buffer->str) + out_len + err_len != buffer->len) {
+		g_string_free (buffer, TRUE);
+		return FALSE;
+	}
+	body++;
+
+	nm_config_print_write (body, out_len);
+	nm_config_print_flush ();
+	fwrite (body + out_len, 1, err_len, stderr);
+
+	g_string_free (buffer, TRUE);
+	*exit_code = code;
+
+	return TRUE;
+}
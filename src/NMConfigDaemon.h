@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#ifndef NM_CONFIG_DAEMON_H
+#define NM_CONFIG_DAEMON_H
+
+#include <glib.h>
+
+#define NM_CONFIG_DAEMON_SOCKET "/var/run/nmconfig.socket"
+
+/*
+ * Local socket protocol: a client sends its arguments (without the
+ * program name), each terminated by a NUL byte, and shuts down its
+ * sending side. The daemon answers with a "<exit code> <stdout length>
+ * <stderr length>\n" header followed by both outputs, and closes.
+ */
+
+typedef struct _NMConfigDaemon NMConfigDaemon;
+typedef struct _NMConfigDaemonQuery NMConfigDaemonQuery;
+
+/* argv starts with the program name and stays valid until the query is
+ * replied to. Every query must be replied to exactly once.
+ */
+typedef void (*NMConfigDaemonQueryFunc) (NMConfigDaemonQuery * query,
+		gint argc, gchar ** argv, gpointer user_data);
+
+NMConfigDaemon * nm_config_daemon_new (const char * socket_path,
+		NMConfigDaemonQueryFunc func, gpointer user_data, GError ** error);
+
+void nm_config_daemon_free (NMConfigDaemon * daemon);
+
+void nm_config_daemon_query_reply (NMConfigDaemonQuery * query, gint exit_code,
+		const GString * out, const GString * err);
+
+gboolean nm_config_daemon_forward (const char * socket_path, gchar ** argv,
+		gint * exit_code);
+
+#endif /* NM_CONFIG_DAEMON_H */
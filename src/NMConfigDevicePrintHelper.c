@@ -20,25 +20,40 @@
  */
 
 
+#include <stdlib.h>
+#include <string.h>
 #include <glib.h>
 #include <glib-object.h>
 #include <arpa/inet.h>
 #include <NetworkManager.h>
-#include <nm-device.h>
-#include <nm-device-ethernet.h>
-#include <nm-device-wifi.h>
-#include <nm-device-bt.h>
-#include <nm-gsm-device.h>
-#include <nm-cdma-device.h>
-#include <nm-access-point.h>
-#include <nm-setting-ip4-config.h>
-#include <nm-setting-ip6-config.h>
 #include <nm-utils.h>
 
 #include "NMConfigDevicePrintHelper.h"
+#include "NMConfigJson.h"
+#include "NMConfigPrint.h"
 
-static gchar *
-device_state_to_string (NMDeviceState state)
+gchar *
+nm_config_state_to_string (NMState state)
+{
+    switch (state) {
+    case NM_STATE_UNKNOWN:
+        return "Unknown";
+    case NM_STATE_ASLEEP:
+        return "Asleep";
+    case NM_STATE_CONNECTING:
+        return "Connecting";
+    case NM_STATE_CONNECTED:
+        return "Connected";
+    case NM_STATE_DISCONNECTED:
+        return "Disconnected";
+    default:
+        return "State not recognized";
+    }
+
+}
+
+gchar *
+nm_config_device_state_to_string (NMDeviceState state)
 {
     switch (state) {
     case NM_DEVICE_STATE_UNKNOWN:
@@ -84,50 +99,40 @@ wifi_mode_to_string (NM80211Mode mode)
 
 
 static void
-print_ip4_addr (gpointer object, gpointer user_data)
+print_ip4_addr (const NMConfigIP4Address * address)
 {
-	NMIP4Address * address = (NMIP4Address *) object;
-	guint32 addr = nm_ip4_address_get_address (address);
-	guint32 prefix = nm_ip4_address_get_prefix (address);
-	guint32 netmask = nm_utils_ip4_prefix_to_netmask (prefix);
-	guint32 gateway = nm_ip4_address_get_gateway (address);
+	guint32 netmask = nm_utils_ip4_prefix_to_netmask (address->prefix);
 
 	struct in_addr tmp_addr;
 	char buf[INET_ADDRSTRLEN + 1];
 
-	g_print ("%-9s ", "");
+	nm_config_print ("%-9s ", "");
 
-	tmp_addr.s_addr = addr;
+	tmp_addr.s_addr = address->address;
 	inet_ntop (AF_INET, &tmp_addr, buf, sizeof (buf));
-	g_print ("IPv4:%s  ", buf);
+	nm_config_print ("IPv4:%s  ", buf);
 
 	tmp_addr.s_addr = netmask;
 	inet_ntop (AF_INET, &tmp_addr, buf, sizeof (buf));
-	g_print ("Netmask:%s  ", buf);
+	nm_config_print ("Netmask:%s  ", buf);
 
-	tmp_addr.s_addr = gateway;
+	tmp_addr.s_addr = address->gateway;
 	inet_ntop (AF_INET, &tmp_addr, buf, sizeof (buf));
-	g_print ("Gateway:%s\n", buf);
+	nm_config_print ("Gateway:%s\n", buf);
 }
 
 static void
-print_ip6_addr (gpointer object, gpointer user_data)
+print_ip6_addr (const NMConfigIP6Address * address)
 {
-	const struct in6_addr * tmp_addr;
 	char buf[INET6_ADDRSTRLEN + 1];
-	NMIP6Address * address = (NMIP6Address *) object;
-	guint32 prefix = nm_ip6_address_get_prefix (address);
-
-	tmp_addr = nm_ip6_address_get_address (address);
 
-	inet_ntop (AF_INET6, &tmp_addr, buf, sizeof (buf));
-	g_print ("%-9s IPv6:%s/%d\n", "", buf, prefix);
+	inet_ntop (AF_INET6, &address->address, buf, sizeof (buf));
+	nm_config_print ("%-9s IPv6:%s/%d\n", "", buf, address->prefix);
 }
 
 static void
-print_ip4_info (NMIP4Config * ip4)
+print_ip4_info (const NMConfigIP4Info * ip4)
 {
-	GSList * addresses;
 	const GArray * dns;
 	const GPtrArray * domains;
 	int i;
@@ -135,19 +140,17 @@ print_ip4_info (NMIP4Config * ip4)
 	if (!ip4)
 		return;
 
-	g_return_if_fail (NM_IS_IP4_CONFIG (ip4));
-
-	addresses = (GSList *) nm_ip4_config_get_addresses (ip4);
-	dns = nm_ip4_config_get_nameservers (ip4);
-	domains = nm_ip4_config_get_domains (ip4);
+	dns = ip4->nameservers;
+	domains = ip4->domains;
 
-	g_slist_foreach (addresses, (GFunc) print_ip4_addr, NULL);
+	for (i = 0; i < ip4->addresses->len; i++)
+		print_ip4_addr (&g_array_index (ip4->addresses, NMConfigIP4Address, i));
 
-	if ((domains && domains->len) || (dns && dns->len))
-		g_print("%-9s ", "");
+	if (domains->len || dns->len)
+		nm_config_print ("%-9s ", "");
 
-	if (dns && dns->len) {
-		g_print("DNS:");
+	if (dns->len) {
+		nm_config_print ("DNS:");
 
 		for (i = 0; i < dns->len; i++) {
 			struct in_addr tmp_addr;
@@ -157,422 +160,1239 @@ print_ip4_info (NMIP4Config * ip4)
 			tmp_addr.s_addr = addr;
 			inet_ntop (AF_INET, &tmp_addr, buf, sizeof (buf));
 
-			g_print("%s ", buf);
+			nm_config_print ("%s ", buf);
 		}
-		g_print (" ");
+		nm_config_print (" ");
 	}
 
-	if (domains && domains->len) {
-		g_print("Domains:");
+	if (domains->len) {
+		nm_config_print ("Domains:");
 
 		for (i = 0; i < domains->len; i++) {
 			char * domain = (char *) g_ptr_array_index(domains, i);
-			g_print("%s ", domain);
+			nm_config_print ("%s ", domain);
 		}
 	}
 
-	if ((domains && domains->len) || (dns && dns->len))
-		g_print("\n");
+	if (domains->len || dns->len)
+		nm_config_print ("\n");
 
 }
 
 static void
-print_ip6_info (NMIP6Config * ip6)
+print_ip6_info (const NMConfigIP6Info * ip6)
 {
-	GSList * addresses;
-	GSList * dns;
+	const GArray * dns;
 	const GPtrArray * domains;
 	int i;
 
 	if (!ip6)
 		return;
 
-	g_return_if_fail (NM_IS_IP6_CONFIG (ip6));
-
-	addresses = (GSList *) nm_ip6_config_get_addresses (ip6);
-	dns = (GSList *) nm_ip6_config_get_nameservers (ip6);
-	domains = nm_ip6_config_get_domains (ip6);
+	dns = ip6->nameservers;
+	domains = ip6->domains;
 
-	g_slist_foreach (addresses, (GFunc) print_ip6_addr, NULL);
+	for (i = 0; i < ip6->addresses->len; i++)
+		print_ip6_addr (&g_array_index (ip6->addresses, NMConfigIP6Address, i));
 
-	if ((domains && domains->len) || (dns && dns->data))
-		g_print("%-9s ", "");
+	if (domains->len || dns->len)
+		nm_config_print ("%-9s ", "");
 
-	if (dns && dns->data) {
-		g_print("DNS:");
+	if (dns->len) {
+		nm_config_print ("DNS:");
 
-		while(dns) {
+		for (i = 0; i < dns->len; i++) {
 			char buf[INET6_ADDRSTRLEN + 1];
-			struct in6_addr * tmp_addr = dns->data;
-
-			dns = g_slist_next (dns);
-			inet_ntop (AF_INET6, &tmp_addr, buf, sizeof (buf));
-			g_print("%s ", buf);
 
+			inet_ntop (AF_INET6, &g_array_index (dns, struct in6_addr, i),
+					buf, sizeof (buf));
+			nm_config_print ("%s ", buf);
 		}
 
-		g_print (" ");
+		nm_config_print (" ");
 	}
 
-	if (domains && domains->len) {
-		g_print("Domains:");
+	if (domains->len) {
+		nm_config_print ("Domains:");
 
 		for (i = 0; i < domains->len; i++) {
 			char * domain = (char *) g_ptr_array_index(domains, i);
-			g_print("%s ", domain);
+			nm_config_print ("%s ", domain);
 		}
 	}
 
-	if ((domains && domains->len) || (dns && dns->data))
-		g_print("\n");
+	if (domains->len || dns->len)
+		nm_config_print ("\n");
 
 }
 
 static void
-show_generic_info (NMDevice * device)
+show_generic_info (const NMConfigDeviceInfo * device)
 {
-	const char *ifname, *uid, *driver;
-	gboolean managed;
-	NMDeviceState state;
-	NMIP4Config * ip4;
-	NMIP6Config * ip6;
-
-	g_return_if_fail (NM_IS_DEVICE (device));
-
-	ifname = nm_device_get_iface (device);
-	managed = nm_device_get_managed (device);
-
-	if (managed) {
-		state = nm_device_get_state (device);
-		ip4 = nm_device_get_ip4_config (device);
-		ip6 = nm_device_get_ip6_config (device);
-		driver = nm_device_get_driver (device);
-		uid = nm_device_get_udi (device);
-
-		//TODO: show active connection name
-		g_print("%-9s State:%s  Connection:%s\n", ifname, device_state_to_string(state), "Not implemented");
-
-		print_ip4_info (ip4);
-
-		print_ip6_info (ip6);
-
-		if (driver || uid) {
-			g_print("%-9s ", "");
-			if (driver)
-				g_print("Driver:%s  ", driver);
-			if (uid)
-				g_print("UID:%s", uid);
-			g_print ("\n");
+	g_return_if_fail (device != NULL);
+
+	if (device->managed) {
+		nm_config_print ("%-9s State:%s  Connection:%s", device->iface,
+				nm_config_device_state_to_string(device->state),
+				device->connection_id ? device->connection_id : "none");
+		if (device->connection_uuid)
+			nm_config_print ("  UUID:%s", device->connection_uuid);
+		nm_config_print ("\n");
+
+		print_ip4_info (device->ip4);
+
+		print_ip6_info (device->ip6);
+
+		if (device->driver || device->udi) {
+			nm_config_print ("%-9s ", "");
+			if (device->driver)
+				nm_config_print ("Driver:%s  ", device->driver);
+			if (device->udi)
+				nm_config_print ("UID:%s", device->udi);
+			nm_config_print ("\n");
 		}
 
 	}
 	else {
-		g_print("%-9s Device is not managed by NetworkManager\n", ifname);
+		nm_config_print ("%-9s Device is not managed by NetworkManager\n", device->iface);
 	}
 }
 
 static void
-show_ethernet_specific_info (NMDevice * dev) {
-	NMDeviceEthernet * device = NM_DEVICE_ETHERNET (dev);
-
-	gboolean carrier;
-	const char * hw_address;
-	guint32 speed;
-
+show_ethernet_specific_info (const NMConfigDeviceInfo * device) {
 	gchar * carrier_str;
 
-	carrier = nm_device_ethernet_get_carrier (device);
-	hw_address = nm_device_ethernet_get_hw_address (device);
-	speed = nm_device_ethernet_get_speed   (device);
-
-	carrier_str = (carrier ? "online" : "offline");
+	carrier_str = (device->carrier ? "online" : "offline");
 
-	g_print ("%-9s HWaddr:%s  Carrier:%s", "", hw_address, carrier_str);
-	if(carrier)
-		g_print ("  Speed:%dMb/s", speed);
-	g_print ("\n");
+	nm_config_print ("%-9s HWaddr:%s  Carrier:%s", "", device->hw_address, carrier_str);
+	if(device->carrier)
+		nm_config_print ("  Speed:%dMb/s", device->speed);
+	nm_config_print ("\n");
 }
 
-static void
-print_access_point_info (NMAccessPoint * ap, gboolean active,
-		guint32 device_capas)
-{
-	const char * bssid;
-	const GByteArray * ssid;
-	NM80211Mode mode;
-	guint32 frequency;
-	guint32 max_bitrate;
-	guint32 signal_strength;
+/* Security of an access point depends only on these flags and on the
+ * device's capabilities, and most access points around share them. The
+ * compatibility check and the description are done once per distinct
+ * tuple and cached for the device.
+ */
+typedef struct {
+	gboolean adhoc;
 	guint32 ap_flags;
 	guint32 wpa_flags;
 	guint32 rsn_flags;
+} APSecurityKey;
+
+typedef struct {
+	APSecurityKey key;
+	gboolean compatible;
+	gchar ** options;    /* "wep", "wpa-psk"... */
+	gchar * description; /* options, or "none" */
+} APSecurity;
+
+static const NMUtilsSecurityType security_types[] = {
+	NMU_SEC_NONE,
+	NMU_SEC_STATIC_WEP,
+	NMU_SEC_LEAP,
+	NMU_SEC_DYNAMIC_WEP,
+	NMU_SEC_WPA_PSK,
+	NMU_SEC_WPA2_PSK,
+	NMU_SEC_WPA_ENTERPRISE,
+	NMU_SEC_WPA2_ENTERPRISE
+};
+
+static guint
+ap_security_hash (gconstpointer v)
+{
+	const APSecurityKey * key = v;
 
-	char *ssid_str;
-	gboolean is_adhoc;
-	gchar * sec_opts[5]; /* Currently five security options is defined */
-	gint sec_opts_num, i;
+	return (key->ap_flags * 31 + key->wpa_flags) * 31
+		+ key->rsn_flags * 2 + (key->adhoc ? 1 : 0);
+}
 
-	g_return_if_fail (NM_IS_ACCESS_POINT (ap));
+static gboolean
+ap_security_equal (gconstpointer a, gconstpointer b)
+{
+	const APSecurityKey * key1 = a;
+	const APSecurityKey * key2 = b;
 
+	return key1->adhoc == key2->adhoc
+		&& key1->ap_flags == key2->ap_flags
+		&& key1->wpa_flags == key2->wpa_flags
+		&& key1->rsn_flags == key2->rsn_flags;
+}
 
-	mode = nm_access_point_get_mode (ap);
-	ap_flags = nm_access_point_get_flags (ap);
-	wpa_flags = nm_access_point_get_wpa_flags (ap);
-	rsn_flags = nm_access_point_get_rsn_flags (ap);
+static void
+ap_security_free (gpointer data)
+{
+	APSecurity * security = data;
 
-	is_adhoc = (mode == NM_802_11_MODE_ADHOC);
+	g_strfreev (security->options);
+	g_free (security->description);
+	g_free (security);
+}
 
-	/* Skip access point not compatible with device's capabilities */
-	if (   !nm_utils_security_valid (NMU_SEC_NONE, device_capas, TRUE, is_adhoc, ap_flags, wpa_flags, rsn_flags)
-		&& !nm_utils_security_valid (NMU_SEC_STATIC_WEP, device_capas, TRUE, is_adhoc, ap_flags, wpa_flags, rsn_flags)
-		&& !nm_utils_security_valid (NMU_SEC_LEAP, device_capas, TRUE, is_adhoc, ap_flags, wpa_flags, rsn_flags)
-		&& !nm_utils_security_valid (NMU_SEC_DYNAMIC_WEP, device_capas, TRUE, is_adhoc, ap_flags, wpa_flags, rsn_flags)
-		&& !nm_utils_security_valid (NMU_SEC_WPA_PSK, device_capas, TRUE, is_adhoc, ap_flags, wpa_flags, rsn_flags)
-		&& !nm_utils_security_valid (NMU_SEC_WPA2_PSK, device_capas, TRUE, is_adhoc, ap_flags, wpa_flags, rsn_flags)
-		&& !nm_utils_security_valid (NMU_SEC_WPA_ENTERPRISE, device_capas,TRUE, is_adhoc, ap_flags, wpa_flags, rsn_flags)
-		&& !nm_utils_security_valid (NMU_SEC_WPA2_ENTERPRISE, device_capas, TRUE, is_adhoc, ap_flags, wpa_flags, rsn_flags))
-		return;
+static GHashTable *
+ap_security_cache_new (void)
+{
+	return g_hash_table_new_full (ap_security_hash, ap_security_equal,
+			NULL, ap_security_free);
+}
+
+static const APSecurity *
+lookup_ap_security (GHashTable * cache, const NMConfigAPInfo * ap,
+		guint32 device_capas)
+{
+	APSecurityKey key;
+	APSecurity * security;
+	gchar * sec_opts[6]; /* Currently five security options is defined, and NULL */
+	gint sec_opts_num, i;
+
+	key.adhoc = (ap->mode == NM_802_11_MODE_ADHOC);
+	key.ap_flags = ap->flags;
+	key.wpa_flags = ap->wpa_flags;
+	key.rsn_flags = ap->rsn_flags;
 
-	bssid = nm_access_point_get_hw_address (ap);
-	ssid = nm_access_point_get_ssid (ap);
-	frequency = nm_access_point_get_frequency (ap);
-	max_bitrate = nm_access_point_get_max_bitrate (ap);
-	signal_strength = nm_access_point_get_strength (ap);
+	security = g_hash_table_lookup (cache, &key);
+	if (security)
+		return security;
 
-	ssid_str = nm_utils_ssid_to_utf8 ((const char *) ssid->data, ssid->len);
+	security = g_new0 (APSecurity, 1);
+	security->key = key;
+
+	/* Access point is compatible if device supports any of its security types */
+	for (i = 0; i < G_N_ELEMENTS (security_types); i++) {
+		if (nm_utils_security_valid (security_types[i], device_capas, TRUE,
+				key.adhoc, key.ap_flags, key.wpa_flags, key.rsn_flags)) {
+			security->compatible = TRUE;
+			break;
+		}
+	}
 
 	sec_opts_num = 0;
-	if ((ap_flags & NM_802_11_AP_FLAGS_PRIVACY) && !wpa_flags && !rsn_flags)
+	if ((key.ap_flags & NM_802_11_AP_FLAGS_PRIVACY) && !key.wpa_flags && !key.rsn_flags)
 		sec_opts[sec_opts_num++] = "wep";
-	if (!is_adhoc) {
-		if (wpa_flags & NM_802_11_AP_SEC_KEY_MGMT_PSK)
+	if (!key.adhoc) {
+		if (key.wpa_flags & NM_802_11_AP_SEC_KEY_MGMT_PSK)
 			sec_opts[sec_opts_num++] = "wpa-psk";
-		if (rsn_flags & NM_802_11_AP_SEC_KEY_MGMT_PSK)
+		if (key.rsn_flags & NM_802_11_AP_SEC_KEY_MGMT_PSK)
 			sec_opts[sec_opts_num++] = "wpa2-psk";
-		if (wpa_flags & NM_802_11_AP_SEC_KEY_MGMT_802_1X)
+		if (key.wpa_flags & NM_802_11_AP_SEC_KEY_MGMT_802_1X)
 			sec_opts[sec_opts_num++] = "wpa-eap";
-		if (rsn_flags & NM_802_11_AP_SEC_KEY_MGMT_802_1X)
+		if (key.rsn_flags & NM_802_11_AP_SEC_KEY_MGMT_802_1X)
 			sec_opts[sec_opts_num++] = "wpa2-eap";
 	}
+	sec_opts[sec_opts_num] = NULL;
 
-	g_print ("%-9s BSSID:%s  Frequency:%dMHz", "", bssid, frequency);
-	if (active)
-		g_print ("  <--  ACTIVE");
-	g_print ("\n");
-	g_print ("%-15s SSID:%s  Mode:%s\n", "", ssid_str,
-			wifi_mode_to_string(mode));
-	g_print ("%-15s Signal:%d  MaxBitrate:%.1fMb/s  Security:", "",
-			signal_strength, max_bitrate/1000.0);
+	security->options = g_strdupv (sec_opts);
+	if (sec_opts_num == 0)
+		security->description = g_strdup ("none");
+	else
+		security->description = g_strjoinv (" ", sec_opts);
 
-	if (sec_opts_num == 0) {
-		g_print ("none");
-	}
-	else {
-		for (i = 0; i < sec_opts_num; i++) {
-			g_print ("%s", sec_opts[i]);
-			if (i != sec_opts_num - 1)
-				g_print (" ");
-		}
-	}
-	g_print ("\n");
+	g_hash_table_insert (cache, &security->key, security);
+
+	return security;
 }
 
-static gint
-compare_aps (gconstpointer a, gconstpointer b, gpointer user_data)
+static void
+print_access_point_info (const NMConfigAPInfo * ap, gboolean active,
+		const APSecurity * security)
 {
-	const char *bssid1, *bssid2;
-	guint8 strength1, strength2;
+	char *ssid_str;
+
+	ssid_str = nm_utils_ssid_to_utf8 ((const char *) ap->ssid->data, ap->ssid->len);
+
+	nm_config_print ("%-9s BSSID:%s  Frequency:%dMHz", "", ap->bssid, ap->frequency);
+	if (active)
+		nm_config_print ("  <--  ACTIVE");
+	nm_config_print ("\n");
+	nm_config_print ("%-15s SSID:%s  Mode:%s\n", "", ssid_str,
+			wifi_mode_to_string(ap->mode));
+	nm_config_print ("%-15s Signal:%d  MaxBitrate:%.1fMb/s  Security:%s\n", "",
+			ap->strength, ap->max_bitrate/1000.0, security->description);
+
+	g_free (ssid_str);
+}
+
+/* Access points are sorted through these keys, so comparisons touch
+ * neither the access point objects nor any strings.
+ */
+typedef struct {
+	guint32 index; /* into the device's access point array */
+	guint8 strength;
+	guint8 active;
+} APSortKey;
 
-	NMAccessPoint * ap1 = NM_ACCESS_POINT (* ((gconstpointer *) a));
-	NMAccessPoint * ap2 = NM_ACCESS_POINT (* ((gconstpointer *) b));
-	NMAccessPoint * active_ap;
+static gint
+compare_ap_keys (gconstpointer a, gconstpointer b)
+{
+	const APSortKey * key1 = a;
+	const APSortKey * key2 = b;
 
 	/* sort by signal strength, but put active ap first */
-	if (user_data) {
-		active_ap = NM_ACCESS_POINT (user_data);
-		bssid1 = nm_access_point_get_hw_address (ap1);
-		bssid2 = nm_access_point_get_hw_address (active_ap);
-		if (!g_strcmp0 (bssid1, bssid2))
-			return -1;
-		bssid1 = nm_access_point_get_hw_address (ap2);
-		if (!g_strcmp0 (bssid1, bssid2))
-			return 1;
+	if (key1->active != key2->active)
+		return key1->active ? -1 : 1;
+
+	if (key1->strength != key2->strength)
+		return key1->strength > key2->strength ? -1 : 1;
+
+	/* keep NetworkManager's order for equal strengths */
+	return key1->index < key2->index ? -1 : (key1->index > key2->index);
+}
+
+/* Partially order keys so that keys[0..n-1] are the n first ones
+ * (in any order). Average O(len), keys are unique thanks to the index.
+ */
+static void
+select_ap_keys (APSortKey * keys, gint len, gint n)
+{
+	gint left = 0, right = len - 1, k = n - 1;
+
+	while (left < right) {
+		APSortKey pivot = keys[left + (right - left) / 2];
+		gint i = left, j = right;
+
+		while (i <= j) {
+			while (compare_ap_keys (&keys[i], &pivot) < 0)
+				i++;
+			while (compare_ap_keys (&keys[j], &pivot) > 0)
+				j--;
+			if (i <= j) {
+				APSortKey tmp = keys[i];
+				keys[i] = keys[j];
+				keys[j] = tmp;
+				i++;
+				j--;
+			}
+		}
+
+		if (k <= j)
+			right = j;
+		else if (k >= i)
+			left = i;
+		else
+			break;
 	}
+}
+
+/* Access points to show, compatible with the device and in order */
+typedef struct {
+	APSortKey * keys;
+	guint shown;
+	const APSecurity ** securities; /* indexed like the access point array */
+	GHashTable * security_cache;
+} APSelection;
 
-	strength1 = nm_access_point_get_strength(ap1);
-	strength2 = nm_access_point_get_strength(ap2);
+static void
+select_access_points (APSelection * selection, const GPtrArray * aps,
+		const char * active_ap_path, guint32 device_caps, guint max_aps)
+{
+	guint i, compatible;
+
+	/* Skip access points not compatible with device's capabilities
+	 * before selecting, so --max-aps counts shown access points.
+	 */
+	selection->security_cache = ap_security_cache_new ();
+	selection->securities = g_new0 (const APSecurity *, aps->len);
+	selection->keys = g_new (APSortKey, aps->len);
+	compatible = 0;
+	for (i = 0; i < aps->len; i++) {
+		const NMConfigAPInfo * ap = g_ptr_array_index (aps, i);
+		const APSecurity * security;
+
+		security = lookup_ap_security (selection->security_cache, ap, device_caps);
+		selection->securities[i] = security;
+		if (!security->compatible)
+			continue;
+
+		selection->keys[compatible].index = i;
+		selection->keys[compatible].strength = ap->strength;
+		selection->keys[compatible].active = active_ap_path && !strcmp (ap->path, active_ap_path);
+		compatible++;
+	}
 
-	if (strength1 < strength2)
-		return 1;
-	else if (strength1 == strength2)
-		return 0;
-	else return -1;
+	selection->shown = compatible;
+	if (max_aps && max_aps < compatible) {
+		select_ap_keys (selection->keys, compatible, max_aps);
+		selection->shown = max_aps;
+	}
+	qsort (selection->keys, selection->shown, sizeof (APSortKey), compare_ap_keys);
+}
 
+static void
+ap_selection_clear (APSelection * selection)
+{
+	g_free (selection->keys);
+	g_free (selection->securities);
+	g_hash_table_destroy (selection->security_cache);
 }
 
 static void
-list_wifi_access_points (const GPtrArray * aps, NMAccessPoint * active_ap,
-		guint32 device_caps)
+list_wifi_access_points (const GPtrArray * aps, const char * active_ap_path,
+		guint32 device_caps, guint max_aps)
 {
+	APSelection selection;
 	guint i;
-	GPtrArray * sorted_aps;
+
 	if (!aps || aps->len == 0) {
-		g_print ("%-9s No access points found\n", "");
+		nm_config_print ("%-9s No access points found\n", "");
 		return;
 	}
 
-	/* make copy of access points array and sort it */
-	sorted_aps = g_malloc0 (sizeof (GPtrArray));
-	sorted_aps->len = aps->len;
-	sorted_aps->pdata = g_memdup (aps->pdata, sizeof (gpointer) * aps->len);
-	g_ptr_array_sort_with_data (sorted_aps, compare_aps, active_ap);
-
-	g_print ("%-9s Access points in range:\n", "");
-	for (i = 0; i < sorted_aps->len; i++) {
-		gboolean active;
-		NMAccessPoint * ap = g_ptr_array_index(sorted_aps, i);
+	select_access_points (&selection, aps, active_ap_path, device_caps, max_aps);
 
-		if (active_ap) {
-			const char * bssid1 = nm_access_point_get_hw_address(ap);
-			const char * bssid2 = nm_access_point_get_hw_address(active_ap);
+	nm_config_print ("%-9s Access points in range:\n", "");
+	for (i = 0; i < selection.shown; i++) {
+		guint index = selection.keys[i].index;
 
-			active = !g_strcmp0 (bssid1, bssid2);
-		}
-		else
-			active = FALSE;
-
-		print_access_point_info(ap, active, device_caps);
+		print_access_point_info (g_ptr_array_index (aps, index),
+				selection.keys[i].active, selection.securities[index]);
 	}
 
-	g_free (sorted_aps->pdata);
-	g_free (sorted_aps);
+	ap_selection_clear (&selection);
 }
 
-static void
-show_wifi_specific_info (NMDevice * dev)
+/* Fills strs, which must have room for six, returns their number */
+static gint
+wifi_capabilities_to_strings (guint32 capas, gchar ** strs)
 {
-	NMDeviceWifi * device = NM_DEVICE_WIFI (dev);
+	gint num = 0;
 
-	const char * hw_address;
-	NM80211Mode mode;
-	guint32 bitrate;
-	guint32 capas;
-	NMAccessPoint * active_ap;
-	const GPtrArray * aps;
-
-	gchar * capa_strs[6]; /* Currently six capabilities is defined */
-	gint capas_num, i;
-
-	hw_address = nm_device_wifi_get_hw_address (device);
-	mode = nm_device_wifi_get_mode (device);
-	bitrate = nm_device_wifi_get_bitrate (device);
-	capas = nm_device_wifi_get_capabilities (device);
-	active_ap = nm_device_wifi_get_active_access_point (device);
-	aps = nm_device_wifi_get_access_points (device);
-
-	capas_num = 0;
 	if (capas & NM_WIFI_DEVICE_CAP_CIPHER_WEP40)
-		capa_strs[capas_num++] = "wep40";
+		strs[num++] = "wep40";
 	if (capas & NM_WIFI_DEVICE_CAP_CIPHER_WEP104)
-		capa_strs[capas_num++] = "wep104";
+		strs[num++] = "wep104";
 	if (capas & NM_WIFI_DEVICE_CAP_CIPHER_TKIP)
-		capa_strs[capas_num++] = "tkip";
+		strs[num++] = "tkip";
 	if (capas & NM_WIFI_DEVICE_CAP_CIPHER_CCMP)
-		capa_strs[capas_num++] = "ccmp";
+		strs[num++] = "ccmp";
 	if (capas & NM_WIFI_DEVICE_CAP_WPA)
-		capa_strs[capas_num++] = "wpa";
+		strs[num++] = "wpa";
 	if (capas & NM_WIFI_DEVICE_CAP_RSN)
-		capa_strs[capas_num++] = "rsn";
+		strs[num++] = "rsn";
 
-	g_print ("%-9s HWaddr:%s  Mode:%s", "", hw_address,
-			wifi_mode_to_string(mode));
-	if (bitrate > 0)
-		g_print ("  Bitrate:%.1fMb/s\n", bitrate/1000.0);
+	return num;
+}
+
+static void
+show_wifi_specific_info (const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options)
+{
+	guint32 capas = device->capabilities;
+
+	gchar * capa_strs[6]; /* Currently six capabilities is defined */
+	gint capas_num, i;
+
+	capas_num = wifi_capabilities_to_strings (capas, capa_strs);
+
+	nm_config_print ("%-9s HWaddr:%s  Mode:%s", "", device->hw_address,
+			wifi_mode_to_string(device->mode));
+	if (device->bitrate > 0)
+		nm_config_print ("  Bitrate:%.1fMb/s\n", device->bitrate/1000.0);
 	else
-		g_print ("\n");
+		nm_config_print ("\n");
 
-	g_print ("%-9s Capabilities:", "");
+	nm_config_print ("%-9s Capabilities:", "");
 	for (i = 0; i < capas_num; i++) {
-		g_print ("%s", capa_strs[i]);
+		nm_config_print ("%s", capa_strs[i]);
 		if (i != capas_num - 1)
-			g_print (" ");
+			nm_config_print (" ");
 	}
 	if (capas_num == 0) {
-		g_print ("none");
+		nm_config_print ("none");
 	}
-	g_print ("\n");
+	nm_config_print ("\n");
 
-	list_wifi_access_points (aps, active_ap, capas);
+	list_wifi_access_points (device->aps, device->active_ap_path, capas,
+			options->max_aps);
 }
 
 static void
-show_bt_specific_info (NMDevice * dev) {
-	NMDeviceBt * device = NM_DEVICE_BT (dev);
+show_bt_specific_info (const NMConfigDeviceInfo * device) {
+	//TODO: implement
+	nm_config_print ("%-9s Bluetooth specific info not yet implemented\n", "");
+}
 
+static void
+show_gsm_specific_info (const NMConfigDeviceInfo * device) {
 	//TODO: implement
-	device = device;
+	nm_config_print ("%-9s GSM specific info not yet implemented\n", "");
+}
 
-	g_print("%-9s Bluetooth specific info not yet implemented\n", "");
+static void
+show_cdma_specific_info (const NMConfigDeviceInfo * device) {
+	//TODO: implement
+	nm_config_print ("%-9s CDMA specific info not yet implemented\n", "");
 }
 
+
 static void
-show_gsm_specific_info (NMDevice * dev) {
-	NMGsmDevice * device = NM_GSM_DEVICE (dev);
+show_device_type_specific_info (const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options)
+{
+	g_return_if_fail (device != NULL);
 
-	//TODO: implement
-	device = device;
+	switch (device->type) {
+	case NM_DEVICE_TYPE_ETHERNET:
+		show_ethernet_specific_info (device);
+		break;
+	case NM_DEVICE_TYPE_WIFI:
+		show_wifi_specific_info (device, options);
+		break;
+	case NM_DEVICE_TYPE_BT:
+		show_bt_specific_info (device);
+		break;
+	case NM_DEVICE_TYPE_GSM:
+		show_gsm_specific_info (device);
+		break;
+	case NM_DEVICE_TYPE_CDMA:
+		show_cdma_specific_info (device);
+		break;
+	default:
+		g_printerr ("Unsupported device type: %d\n", device->type);
+	}
+}
 
-	g_print("%-9s GSM specific info not yet implemented\n", "");
+void
+nm_config_device_show_generic_info (const NMConfigDeviceInfo * device)
+{
+	show_generic_info (device);
+	nm_config_print ("\n");
+}
+
+void
+nm_config_device_show_full_info (const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options)
+{
+	show_generic_info (device);
+	show_device_type_specific_info (device, options);
+	nm_config_print ("\n");
+}
+
+void
+nm_config_device_show_summary (const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options)
+{
+	show_generic_info (device);
+	if (device->type == NM_DEVICE_TYPE_WIFI)
+		list_wifi_access_points (device->aps, device->active_ap_path,
+				device->capabilities, options->max_aps);
+	nm_config_print ("\n");
+}
+
+struct _NMConfigAPSecurityCache {
+	GHashTable * table; /* APSecurityKey -> APSecurity */
+};
+
+NMConfigAPSecurityCache *
+nm_config_ap_security_cache_new (void)
+{
+	NMConfigAPSecurityCache * cache = g_new0 (NMConfigAPSecurityCache, 1);
+
+	cache->table = ap_security_cache_new ();
+
+	return cache;
+}
+
+void
+nm_config_ap_security_cache_free (NMConfigAPSecurityCache * cache)
+{
+	if (!cache)
+		return;
+
+	g_hash_table_destroy (cache->table);
+	g_free (cache);
+}
+
+gboolean
+nm_config_device_show_access_point (const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap, NMConfigAPSecurityCache * cache)
+{
+	const APSecurity * security;
+
+	g_return_val_if_fail (cache != NULL, FALSE);
+
+	security = lookup_ap_security (cache->table, ap, device->capabilities);
+	if (security->compatible)
+		print_access_point_info (ap, device->active_ap_path
+				&& !strcmp (ap->path, device->active_ap_path), security);
+
+	return security->compatible;
+}
+
+/* JSON */
+
+static const char *
+device_type_to_token (NMDeviceType type)
+{
+	switch (type) {
+	case NM_DEVICE_TYPE_ETHERNET:
+		return "ethernet";
+	case NM_DEVICE_TYPE_WIFI:
+		return "wifi";
+	case NM_DEVICE_TYPE_BT:
+		return "bluetooth";
+	case NM_DEVICE_TYPE_GSM:
+		return "gsm";
+	case NM_DEVICE_TYPE_CDMA:
+		return "cdma";
+	default:
+		return "unknown";
+	}
+}
+
+static const char *
+device_state_to_token (NMDeviceState state)
+{
+	switch (state) {
+	case NM_DEVICE_STATE_UNMANAGED:
+		return "unmanaged";
+	case NM_DEVICE_STATE_UNAVAILABLE:
+		return "unavailable";
+	case NM_DEVICE_STATE_DISCONNECTED:
+		return "disconnected";
+	case NM_DEVICE_STATE_PREPARE:
+		return "prepare";
+	case NM_DEVICE_STATE_CONFIG:
+		return "config";
+	case NM_DEVICE_STATE_NEED_AUTH:
+		return "need-auth";
+	case NM_DEVICE_STATE_IP_CONFIG:
+		return "ip-config";
+	case NM_DEVICE_STATE_ACTIVATED:
+		return "activated";
+	case NM_DEVICE_STATE_FAILED:
+		return "failed";
+	default:
+		return "unknown";
+	}
+}
+
+static const char *
+wifi_mode_to_token (NM80211Mode mode)
+{
+	switch (mode) {
+	case NM_802_11_MODE_ADHOC:
+		return "adhoc";
+	case NM_802_11_MODE_INFRA:
+		return "infrastructure";
+	default:
+		return "unknown";
+	}
 }
 
 static void
-show_cdma_specific_info (NMDevice * dev) {
-	NMCdmaDevice * device = NM_CDMA_DEVICE (dev);
+json_ip4_address (NMConfigJson * json, const char * key, guint32 address)
+{
+	struct in_addr tmp_addr;
+	char buf[INET_ADDRSTRLEN + 1];
 
-	//TODO: implement
-	device = device;
+	tmp_addr.s_addr = address;
+	inet_ntop (AF_INET, &tmp_addr, buf, sizeof (buf));
+	nm_config_json_string (json, key, buf);
+}
+
+static void
+json_ip6_address (NMConfigJson * json, const char * key,
+		const struct in6_addr * address)
+{
+	char buf[INET6_ADDRSTRLEN + 1];
 
-	g_print("%-9s CDMA specific info not yet implemented\n", "");
+	inet_ntop (AF_INET6, address, buf, sizeof (buf));
+	nm_config_json_string (json, key, buf);
 }
 
+static void
+json_domains (NMConfigJson * json, const GPtrArray * domains)
+{
+	int i;
+
+	nm_config_json_begin_array (json, "domains");
+	for (i = 0; i < domains->len; i++)
+		nm_config_json_string (json, NULL, g_ptr_array_index (domains, i));
+	nm_config_json_end_array (json);
+}
 
 static void
-show_device_type_specific_info (NMDevice * device)
+json_ip4_info (NMConfigJson * json, const NMConfigIP4Info * ip4)
 {
-	g_return_if_fail (NM_IS_DEVICE (device));
+	int i;
 
-	if (NM_IS_DEVICE_ETHERNET (device)) {
-		show_ethernet_specific_info (device);
+	if (!ip4) {
+		nm_config_json_null (json, "ip4");
+		return;
 	}
-	else if (NM_IS_DEVICE_WIFI (device)) {
-		show_wifi_specific_info (device);
+
+	nm_config_json_begin_object (json, "ip4");
+
+	nm_config_json_begin_array (json, "addresses");
+	for (i = 0; i < ip4->addresses->len; i++) {
+		const NMConfigIP4Address * address;
+
+		address = &g_array_index (ip4->addresses, NMConfigIP4Address, i);
+		nm_config_json_begin_object (json, NULL);
+		json_ip4_address (json, "address", address->address);
+		nm_config_json_uint (json, "prefix", address->prefix);
+		json_ip4_address (json, "gateway", address->gateway);
+		nm_config_json_end_object (json);
 	}
-	else if (NM_IS_DEVICE_BT (device)) {
-		show_bt_specific_info (device);
+	nm_config_json_end_array (json);
+
+	nm_config_json_begin_array (json, "nameservers");
+	for (i = 0; i < ip4->nameservers->len; i++)
+		json_ip4_address (json, NULL, g_array_index (ip4->nameservers, guint32, i));
+	nm_config_json_end_array (json);
+
+	json_domains (json, ip4->domains);
+
+	nm_config_json_end_object (json);
+}
+
+static void
+json_ip6_info (NMConfigJson * json, const NMConfigIP6Info * ip6)
+{
+	int i;
+
+	if (!ip6) {
+		nm_config_json_null (json, "ip6");
+		return;
 	}
-	else if (NM_IS_GSM_DEVICE (device)) {
-		show_gsm_specific_info (device);
+
+	nm_config_json_begin_object (json, "ip6");
+
+	nm_config_json_begin_array (json, "addresses");
+	for (i = 0; i < ip6->addresses->len; i++) {
+		const NMConfigIP6Address * address;
+
+		address = &g_array_index (ip6->addresses, NMConfigIP6Address, i);
+		nm_config_json_begin_object (json, NULL);
+		json_ip6_address (json, "address", &address->address);
+		nm_config_json_uint (json, "prefix", address->prefix);
+		nm_config_json_end_object (json);
 	}
-	else if (NM_IS_CDMA_DEVICE (device)) {
-		show_cdma_specific_info (device);
+	nm_config_json_end_array (json);
+
+	nm_config_json_begin_array (json, "nameservers");
+	for (i = 0; i < ip6->nameservers->len; i++)
+		json_ip6_address (json, NULL,
+				&g_array_index (ip6->nameservers, struct in6_addr, i));
+	nm_config_json_end_array (json);
+
+	json_domains (json, ip6->domains);
+
+	nm_config_json_end_object (json);
+}
+
+static void
+json_access_points (NMConfigJson * json, const NMConfigDeviceInfo * device,
+		guint max_aps)
+{
+	APSelection selection;
+	guint i;
+	gchar ** option;
+
+	nm_config_json_begin_array (json, "access_points");
+
+	if (device->aps && device->aps->len) {
+		select_access_points (&selection, device->aps, device->active_ap_path,
+				device->capabilities, max_aps);
+
+		for (i = 0; i < selection.shown; i++) {
+			guint index = selection.keys[i].index;
+			const NMConfigAPInfo * ap = g_ptr_array_index (device->aps, index);
+			char * ssid_str;
+
+			ssid_str = nm_utils_ssid_to_utf8 ((const char *) ap->ssid->data, ap->ssid->len);
+
+			nm_config_json_begin_object (json, NULL);
+			nm_config_json_string (json, "bssid", ap->bssid);
+			nm_config_json_string (json, "ssid", ssid_str);
+			nm_config_json_boolean (json, "active", selection.keys[i].active);
+			nm_config_json_uint (json, "frequency", ap->frequency);
+			nm_config_json_string (json, "mode", wifi_mode_to_token (ap->mode));
+			nm_config_json_uint (json, "strength", ap->strength);
+			nm_config_json_uint (json, "max_bitrate", ap->max_bitrate);
+			nm_config_json_begin_array (json, "security");
+			for (option = selection.securities[index]->options; *option; option++)
+				nm_config_json_string (json, NULL, *option);
+			nm_config_json_end_array (json);
+			nm_config_json_end_object (json);
+
+			g_free (ssid_str);
+		}
+
+		ap_selection_clear (&selection);
 	}
-	else {
-		g_printerr ("Unsupported device type: %s\n",
-				g_type_name (G_TYPE_FROM_INSTANCE (device)));
+
+	nm_config_json_end_array (json);
+}
+
+/* --fields. Fields which don't apply to a device, e.g. carrier of a wifi
+ * one, are printed as -- or written as null.
+ */
+
+static void
+text_ip4_addresses (const NMConfigIP4Info * ip4)
+{
+	struct in_addr tmp_addr;
+	char buf[INET_ADDRSTRLEN + 1];
+	int i;
+
+	if (!ip4 || ip4->addresses->len == 0) {
+		nm_config_print ("--");
+		return;
+	}
+
+	for (i = 0; i < ip4->addresses->len; i++) {
+		const NMConfigIP4Address * address;
+
+		address = &g_array_index (ip4->addresses, NMConfigIP4Address, i);
+		tmp_addr.s_addr = address->address;
+		inet_ntop (AF_INET, &tmp_addr, buf, sizeof (buf));
+		nm_config_print ("%s%s/%u", i ? "," : "", buf, address->prefix);
 	}
 }
 
+static void
+text_ip6_addresses (const NMConfigIP6Info * ip6)
+{
+	char buf[INET6_ADDRSTRLEN + 1];
+	int i;
+
+	if (!ip6 || ip6->addresses->len == 0) {
+		nm_config_print ("--");
+		return;
+	}
+
+	for (i = 0; i < ip6->addresses->len; i++) {
+		const NMConfigIP6Address * address;
+
+		address = &g_array_index (ip6->addresses, NMConfigIP6Address, i);
+		inet_ntop (AF_INET6, &address->address, buf, sizeof (buf));
+		nm_config_print ("%s%s/%u", i ? "," : "", buf, address->prefix);
+	}
+}
+
+static void
+text_string (const char * value)
+{
+	nm_config_print ("%s", value ? value : "--");
+}
+
+static void
+text_device_field (const NMConfigDeviceInfo * device, NMConfigField field)
+{
+	gboolean ethernet = device->type == NM_DEVICE_TYPE_ETHERNET;
+	gboolean wifi = device->type == NM_DEVICE_TYPE_WIFI;
+	gchar * capa_strs[6];
+	gint capas_num, i;
+
+	switch (field) {
+	case NM_CONFIG_FIELD_IFACE:
+		text_string (device->iface);
+		break;
+	case NM_CONFIG_FIELD_TYPE:
+		text_string (device_type_to_token (device->type));
+		break;
+	case NM_CONFIG_FIELD_MANAGED:
+		text_string (device->managed ? "yes" : "no");
+		break;
+	case NM_CONFIG_FIELD_STATE:
+		text_string (device_state_to_token (device->state));
+		break;
+	case NM_CONFIG_FIELD_CONNECTION:
+		text_string (device->connection_id);
+		break;
+	case NM_CONFIG_FIELD_IP4:
+		text_ip4_addresses (device->ip4);
+		break;
+	case NM_CONFIG_FIELD_IP6:
+		text_ip6_addresses (device->ip6);
+		break;
+	case NM_CONFIG_FIELD_DRIVER:
+		text_string (device->driver);
+		break;
+	case NM_CONFIG_FIELD_UDI:
+		text_string (device->udi);
+		break;
+	case NM_CONFIG_FIELD_HW_ADDRESS:
+		text_string (device->hw_address);
+		break;
+	case NM_CONFIG_FIELD_CARRIER:
+		text_string (ethernet ? (device->carrier ? "yes" : "no") : NULL);
+		break;
+	case NM_CONFIG_FIELD_SPEED:
+		if (ethernet && device->carrier)
+			nm_config_print ("%u", device->speed);
+		else
+			text_string (NULL);
+		break;
+	case NM_CONFIG_FIELD_MODE:
+		text_string (wifi ? wifi_mode_to_token (device->mode) : NULL);
+		break;
+	case NM_CONFIG_FIELD_BITRATE:
+		if (wifi)
+			nm_config_print ("%u", device->bitrate);
+		else
+			text_string (NULL);
+		break;
+	case NM_CONFIG_FIELD_CAPABILITIES:
+		if (!wifi) {
+			text_string (NULL);
+			break;
+		}
+		capas_num = wifi_capabilities_to_strings (device->capabilities, capa_strs);
+		for (i = 0; i < capas_num; i++)
+			nm_config_print ("%s%s", i ? "," : "", capa_strs[i]);
+		if (capas_num == 0)
+			nm_config_print ("none");
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+text_ap_field (const NMConfigAPInfo * ap, gboolean active,
+		const APSecurity * security, NMConfigField field)
+{
+	char * ssid_str;
+	gchar ** option;
+
+	switch (field) {
+	case NM_CONFIG_FIELD_AP_BSSID:
+		text_string (ap->bssid);
+		break;
+	case NM_CONFIG_FIELD_AP_SSID:
+		ssid_str = nm_utils_ssid_to_utf8 ((const char *) ap->ssid->data, ap->ssid->len);
+		text_string (ssid_str);
+		g_free (ssid_str);
+		break;
+	case NM_CONFIG_FIELD_AP_ACTIVE:
+		text_string (active ? "yes" : "no");
+		break;
+	case NM_CONFIG_FIELD_AP_FREQUENCY:
+		nm_config_print ("%u", ap->frequency);
+		break;
+	case NM_CONFIG_FIELD_AP_MODE:
+		text_string (wifi_mode_to_token (ap->mode));
+		break;
+	case NM_CONFIG_FIELD_AP_STRENGTH:
+		nm_config_print ("%u", ap->strength);
+		break;
+	case NM_CONFIG_FIELD_AP_MAX_BITRATE:
+		nm_config_print ("%u", ap->max_bitrate);
+		break;
+	case NM_CONFIG_FIELD_AP_SECURITY:
+		for (option = security->options; *option; option++)
+			nm_config_print ("%s%s", option != security->options ? "," : "", *option);
+		if (!security->options[0])
+			nm_config_print ("none");
+		break;
+	default:
+		break;
+	}
+}
+
+/* Access points are read only for the access point fields. Whichever
+ * are selected, the ones the device can't use are left out, as in the
+ * full info.
+ */
+static gboolean
+select_field_access_points (APSelection * selection,
+		const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options)
+{
+	if (!device->aps || !device->aps->len
+		|| !(options->fields.mask >> NM_CONFIG_FIELD_FIRST_AP))
+		return FALSE;
+
+	select_access_points (selection, device->aps, device->active_ap_path,
+			device->capabilities, options->max_aps);
+	return TRUE;
+}
+
 void
-nm_config_device_show_generic_info (NMDevice * device)
+nm_config_device_show_fields (const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options)
 {
-	show_generic_info (device);
-	g_print ("\n");
+	const NMConfigFields * fields = &options->fields;
+	APSelection selection;
+	gboolean shown = FALSE;
+	guint i, j;
+
+	g_return_if_fail (device != NULL);
+	g_return_if_fail (fields->len > 0);
+
+	/* The interface keys the line, and labels the access points below */
+	if (!nm_config_fields_has (fields, NM_CONFIG_FIELD_IFACE)) {
+		text_device_field (device, NM_CONFIG_FIELD_IFACE);
+		shown = TRUE;
+	}
+
+	for (i = 0; i < fields->len; i++) {
+		if (fields->list[i] >= NM_CONFIG_FIELD_FIRST_AP)
+			continue;
+		if (shown)
+			nm_config_print ("\t");
+		text_device_field (device, fields->list[i]);
+		shown = TRUE;
+	}
+	nm_config_print ("\n");
+
+	if (!select_field_access_points (&selection, device, options))
+		return;
+
+	for (i = 0; i < selection.shown; i++) {
+		guint index = selection.keys[i].index;
+
+		for (j = 0; j < fields->len; j++) {
+			if (fields->list[j] < NM_CONFIG_FIELD_FIRST_AP)
+				continue;
+			nm_config_print ("\t");
+			text_ap_field (g_ptr_array_index (device->aps, index),
+					selection.keys[i].active, selection.securities[index],
+					fields->list[j]);
+		}
+		nm_config_print ("\n");
+	}
+
+	ap_selection_clear (&selection);
+}
+
+static void
+json_device_field (NMConfigJson * json, const NMConfigDeviceInfo * device,
+		NMConfigField field)
+{
+	const char * key = nm_config_field_to_string (field);
+	gboolean ethernet = device->type == NM_DEVICE_TYPE_ETHERNET;
+	gboolean wifi = device->type == NM_DEVICE_TYPE_WIFI;
+	gchar * capa_strs[6];
+	gint capas_num, i;
+
+	switch (field) {
+	case NM_CONFIG_FIELD_IFACE:
+		nm_config_json_string (json, key, device->iface);
+		break;
+	case NM_CONFIG_FIELD_TYPE:
+		nm_config_json_string (json, key, device_type_to_token (device->type));
+		break;
+	case NM_CONFIG_FIELD_MANAGED:
+		nm_config_json_boolean (json, key, device->managed);
+		break;
+	case NM_CONFIG_FIELD_STATE:
+		nm_config_json_string (json, key, device_state_to_token (device->state));
+		break;
+	case NM_CONFIG_FIELD_CONNECTION:
+		if (device->connection_id || device->connection_uuid) {
+			nm_config_json_begin_object (json, key);
+			nm_config_json_string (json, "id", device->connection_id);
+			nm_config_json_string (json, "uuid", device->connection_uuid);
+			nm_config_json_end_object (json);
+		}
+		else
+			nm_config_json_null (json, key);
+		break;
+	case NM_CONFIG_FIELD_IP4:
+		json_ip4_info (json, device->ip4);
+		break;
+	case NM_CONFIG_FIELD_IP6:
+		json_ip6_info (json, device->ip6);
+		break;
+	case NM_CONFIG_FIELD_DRIVER:
+		nm_config_json_string (json, key, device->driver);
+		break;
+	case NM_CONFIG_FIELD_UDI:
+		nm_config_json_string (json, key, device->udi);
+		break;
+	case NM_CONFIG_FIELD_HW_ADDRESS:
+		nm_config_json_string (json, key, device->hw_address);
+		break;
+	case NM_CONFIG_FIELD_CARRIER:
+		if (ethernet)
+			nm_config_json_boolean (json, key, device->carrier);
+		else
+			nm_config_json_null (json, key);
+		break;
+	case NM_CONFIG_FIELD_SPEED:
+		if (ethernet && device->carrier)
+			nm_config_json_uint (json, key, device->speed);
+		else
+			nm_config_json_null (json, key);
+		break;
+	case NM_CONFIG_FIELD_MODE:
+		nm_config_json_string (json, key, wifi ? wifi_mode_to_token (device->mode) : NULL);
+		break;
+	case NM_CONFIG_FIELD_BITRATE:
+		if (wifi)
+			nm_config_json_uint (json, key, device->bitrate);
+		else
+			nm_config_json_null (json, key);
+		break;
+	case NM_CONFIG_FIELD_CAPABILITIES:
+		if (!wifi) {
+			nm_config_json_null (json, key);
+			break;
+		}
+		capas_num = wifi_capabilities_to_strings (device->capabilities, capa_strs);
+		nm_config_json_begin_array (json, key);
+		for (i = 0; i < capas_num; i++)
+			nm_config_json_string (json, NULL, capa_strs[i]);
+		nm_config_json_end_array (json);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+json_ap_field (NMConfigJson * json, const NMConfigAPInfo * ap, gboolean active,
+		const APSecurity * security, NMConfigField field)
+{
+	/* Within access_points the ap. prefix is left out */
+	const char * key = nm_config_field_to_string (field) + 3;
+	char * ssid_str;
+	gchar ** option;
+
+	switch (field) {
+	case NM_CONFIG_FIELD_AP_BSSID:
+		nm_config_json_string (json, key, ap->bssid);
+		break;
+	case NM_CONFIG_FIELD_AP_SSID:
+		ssid_str = nm_utils_ssid_to_utf8 ((const char *) ap->ssid->data, ap->ssid->len);
+		nm_config_json_string (json, key, ssid_str);
+		g_free (ssid_str);
+		break;
+	case NM_CONFIG_FIELD_AP_ACTIVE:
+		nm_config_json_boolean (json, key, active);
+		break;
+	case NM_CONFIG_FIELD_AP_FREQUENCY:
+		nm_config_json_uint (json, key, ap->frequency);
+		break;
+	case NM_CONFIG_FIELD_AP_MODE:
+		nm_config_json_string (json, key, wifi_mode_to_token (ap->mode));
+		break;
+	case NM_CONFIG_FIELD_AP_STRENGTH:
+		nm_config_json_uint (json, key, ap->strength);
+		break;
+	case NM_CONFIG_FIELD_AP_MAX_BITRATE:
+		nm_config_json_uint (json, key, ap->max_bitrate);
+		break;
+	case NM_CONFIG_FIELD_AP_SECURITY:
+		nm_config_json_begin_array (json, key);
+		for (option = security->options; *option; option++)
+			nm_config_json_string (json, NULL, *option);
+		nm_config_json_end_array (json);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+json_fields (NMConfigJson * json, const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options)
+{
+	const NMConfigFields * fields = &options->fields;
+	APSelection selection;
+	guint i, j;
+
+	for (i = 0; i < fields->len; i++) {
+		if (fields->list[i] < NM_CONFIG_FIELD_FIRST_AP)
+			json_device_field (json, device, fields->list[i]);
+	}
+
+	if (device->type != NM_DEVICE_TYPE_WIFI
+		|| !(fields->mask >> NM_CONFIG_FIELD_FIRST_AP))
+		return;
+
+	nm_config_json_begin_array (json, "access_points");
+
+	if (select_field_access_points (&selection, device, options)) {
+		for (i = 0; i < selection.shown; i++) {
+			guint index = selection.keys[i].index;
+
+			nm_config_json_begin_object (json, NULL);
+			for (j = 0; j < fields->len; j++) {
+				if (fields->list[j] >= NM_CONFIG_FIELD_FIRST_AP)
+					json_ap_field (json, g_ptr_array_index (device->aps, index),
+							selection.keys[i].active, selection.securities[index],
+							fields->list[j]);
+			}
+			nm_config_json_end_object (json);
+		}
+
+		ap_selection_clear (&selection);
+	}
+
+	nm_config_json_end_array (json);
 }
 
+/* Same content as nm_config_device_show_full_info(), as one JSON object,
+ * or only the --fields of options
+ */
 void
-nm_config_device_show_full_info (NMDevice * device)
+nm_config_device_write_json (NMConfigJson * json, const char * key,
+		const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options)
 {
-	show_generic_info (device);
-	show_device_type_specific_info (device);
-	g_print ("\n");
+	gchar * capa_strs[6];
+	gint capas_num, i;
+
+	g_return_if_fail (json != NULL);
+	g_return_if_fail (device != NULL);
+
+	nm_config_json_begin_object (json, key);
+
+	if (options->fields.len) {
+		json_fields (json, device, options);
+		nm_config_json_end_object (json);
+		return;
+	}
+
+	nm_config_json_string (json, "iface", device->iface);
+	nm_config_json_string (json, "type", device_type_to_token (device->type));
+	nm_config_json_boolean (json, "managed", device->managed);
+
+	if (device->managed) {
+		nm_config_json_string (json, "state", device_state_to_token (device->state));
+		if (device->connection_id || device->connection_uuid) {
+			nm_config_json_begin_object (json, "connection");
+			nm_config_json_string (json, "id", device->connection_id);
+			nm_config_json_string (json, "uuid", device->connection_uuid);
+			nm_config_json_end_object (json);
+		}
+		else
+			nm_config_json_null (json, "connection");
+		json_ip4_info (json, device->ip4);
+		json_ip6_info (json, device->ip6);
+		nm_config_json_string (json, "driver", device->driver);
+		nm_config_json_string (json, "udi", device->udi);
+	}
+
+	switch (device->type) {
+	case NM_DEVICE_TYPE_ETHERNET:
+		nm_config_json_string (json, "hw_address", device->hw_address);
+		nm_config_json_boolean (json, "carrier", device->carrier);
+		if (device->carrier)
+			nm_config_json_uint (json, "speed", device->speed);
+		break;
+	case NM_DEVICE_TYPE_WIFI:
+		nm_config_json_string (json, "hw_address", device->hw_address);
+		nm_config_json_string (json, "mode", wifi_mode_to_token (device->mode));
+		nm_config_json_uint (json, "bitrate", device->bitrate);
+
+		capas_num = wifi_capabilities_to_strings (device->capabilities, capa_strs);
+		nm_config_json_begin_array (json, "capabilities");
+		for (i = 0; i < capas_num; i++)
+			nm_config_json_string (json, NULL, capa_strs[i]);
+		nm_config_json_end_array (json);
+
+		json_access_points (json, device, options->max_aps);
+		break;
+	default:
+		break;
+	}
+
+	nm_config_json_end_object (json);
 }
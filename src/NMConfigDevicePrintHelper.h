@@ -22,9 +22,49 @@
 #ifndef NM_CONFIG_DEVICE_PRINT_HELPER_H
 #define NM_CONFIG_DEVICE_PRINT_HELPER_H
 
-#include <nm-device.h>
+#include "NMConfigSnapshot.h"
+#include "NMConfigFields.h"
+#include "NMConfigJson.h"
 
-void nm_config_device_show_generic_info (NMDevice * device);
-void nm_config_device_show_full_info (NMDevice * device);
+typedef struct {
+	guint max_aps; /* 0 means show all access points */
+	NMConfigFields fields; /* --fields, empty for the full info */
+} NMConfigDevicePrintOptions;
+
+gchar * nm_config_state_to_string (NMState state);
+gchar * nm_config_device_state_to_string (NMDeviceState state);
+
+void nm_config_device_show_generic_info (const NMConfigDeviceInfo * device);
+void nm_config_device_show_full_info (const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options);
+
+/* State, addresses and, for wifi, the strongest access points */
+void nm_config_device_show_summary (const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options);
+
+/* The --fields of device on one line, tab separated, and of each of its
+ * access points on a line of their own starting with a tab. The line of
+ * the device starts with its interface name unless iface is selected.
+ */
+void nm_config_device_show_fields (const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options);
+
+/* Security of access points as worked out for one device, kept across
+ * nm_config_device_show_access_point() calls for that device.
+ */
+typedef struct _NMConfigAPSecurityCache NMConfigAPSecurityCache;
+
+NMConfigAPSecurityCache * nm_config_ap_security_cache_new (void);
+void nm_config_ap_security_cache_free (NMConfigAPSecurityCache * cache);
+
+/* One access point of device, as listed in its full info. Returns FALSE,
+ * printing nothing, if the device can't use the access point.
+ */
+gboolean nm_config_device_show_access_point (const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap, NMConfigAPSecurityCache * cache);
+
+void nm_config_device_write_json (NMConfigJson * json, const char * key,
+		const NMConfigDeviceInfo * device,
+		const NMConfigDevicePrintOptions * options);
 
 #endif /* NM_CONFIG_DEVICE_PRINT_HELPER_H */
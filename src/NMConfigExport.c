@@ -0,0 +1,316 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <dbus/dbus-glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigExport.h"
+#include "NMConfigConnections.h"
+#include "NMConfigConnectionPrintHelper.h"
+#include "NMConfigJson.h"
+#include "NMConfigKeyfile.h"
+#include "NMConfigPrint.h"
+#include "NMConfigSnapshot.h"
+#include "NMConfigStats.h"
+
+#define DBUS_TYPE_G_MAP_OF_VARIANT \
+	(dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, G_TYPE_VALUE))
+#define DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT \
+	(dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, DBUS_TYPE_G_MAP_OF_VARIANT))
+
+typedef struct {
+	DBusGProxy * proxy;    /* while the call is out */
+	GHashTable * settings; /* NULL if it couldn't be read */
+	gboolean answered;
+} Slot;
+
+struct _NMConfigExport {
+	DBusGConnection * bus;
+	const GArray * entries;
+	NMConfigOutputFormat format;
+	gchar * path;
+	FILE * file;           /* NULL for the standard output */
+	GString * buffer;
+	NMConfigJson json;
+
+	GArray * slots;        /* Slot, indexed like the entries */
+	guint next_call;
+	guint next_write;
+	guint window;
+	gint timeout_ms;
+
+	guint done_id;
+	gint exit_code;
+	NMConfigExportFunc callback;
+	gpointer user_data;
+};
+
+typedef struct {
+	NMConfigExport * export;
+	guint slot;
+	gdouble started;
+} ExportCall;
+
+static void
+write_buffer (NMConfigExport * export)
+{
+	if (export->buffer->len == 0)
+		return;
+
+	if (export->file)
+		fwrite (export->buffer->str, 1, export->buffer->len, export->file);
+	else
+		nm_config_print_write (export->buffer->str, export->buffer->len);
+	g_string_truncate (export->buffer, 0);
+}
+
+static void
+write_connection (NMConfigExport * export, const NMConfigConnectionEntry * entry,
+		GHashTable * settings)
+{
+	const char * scope = entry->scope == NM_CONNECTION_SCOPE_USER ? "user" : "system";
+	GError * err = NULL;
+
+	switch (export->format) {
+	case NM_CONFIG_OUTPUT_JSON:
+	case NM_CONFIG_OUTPUT_NDJSON:
+		if (export->format == NM_CONFIG_OUTPUT_NDJSON)
+			nm_config_json_init (&export->json, export->buffer);
+		nm_config_json_begin_object (&export->json, NULL);
+		nm_config_json_string (&export->json, "scope", scope);
+		nm_config_connection_write_json (&export->json, "connection",
+				entry->info, settings);
+		nm_config_json_end_object (&export->json);
+		if (export->format == NM_CONFIG_OUTPUT_NDJSON)
+			g_string_append_c (export->buffer, '\n');
+		break;
+	default:
+		g_string_append_printf (export->buffer, "# %s, %s scope\n", entry->info->id, scope);
+		if (!nm_config_keyfile_write (export->buffer, settings, &err)) {
+			g_printerr ("Could not export %s: %s\n", entry->info->id, err->message);
+			g_error_free (err);
+			g_string_truncate (export->buffer, 0);
+			export->exit_code = 1;
+		}
+	}
+
+	write_buffer (export);
+}
+
+static gboolean
+done_cb (gpointer user_data)
+{
+	NMConfigExport * export = user_data;
+
+	export->done_id = 0;
+	export->callback (export->exit_code, export->user_data);
+
+	return FALSE;
+}
+
+static void
+finish (NMConfigExport * export)
+{
+	if (export->format == NM_CONFIG_OUTPUT_JSON) {
+		nm_config_json_end_array (&export->json);
+		nm_config_json_end_object (&export->json);
+		g_string_append_c (export->buffer, '\n');
+		write_buffer (export);
+	}
+
+	if (export->file) {
+		if (ferror (export->file) | fclose (export->file)) {
+			g_printerr ("Could not write %s: %s\n", export->path, g_strerror (errno));
+			export->exit_code = 1;
+		}
+		export->file = NULL;
+	}
+	else
+		nm_config_print_flush ();
+
+	/* Not from here: the callback may free the export */
+	export->done_id = g_idle_add (done_cb, export);
+}
+
+/* Writes the answers which have all the ones before them written */
+static void
+write_ready (NMConfigExport * export)
+{
+	while (export->next_write < export->entries->len) {
+		Slot * slot = &g_array_index (export->slots, Slot, export->next_write);
+
+		if (!slot->answered)
+			break;
+
+		if (slot->settings) {
+			write_connection (export, &g_array_index (export->entries,
+					NMConfigConnectionEntry, export->next_write), slot->settings);
+			g_hash_table_destroy (slot->settings);
+			slot->settings = NULL;
+		}
+		export->next_write++;
+	}
+}
+
+static void start_calls (NMConfigExport * export);
+
+static void
+get_settings_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	ExportCall * data = user_data;
+	NMConfigExport * export = data->export;
+	Slot * slot = &g_array_index (export->slots, Slot, data->slot);
+	GError * err = NULL;
+
+	nm_config_stats_call (NM_DBUS_IFACE_SETTINGS_CONNECTION, "GetSettings",
+			data->started);
+
+	if (!dbus_g_proxy_end_call (proxy, call, &err,
+			DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT, &slot->settings,
+			G_TYPE_INVALID)) {
+		g_printerr ("Could not read connection %s: %s\n",
+				dbus_g_proxy_get_path (proxy), err->message);
+		g_error_free (err);
+		slot->settings = NULL;
+		export->exit_code = 1;
+	}
+	slot->answered = TRUE;
+	nm_config_proxy_unref_later (slot->proxy);
+	slot->proxy = NULL;
+
+	write_ready (export);
+	start_calls (export);
+}
+
+/* Calls out and answers not yet written together stay within the
+ * window, so a slow answer holds back at most window connections.
+ */
+static void
+start_calls (NMConfigExport * export)
+{
+	while (export->next_call - export->next_write < export->window
+		&& export->next_call < export->entries->len) {
+		const NMConfigConnectionEntry * entry = &g_array_index (export->entries,
+				NMConfigConnectionEntry, export->next_call);
+		Slot * slot = &g_array_index (export->slots, Slot, export->next_call);
+		ExportCall * data = g_new0 (ExportCall, 1);
+
+		slot->proxy = dbus_g_proxy_new_for_name (export->bus,
+				entry->scope == NM_CONNECTION_SCOPE_USER ?
+					NM_DBUS_SERVICE_USER_SETTINGS : NM_DBUS_SERVICE_SYSTEM_SETTINGS,
+				entry->info->path, NM_DBUS_IFACE_SETTINGS_CONNECTION);
+
+		data->export = export;
+		data->slot = export->next_call++;
+		data->started = nm_config_stats_now ();
+
+		dbus_g_proxy_begin_call_with_timeout (slot->proxy, "GetSettings",
+				get_settings_cb, data, g_free, export->timeout_ms,
+				G_TYPE_INVALID);
+	}
+
+	if (export->next_write == export->entries->len && !export->done_id)
+		finish (export);
+}
+
+NMConfigExport *
+nm_config_export_new (DBusGConnection * bus, const GArray * entries,
+		NMConfigOutputFormat format, const char * path, guint window,
+		gint timeout_ms, NMConfigExportFunc callback, gpointer user_data,
+		GError ** error)
+{
+	NMConfigExport * export;
+	FILE * file = NULL;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (entries != NULL, NULL);
+	g_return_val_if_fail (window > 0, NULL);
+	g_return_val_if_fail (callback != NULL, NULL);
+
+	if (path) {
+		file = fopen (path, "w");
+		if (!file) {
+			g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+					"Could not open %s: %s", path, g_strerror (errno));
+			return NULL;
+		}
+	}
+
+	export = g_new0 (NMConfigExport, 1);
+	export->bus = dbus_g_connection_ref (bus);
+	export->entries = entries;
+	export->format = format;
+	export->path = g_strdup (path);
+	export->file = file;
+	export->buffer = g_string_sized_new (4096);
+	export->slots = g_array_new (FALSE, TRUE, sizeof (Slot));
+	g_array_set_size (export->slots, entries->len);
+	export->window = window;
+	export->timeout_ms = timeout_ms;
+	export->callback = callback;
+	export->user_data = user_data;
+
+	if (format == NM_CONFIG_OUTPUT_JSON) {
+		nm_config_json_init (&export->json, export->buffer);
+		nm_config_json_begin_object (&export->json, NULL);
+		nm_config_json_begin_array (&export->json, "connections");
+	}
+
+	start_calls (export);
+
+	return export;
+}
+
+void
+nm_config_export_free (NMConfigExport * export)
+{
+	int i;
+
+	if (!export)
+		return;
+
+	if (export->done_id)
+		g_source_remove (export->done_id);
+
+	for (i = 0; i < export->slots->len; i++) {
+		Slot * slot = &g_array_index (export->slots, Slot, i);
+
+		/* Pending calls are cancelled with their proxies */
+		if (slot->proxy)
+			g_object_unref (slot->proxy);
+		if (slot->settings)
+			g_hash_table_destroy (slot->settings);
+	}
+	g_array_free (export->slots, TRUE);
+
+	if (export->file)
+		fclose (export->file);
+	g_string_free (export->buffer, TRUE);
+	g_free (export->path);
+	dbus_g_connection_unref (export->bus);
+	g_free (export);
+}
@@ -0,0 +1,59 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+
+#ifndef NM_CONFIG_EXPORT_H
+#define NM_CONFIG_EXPORT_H
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+
+#include "NMConfigOutput.h"
+
+/*
+ * `nmconfig export`: writes all settings of stored connections, in
+ * nmconfig's key file format (see NMConfigKeyfile.h) for text output,
+ * or as JSON. At most window GetSettings calls are in flight, and each
+ * answer is written as soon as the ones before it are, so no more than
+ * window connections are held at a time.
+ */
+
+typedef struct _NMConfigExport NMConfigExport;
+
+/* Called from the main loop once every connection is written or failed;
+ * exit code is 0 if all of them were written. The export may be freed
+ * from the callback.
+ */
+typedef void (*NMConfigExportFunc) (gint exit_code, gpointer user_data);
+
+/* entries are NMConfigConnectionEntry, see NMConfigConnections.h, and
+ * must stay valid as long as the export runs. path NULL writes to the
+ * standard output. Returns NULL if path can't be opened.
+ */
+NMConfigExport * nm_config_export_new (DBusGConnection * bus,
+		const GArray * entries, NMConfigOutputFormat format, const char * path,
+		guint window, gint timeout_ms, NMConfigExportFunc callback,
+		gpointer user_data, GError ** error);
+
+void nm_config_export_free (NMConfigExport * export);
+
+#endif /* NM_CONFIG_EXPORT_H */
@@ -0,0 +1,165 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <string.h>
+#include <glib.h>
+
+#include "NMConfigFields.h"
+
+/* Indexed by NMConfigField; the names are the keys of the JSON output,
+ * access point fields prefixed with "ap."
+ */
+static const struct {
+	const char * name;
+	NMConfigFetchPlan plan; /* what has to be read besides the device */
+} fields_info[NM_CONFIG_N_FIELDS] = {
+	{ "iface", 0 },
+	{ "type", 0 },
+	{ "managed", 0 },
+	{ "state", 0 },
+	{ "connection", NM_CONFIG_FETCH_ACTIVE_CONNECTIONS },
+	{ "ip4", NM_CONFIG_FETCH_IP4 },
+	{ "ip6", NM_CONFIG_FETCH_IP6 },
+	{ "driver", 0 },
+	{ "udi", 0 },
+	{ "hw_address", NM_CONFIG_FETCH_WIRED | NM_CONFIG_FETCH_WIRELESS },
+	{ "carrier", NM_CONFIG_FETCH_WIRED },
+	{ "speed", NM_CONFIG_FETCH_WIRED },
+	{ "mode", NM_CONFIG_FETCH_WIRELESS },
+	{ "bitrate", NM_CONFIG_FETCH_WIRELESS },
+	{ "capabilities", NM_CONFIG_FETCH_WIRELESS },
+
+	/* The active one is listed first, security depends on the device's
+	 * capabilities: both need the wireless properties.
+	 */
+	{ "ap.bssid", NM_CONFIG_FETCH_ACCESS_POINTS | NM_CONFIG_FETCH_WIRELESS },
+	{ "ap.ssid", NM_CONFIG_FETCH_ACCESS_POINTS | NM_CONFIG_FETCH_WIRELESS },
+	{ "ap.active", NM_CONFIG_FETCH_ACCESS_POINTS | NM_CONFIG_FETCH_WIRELESS },
+	{ "ap.frequency", NM_CONFIG_FETCH_ACCESS_POINTS | NM_CONFIG_FETCH_WIRELESS },
+	{ "ap.mode", NM_CONFIG_FETCH_ACCESS_POINTS | NM_CONFIG_FETCH_WIRELESS },
+	{ "ap.strength", NM_CONFIG_FETCH_ACCESS_POINTS | NM_CONFIG_FETCH_WIRELESS },
+	{ "ap.max_bitrate", NM_CONFIG_FETCH_ACCESS_POINTS | NM_CONFIG_FETCH_WIRELESS },
+	{ "ap.security", NM_CONFIG_FETCH_ACCESS_POINTS | NM_CONFIG_FETCH_WIRELESS }
+};
+
+static gint
+field_from_string (const char * name)
+{
+	gint i;
+
+	for (i = 0; i < NM_CONFIG_N_FIELDS; i++) {
+		if (!strcmp (fields_info[i].name, name))
+			return i;
+	}
+
+	return -1;
+}
+
+gboolean
+nm_config_fields_parse (NMConfigFields * fields, const char * spec,
+		GError ** error)
+{
+	gchar ** names;
+	gint i, field;
+	gboolean ok = TRUE;
+
+	g_return_val_if_fail (fields != NULL, FALSE);
+	g_return_val_if_fail (spec != NULL, FALSE);
+
+	memset (fields, 0, sizeof (NMConfigFields));
+
+	names = g_strsplit (spec, ",", -1);
+	for (i = 0; ok && names[i]; i++) {
+		gchar * name = g_strstrip (names[i]);
+
+		field = field_from_string (name);
+		if (field < 0) {
+			g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+					"Unknown field: %s", name);
+			ok = FALSE;
+		}
+		else if (fields->mask & (1 << field)) {
+			g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+					"Field given twice: %s", name);
+			ok = FALSE;
+		}
+		else {
+			fields->list[fields->len++] = field;
+			fields->mask |= 1 << field;
+		}
+	}
+	g_strfreev (names);
+
+	if (ok && fields->len == 0) {
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+				"--fields names no field");
+		ok = FALSE;
+	}
+
+	if (!ok)
+		memset (fields, 0, sizeof (NMConfigFields));
+
+	return ok;
+}
+
+const char *
+nm_config_field_to_string (NMConfigField field)
+{
+	g_return_val_if_fail (field < NM_CONFIG_N_FIELDS, NULL);
+
+	return fields_info[field].name;
+}
+
+gboolean
+nm_config_fields_has (const NMConfigFields * fields, NMConfigField field)
+{
+	g_return_val_if_fail (fields != NULL, FALSE);
+
+	return fields->len == 0 || (fields->mask & (1 << field));
+}
+
+gboolean
+nm_config_fields_has_access_points (const NMConfigFields * fields)
+{
+	g_return_val_if_fail (fields != NULL, FALSE);
+
+	return fields->len == 0 || (fields->mask >> NM_CONFIG_FIELD_FIRST_AP);
+}
+
+/* Only the device objects themselves are always read: their properties
+ * tell the interface name the selection is matched against.
+ */
+NMConfigFetchPlan
+nm_config_fields_to_plan (const NMConfigFields * fields)
+{
+	NMConfigFetchPlan plan = 0;
+	guint i;
+
+	g_return_val_if_fail (fields != NULL, NM_CONFIG_FETCH_ALL);
+
+	if (fields->len == 0)
+		return NM_CONFIG_FETCH_ALL;
+
+	for (i = 0; i < fields->len; i++)
+		plan |= fields_info[fields->list[i]].plan;
+
+	return plan;
+}
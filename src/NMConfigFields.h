@@ -0,0 +1,90 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_FIELDS_H
+#define NM_CONFIG_FIELDS_H
+
+#include <glib.h>
+
+#include "NMConfigSnapshot.h"
+
+/*
+ * --fields: the device and access point properties a listing shows.
+ * A selection is compiled into the fetch plan reading only what it
+ * needs, see nm_config_fields_to_plan(), and printed by
+ * nm_config_device_show_fields() and nm_config_device_write_json().
+ */
+
+typedef enum {
+	/* devices */
+	NM_CONFIG_FIELD_IFACE = 0,
+	NM_CONFIG_FIELD_TYPE,
+	NM_CONFIG_FIELD_MANAGED,
+	NM_CONFIG_FIELD_STATE,
+	NM_CONFIG_FIELD_CONNECTION,
+	NM_CONFIG_FIELD_IP4,
+	NM_CONFIG_FIELD_IP6,
+	NM_CONFIG_FIELD_DRIVER,
+	NM_CONFIG_FIELD_UDI,
+	NM_CONFIG_FIELD_HW_ADDRESS,
+	NM_CONFIG_FIELD_CARRIER,       /* ethernet */
+	NM_CONFIG_FIELD_SPEED,
+	NM_CONFIG_FIELD_MODE,          /* wifi */
+	NM_CONFIG_FIELD_BITRATE,
+	NM_CONFIG_FIELD_CAPABILITIES,
+
+	/* access points of wifi devices, named ap.FIELD */
+	NM_CONFIG_FIELD_AP_BSSID,
+	NM_CONFIG_FIELD_AP_SSID,
+	NM_CONFIG_FIELD_AP_ACTIVE,
+	NM_CONFIG_FIELD_AP_FREQUENCY,
+	NM_CONFIG_FIELD_AP_MODE,
+	NM_CONFIG_FIELD_AP_STRENGTH,
+	NM_CONFIG_FIELD_AP_MAX_BITRATE,
+	NM_CONFIG_FIELD_AP_SECURITY,
+
+	NM_CONFIG_N_FIELDS
+} NMConfigField;
+
+#define NM_CONFIG_FIELD_FIRST_AP NM_CONFIG_FIELD_AP_BSSID
+
+typedef struct {
+	guint8 list[NM_CONFIG_N_FIELDS]; /* NMConfigField, in the order given */
+	guint len;                       /* 0 for everything */
+	guint32 mask;                    /* 1 << NMConfigField of each listed */
+} NMConfigFields;
+
+/* spec is a comma separated list of field names, e.g. "iface,state,ip4" */
+gboolean nm_config_fields_parse (NMConfigFields * fields, const char * spec,
+		GError ** error);
+
+const char * nm_config_field_to_string (NMConfigField field);
+
+/* TRUE if field is selected, or nothing is */
+gboolean nm_config_fields_has (const NMConfigFields * fields, NMConfigField field);
+
+/* TRUE if any access point field is selected, or nothing is */
+gboolean nm_config_fields_has_access_points (const NMConfigFields * fields);
+
+NMConfigFetchPlan nm_config_fields_to_plan (const NMConfigFields * fields);
+
+#endif /* NM_CONFIG_FIELDS_H */
@@ -0,0 +1,413 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+#include <dbus/dbus-glib.h>
+#include <dbus/dbus-glib-lowlevel.h>
+
+#include "NMConfigFleet.h"
+#include "NMConfigJson.h"
+#include "NMConfigPrint.h"
+#include "NMConfigSnapshot.h"
+
+typedef struct {
+	NMConfigFleet * fleet;
+	const char * address;
+	DBusConnection * connection; /* private, closed once the state is read */
+	DBusPendingCall * hello; /* until the bus daemon answers */
+	GString * listing;   /* until every bus before is printed */
+	gchar * error;       /* NULL if listed */
+	gboolean done;
+} Slot;
+
+struct _NMConfigFleet {
+	const NMConfigIfaceMatch * match;
+	NMConfigOutputFormat format;
+	NMConfigDevicePrintOptions options;
+	guint window;
+	gint timeout_ms;
+
+	Slot * slots;
+	guint n_slots;
+	guint next_start;
+	guint next_print;
+	guint in_flight;
+	guint failed;
+
+	/* JSON and NDJSON records */
+	GString * buffer;
+	NMConfigJson json;
+
+	guint done_id;
+	NMConfigFleetFunc callback;
+	gpointer user_data;
+};
+
+static void fill_window (NMConfigFleet * fleet);
+
+/* Output, one record per bus in the order given */
+
+static void
+print_begin (NMConfigFleet * fleet)
+{
+	if (fleet->format != NM_CONFIG_OUTPUT_JSON)
+		return;
+
+	nm_config_json_init (&fleet->json, fleet->buffer);
+	nm_config_json_begin_object (&fleet->json, NULL);
+	nm_config_json_begin_array (&fleet->json, "buses");
+}
+
+static void
+print_slot (NMConfigFleet * fleet, Slot * slot)
+{
+	gsize len;
+
+	if (slot->error)
+		g_printerr ("%s: %s\n", slot->address, slot->error);
+
+	if (fleet->format == NM_CONFIG_OUTPUT_TEXT) {
+		if (slot->error)
+			nm_config_print ("Bus %s: failed\n\n", slot->address);
+		else {
+			nm_config_print ("Bus %s:\n", slot->address);
+			nm_config_print_write (slot->listing->str, slot->listing->len);
+		}
+		return;
+	}
+
+	/* Each listing is the JSON document of a single bus */
+	if (fleet->format == NM_CONFIG_OUTPUT_NDJSON) {
+		nm_config_json_init (&fleet->json, fleet->buffer);
+		g_string_truncate (fleet->buffer, 0);
+	}
+
+	nm_config_json_begin_object (&fleet->json, NULL);
+	nm_config_json_string (&fleet->json, "bus", slot->address);
+	if (slot->error)
+		nm_config_json_string (&fleet->json, "error", slot->error);
+	else {
+		len = slot->listing->len;
+		while (len > 0 && slot->listing->str[len - 1] == '\n')
+			len--;
+		nm_config_json_raw (&fleet->json, "state", slot->listing->str, len);
+	}
+	nm_config_json_end_object (&fleet->json);
+
+	if (fleet->format == NM_CONFIG_OUTPUT_NDJSON)
+		g_string_append_c (fleet->buffer, '\n');
+	nm_config_print_write (fleet->buffer->str, fleet->buffer->len);
+	g_string_truncate (fleet->buffer, 0);
+}
+
+static void
+print_end (NMConfigFleet * fleet)
+{
+	if (fleet->format != NM_CONFIG_OUTPUT_JSON)
+		return;
+
+	nm_config_json_end_array (&fleet->json);
+	nm_config_json_end_object (&fleet->json);
+	g_string_append_c (fleet->buffer, '\n');
+	nm_config_print_write (fleet->buffer->str, fleet->buffer->len);
+	g_string_truncate (fleet->buffer, 0);
+}
+
+static gboolean
+done_cb (gpointer user_data)
+{
+	NMConfigFleet * fleet = user_data;
+
+	fleet->done_id = 0;
+
+	/* The callback may free the fleet */
+	fleet->callback (fleet->failed, fleet->user_data);
+
+	return FALSE;
+}
+
+/* Print the listings whose turn it is, and drop them */
+static void
+print_ready (NMConfigFleet * fleet)
+{
+	while (fleet->next_print < fleet->n_slots
+		&& fleet->slots[fleet->next_print].done) {
+		Slot * slot = &fleet->slots[fleet->next_print++];
+
+		print_slot (fleet, slot);
+		if (slot->listing) {
+			g_string_free (slot->listing, TRUE);
+			slot->listing = NULL;
+		}
+	}
+
+	if (fleet->next_print == fleet->n_slots && !fleet->done_id) {
+		print_end (fleet);
+		nm_config_print_flush ();
+		fleet->done_id = g_idle_add (done_cb, fleet);
+	}
+}
+
+/* Reading */
+
+/* Records the outcome of slot, leaving the printing to the caller */
+static void
+slot_done (Slot * slot, const char * error)
+{
+	NMConfigFleet * fleet = slot->fleet;
+
+	slot->done = TRUE;
+	if (error) {
+		slot->error = g_strdup (error);
+		fleet->failed++;
+	}
+
+	/* The connection isn't needed once the state is read */
+	if (slot->connection) {
+		dbus_connection_close (slot->connection);
+		dbus_connection_unref (slot->connection);
+		slot->connection = NULL;
+	}
+
+	fleet->in_flight--;
+}
+
+static void
+slot_finish (Slot * slot, const char * error)
+{
+	slot_done (slot, error);
+	fill_window (slot->fleet);
+}
+
+static void
+render_listing (NMConfigFleet * fleet, Slot * slot, const NMConfigSnapshot * snapshot)
+{
+	NMConfigOutput * output;
+	guint i;
+
+	/* NDJSON records of a bus are kept together in one document */
+	output = nm_config_output_new (fleet->format == NM_CONFIG_OUTPUT_TEXT ?
+			NM_CONFIG_OUTPUT_TEXT : NM_CONFIG_OUTPUT_JSON, &fleet->options);
+
+	slot->listing = g_string_new (NULL);
+	nm_config_print_capture (slot->listing);
+
+	nm_config_output_manager (output, snapshot);
+	for (i = 0; i < snapshot->devices->len; i++)
+		nm_config_output_device (output, g_ptr_array_index (snapshot->devices, i));
+	nm_config_output_finish (output);
+
+	nm_config_print_capture (NULL);
+	nm_config_output_free (output);
+}
+
+static void
+snapshot_ready_cb (NMConfigSnapshot * snapshot, GError * error,
+		gpointer user_data)
+{
+	Slot * slot = user_data;
+
+	if (!snapshot) {
+		slot_finish (slot, error->message);
+		return;
+	}
+
+	render_listing (slot->fleet, slot, snapshot);
+	nm_config_snapshot_free (snapshot);
+	slot_finish (slot, NULL);
+}
+
+static void
+fetch_slot (NMConfigFleet * fleet, Slot * slot)
+{
+	DBusGConnection * bus = dbus_connection_get_g_connection (slot->connection);
+
+	nm_config_snapshot_fetch_streaming (bus, fleet->match,
+			nm_config_fields_to_plan (&fleet->options.fields),
+			NULL, snapshot_ready_cb, slot);
+}
+
+/* Without a unique name, NetworkManager can't be called by its name */
+static void
+hello_cb (DBusPendingCall * pending, void * user_data)
+{
+	Slot * slot = user_data;
+	NMConfigFleet * fleet = slot->fleet;
+	DBusMessage * reply;
+	DBusError dbus_error;
+	const char * name = NULL;
+
+	reply = dbus_pending_call_steal_reply (pending);
+	dbus_pending_call_unref (slot->hello);
+	slot->hello = NULL;
+
+	/* A timeout arrives as an error reply as well */
+	dbus_error_init (&dbus_error);
+	if (dbus_set_error_from_message (&dbus_error, reply)
+		|| !dbus_message_get_args (reply, &dbus_error,
+				DBUS_TYPE_STRING, &name, DBUS_TYPE_INVALID)) {
+		dbus_message_unref (reply);
+		slot_finish (slot, dbus_error.message);
+		dbus_error_free (&dbus_error);
+		return;
+	}
+
+	dbus_bus_set_unique_name (slot->connection, name);
+	dbus_message_unref (reply);
+
+	fetch_slot (fleet, slot);
+}
+
+/* Only connecting blocks, on a local socket briefly; authentication and
+ * Hello run from the main loop. The connection is private: a shared one
+ * would stay open, held by libdbus, after the slot is done with it.
+ */
+static void
+start_slot (NMConfigFleet * fleet, Slot * slot)
+{
+	DBusMessage * hello;
+	DBusError dbus_error;
+
+	fleet->in_flight++;
+
+	dbus_error_init (&dbus_error);
+	slot->connection = dbus_connection_open_private (slot->address, &dbus_error);
+	if (!slot->connection) {
+		slot_done (slot, dbus_error.message);
+		dbus_error_free (&dbus_error);
+		return;
+	}
+	dbus_connection_setup_with_g_main (slot->connection, NULL);
+
+	hello = dbus_message_new_method_call (DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+			DBUS_INTERFACE_DBUS, "Hello");
+	if (!dbus_connection_send_with_reply (slot->connection, hello, &slot->hello,
+			fleet->timeout_ms) || !slot->hello) {
+		dbus_message_unref (hello);
+		slot_done (slot, "Could not send Hello to the bus daemon");
+		return;
+	}
+	dbus_message_unref (hello);
+
+	dbus_pending_call_set_notify (slot->hello, hello_cb, slot, NULL);
+}
+
+/* Start buses while there is room in the window. A bus failing at once
+ * only frees its place, the loop goes on with the next one.
+ */
+static void
+fill_window (NMConfigFleet * fleet)
+{
+	while (fleet->in_flight < fleet->window && fleet->next_start < fleet->n_slots)
+		start_slot (fleet, &fleet->slots[fleet->next_start++]);
+
+	print_ready (fleet);
+}
+
+NMConfigFleet *
+nm_config_fleet_new (const GPtrArray * addresses,
+		const NMConfigIfaceMatch * match, NMConfigOutputFormat format,
+		const NMConfigDevicePrintOptions * options, guint window,
+		gint timeout_ms, NMConfigFleetFunc callback, gpointer user_data)
+{
+	NMConfigFleet * fleet;
+	GHashTable * seen;
+	guint i;
+
+	g_return_val_if_fail (addresses != NULL, NULL);
+	g_return_val_if_fail (addresses->len > 0, NULL);
+	g_return_val_if_fail (options != NULL, NULL);
+	g_return_val_if_fail (window > 0, NULL);
+	g_return_val_if_fail (callback != NULL, NULL);
+
+	fleet = g_new0 (NMConfigFleet, 1);
+	fleet->match = match;
+	fleet->format = format;
+	fleet->options = *options;
+	fleet->window = window;
+	fleet->timeout_ms = timeout_ms;
+	fleet->callback = callback;
+	fleet->user_data = user_data;
+	fleet->buffer = g_string_sized_new (4096);
+
+	/* A bus given twice is listed once, at its first place */
+	seen = g_hash_table_new (g_str_hash, g_str_equal);
+	fleet->slots = g_new0 (Slot, addresses->len);
+	for (i = 0; i < addresses->len; i++) {
+		const char * address = g_ptr_array_index (addresses, i);
+
+		if (g_hash_table_lookup (seen, address))
+			continue;
+		g_hash_table_insert (seen, (gpointer) address, (gpointer) address);
+
+		fleet->slots[fleet->n_slots].fleet = fleet;
+		fleet->slots[fleet->n_slots].address = address;
+		fleet->n_slots++;
+	}
+	g_hash_table_destroy (seen);
+
+	print_begin (fleet);
+	fill_window (fleet);
+
+	return fleet;
+}
+
+guint
+nm_config_fleet_get_pending (const NMConfigFleet * fleet)
+{
+	g_return_val_if_fail (fleet != NULL, 0);
+
+	return fleet->n_slots - fleet->next_print;
+}
+
+void
+nm_config_fleet_free (NMConfigFleet * fleet)
+{
+	guint i;
+
+	if (!fleet)
+		return;
+
+	if (fleet->done_id)
+		g_source_remove (fleet->done_id);
+
+	for (i = 0; i < fleet->n_slots; i++) {
+		Slot * slot = &fleet->slots[i];
+
+		if (slot->hello) {
+			dbus_pending_call_cancel (slot->hello);
+			dbus_pending_call_unref (slot->hello);
+		}
+		if (slot->connection) {
+			dbus_connection_close (slot->connection);
+			dbus_connection_unref (slot->connection);
+		}
+		if (slot->listing)
+			g_string_free (slot->listing, TRUE);
+		g_free (slot->error);
+	}
+
+	g_free (fleet->slots);
+	g_string_free (fleet->buffer, TRUE);
+	g_free (fleet);
+}
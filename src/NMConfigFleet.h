@@ -0,0 +1,62 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_FLEET_H
+#define NM_CONFIG_FLEET_H
+
+#include <glib.h>
+
+#include "NMConfigDevicePrintHelper.h"
+#include "NMConfigOutput.h"
+#include "NMConfigIfaceMatch.h"
+
+/*
+ * --bus and --bus-list: the devices of the NetworkManagers on many
+ * buses, e.g. one per network namespace, listed by one process. At most
+ * window buses are read at a time, all of them from the main loop; the
+ * listings are printed in the order the buses were given, each labelled
+ * with its address.
+ */
+
+typedef struct _NMConfigFleet NMConfigFleet;
+
+/* Called once, from the main loop, when every bus was listed or failed;
+ * the fleet may be freed from the callback.
+ */
+typedef void (*NMConfigFleetFunc) (guint failed, gpointer user_data);
+
+/* addresses are D-Bus addresses, e.g. unix:path=/run/ns1/system_bus_socket;
+ * one given more than once is listed once. match, if not NULL, selects
+ * the devices listed. A bus whose daemon
+ * doesn't answer the Hello call within timeout_ms fails.
+ */
+NMConfigFleet * nm_config_fleet_new (const GPtrArray * addresses,
+		const NMConfigIfaceMatch * match, NMConfigOutputFormat format,
+		const NMConfigDevicePrintOptions * options, guint window,
+		gint timeout_ms, NMConfigFleetFunc callback, gpointer user_data);
+
+/* Buses not listed yet */
+guint nm_config_fleet_get_pending (const NMConfigFleet * fleet);
+
+void nm_config_fleet_free (NMConfigFleet * fleet);
+
+#endif /* NM_CONFIG_FLEET_H */
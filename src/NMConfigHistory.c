@@ -0,0 +1,523 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <nm-utils.h>
+
+#include "NMConfigHistory.h"
+#include "NMConfigPrint.h"
+
+/*
+ * History file format, version 1. All integers are little-endian
+ * guint32. The file is a FileHeader, the BSSID table of MAX_BSSIDS
+ * entries and the ring of header.slots samples; its size never changes
+ * once created.
+ *
+ * Samples are written at header.next, which then moves on and wraps
+ * around; header.filled counts the slots written so far. A sample names
+ * its access point by index into the BSSID table, whose entries are
+ * filled before header.n_bssids counts them, so a reader mapping the
+ * file while it's written sees complete entries only. A reader may see
+ * one sample half written, at worst.
+ */
+
+#define FILE_MAGIC "NMCHIST"
+#define FILE_VERSION 1
+
+#define MAX_BSSIDS 256
+#define MAX_IFACE 16 /* IFNAMSIZ */
+
+/* Strength is a percentage, it's counted in one bucket per value */
+#define MAX_STRENGTH 100
+
+typedef struct {
+	gchar magic[8];
+	guint32 version;
+	guint32 slots;
+	guint32 next;        /* slot the next sample goes to */
+	guint32 filled;      /* slots holding a sample, up to slots */
+	guint32 n_bssids;    /* entries used in the BSSID table */
+	guint32 reserved;
+	gchar iface[MAX_IFACE];
+} FileHeader;
+
+typedef struct {
+	gchar bssid[20];     /* NUL terminated */
+	guint8 ssid[32];
+	guint32 ssid_len;
+} FileBSSID;
+
+typedef struct {
+	guint32 time;        /* seconds since the epoch */
+	guint32 usec;
+	guint32 bssid;       /* index into the BSSID table */
+	guint32 strength;
+	guint32 frequency;   /* MHz */
+	guint32 max_bitrate; /* kb/s */
+	guint32 bitrate;     /* kb/s, the device's, 0 unless the access point is active */
+} FileSample;
+
+#define LE(value) GUINT32_TO_LE (value)
+#define FROM_LE(value) GUINT32_FROM_LE (value)
+
+static gsize
+file_length (guint32 slots)
+{
+	return sizeof (FileHeader) + MAX_BSSIDS * sizeof (FileBSSID)
+		+ (gsize) slots * sizeof (FileSample);
+}
+
+/* Writing */
+
+struct _NMConfigHistory {
+	gchar * path;
+	gchar * data;
+	gsize length;
+
+	FileHeader * header;
+	FileBSSID * bssids;
+	FileSample * samples;
+	guint32 slots;
+
+	GHashTable * indexes; /* BSSID -> index in the table + 1 */
+	gboolean full;        /* the BSSID table is, and it was said */
+};
+
+static gboolean
+check_header (const FileHeader * header, gsize length)
+{
+	guint32 slots = FROM_LE (header->slots);
+
+	return length >= sizeof (FileHeader)
+		&& !memcmp (header->magic, FILE_MAGIC, sizeof (header->magic))
+		&& FROM_LE (header->version) == FILE_VERSION
+		&& slots > 0
+		&& length == file_length (slots)
+		&& FROM_LE (header->next) < slots
+		&& FROM_LE (header->filled) <= slots
+		&& FROM_LE (header->n_bssids) <= MAX_BSSIDS;
+}
+
+NMConfigHistory *
+nm_config_history_open (const char * path, const char * iface,
+		guint slots, GError ** error)
+{
+	NMConfigHistory * history;
+	FileHeader header;
+	struct stat st;
+	gboolean created;
+	gsize length;
+	gchar * data;
+	guint32 i;
+	int fd;
+
+	g_return_val_if_fail (path != NULL, NULL);
+	g_return_val_if_fail (iface != NULL, NULL);
+	g_return_val_if_fail (slots > 0, NULL);
+
+	if (strlen (iface) >= MAX_IFACE) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				"Interface name too long: %s", iface);
+		return NULL;
+	}
+
+	fd = open (path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0 || fstat (fd, &st) < 0) {
+		int errsv = errno;
+
+		if (fd >= 0)
+			close (fd);
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errsv),
+				"Could not open %s: %s", path, g_strerror (errsv));
+		return NULL;
+	}
+
+	created = (st.st_size == 0);
+	if (created) {
+		length = file_length (slots);
+		if (ftruncate (fd, length) < 0) {
+			int errsv = errno;
+
+			close (fd);
+			g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errsv),
+					"Could not create %s: %s", path, g_strerror (errsv));
+			return NULL;
+		}
+	}
+	else {
+		length = st.st_size;
+		if (pread (fd, &header, sizeof (header), 0) != sizeof (header)
+			|| !check_header (&header, length)) {
+			close (fd);
+			g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+					"%s is not an nmconfig signal history", path);
+			return NULL;
+		}
+		if (strncmp (header.iface, iface, MAX_IFACE)) {
+			close (fd);
+			g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+					"%s is the history of %.*s, not of %s", path,
+					MAX_IFACE, header.iface, iface);
+			return NULL;
+		}
+	}
+
+	data = mmap (NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close (fd);
+	if (data == MAP_FAILED) {
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+				"Could not map %s: %s", path, g_strerror (errno));
+		return NULL;
+	}
+
+	history = g_new0 (NMConfigHistory, 1);
+	history->path = g_strdup (path);
+	history->data = data;
+	history->length = length;
+	history->header = (FileHeader *) data;
+	history->bssids = (FileBSSID *) (data + sizeof (FileHeader));
+	history->samples = (FileSample *) (data + sizeof (FileHeader)
+			+ MAX_BSSIDS * sizeof (FileBSSID));
+
+	if (created) {
+		memcpy (history->header->magic, FILE_MAGIC, sizeof (history->header->magic));
+		history->header->version = LE (FILE_VERSION);
+		history->header->slots = LE (slots);
+		strncpy (history->header->iface, iface, MAX_IFACE);
+	}
+	history->slots = FROM_LE (history->header->slots);
+
+	history->indexes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; i < FROM_LE (history->header->n_bssids); i++) {
+		history->bssids[i].bssid[sizeof (history->bssids[i].bssid) - 1] = '\0';
+		g_hash_table_insert (history->indexes, g_strdup (history->bssids[i].bssid),
+				GUINT_TO_POINTER (i + 1));
+	}
+
+	return history;
+}
+
+/* Index of ap in the BSSID table + 1, 0 if the table is full */
+static guint
+add_bssid (NMConfigHistory * history, const NMConfigAPInfo * ap)
+{
+	guint32 index = FROM_LE (history->header->n_bssids);
+	FileBSSID * entry;
+
+	if (index == MAX_BSSIDS) {
+		if (!history->full)
+			g_printerr ("%s: more than %d access points seen, new ones aren't recorded\n",
+					history->path, MAX_BSSIDS);
+		history->full = TRUE;
+		return 0;
+	}
+
+	entry = &history->bssids[index];
+	memset (entry, 0, sizeof (*entry));
+	g_strlcpy (entry->bssid, ap->bssid, sizeof (entry->bssid));
+	if (ap->ssid) {
+		guint32 len = MIN (ap->ssid->len, sizeof (entry->ssid));
+
+		memcpy (entry->ssid, ap->ssid->data, len);
+		entry->ssid_len = LE (len);
+	}
+
+	/* Counted once complete, for readers of the file */
+	history->header->n_bssids = LE (index + 1);
+	g_hash_table_insert (history->indexes, g_strdup (ap->bssid),
+			GUINT_TO_POINTER (index + 1));
+
+	return index + 1;
+}
+
+void
+nm_config_history_record (NMConfigHistory * history, const NMConfigAPInfo * ap,
+		guint32 bitrate, const GTimeVal * now)
+{
+	FileHeader * header;
+	FileSample * sample;
+	guint32 next, filled;
+	guint index;
+
+	g_return_if_fail (history != NULL);
+	g_return_if_fail (ap != NULL);
+	g_return_if_fail (now != NULL);
+
+	if (!ap->bssid)
+		return;
+
+	index = GPOINTER_TO_UINT (g_hash_table_lookup (history->indexes, ap->bssid));
+	if (!index && !(index = add_bssid (history, ap)))
+		return;
+
+	header = history->header;
+	next = FROM_LE (header->next);
+	sample = &history->samples[next];
+	sample->time = LE (now->tv_sec);
+	sample->usec = LE (now->tv_usec);
+	sample->bssid = LE (index - 1);
+	sample->strength = LE (ap->strength);
+	sample->frequency = LE (ap->frequency);
+	sample->max_bitrate = LE (ap->max_bitrate);
+	sample->bitrate = LE (bitrate);
+
+	header->next = LE ((next + 1) % history->slots);
+	filled = FROM_LE (header->filled);
+	if (filled < history->slots)
+		header->filled = LE (filled + 1);
+}
+
+void
+nm_config_history_close (NMConfigHistory * history)
+{
+	if (!history)
+		return;
+
+	munmap (history->data, history->length);
+	g_hash_table_destroy (history->indexes);
+	g_free (history->path);
+	g_free (history);
+}
+
+/* Reading, straight from the mapped file */
+
+typedef struct {
+	guint32 index;       /* in the BSSID table */
+	guint32 count;
+	guint32 min;
+	guint32 max;
+	guint64 sum;
+	guint32 histogram[MAX_STRENGTH + 1];
+	guint32 frequency;   /* of the newest sample */
+	guint32 max_bitrate;
+	guint32 active;      /* samples taken while it was the active one */
+	guint64 bitrate_sum;
+} BSSIDStats;
+
+static gdouble
+stats_average (const BSSIDStats * stats)
+{
+	return stats->count ? (gdouble) stats->sum / stats->count : 0;
+}
+
+/* Strongest first, as access points are listed */
+static gint
+compare_stats (gconstpointer a, gconstpointer b)
+{
+	const BSSIDStats * stats1 = *(const BSSIDStats * const *) a;
+	const BSSIDStats * stats2 = *(const BSSIDStats * const *) b;
+	gdouble average1 = stats_average (stats1);
+	gdouble average2 = stats_average (stats2);
+
+	if (average1 > average2)
+		return -1;
+	if (average1 < average2)
+		return 1;
+	return stats1->index < stats2->index ? -1 : (stats1->index > stats2->index);
+}
+
+/* Nearest rank: the smallest strength at least percent of the samples
+ * don't exceed.
+ */
+static guint
+stats_percentile (const BSSIDStats * stats, guint percent)
+{
+	guint64 rank = ((guint64) stats->count * percent + 99) / 100;
+	guint64 seen = 0;
+	guint strength;
+
+	if (rank == 0)
+		rank = 1;
+
+	for (strength = 0; strength <= MAX_STRENGTH; strength++) {
+		seen += stats->histogram[strength];
+		if (seen >= rank)
+			return strength;
+	}
+
+	return MAX_STRENGTH;
+}
+
+static void
+format_time (guint32 seconds, char * buf, gsize size)
+{
+	time_t time_value = seconds;
+	struct tm tm;
+
+	localtime_r (&time_value, &tm);
+	strftime (buf, size, "%Y-%m-%d %H:%M:%S", &tm);
+}
+
+static guint64
+sample_time (const FileSample * sample)
+{
+	return (guint64) FROM_LE (sample->time) * G_USEC_PER_SEC + FROM_LE (sample->usec);
+}
+
+static void
+print_stats (const FileBSSID * entry, const BSSIDStats * stats)
+{
+	gchar * ssid;
+
+	ssid = nm_utils_ssid_to_utf8 ((const char *) entry->ssid,
+			MIN (FROM_LE (entry->ssid_len), sizeof (entry->ssid)));
+
+	nm_config_print ("%s  SSID:%s  Samples:%u\n", entry->bssid, ssid ? ssid : "",
+			stats->count);
+	nm_config_print ("%-9s Signal min:%u  avg:%.1f  max:%u  p50:%u  p90:%u  p99:%u\n", "",
+			stats->min, stats_average (stats), stats->max,
+			stats_percentile (stats, 50), stats_percentile (stats, 90),
+			stats_percentile (stats, 99));
+	nm_config_print ("%-9s Frequency:%uMHz  MaxBitrate:%.1fMb/s", "",
+			stats->frequency, stats->max_bitrate / 1000.0);
+	if (stats->active)
+		nm_config_print ("  Bitrate:%.1fMb/s (average of %u samples while active)",
+				(gdouble) stats->bitrate_sum / stats->active / 1000.0, stats->active);
+	nm_config_print ("\n");
+
+	g_free (ssid);
+}
+
+gboolean
+nm_config_history_report (const char * path, guint seconds, GError ** error)
+{
+	GMappedFile * mapped;
+	const gchar * data;
+	const FileHeader * header;
+	const FileBSSID * entries;
+	const FileSample * samples;
+	BSSIDStats * stats;
+	GPtrArray * seen;
+	guint32 slots, filled, first, n_bssids, i;
+	guint64 newest = 0, since = 0, oldest = G_MAXUINT64;
+	guint total = 0;
+	char from[32], to[32];
+
+	g_return_val_if_fail (path != NULL, FALSE);
+
+	mapped = g_mapped_file_new (path, FALSE, error);
+	if (!mapped)
+		return FALSE;
+
+	data = g_mapped_file_get_contents (mapped);
+	header = (const FileHeader *) data;
+	if (!check_header (header, g_mapped_file_get_length (mapped))) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				"%s is not an nmconfig signal history", path);
+		g_mapped_file_free (mapped);
+		return FALSE;
+	}
+
+	entries = (const FileBSSID *) (data + sizeof (FileHeader));
+	samples = (const FileSample *) (data + sizeof (FileHeader)
+			+ MAX_BSSIDS * sizeof (FileBSSID));
+	slots = FROM_LE (header->slots);
+	filled = FROM_LE (header->filled);
+	n_bssids = FROM_LE (header->n_bssids);
+
+	/* Oldest sample first, it's where the next one goes once full */
+	first = filled < slots ? 0 : FROM_LE (header->next);
+
+	/* The window ends with the newest sample, so a history copied off
+	 * a node reads the same later on.
+	 */
+	if (seconds && filled) {
+		newest = sample_time (&samples[(first + filled - 1) % slots]);
+		since = newest > (guint64) seconds * G_USEC_PER_SEC
+			? newest - (guint64) seconds * G_USEC_PER_SEC : 0;
+	}
+
+	stats = g_new0 (BSSIDStats, n_bssids);
+	for (i = 0; i < n_bssids; i++)
+		stats[i].index = i;
+
+	newest = 0;
+	for (i = 0; i < filled; i++) {
+		const FileSample * sample = &samples[(first + i) % slots];
+		guint32 index = FROM_LE (sample->bssid);
+		guint32 strength = MIN (FROM_LE (sample->strength), MAX_STRENGTH);
+		guint64 time = sample_time (sample);
+		BSSIDStats * bssid_stats;
+
+		/* Entries are counted before samples refer to them, anything
+		 * else is a sample being written.
+		 */
+		if (index >= n_bssids || time < since)
+			continue;
+
+		bssid_stats = &stats[index];
+		if (!bssid_stats->count || strength < bssid_stats->min)
+			bssid_stats->min = strength;
+		if (strength > bssid_stats->max)
+			bssid_stats->max = strength;
+		bssid_stats->count++;
+		bssid_stats->sum += strength;
+		bssid_stats->histogram[strength]++;
+		bssid_stats->frequency = FROM_LE (sample->frequency);
+		bssid_stats->max_bitrate = FROM_LE (sample->max_bitrate);
+		if (sample->bitrate) {
+			bssid_stats->active++;
+			bssid_stats->bitrate_sum += FROM_LE (sample->bitrate);
+		}
+
+		oldest = MIN (oldest, time);
+		newest = MAX (newest, time);
+		total++;
+	}
+
+	seen = g_ptr_array_sized_new (n_bssids);
+	for (i = 0; i < n_bssids; i++) {
+		if (stats[i].count)
+			g_ptr_array_add (seen, &stats[i]);
+	}
+	g_ptr_array_sort (seen, compare_stats);
+
+	if (total == 0)
+		nm_config_print ("%.*s: no samples\n", MAX_IFACE, header->iface);
+	else {
+		format_time (oldest / G_USEC_PER_SEC, from, sizeof (from));
+		format_time (newest / G_USEC_PER_SEC, to, sizeof (to));
+		nm_config_print ("%.*s: %u samples of %u access points from %s to %s\n\n",
+				MAX_IFACE, header->iface, total, seen->len, from, to);
+	}
+
+	for (i = 0; i < seen->len; i++) {
+		const BSSIDStats * bssid_stats = g_ptr_array_index (seen, i);
+		FileBSSID entry = entries[bssid_stats->index];
+
+		entry.bssid[sizeof (entry.bssid) - 1] = '\0';
+		print_stats (&entry, bssid_stats);
+	}
+
+	g_ptr_array_free (seen, TRUE);
+	g_free (stats);
+	g_mapped_file_free (mapped);
+
+	return TRUE;
+}
@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_HISTORY_H
+#define NM_CONFIG_HISTORY_H
+
+#include <glib.h>
+
+#include "NMConfigSnapshot.h"
+
+/*
+ * Signal history of the access points seen by one wireless device, as
+ * written by the sample command: a file of fixed size, mapped shared
+ * and used as a ring of samples, the oldest overwritten first. See
+ * NMConfigHistory.c for the format.
+ */
+
+/* Samples kept by a new history file unless --slots is given */
+#define NM_CONFIG_HISTORY_DEFAULT_SLOTS 65536
+
+typedef struct _NMConfigHistory NMConfigHistory;
+
+/* Opens the history at path to add samples of iface. An existing
+ * history of the same interface is continued, with its own number of
+ * slots; else a new one of slots samples is created. Files which aren't
+ * histories are never overwritten.
+ */
+NMConfigHistory * nm_config_history_open (const char * path, const char * iface,
+		guint slots, GError ** error);
+
+/* Adds one sample of ap; bitrate is the device's, 0 if ap isn't the
+ * active access point. Writes to the mapping only, nothing is allocated
+ * unless the BSSID is new to the file.
+ */
+void nm_config_history_record (NMConfigHistory * history, const NMConfigAPInfo * ap,
+		guint32 bitrate, const GTimeVal * now);
+
+void nm_config_history_close (NMConfigHistory * history);
+
+/* Prints per BSSID statistics of the samples of the last seconds, or of
+ * all samples if seconds is 0.
+ */
+gboolean nm_config_history_report (const char * path, guint seconds,
+		GError ** error);
+
+#endif /* NM_CONFIG_HISTORY_H */
@@ -0,0 +1,118 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <fnmatch.h>
+#include <string.h>
+#include <glib.h>
+
+#include "NMConfigIfaceMatch.h"
+
+struct _NMConfigIfaceMatch {
+	GHashTable * name_set;
+	GPtrArray * names;
+	GPtrArray * patterns;
+};
+
+NMConfigIfaceMatch *
+nm_config_iface_match_new (const GPtrArray * names)
+{
+	NMConfigIfaceMatch * match;
+	int i;
+
+	g_return_val_if_fail (names != NULL, NULL);
+
+	match = g_new0 (NMConfigIfaceMatch, 1);
+	match->name_set = g_hash_table_new (g_str_hash, g_str_equal);
+	match->names = g_ptr_array_new ();
+	match->patterns = g_ptr_array_new ();
+
+	for (i = 0; i < names->len; i++) {
+		gchar * name = g_ptr_array_index (names, i);
+
+		if (strpbrk (name, "*?["))
+			g_ptr_array_add (match->patterns, g_strdup (name));
+		else if (!g_hash_table_lookup (match->name_set, name)) {
+			name = g_strdup (name);
+			g_ptr_array_add (match->names, name);
+			g_hash_table_insert (match->name_set, name, name);
+		}
+	}
+
+	return match;
+}
+
+gboolean
+nm_config_iface_match_pattern (const char * pattern, const char * iface)
+{
+	return fnmatch (pattern, iface, 0) == 0;
+}
+
+gboolean
+nm_config_iface_match_test (const NMConfigIfaceMatch * match,
+		const char * iface)
+{
+	int i;
+
+	g_return_val_if_fail (match != NULL, FALSE);
+
+	if (!iface)
+		return FALSE;
+
+	if (g_hash_table_lookup (match->name_set, iface))
+		return TRUE;
+
+	for (i = 0; i < match->patterns->len; i++) {
+		if (nm_config_iface_match_pattern (g_ptr_array_index (match->patterns, i), iface))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+const GPtrArray *
+nm_config_iface_match_get_names (const NMConfigIfaceMatch * match)
+{
+	g_return_val_if_fail (match != NULL, NULL);
+
+	return match->names;
+}
+
+const GPtrArray *
+nm_config_iface_match_get_patterns (const NMConfigIfaceMatch * match)
+{
+	g_return_val_if_fail (match != NULL, NULL);
+
+	return match->patterns;
+}
+
+void
+nm_config_iface_match_free (NMConfigIfaceMatch * match)
+{
+	if (!match)
+		return;
+
+	g_hash_table_destroy (match->name_set);
+	g_ptr_array_foreach (match->names, (GFunc) g_free, NULL);
+	g_ptr_array_free (match->names, TRUE);
+	g_ptr_array_foreach (match->patterns, (GFunc) g_free, NULL);
+	g_ptr_array_free (match->patterns, TRUE);
+	g_free (match);
+}
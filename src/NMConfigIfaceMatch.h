@@ -0,0 +1,49 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_IFACE_MATCH_H
+#define NM_CONFIG_IFACE_MATCH_H
+
+#include <glib.h>
+
+/*
+ * Interface names given on the command line. Plain names are looked up
+ * in a hash table, names with glob characters (*, ? or [) are matched
+ * as patterns.
+ */
+
+typedef struct _NMConfigIfaceMatch NMConfigIfaceMatch;
+
+NMConfigIfaceMatch * nm_config_iface_match_new (const GPtrArray * names);
+
+gboolean nm_config_iface_match_test (const NMConfigIfaceMatch * match,
+		const char * iface);
+
+/* Plain names, and patterns, in the order given */
+const GPtrArray * nm_config_iface_match_get_names (const NMConfigIfaceMatch * match);
+const GPtrArray * nm_config_iface_match_get_patterns (const NMConfigIfaceMatch * match);
+
+gboolean nm_config_iface_match_pattern (const char * pattern, const char * iface);
+
+void nm_config_iface_match_free (NMConfigIfaceMatch * match);
+
+#endif /* NM_CONFIG_IFACE_MATCH_H */
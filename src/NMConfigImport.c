@@ -0,0 +1,219 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dbus/dbus-glib.h>
+#include <NetworkManager.h>
+#include <nm-connection.h>
+#include <nm-setting-connection.h>
+
+#include "NMConfigImport.h"
+#include "NMConfigKeyfile.h"
+#include "NMConfigPrint.h"
+#include "NMConfigStats.h"
+
+#define DBUS_TYPE_G_MAP_OF_VARIANT \
+	(dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, G_TYPE_VALUE))
+#define DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT \
+	(dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, DBUS_TYPE_G_MAP_OF_VARIANT))
+
+struct _NMConfigImport {
+	gchar * path;
+	NMConfigKeyfileReader * reader;
+	gboolean eof;
+
+	DBusGProxy * proxy;
+	guint window;
+	guint in_flight;
+	gint timeout_ms;
+	GTimer * timer;
+	guint added;
+	guint failed;
+
+	guint done_id;
+	NMConfigImportFunc callback;
+	gpointer user_data;
+};
+
+typedef struct {
+	NMConfigImport * import;
+	gchar * id;
+	gdouble started;
+} ImportCall;
+
+static void
+import_call_free (gpointer data)
+{
+	ImportCall * call = data;
+
+	g_free (call->id);
+	g_free (call);
+}
+
+static gboolean
+done_cb (gpointer user_data)
+{
+	NMConfigImport * import = user_data;
+
+	import->done_id = 0;
+	import->callback (import->failed ? 1 : 0, import->user_data);
+
+	return FALSE;
+}
+
+static void
+finish (NMConfigImport * import)
+{
+	nm_config_print ("%u added, %u failed in %.3fs\n", import->added, import->failed,
+			g_timer_elapsed (import->timer, NULL));
+	nm_config_print_flush ();
+
+	/* Not from here: the callback may free the import */
+	import->done_id = g_idle_add (done_cb, import);
+}
+
+static void fill_window (NMConfigImport * import);
+
+static void
+add_connection_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	ImportCall * data = user_data;
+	NMConfigImport * import = data->import;
+	GError * err = NULL;
+
+	nm_config_stats_call (NM_DBUS_IFACE_SETTINGS, "AddConnection", data->started);
+
+	if (dbus_g_proxy_end_call (proxy, call, &err, G_TYPE_INVALID)) {
+		nm_config_print ("%s: added\n", data->id);
+		import->added++;
+	}
+	else {
+		nm_config_print ("%s: failed, %s\n", data->id, err->message);
+		g_error_free (err);
+		import->failed++;
+	}
+	nm_config_print_flush ();
+	import->in_flight--;
+
+	fill_window (import);
+}
+
+static void
+add_connection (NMConfigImport * import, NMConnection * connection)
+{
+	NMSettingConnection * s_con;
+	ImportCall * data = g_new0 (ImportCall, 1);
+	GHashTable * settings;
+
+	s_con = NM_SETTING_CONNECTION (nm_connection_get_setting (connection,
+			NM_TYPE_SETTING_CONNECTION));
+	data->import = import;
+	data->id = g_strdup (nm_setting_connection_get_id (s_con));
+	data->started = nm_config_stats_now ();
+	import->in_flight++;
+
+	/* The settings are marshalled right away */
+	settings = nm_connection_to_hash (connection);
+	dbus_g_proxy_begin_call_with_timeout (import->proxy, "AddConnection",
+			add_connection_cb, data, import_call_free, import->timeout_ms,
+			DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT, settings,
+			G_TYPE_INVALID);
+	g_hash_table_destroy (settings);
+}
+
+/* Reads no further than the window has room for */
+static void
+fill_window (NMConfigImport * import)
+{
+	while (!import->eof && import->in_flight < import->window) {
+		NMConnection * connection;
+		GError * err = NULL;
+
+		connection = nm_config_keyfile_reader_next (import->reader, &err);
+		if (connection) {
+			add_connection (import, connection);
+			g_object_unref (connection);
+		}
+		else if (err) {
+			g_printerr ("%s: %s\n", import->path, err->message);
+			g_error_free (err);
+			import->failed++;
+		}
+		else
+			import->eof = TRUE;
+	}
+
+	if (import->eof && import->in_flight == 0 && !import->done_id)
+		finish (import);
+}
+
+NMConfigImport *
+nm_config_import_new (DBusGConnection * bus, const char * path, guint window,
+		gint timeout_ms, NMConfigImportFunc callback, gpointer user_data,
+		GError ** error)
+{
+	NMConfigImport * import;
+	NMConfigKeyfileReader * reader;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (path != NULL, NULL);
+	g_return_val_if_fail (window > 0, NULL);
+	g_return_val_if_fail (callback != NULL, NULL);
+
+	reader = nm_config_keyfile_reader_new (path, error);
+	if (!reader)
+		return NULL;
+
+	import = g_new0 (NMConfigImport, 1);
+	import->path = g_strdup (path);
+	import->reader = reader;
+	import->proxy = dbus_g_proxy_new_for_name (bus, NM_DBUS_SERVICE_SYSTEM_SETTINGS,
+			NM_DBUS_PATH_SETTINGS, NM_DBUS_IFACE_SETTINGS);
+	import->window = window;
+	import->timeout_ms = timeout_ms;
+	import->timer = g_timer_new ();
+	import->callback = callback;
+	import->user_data = user_data;
+
+	fill_window (import);
+
+	return import;
+}
+
+void
+nm_config_import_free (NMConfigImport * import)
+{
+	if (!import)
+		return;
+
+	if (import->done_id)
+		g_source_remove (import->done_id);
+
+	/* Pending calls are cancelled with the proxy */
+	g_object_unref (import->proxy);
+	nm_config_keyfile_reader_free (import->reader);
+	g_timer_destroy (import->timer);
+	g_free (import->path);
+	g_free (import);
+}
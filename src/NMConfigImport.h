@@ -0,0 +1,55 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+
+#ifndef NM_CONFIG_IMPORT_H
+#define NM_CONFIG_IMPORT_H
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+
+/*
+ * `nmconfig import FILE`: adds the connections of a file written by
+ * `nmconfig export` (see NMConfigKeyfile.h), to the system
+ * settings service. The file is read only as far as needed to keep
+ * window AddConnection calls in flight. Connections which don't parse
+ * or verify are reported and skipped.
+ */
+
+typedef struct _NMConfigImport NMConfigImport;
+
+/* Called from the main loop once the whole file is read and every call
+ * answered; exit code is 0 if all connections were added. The import
+ * may be freed from the callback.
+ */
+typedef void (*NMConfigImportFunc) (gint exit_code, gpointer user_data);
+
+/* path "-" reads the standard input. Returns NULL if path can't be
+ * opened.
+ */
+NMConfigImport * nm_config_import_new (DBusGConnection * bus, const char * path,
+		guint window, gint timeout_ms, NMConfigImportFunc callback,
+		gpointer user_data, GError ** error);
+
+void nm_config_import_free (NMConfigImport * import);
+
+#endif /* NM_CONFIG_IMPORT_H */
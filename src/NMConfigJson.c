@@ -0,0 +1,177 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <glib.h>
+
+#include "NMConfigJson.h"
+
+void
+nm_config_json_init (NMConfigJson * json, GString * buffer)
+{
+	g_return_if_fail (json != NULL);
+	g_return_if_fail (buffer != NULL);
+
+	json->buffer = buffer;
+	json->depth = 0;
+	json->first[0] = TRUE;
+	json->in_object[0] = FALSE;
+}
+
+static void
+write_escaped (GString * buffer, const char * value)
+{
+	const char * start = value;
+	const char * p;
+
+	g_string_append_c (buffer, '"');
+
+	/* Copy runs of plain characters at once */
+	for (p = value; *p; p++) {
+		unsigned char c = *p;
+
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+
+		g_string_append_len (buffer, start, p - start);
+		start = p + 1;
+
+		switch (c) {
+		case '"':
+			g_string_append (buffer, "\\\"");
+			break;
+		case '\\':
+			g_string_append (buffer, "\\\\");
+			break;
+		case '\n':
+			g_string_append (buffer, "\\n");
+			break;
+		case '\t':
+			g_string_append (buffer, "\\t");
+			break;
+		default:
+			g_string_append_printf (buffer, "\\u%04x", c);
+		}
+	}
+	g_string_append_len (buffer, start, p - start);
+
+	g_string_append_c (buffer, '"');
+}
+
+/* Separator and key of the next value */
+static void
+write_key (NMConfigJson * json, const char * key)
+{
+	if (!json->first[json->depth])
+		g_string_append_c (json->buffer, ',');
+	json->first[json->depth] = FALSE;
+
+	if (json->in_object[json->depth] && key) {
+		write_escaped (json->buffer, key);
+		g_string_append_c (json->buffer, ':');
+	}
+}
+
+static void
+begin_container (NMConfigJson * json, const char * key, gboolean object)
+{
+	g_return_if_fail (json->depth + 1 < NM_CONFIG_JSON_MAX_DEPTH);
+
+	write_key (json, key);
+	g_string_append_c (json->buffer, object ? '{' : '[');
+
+	json->depth++;
+	json->first[json->depth] = TRUE;
+	json->in_object[json->depth] = object;
+}
+
+static void
+end_container (NMConfigJson * json, gboolean object)
+{
+	g_return_if_fail (json->depth > 0);
+	g_return_if_fail (json->in_object[json->depth] == object);
+
+	g_string_append_c (json->buffer, object ? '}' : ']');
+	json->depth--;
+}
+
+void
+nm_config_json_begin_object (NMConfigJson * json, const char * key)
+{
+	begin_container (json, key, TRUE);
+}
+
+void
+nm_config_json_end_object (NMConfigJson * json)
+{
+	end_container (json, TRUE);
+}
+
+void
+nm_config_json_begin_array (NMConfigJson * json, const char * key)
+{
+	begin_container (json, key, FALSE);
+}
+
+void
+nm_config_json_end_array (NMConfigJson * json)
+{
+	end_container (json, FALSE);
+}
+
+void
+nm_config_json_string (NMConfigJson * json, const char * key, const char * value)
+{
+	write_key (json, key);
+
+	if (value)
+		write_escaped (json->buffer, value);
+	else
+		g_string_append (json->buffer, "null");
+}
+
+void
+nm_config_json_uint (NMConfigJson * json, const char * key, guint64 value)
+{
+	write_key (json, key);
+	g_string_append_printf (json->buffer, "%" G_GUINT64_FORMAT, value);
+}
+
+void
+nm_config_json_boolean (NMConfigJson * json, const char * key, gboolean value)
+{
+	write_key (json, key);
+	g_string_append (json->buffer, value ? "true" : "false");
+}
+
+void
+nm_config_json_null (NMConfigJson * json, const char * key)
+{
+	write_key (json, key);
+	g_string_append (json->buffer, "null");
+}
+
+void
+nm_config_json_raw (NMConfigJson * json, const char * key,
+		const char * value, gsize len)
+{
+	write_key (json, key);
+	g_string_append_len (json->buffer, value, len);
+}
@@ -0,0 +1,60 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_JSON_H
+#define NM_CONFIG_JSON_H
+
+#include <glib.h>
+
+/*
+ * Streaming JSON writer. Values are appended to the caller's buffer as
+ * they are written; no document tree is built. Keys are ignored for
+ * values written into arrays or at the top level.
+ */
+
+#define NM_CONFIG_JSON_MAX_DEPTH 16
+
+typedef struct {
+	GString * buffer;
+	guint depth;
+	gboolean first[NM_CONFIG_JSON_MAX_DEPTH]; /* no value in the container yet */
+	gboolean in_object[NM_CONFIG_JSON_MAX_DEPTH];
+} NMConfigJson;
+
+void nm_config_json_init (NMConfigJson * json, GString * buffer);
+
+void nm_config_json_begin_object (NMConfigJson * json, const char * key);
+void nm_config_json_end_object (NMConfigJson * json);
+void nm_config_json_begin_array (NMConfigJson * json, const char * key);
+void nm_config_json_end_array (NMConfigJson * json);
+
+/* value may be NULL, it's written as null */
+void nm_config_json_string (NMConfigJson * json, const char * key, const char * value);
+void nm_config_json_uint (NMConfigJson * json, const char * key, guint64 value);
+void nm_config_json_boolean (NMConfigJson * json, const char * key, gboolean value);
+void nm_config_json_null (NMConfigJson * json, const char * key);
+
+/* value is len bytes of JSON written elsewhere, e.g. a whole document */
+void nm_config_json_raw (NMConfigJson * json, const char * key,
+		const char * value, gsize len);
+
+#endif /* NM_CONFIG_JSON_H */
@@ -0,0 +1,756 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <dbus/dbus-glib.h>
+#include <nm-connection.h>
+#include <nm-setting.h>
+#include <nm-setting-connection.h>
+
+#include "NMConfigKeyfile.h"
+
+/* libnm-util's property types beyond the ones dbus-glib names */
+#define TYPE_LIST_OF_STRING (dbus_g_type_get_collection ("GSList", G_TYPE_STRING))
+#define TYPE_ARRAY_OF_UINT_ARRAY (dbus_g_type_get_collection ("GPtrArray", DBUS_TYPE_G_UINT_ARRAY))
+#define TYPE_ARRAY_OF_UCHAR_ARRAY (dbus_g_type_get_collection ("GPtrArray", DBUS_TYPE_G_UCHAR_ARRAY))
+#define TYPE_MAP_OF_STRING (dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, G_TYPE_STRING))
+
+#define LIST_SEPARATOR ';'
+
+/* Writing */
+
+/* As GKeyFile escapes values, and the list separator in list items */
+static void
+append_escaped (GString * buffer, const char * value, gboolean list_item)
+{
+	const char * p;
+
+	for (p = value; *p; p++) {
+		switch (*p) {
+		case '\\':
+			g_string_append (buffer, "\\\\");
+			break;
+		case '\n':
+			g_string_append (buffer, "\\n");
+			break;
+		case '\t':
+			g_string_append (buffer, "\\t");
+			break;
+		case '\r':
+			g_string_append (buffer, "\\r");
+			break;
+		case ' ':
+			g_string_append (buffer, p == value ? "\\s" : " ");
+			break;
+		case LIST_SEPARATOR:
+			g_string_append (buffer, list_item ? "\\;" : ";");
+			break;
+		default:
+			g_string_append_c (buffer, *p);
+		}
+	}
+}
+
+static void
+append_bytes (GString * buffer, const GByteArray * bytes)
+{
+	int i;
+
+	for (i = 0; bytes && i < bytes->len; i++)
+		g_string_append_printf (buffer, "%s%02x", i ? ":" : "", bytes->data[i]);
+}
+
+static void
+append_uints (GString * buffer, const GArray * uints, char separator)
+{
+	int i;
+
+	for (i = 0; uints && i < uints->len; i++) {
+		if (i)
+			g_string_append_c (buffer, separator);
+		g_string_append_printf (buffer, "%u", g_array_index (uints, guint, i));
+	}
+}
+
+static gint
+compare_strings (gconstpointer a, gconstpointer b)
+{
+	return strcmp (*(const char **) a, *(const char **) b);
+}
+
+/* FALSE for types with no text form */
+static gboolean
+append_value (GString * buffer, const GValue * value)
+{
+	GType type = G_VALUE_TYPE (value);
+	int i;
+
+	if (type == G_TYPE_STRING)
+		append_escaped (buffer, g_value_get_string (value), FALSE);
+	else if (type == G_TYPE_BOOLEAN)
+		g_string_append (buffer, g_value_get_boolean (value) ? "true" : "false");
+	else if (type == G_TYPE_UINT)
+		g_string_append_printf (buffer, "%u", g_value_get_uint (value));
+	else if (type == G_TYPE_INT)
+		g_string_append_printf (buffer, "%d", g_value_get_int (value));
+	else if (type == G_TYPE_UINT64)
+		g_string_append_printf (buffer, "%" G_GUINT64_FORMAT, g_value_get_uint64 (value));
+	else if (type == G_TYPE_UCHAR)
+		g_string_append_printf (buffer, "%u", g_value_get_uchar (value));
+	else if (type == DBUS_TYPE_G_UCHAR_ARRAY)
+		append_bytes (buffer, g_value_get_boxed (value));
+	else if (type == DBUS_TYPE_G_UINT_ARRAY)
+		append_uints (buffer, g_value_get_boxed (value), LIST_SEPARATOR);
+	else if (type == TYPE_LIST_OF_STRING) {
+		GSList * iter;
+
+		for (iter = g_value_get_boxed (value); iter; iter = iter->next) {
+			append_escaped (buffer, iter->data, TRUE);
+			if (iter->next)
+				g_string_append_c (buffer, LIST_SEPARATOR);
+		}
+	}
+	else if (type == TYPE_ARRAY_OF_UINT_ARRAY || type == TYPE_ARRAY_OF_UCHAR_ARRAY) {
+		GPtrArray * items = g_value_get_boxed (value);
+
+		for (i = 0; items && i < items->len; i++) {
+			if (i)
+				g_string_append_c (buffer, LIST_SEPARATOR);
+			if (type == TYPE_ARRAY_OF_UINT_ARRAY)
+				append_uints (buffer, g_ptr_array_index (items, i), ',');
+			else
+				append_bytes (buffer, g_ptr_array_index (items, i));
+		}
+	}
+	else if (type == TYPE_MAP_OF_STRING) {
+		GHashTable * map = g_value_get_boxed (value);
+		GPtrArray * keys = g_ptr_array_new ();
+		GHashTableIter iter;
+		gpointer key;
+
+		if (map) {
+			g_hash_table_iter_init (&iter, map);
+			while (g_hash_table_iter_next (&iter, &key, NULL))
+				g_ptr_array_add (keys, key);
+		}
+		g_ptr_array_sort (keys, compare_strings);
+
+		for (i = 0; i < keys->len; i++) {
+			key = g_ptr_array_index (keys, i);
+			if (i)
+				g_string_append_c (buffer, LIST_SEPARATOR);
+			append_escaped (buffer, key, TRUE);
+			g_string_append_c (buffer, '=');
+			append_escaped (buffer, g_hash_table_lookup (map, key), TRUE);
+		}
+		g_ptr_array_free (keys, TRUE);
+	}
+	else
+		return FALSE;
+
+	return TRUE;
+}
+
+typedef struct {
+	const char * id;
+	GHashTable * groups; /* setting name -> GString of its lines */
+} WriteData;
+
+static void
+write_property (NMSetting * setting, const char * key, const GValue * value,
+		GParamFlags flags, gpointer user_data)
+{
+	WriteData * data = user_data;
+	const char * name = nm_setting_get_name (setting);
+	GParamSpec * pspec;
+	GString * group;
+	gsize start;
+
+	/* Even a setting with nothing but defaults gets its group */
+	group = g_hash_table_lookup (data->groups, name);
+	if (!group) {
+		group = g_string_new (NULL);
+		g_hash_table_insert (data->groups, (gpointer) name, group);
+	}
+
+	if (!(flags & G_PARAM_WRITABLE) || (flags & NM_SETTING_PARAM_SECRET)
+		|| !strcmp (key, NM_SETTING_NAME))
+		return;
+
+	pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (setting), key);
+	if (pspec && g_param_value_defaults (pspec, (GValue *) value))
+		return;
+
+	start = group->len;
+	g_string_append_printf (group, "%s=", key);
+	if (!append_value (group, value)) {
+		g_printerr ("%s: %s.%s has no text form, it's not written\n",
+				data->id, name, key);
+		g_string_truncate (group, start);
+		return;
+	}
+	g_string_append_c (group, '\n');
+}
+
+static void
+free_group (gpointer data)
+{
+	g_string_free (data, TRUE);
+}
+
+static void
+append_group (GString * buffer, const char * name, const GString * group)
+{
+	g_string_append_printf (buffer, "[%s]\n", name);
+	g_string_append_len (buffer, group->str, group->len);
+	g_string_append_c (buffer, '\n');
+}
+
+gboolean
+nm_config_keyfile_write (GString * buffer, GHashTable * settings,
+		GError ** error)
+{
+	NMConnection * connection;
+	NMSettingConnection * s_con;
+	WriteData data;
+	GPtrArray * names;
+	GHashTableIter iter;
+	gpointer name;
+	int i;
+
+	g_return_val_if_fail (buffer != NULL, FALSE);
+	g_return_val_if_fail (settings != NULL, FALSE);
+
+	connection = nm_connection_new_from_hash (settings, error);
+	if (!connection)
+		return FALSE;
+
+	s_con = NM_SETTING_CONNECTION (nm_connection_get_setting (connection,
+			NM_TYPE_SETTING_CONNECTION));
+	data.id = nm_setting_connection_get_id (s_con);
+	data.groups = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, free_group);
+	nm_connection_for_each_setting_value (connection, write_property, &data);
+
+	/* [connection] starts a connection, the other settings follow by name */
+	append_group (buffer, NM_SETTING_CONNECTION_SETTING_NAME,
+			g_hash_table_lookup (data.groups, NM_SETTING_CONNECTION_SETTING_NAME));
+
+	names = g_ptr_array_new ();
+	g_hash_table_iter_init (&iter, data.groups);
+	while (g_hash_table_iter_next (&iter, &name, NULL)) {
+		if (strcmp (name, NM_SETTING_CONNECTION_SETTING_NAME))
+			g_ptr_array_add (names, name);
+	}
+	g_ptr_array_sort (names, compare_strings);
+
+	for (i = 0; i < names->len; i++) {
+		name = g_ptr_array_index (names, i);
+		append_group (buffer, name, g_hash_table_lookup (data.groups, name));
+	}
+
+	g_ptr_array_free (names, TRUE);
+	g_hash_table_destroy (data.groups);
+	g_object_unref (connection);
+
+	return TRUE;
+}
+
+/* Reading */
+
+struct _NMConfigKeyfileReader {
+	GIOChannel * channel;
+	guint line;
+	gboolean next_started; /* [connection] of the next one was read */
+	guint next_line;
+	gboolean failed;       /* reading failed, nothing more comes */
+};
+
+/* Undoes append_escaped(); list items end at an unescaped separator.
+ * Returns where the value ends.
+ */
+static const char *
+unescape (const char * value, gboolean list_item, GString * result)
+{
+	const char * p;
+
+	g_string_truncate (result, 0);
+	for (p = value; *p; p++) {
+		if (list_item && *p == LIST_SEPARATOR)
+			break;
+
+		if (*p != '\\' || !p[1]) {
+			g_string_append_c (result, *p);
+			continue;
+		}
+
+		switch (*++p) {
+		case 'n':
+			g_string_append_c (result, '\n');
+			break;
+		case 't':
+			g_string_append_c (result, '\t');
+			break;
+		case 'r':
+			g_string_append_c (result, '\r');
+			break;
+		case 's':
+			g_string_append_c (result, ' ');
+			break;
+		default:
+			g_string_append_c (result, *p);
+		}
+	}
+
+	return p;
+}
+
+/* Unescaped list items, none for an empty value */
+static GPtrArray *
+split_list (const char * value)
+{
+	GPtrArray * items = g_ptr_array_new ();
+	GString * item = g_string_new (NULL);
+	const char * p = value;
+
+	while (*p) {
+		p = unescape (p, TRUE, item);
+		g_ptr_array_add (items, g_strdup (item->str));
+		if (*p)
+			p++;
+	}
+
+	g_string_free (item, TRUE);
+	return items;
+}
+
+static void
+free_list (GPtrArray * items)
+{
+	g_ptr_array_foreach (items, (GFunc) g_free, NULL);
+	g_ptr_array_free (items, TRUE);
+}
+
+static gboolean
+parse_uint (const char * string, guint64 max, guint64 * result)
+{
+	char * end;
+
+	if (!g_ascii_isdigit (*string))
+		return FALSE;
+
+	errno = 0;
+	*result = g_ascii_strtoull (string, &end, 10);
+	return !errno && !*end && *result <= max;
+}
+
+static GByteArray *
+parse_bytes (const char * string)
+{
+	GByteArray * bytes = g_byte_array_new ();
+	const char * p = string;
+	guint8 byte;
+
+	while (*p) {
+		if (!g_ascii_isxdigit (p[0]) || !g_ascii_isxdigit (p[1])
+			|| (p[2] && p[2] != ':') || (p[2] == ':' && !p[3])) {
+			g_byte_array_free (bytes, TRUE);
+			return NULL;
+		}
+		byte = g_ascii_xdigit_value (p[0]) << 4 | g_ascii_xdigit_value (p[1]);
+		g_byte_array_append (bytes, &byte, 1);
+		p += p[2] ? 3 : 2;
+	}
+
+	return bytes;
+}
+
+static GArray *
+parse_uints (const char * string, char separator)
+{
+	GArray * uints = g_array_new (FALSE, FALSE, sizeof (guint));
+	gchar ** parts;
+	guint64 number;
+	int i;
+
+	if (!*string)
+		return uints;
+
+	parts = g_strsplit (string, separator == ',' ? "," : ";", -1);
+	for (i = 0; parts[i]; i++) {
+		guint item;
+
+		if (!parse_uint (parts[i], G_MAXUINT32, &number)) {
+			g_array_free (uints, TRUE);
+			uints = NULL;
+			break;
+		}
+		item = number;
+		g_array_append_val (uints, item);
+	}
+	g_strfreev (parts);
+
+	return uints;
+}
+
+/* Parses string into value, initialized to the property's type */
+static gboolean
+parse_value (GValue * value, const char * string)
+{
+	GType type = G_VALUE_TYPE (value);
+	GString * unescaped;
+	GPtrArray * items;
+	guint64 number;
+	gboolean valid = TRUE;
+	int i;
+
+	if (type == G_TYPE_STRING) {
+		unescaped = g_string_new (NULL);
+		unescape (string, FALSE, unescaped);
+		g_value_take_string (value, g_string_free (unescaped, FALSE));
+	}
+	else if (type == G_TYPE_BOOLEAN) {
+		if (!strcmp (string, "true"))
+			g_value_set_boolean (value, TRUE);
+		else if (!strcmp (string, "false"))
+			g_value_set_boolean (value, FALSE);
+		else
+			return FALSE;
+	}
+	else if (type == G_TYPE_UINT || type == G_TYPE_UCHAR || type == G_TYPE_UINT64) {
+		if (!parse_uint (string, type == G_TYPE_UINT ? G_MAXUINT32 :
+				type == G_TYPE_UCHAR ? G_MAXUINT8 : G_MAXUINT64, &number))
+			return FALSE;
+		if (type == G_TYPE_UINT)
+			g_value_set_uint (value, number);
+		else if (type == G_TYPE_UCHAR)
+			g_value_set_uchar (value, number);
+		else
+			g_value_set_uint64 (value, number);
+	}
+	else if (type == G_TYPE_INT) {
+		gint64 signed_number;
+		char * end;
+
+		errno = 0;
+		signed_number = g_ascii_strtoll (string, &end, 10);
+		if (errno || end == string || *end
+			|| signed_number < G_MININT32 || signed_number > G_MAXINT32)
+			return FALSE;
+		g_value_set_int (value, signed_number);
+	}
+	else if (type == DBUS_TYPE_G_UCHAR_ARRAY) {
+		GByteArray * bytes = parse_bytes (string);
+
+		if (!bytes)
+			return FALSE;
+		g_value_take_boxed (value, bytes);
+	}
+	else if (type == DBUS_TYPE_G_UINT_ARRAY) {
+		GArray * uints = parse_uints (string, LIST_SEPARATOR);
+
+		if (!uints)
+			return FALSE;
+		g_value_take_boxed (value, uints);
+	}
+	else if (type == TYPE_LIST_OF_STRING) {
+		GSList * list = NULL;
+
+		items = split_list (string);
+		for (i = items->len - 1; i >= 0; i--)
+			list = g_slist_prepend (list, g_strdup (g_ptr_array_index (items, i)));
+		free_list (items);
+		g_value_take_boxed (value, list);
+	}
+	else if (type == TYPE_ARRAY_OF_UINT_ARRAY || type == TYPE_ARRAY_OF_UCHAR_ARRAY) {
+		GPtrArray * array = g_ptr_array_new ();
+
+		items = split_list (string);
+		for (i = 0; valid && i < items->len; i++) {
+			gpointer item;
+
+			if (type == TYPE_ARRAY_OF_UINT_ARRAY)
+				item = parse_uints (g_ptr_array_index (items, i), ',');
+			else
+				item = parse_bytes (g_ptr_array_index (items, i));
+
+			if (item)
+				g_ptr_array_add (array, item);
+			else
+				valid = FALSE;
+		}
+		free_list (items);
+
+		/* The value frees the items as well */
+		g_value_take_boxed (value, array);
+	}
+	else if (type == TYPE_MAP_OF_STRING) {
+		GHashTable * map = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+		items = split_list (string);
+		for (i = 0; valid && i < items->len; i++) {
+			const char * item = g_ptr_array_index (items, i);
+			const char * equals = strchr (item, '=');
+
+			if (equals)
+				g_hash_table_insert (map, g_strndup (item, equals - item),
+						g_strdup (equals + 1));
+			else
+				valid = FALSE;
+		}
+		free_list (items);
+		g_value_take_boxed (value, map);
+	}
+	else
+		return FALSE;
+
+	return valid;
+}
+
+static void
+set_error (GError ** error, guint line, const char * format, ...) G_GNUC_PRINTF (3, 4);
+
+/* Keeps the first error of a connection */
+static void
+set_error (GError ** error, guint line, const char * format, ...)
+{
+	gchar * message;
+	va_list args;
+
+	if (*error)
+		return;
+
+	va_start (args, format);
+	message = g_strdup_vprintf (format, args);
+	va_end (args);
+
+	g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_PARSE,
+			"line %u: %s", line, message);
+	g_free (message);
+}
+
+static void
+set_property (NMSetting * setting, const char * line, guint line_number,
+		GError ** error)
+{
+	const char * equals = strchr (line, '=');
+	GParamSpec * pspec;
+	GValue value = { 0 };
+	gchar * key;
+
+	if (!equals) {
+		set_error (error, line_number, "expected KEY=VALUE");
+		return;
+	}
+
+	key = g_strstrip (g_strndup (line, equals - line));
+	pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (setting), key);
+	if (!pspec || !(pspec->flags & G_PARAM_WRITABLE) || !strcmp (key, NM_SETTING_NAME)) {
+		set_error (error, line_number, "%s has no property %s",
+				nm_setting_get_name (setting), key);
+		g_free (key);
+		return;
+	}
+
+	g_value_init (&value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+	if (parse_value (&value, equals + 1))
+		g_object_set_property (G_OBJECT (setting), key, &value);
+	else
+		set_error (error, line_number, "invalid value of %s.%s",
+				nm_setting_get_name (setting), key);
+
+	g_value_unset (&value);
+	g_free (key);
+}
+
+/* NULL, with error set for unknown settings */
+static NMSetting *
+add_setting (NMConnection * connection, const char * name, guint line,
+		GError ** error)
+{
+	NMSetting * setting;
+	GType type;
+
+	setting = nm_connection_get_setting_by_name (connection, name);
+	if (setting)
+		return setting;
+
+	type = nm_connection_lookup_setting_type (name);
+	if (!type) {
+		set_error (error, line, "unknown setting %s", name);
+		return NULL;
+	}
+
+	setting = g_object_new (type, NULL);
+	nm_connection_add_setting (connection, setting);
+
+	return setting;
+}
+
+NMConfigKeyfileReader *
+nm_config_keyfile_reader_new (const char * path, GError ** error)
+{
+	NMConfigKeyfileReader * reader;
+	GIOChannel * channel;
+
+	g_return_val_if_fail (path != NULL, NULL);
+
+	if (!strcmp (path, "-"))
+		channel = g_io_channel_unix_new (0);
+	else {
+		channel = g_io_channel_new_file (path, "r", error);
+		if (!channel)
+			return NULL;
+	}
+
+	/* Values are read as bytes, they need not be UTF-8 */
+	g_io_channel_set_encoding (channel, NULL, NULL);
+
+	reader = g_new0 (NMConfigKeyfileReader, 1);
+	reader->channel = channel;
+
+	return reader;
+}
+
+NMConnection *
+nm_config_keyfile_reader_next (NMConfigKeyfileReader * reader, GError ** error)
+{
+	NMConnection * connection = NULL;
+	NMSetting * setting = NULL;
+	GError * err = NULL;
+	guint first_line = 0;
+	gchar * line;
+	gsize length;
+
+	g_return_val_if_fail (reader != NULL, NULL);
+
+	if (reader->failed)
+		return NULL;
+
+	if (reader->next_started) {
+		reader->next_started = FALSE;
+		first_line = reader->next_line;
+		connection = nm_connection_new ();
+		setting = add_setting (connection, NM_SETTING_CONNECTION_SETTING_NAME,
+				first_line, &err);
+	}
+
+	for (;;) {
+		GIOStatus status;
+		GError * io_err = NULL;
+		char * p;
+
+		status = g_io_channel_read_line (reader->channel, &line, &length, NULL, &io_err);
+		if (status == G_IO_STATUS_EOF)
+			break;
+		if (status != G_IO_STATUS_NORMAL) {
+			set_error (&err, reader->line + 1, "%s",
+					io_err ? io_err->message : "could not read");
+			if (io_err)
+				g_error_free (io_err);
+			reader->failed = TRUE;
+			break;
+		}
+		reader->line++;
+
+		/* Values keep their spaces, but for the line break */
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			line[--length] = '\0';
+		for (p = line; g_ascii_isspace (*p); p++);
+
+		if (*p == '\0' || *p == '#') {
+			g_free (line);
+			continue;
+		}
+
+		if (*p == '[') {
+			char * end = strchr (p, ']');
+
+			if (!end || end[1] != '\0') {
+				set_error (&err, reader->line, "unterminated group name");
+				setting = NULL;
+				g_free (line);
+				continue;
+			}
+			*end = '\0';
+			p++;
+
+			/* The next connection, read on the next call */
+			if (!strcmp (p, NM_SETTING_CONNECTION_SETTING_NAME) && (connection || err)) {
+				reader->next_started = TRUE;
+				reader->next_line = reader->line;
+				g_free (line);
+				break;
+			}
+
+			if (!connection) {
+				if (strcmp (p, NM_SETTING_CONNECTION_SETTING_NAME)) {
+					set_error (&err, reader->line,
+							"[%s] outside of a connection", p);
+					g_free (line);
+					continue;
+				}
+				connection = nm_connection_new ();
+				first_line = reader->line;
+			}
+
+			setting = add_setting (connection, p, reader->line, &err);
+		}
+		else if (setting)
+			set_property (setting, p, reader->line, &err);
+		else if (!connection)
+			set_error (&err, reader->line, "property outside of a connection");
+
+		g_free (line);
+	}
+
+	if (!err && connection && !nm_connection_verify (connection, &err)) {
+		gchar * message = g_strdup_printf ("connection at line %u: %s",
+				first_line, err->message);
+
+		g_free (err->message);
+		err->message = message;
+	}
+
+	if (err) {
+		g_propagate_error (error, err);
+		if (connection)
+			g_object_unref (connection);
+		return NULL;
+	}
+
+	return connection;
+}
+
+void
+nm_config_keyfile_reader_free (NMConfigKeyfileReader * reader)
+{
+	if (!reader)
+		return;
+
+	g_io_channel_unref (reader->channel);
+	g_free (reader);
+}
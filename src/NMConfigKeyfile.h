@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+
+#ifndef NM_CONFIG_KEYFILE_H
+#define NM_CONFIG_KEYFILE_H
+
+#include <glib.h>
+#include <nm-connection.h>
+
+/*
+ * Connections as text, in nmconfig's own format with GKeyFile syntax: a
+ * group per setting and a line per property. Any number of connections
+ * follow each other in one file, each starting with its [connection]
+ * group. Values are written and parsed after the type of the libnm-util
+ * property they belong to, e.g. IPv4 addresses as lists of network order
+ * integers and SSIDs as bytes, so NetworkManager's keyfile plugin can't
+ * read these files, nor can import read the plugin's. Properties left
+ * at their default are not written, and neither are those without a
+ * text form, such as IPv6 addresses and routes, so a connection may
+ * not import back complete.
+ */
+
+/* Appends the connection, as returned by GetSettings, to buffer.
+ * Properties which have no text form are skipped with a warning.
+ */
+gboolean nm_config_keyfile_write (GString * buffer, GHashTable * settings,
+		GError ** error);
+
+typedef struct _NMConfigKeyfileReader NMConfigKeyfileReader;
+
+/* path "-" reads the standard input */
+NMConfigKeyfileReader * nm_config_keyfile_reader_new (const char * path,
+		GError ** error);
+
+/* Reads the next connection, and no further. Returns NULL with error
+ * set if it's invalid, the next call goes on with the one after it;
+ * NULL without error at the end of the file. A read error is reported
+ * once and then taken as the end of the file.
+ */
+NMConnection * nm_config_keyfile_reader_next (NMConfigKeyfileReader * reader,
+		GError ** error);
+
+void nm_config_keyfile_reader_free (NMConfigKeyfileReader * reader);
+
+#endif /* NM_CONFIG_KEYFILE_H */
@@ -0,0 +1,309 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <dbus/dbus-glib-lowlevel.h>
+#include <NetworkManager.h>
+
+#include "NMConfigLiveSnapshot.h"
+
+/* Refetches are delayed a bit, so a burst of changes costs one */
+#define REFRESH_DELAY 100
+
+struct _NMConfigLiveSnapshot {
+	DBusGConnection * bus;
+	const NMConfigIfaceMatch * match;
+
+	NMConfigSnapshot * snapshot;
+	gboolean fetching;
+	guint refresh_id;
+	GSList * pending_signals; /* DBusMessage, arrived while fetching */
+	gboolean filter_added;
+
+	guint pending;            /* fetches and access point reads in flight */
+	gboolean freed;           /* free once the last of them is answered */
+
+	NMConfigLiveFetchedFunc fetched;
+	NMConfigLiveSignalFunc signal;
+	NMConfigLiveAccessPointFunc ap_added;
+	gpointer user_data;
+};
+
+typedef struct {
+	NMConfigLiveSnapshot * live;
+	gchar * device_path;
+} APAddedData;
+
+static void live_fetch (NMConfigLiveSnapshot * live);
+
+/* Once freed, the answers still in flight only free what they bring */
+static gboolean
+answered (NMConfigLiveSnapshot * live)
+{
+	live->pending--;
+
+	if (!live->freed)
+		return FALSE;
+
+	if (!live->pending)
+		g_free (live);
+	return TRUE;
+}
+
+static void
+drop_pending_signals (NMConfigLiveSnapshot * live)
+{
+	g_slist_foreach (live->pending_signals, (GFunc) dbus_message_unref, NULL);
+	g_slist_free (live->pending_signals);
+	live->pending_signals = NULL;
+}
+
+static gboolean
+refresh_cb (gpointer user_data)
+{
+	NMConfigLiveSnapshot * live = user_data;
+
+	live->refresh_id = 0;
+	live_fetch (live);
+
+	return FALSE;
+}
+
+static void
+schedule_refresh (NMConfigLiveSnapshot * live)
+{
+	if (!live->refresh_id)
+		live->refresh_id = g_timeout_add (REFRESH_DELAY, refresh_cb, live);
+}
+
+static void
+snapshot_ready_cb (NMConfigSnapshot * snapshot, GError * error,
+		gpointer user_data)
+{
+	NMConfigLiveSnapshot * live = user_data;
+	NMConfigSnapshot * old;
+	GSList * signals, * iter;
+
+	if (answered (live)) {
+		nm_config_snapshot_free (snapshot);
+		return;
+	}
+
+	live->fetching = FALSE;
+
+	if (!snapshot) {
+		live->fetched (NULL, error, live->user_data);
+
+		/* Nothing to apply the queued changes to */
+		if (!live->snapshot) {
+			drop_pending_signals (live);
+			return;
+		}
+	}
+	else {
+		old = live->snapshot;
+		live->snapshot = snapshot;
+		live->fetched (old, NULL, live->user_data);
+		nm_config_snapshot_free (old);
+	}
+
+	/* Catch up with changes announced while the snapshot was read */
+	signals = g_slist_reverse (live->pending_signals);
+	live->pending_signals = NULL;
+	for (iter = signals; iter; iter = g_slist_next (iter)) {
+		live->signal (iter->data, live->user_data);
+		dbus_message_unref (iter->data);
+	}
+	g_slist_free (signals);
+}
+
+static void
+live_fetch (NMConfigLiveSnapshot * live)
+{
+	if (live->fetching)
+		return;
+
+	live->fetching = TRUE;
+	live->pending++;
+	nm_config_snapshot_fetch (live->bus, live->match, snapshot_ready_cb, live);
+}
+
+static void
+access_point_ready_cb (NMConfigAPInfo * ap, gpointer user_data)
+{
+	APAddedData * data = user_data;
+	NMConfigLiveSnapshot * live = data->live;
+	const NMConfigDeviceInfo * device;
+
+	if (answered (live))
+		nm_config_ap_info_free (ap);
+	else if (ap) {
+		/* Not added if the device or the access point are already gone,
+		 * or a refetch in the meantime has seen it.
+		 */
+		if (nm_config_snapshot_add_access_point (live->snapshot,
+				data->device_path, ap) && live->ap_added) {
+			device = nm_config_snapshot_lookup_device (live->snapshot,
+					data->device_path);
+			live->ap_added (device, ap, live->user_data);
+		}
+	}
+
+	g_free (data->device_path);
+	g_free (data);
+}
+
+static void
+read_access_point (NMConfigLiveSnapshot * live, const char * device_path,
+		const char * ap_path)
+{
+	APAddedData * data;
+
+	data = g_new0 (APAddedData, 1);
+	data->live = live;
+	data->device_path = g_strdup (device_path);
+	live->pending++;
+	nm_config_snapshot_fetch_access_point (live->bus, ap_path,
+			access_point_ready_cb, data);
+}
+
+static DBusHandlerResult
+signal_filter (DBusConnection * connection, DBusMessage * message,
+		void * user_data)
+{
+	NMConfigLiveSnapshot * live = user_data;
+	const char * iface;
+
+	iface = dbus_message_get_interface (message);
+	if (dbus_message_get_type (message) != DBUS_MESSAGE_TYPE_SIGNAL
+		|| !iface || !g_str_has_prefix (iface, NM_DBUS_INTERFACE))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	if (live->fetching)
+		live->pending_signals = g_slist_prepend (live->pending_signals,
+				dbus_message_ref (message));
+	else if (live->snapshot)
+		live->signal (message, live->user_data);
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+NMConfigLiveSnapshot *
+nm_config_live_snapshot_new (DBusGConnection * bus,
+		const NMConfigIfaceMatch * match, NMConfigLiveFetchedFunc fetched,
+		NMConfigLiveSignalFunc signal, NMConfigLiveAccessPointFunc ap_added,
+		gpointer user_data)
+{
+	NMConfigLiveSnapshot * live;
+	DBusConnection * connection;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (fetched != NULL, NULL);
+	g_return_val_if_fail (signal != NULL, NULL);
+
+	live = g_new0 (NMConfigLiveSnapshot, 1);
+	live->bus = bus;
+	live->match = match;
+	live->fetched = fetched;
+	live->signal = signal;
+	live->ap_added = ap_added;
+	live->user_data = user_data;
+
+	/* Subscribe before reading, changes made meanwhile are queued */
+	connection = dbus_g_connection_get_connection (bus);
+	dbus_bus_add_match (connection,
+			"type='signal',sender='" NM_DBUS_SERVICE "'", NULL);
+	dbus_connection_add_filter (connection, signal_filter, live, NULL);
+	live->filter_added = TRUE;
+
+	live_fetch (live);
+
+	return live;
+}
+
+NMConfigSnapshot *
+nm_config_live_snapshot_get (const NMConfigLiveSnapshot * live)
+{
+	g_return_val_if_fail (live != NULL, NULL);
+
+	return live->snapshot;
+}
+
+gboolean
+nm_config_live_snapshot_is_fetching (const NMConfigLiveSnapshot * live)
+{
+	g_return_val_if_fail (live != NULL, FALSE);
+
+	return live->fetching;
+}
+
+NMConfigSnapshotUpdate
+nm_config_live_snapshot_apply_signal (NMConfigLiveSnapshot * live,
+		DBusMessage * message)
+{
+	const char * path = dbus_message_get_path (message);
+	const char * member = dbus_message_get_member (message);
+	const NMConfigDeviceInfo * device;
+	const char * ap_path;
+	NMConfigSnapshotUpdate update;
+
+	g_return_val_if_fail (live != NULL, NM_CONFIG_SNAPSHOT_UNCHANGED);
+	g_return_val_if_fail (live->snapshot != NULL, NM_CONFIG_SNAPSHOT_UNCHANGED);
+
+	if (path && member && !strcmp (member, "AccessPointAdded")
+		&& (device = nm_config_snapshot_lookup_device (live->snapshot, path))
+		&& device->aps) {
+		ap_path = nm_config_signal_read_path (message);
+		if (ap_path)
+			read_access_point (live, path, ap_path);
+		return NM_CONFIG_SNAPSHOT_UNCHANGED;
+	}
+
+	update = nm_config_snapshot_apply_signal (live->snapshot, message);
+	if (update == NM_CONFIG_SNAPSHOT_STALE)
+		schedule_refresh (live);
+
+	return update;
+}
+
+void
+nm_config_live_snapshot_free (NMConfigLiveSnapshot * live)
+{
+	if (!live)
+		return;
+
+	if (live->refresh_id)
+		g_source_remove (live->refresh_id);
+
+	if (live->filter_added)
+		dbus_connection_remove_filter (dbus_g_connection_get_connection (live->bus),
+				signal_filter, live);
+
+	drop_pending_signals (live);
+	nm_config_snapshot_free (live->snapshot);
+
+	/* A fetch or access point reads still in flight refer to it */
+	if (live->pending)
+		live->freed = TRUE;
+	else
+		g_free (live);
+}
@@ -0,0 +1,88 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_LIVE_SNAPSHOT_H
+#define NM_CONFIG_LIVE_SNAPSHOT_H
+
+#include <glib.h>
+#include <dbus/dbus.h>
+#include <dbus/dbus-glib.h>
+
+#include "NMConfigIfaceMatch.h"
+#include "NMConfigSnapshot.h"
+
+/*
+ * A snapshot kept up to date from NetworkManager's signals, for the
+ * commands that follow changes: watch, top, sample, scan and
+ * wait-online. The signals are subscribed to before the first fetch,
+ * and those arriving while a fetch is in flight are queued and handed
+ * out once it's done. A change the snapshot can't be updated with is
+ * read by fetching it again, and access points announced by
+ * AccessPointAdded are read one by one.
+ */
+
+typedef struct _NMConfigLiveSnapshot NMConfigLiveSnapshot;
+
+/* Called when a fetch is done. On success the new snapshot is current
+ * already and old is the one it replaces, NULL the first time; old is
+ * freed once the callback returns. On failure old is NULL and the
+ * current snapshot is kept, which is NULL if none was ever read.
+ */
+typedef void (*NMConfigLiveFetchedFunc) (const NMConfigSnapshot * old,
+		GError * error, gpointer user_data);
+
+/* Called for each NetworkManager signal, in order, once a snapshot is
+ * current. Apply it with nm_config_live_snapshot_apply_signal().
+ */
+typedef void (*NMConfigLiveSignalFunc) (DBusMessage * message, gpointer user_data);
+
+/* Called once an access point announced by AccessPointAdded was read
+ * and added to the current snapshot.
+ */
+typedef void (*NMConfigLiveAccessPointFunc) (const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap, gpointer user_data);
+
+/* Only the devices match names are read, every device if it's NULL;
+ * match must outlive the live snapshot. Callbacks come from the main
+ * loop, and the live snapshot isn't freed from them.
+ */
+NMConfigLiveSnapshot * nm_config_live_snapshot_new (DBusGConnection * bus,
+		const NMConfigIfaceMatch * match, NMConfigLiveFetchedFunc fetched,
+		NMConfigLiveSignalFunc signal, NMConfigLiveAccessPointFunc ap_added,
+		gpointer user_data);
+
+/* NULL until the first fetch succeeded */
+NMConfigSnapshot * nm_config_live_snapshot_get (const NMConfigLiveSnapshot * live);
+
+gboolean nm_config_live_snapshot_is_fetching (const NMConfigLiveSnapshot * live);
+
+/* Applies message to the current snapshot, and fetches it again, a bit
+ * later so a burst of changes costs one fetch, if it's stale. For
+ * AccessPointAdded of a device in the snapshot the access point is read
+ * instead, and UNCHANGED is returned.
+ */
+NMConfigSnapshotUpdate nm_config_live_snapshot_apply_signal (NMConfigLiveSnapshot * live,
+		DBusMessage * message);
+
+void nm_config_live_snapshot_free (NMConfigLiveSnapshot * live);
+
+#endif /* NM_CONFIG_LIVE_SNAPSHOT_H */
@@ -0,0 +1,401 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigOutput.h"
+#include "NMConfigConnectionPrintHelper.h"
+#include "NMConfigJson.h"
+#include "NMConfigPrint.h"
+
+typedef enum {
+	SECTION_NONE,
+	SECTION_DEVICES,
+	SECTION_CONNECTIONS
+} Section;
+
+typedef struct {
+	void (*manager) (NMConfigOutput * output, const NMConfigSnapshot * snapshot);
+	void (*device) (NMConfigOutput * output, const NMConfigDeviceInfo * device);
+	void (*connections) (NMConfigOutput * output, NMConnectionScope scope,
+			const GPtrArray * connections, const GPtrArray * details,
+			gboolean available);
+	void (*finish) (NMConfigOutput * output);
+} OutputBackend;
+
+struct _NMConfigOutput {
+	const OutputBackend * backend;
+	NMConfigDevicePrintOptions options;
+
+	/* JSON backends; the buffer is reused for every record */
+	GString * buffer;
+	NMConfigJson json;
+	gboolean started;
+	Section section;
+};
+
+static const char *
+scope_to_string (NMConnectionScope scope)
+{
+	return scope == NM_CONNECTION_SCOPE_USER ? "user" : "system";
+}
+
+/* Text */
+
+static void
+text_manager (NMConfigOutput * output, const NMConfigSnapshot * snapshot)
+{
+	nm_config_print ("NetworkManager state:      %s\n", nm_config_state_to_string(snapshot->state));
+	nm_config_print ("Wireless enabled:          %s\n", (snapshot->wireless_enabled ? "Yes" : "No"));
+	nm_config_print ("Wireless hardware enabled: %s\n", (snapshot->wireless_hw_enabled ? "Yes" : "No"));
+
+	nm_config_print ("\n");
+}
+
+static void
+text_device (NMConfigOutput * output, const NMConfigDeviceInfo * device)
+{
+	if (output->options.fields.len)
+		nm_config_device_show_fields (device, &output->options);
+	else
+		nm_config_device_show_full_info (device, &output->options);
+}
+
+static void
+text_connections (NMConfigOutput * output, NMConnectionScope scope,
+		const GPtrArray * connections,
+		const GPtrArray * details, gboolean available)
+{
+	const char * name = scope == NM_CONNECTION_SCOPE_USER ? "User" : "System";
+	int i;
+
+	if (connections && connections->len > 0) {
+		nm_config_print ("%s scope connections:\n", name);
+		for (i = 0; i < connections->len; i++)
+			nm_config_connection_show (g_ptr_array_index (connections, i),
+					details ? g_ptr_array_index (details, i) : NULL);
+	}
+	else if (available)
+		nm_config_print ("No %s scope connections\n", scope_to_string (scope));
+	else
+		nm_config_print ("%s scope settings service is unavailable\n", name);
+	nm_config_print ("\n");
+}
+
+static void
+text_finish (NMConfigOutput * output)
+{
+}
+
+static const OutputBackend text_backend = {
+	text_manager,
+	text_device,
+	text_connections,
+	text_finish
+};
+
+/* JSON */
+
+static void
+json_flush (NMConfigOutput * output)
+{
+	if (output->buffer->len == 0)
+		return;
+
+	nm_config_print_write (output->buffer->str, output->buffer->len);
+	g_string_truncate (output->buffer, 0);
+}
+
+/* Open the document and the section the next record belongs to */
+static void
+json_enter (NMConfigOutput * output, Section section)
+{
+	if (!output->started) {
+		nm_config_json_begin_object (&output->json, NULL);
+		output->started = TRUE;
+	}
+
+	if (output->section == section)
+		return;
+
+	if (output->section == SECTION_DEVICES)
+		nm_config_json_end_array (&output->json);
+	else if (output->section == SECTION_CONNECTIONS)
+		nm_config_json_end_object (&output->json);
+
+	if (section == SECTION_DEVICES)
+		nm_config_json_begin_array (&output->json, "devices");
+	else if (section == SECTION_CONNECTIONS)
+		nm_config_json_begin_object (&output->json, "connections");
+
+	output->section = section;
+}
+
+static const char *
+manager_state_to_token (NMState state)
+{
+	switch (state) {
+	case NM_STATE_ASLEEP:
+		return "asleep";
+	case NM_STATE_CONNECTING:
+		return "connecting";
+	case NM_STATE_CONNECTED:
+		return "connected";
+	case NM_STATE_DISCONNECTED:
+		return "disconnected";
+	default:
+		return "unknown";
+	}
+}
+
+static void
+json_manager_fields (NMConfigJson * json, const NMConfigSnapshot * snapshot)
+{
+	nm_config_json_string (json, "state", manager_state_to_token (snapshot->state));
+	nm_config_json_boolean (json, "wireless_enabled", snapshot->wireless_enabled);
+	nm_config_json_boolean (json, "wireless_hardware_enabled", snapshot->wireless_hw_enabled);
+}
+
+static void
+json_manager (NMConfigOutput * output, const NMConfigSnapshot * snapshot)
+{
+	json_enter (output, SECTION_NONE);
+	nm_config_json_begin_object (&output->json, "manager");
+	json_manager_fields (&output->json, snapshot);
+	nm_config_json_end_object (&output->json);
+	json_flush (output);
+}
+
+static void
+json_device (NMConfigOutput * output, const NMConfigDeviceInfo * device)
+{
+	json_enter (output, SECTION_DEVICES);
+	nm_config_device_write_json (&output->json, NULL, device, &output->options);
+	json_flush (output);
+}
+
+static void
+json_connections (NMConfigOutput * output, NMConnectionScope scope,
+		const GPtrArray * connections,
+		const GPtrArray * details, gboolean available)
+{
+	int i;
+
+	json_enter (output, SECTION_CONNECTIONS);
+
+	if (!available)
+		nm_config_json_null (&output->json, scope_to_string (scope));
+	else {
+		nm_config_json_begin_array (&output->json, scope_to_string (scope));
+		for (i = 0; connections && i < connections->len; i++)
+			nm_config_connection_write_json (&output->json, NULL,
+					g_ptr_array_index (connections, i),
+					details ? g_ptr_array_index (details, i) : NULL);
+		nm_config_json_end_array (&output->json);
+	}
+
+	json_flush (output);
+}
+
+static void
+json_finish (NMConfigOutput * output)
+{
+	json_enter (output, SECTION_NONE);
+	nm_config_json_end_object (&output->json);
+	g_string_append_c (output->buffer, '\n');
+	json_flush (output);
+}
+
+static const OutputBackend json_backend = {
+	json_manager,
+	json_device,
+	json_connections,
+	json_finish
+};
+
+/* NDJSON, every record is an object of its own named after its kind */
+
+static void
+ndjson_begin (NMConfigOutput * output)
+{
+	nm_config_json_init (&output->json, output->buffer);
+	nm_config_json_begin_object (&output->json, NULL);
+}
+
+static void
+ndjson_end (NMConfigOutput * output)
+{
+	nm_config_json_end_object (&output->json);
+	g_string_append_c (output->buffer, '\n');
+	json_flush (output);
+}
+
+static void
+ndjson_manager (NMConfigOutput * output, const NMConfigSnapshot * snapshot)
+{
+	ndjson_begin (output);
+	nm_config_json_begin_object (&output->json, "manager");
+	json_manager_fields (&output->json, snapshot);
+	nm_config_json_end_object (&output->json);
+	ndjson_end (output);
+}
+
+static void
+ndjson_device (NMConfigOutput * output, const NMConfigDeviceInfo * device)
+{
+	ndjson_begin (output);
+	nm_config_device_write_json (&output->json, "device", device, &output->options);
+	ndjson_end (output);
+}
+
+static void
+ndjson_connections (NMConfigOutput * output, NMConnectionScope scope,
+		const GPtrArray * connections,
+		const GPtrArray * details, gboolean available)
+{
+	int i;
+
+	for (i = 0; connections && i < connections->len; i++) {
+		ndjson_begin (output);
+		nm_config_json_string (&output->json, "scope", scope_to_string (scope));
+		nm_config_connection_write_json (&output->json, "connection",
+				g_ptr_array_index (connections, i),
+				details ? g_ptr_array_index (details, i) : NULL);
+		ndjson_end (output);
+	}
+}
+
+static void
+ndjson_finish (NMConfigOutput * output)
+{
+}
+
+static const OutputBackend ndjson_backend = {
+	ndjson_manager,
+	ndjson_device,
+	ndjson_connections,
+	ndjson_finish
+};
+
+gboolean
+nm_config_output_format_from_string (const char * name,
+		NMConfigOutputFormat * format)
+{
+	g_return_val_if_fail (name != NULL, FALSE);
+	g_return_val_if_fail (format != NULL, FALSE);
+
+	if (!strcmp (name, "text"))
+		*format = NM_CONFIG_OUTPUT_TEXT;
+	else if (!strcmp (name, "json"))
+		*format = NM_CONFIG_OUTPUT_JSON;
+	else if (!strcmp (name, "ndjson"))
+		*format = NM_CONFIG_OUTPUT_NDJSON;
+	else
+		return FALSE;
+
+	return TRUE;
+}
+
+NMConfigOutput *
+nm_config_output_new (NMConfigOutputFormat format,
+		const NMConfigDevicePrintOptions * options)
+{
+	NMConfigOutput * output;
+
+	g_return_val_if_fail (options != NULL, NULL);
+
+	output = g_new0 (NMConfigOutput, 1);
+	output->options = *options;
+
+	switch (format) {
+	case NM_CONFIG_OUTPUT_JSON:
+		output->backend = &json_backend;
+		break;
+	case NM_CONFIG_OUTPUT_NDJSON:
+		output->backend = &ndjson_backend;
+		break;
+	default:
+		output->backend = &text_backend;
+	}
+
+	output->buffer = g_string_sized_new (4096);
+	nm_config_json_init (&output->json, output->buffer);
+	output->section = SECTION_NONE;
+
+	return output;
+}
+
+void
+nm_config_output_manager (NMConfigOutput * output,
+		const NMConfigSnapshot * snapshot)
+{
+	g_return_if_fail (output != NULL);
+	g_return_if_fail (snapshot != NULL);
+
+	/* --fields lists devices only */
+	if (output->options.fields.len)
+		return;
+
+	output->backend->manager (output, snapshot);
+}
+
+void
+nm_config_output_device (NMConfigOutput * output,
+		const NMConfigDeviceInfo * device)
+{
+	g_return_if_fail (output != NULL);
+	g_return_if_fail (device != NULL);
+
+	output->backend->device (output, device);
+}
+
+void
+nm_config_output_connections (NMConfigOutput * output,
+		NMConnectionScope scope, const GPtrArray * connections,
+		const GPtrArray * details, gboolean available)
+{
+	g_return_if_fail (output != NULL);
+
+	if (output->options.fields.len)
+		return;
+
+	output->backend->connections (output, scope, connections, details, available);
+}
+
+void
+nm_config_output_finish (NMConfigOutput * output)
+{
+	g_return_if_fail (output != NULL);
+
+	output->backend->finish (output);
+}
+
+void
+nm_config_output_free (NMConfigOutput * output)
+{
+	if (!output)
+		return;
+
+	g_string_free (output->buffer, TRUE);
+	g_free (output);
+}
@@ -0,0 +1,73 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_OUTPUT_H
+#define NM_CONFIG_OUTPUT_H
+
+#include <glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigSnapshot.h"
+#include "NMConfigSettings.h"
+#include "NMConfigDevicePrintHelper.h"
+
+/*
+ * Output sink. The NetworkManager state, devices and connections are
+ * handed to it in the order they should appear, and it writes them in
+ * the selected format as they come.
+ */
+
+typedef enum {
+	NM_CONFIG_OUTPUT_TEXT = 0,
+	NM_CONFIG_OUTPUT_JSON,   /* one JSON document */
+	NM_CONFIG_OUTPUT_NDJSON  /* one JSON object per line and record */
+} NMConfigOutputFormat;
+
+typedef struct _NMConfigOutput NMConfigOutput;
+
+gboolean nm_config_output_format_from_string (const char * name,
+		NMConfigOutputFormat * format);
+
+NMConfigOutput * nm_config_output_new (NMConfigOutputFormat format,
+		const NMConfigDevicePrintOptions * options);
+
+void nm_config_output_manager (NMConfigOutput * output,
+		const NMConfigSnapshot * snapshot);
+
+void nm_config_output_device (NMConfigOutput * output,
+		const NMConfigDeviceInfo * device);
+
+/* connections are NMConfigConnectionInfo, NULL if there are none.
+ * details, if given, holds the settings of each connection as
+ * nm_config_connections_fetch_details() reads them. available is FALSE
+ * if the settings service for scope isn't running.
+ */
+void nm_config_output_connections (NMConfigOutput * output,
+		NMConnectionScope scope, const GPtrArray * connections,
+		const GPtrArray * details, gboolean available);
+
+/* Completes the output, nothing may be written afterwards */
+void nm_config_output_finish (NMConfigOutput * output);
+
+void nm_config_output_free (NMConfigOutput * output);
+
+#endif /* NM_CONFIG_OUTPUT_H */
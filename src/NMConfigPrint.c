@@ -0,0 +1,173 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <glib.h>
+
+#include "NMConfigPrint.h"
+
+/* The buffer is written out once it holds this much */
+#define FLUSH_SIZE (64 * 1024)
+
+static GString * buffer = NULL;
+static GString * capture = NULL;
+static gboolean unbuffered = FALSE;
+static guint write_calls = 0;
+
+static GString *
+get_buffer (void)
+{
+	if (!buffer)
+		buffer = g_string_sized_new (FLUSH_SIZE + 1024);
+
+	return buffer;
+}
+
+/* Write all of iov to stdout. Output that can't be written (closed
+ * pipe, full disk) is dropped, as stdio would do.
+ */
+static void
+write_all (struct iovec * iov, int iovcnt)
+{
+	while (iovcnt > 0) {
+		ssize_t written;
+
+		written = writev (STDOUT_FILENO, iov, iovcnt);
+		write_calls++;
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+
+		while (iovcnt > 0 && (size_t) written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+}
+
+void
+nm_config_print (const gchar * format, ...)
+{
+	va_list args;
+
+	va_start (args, format);
+
+	if (capture)
+		g_string_append_vprintf (capture, format, args);
+	else if (unbuffered) {
+		gchar * string = g_strdup_vprintf (format, args);
+
+		g_print ("%s", string);
+		g_free (string);
+		write_calls++;
+	}
+	else {
+		g_string_append_vprintf (get_buffer (), format, args);
+		if (buffer->len >= FLUSH_SIZE)
+			nm_config_print_flush ();
+	}
+
+	va_end (args);
+}
+
+void
+nm_config_print_write (const gchar * data, gsize len)
+{
+	struct iovec iov[2];
+
+	if (capture) {
+		g_string_append_len (capture, data, len);
+		return;
+	}
+
+	if (unbuffered) {
+		nm_config_print ("%.*s", (int) len, data);
+		return;
+	}
+
+	get_buffer ();
+	if (buffer->len + len < FLUSH_SIZE) {
+		g_string_append_len (buffer, data, len);
+		return;
+	}
+
+	/* Write what is buffered and data together */
+	iov[0].iov_base = buffer->str;
+	iov[0].iov_len = buffer->len;
+	iov[1].iov_base = (gchar *) data;
+	iov[1].iov_len = len;
+	write_all (iov, 2);
+
+	g_string_truncate (buffer, 0);
+}
+
+void
+nm_config_print_flush (void)
+{
+	struct iovec iov;
+
+	if (unbuffered) {
+		fflush (stdout);
+		return;
+	}
+
+	if (!buffer || buffer->len == 0)
+		return;
+
+	iov.iov_base = buffer->str;
+	iov.iov_len = buffer->len;
+	write_all (&iov, 1);
+
+	g_string_truncate (buffer, 0);
+}
+
+void
+nm_config_print_capture (GString * target)
+{
+	/* Don't mix output printed so far into the capture */
+	if (target)
+		nm_config_print_flush ();
+
+	capture = target;
+}
+
+void
+nm_config_print_set_unbuffered (gboolean enabled)
+{
+	nm_config_print_flush ();
+	unbuffered = enabled;
+}
+
+guint
+nm_config_print_get_write_calls (void)
+{
+	return write_calls;
+}
@@ -0,0 +1,52 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_PRINT_H
+#define NM_CONFIG_PRINT_H
+
+#include <glib.h>
+
+/*
+ * Standard output of nmconfig. Everything printed is collected in one
+ * buffer and written with few large write(2) calls: when the buffer
+ * fills up, and on nm_config_print_flush().
+ */
+
+void nm_config_print (const gchar * format, ...) G_GNUC_PRINTF (1, 2);
+
+/* Print len bytes of data without copying them if they are large */
+void nm_config_print_write (const gchar * data, gsize len);
+
+void nm_config_print_flush (void);
+
+/* Collect the output in buffer instead of writing it, until called
+ * again with NULL.
+ */
+void nm_config_print_capture (GString * buffer);
+
+/* For comparison: pass every call to g_print() as nmconfig used to */
+void nm_config_print_set_unbuffered (gboolean unbuffered);
+
+/* Number of write(2)/writev(2) calls made so far */
+guint nm_config_print_get_write_calls (void);
+
+#endif /* NM_CONFIG_PRINT_H */
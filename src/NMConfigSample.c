@@ -0,0 +1,250 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigSample.h"
+#include "NMConfigHistory.h"
+#include "NMConfigIfaceMatch.h"
+#include "NMConfigSnapshot.h"
+#include "NMConfigLiveSnapshot.h"
+
+struct _NMConfigSample {
+	gchar * iface;
+	NMConfigIfaceMatch * match; /* the device only is read */
+	NMConfigHistory * history;
+	guint tick_id;
+
+	NMConfigLiveSnapshot * live;
+	gboolean device_gone;     /* and it was said */
+
+	NMConfigSampleFailedFunc failed;
+	gpointer user_data;
+};
+
+static const NMConfigDeviceInfo *
+sampled_device (NMConfigSample * sample)
+{
+	const NMConfigSnapshot * snapshot = nm_config_live_snapshot_get (sample->live);
+	const NMConfigDeviceInfo * device;
+
+	if (!snapshot)
+		return NULL;
+
+	device = nm_config_snapshot_lookup_iface (snapshot, sample->iface, NULL);
+
+	return device && device->type == NM_DEVICE_TYPE_WIFI ? device : NULL;
+}
+
+/* Recording */
+
+static void
+record_access_point (NMConfigSample * sample, const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap, const GTimeVal * now)
+{
+	guint32 bitrate = 0;
+
+	if (device->active_ap_path && !strcmp (ap->path, device->active_ap_path))
+		bitrate = device->bitrate;
+
+	nm_config_history_record (sample->history, ap, bitrate, now);
+}
+
+static void
+record_device (NMConfigSample * sample, const NMConfigDeviceInfo * device)
+{
+	GTimeVal now;
+	guint i;
+
+	if (!device->aps)
+		return;
+
+	g_get_current_time (&now);
+	for (i = 0; i < device->aps->len; i++)
+		record_access_point (sample, device, g_ptr_array_index (device->aps, i), &now);
+}
+
+static void
+record_changed (NMConfigSample * sample, const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap)
+{
+	GTimeVal now;
+
+	g_get_current_time (&now);
+	record_access_point (sample, device, ap, &now);
+}
+
+static gboolean
+tick_cb (gpointer user_data)
+{
+	NMConfigSample * sample = user_data;
+	const NMConfigDeviceInfo * device;
+
+	if (!nm_config_live_snapshot_is_fetching (sample->live)
+		&& (device = sampled_device (sample)))
+		record_device (sample, device);
+
+	return TRUE;
+}
+
+/* Live snapshot callbacks */
+
+static void
+snapshot_fetched_cb (const NMConfigSnapshot * old, GError * error,
+		gpointer user_data)
+{
+	NMConfigSample * sample = user_data;
+	const NMConfigDeviceInfo * device;
+	gboolean first = !old && !error;
+
+	if (error) {
+		if (!nm_config_live_snapshot_get (sample->live)) {
+			GError * err = NULL;
+
+			g_set_error (&err, error->domain, error->code,
+					"Could not read NetworkManager state: %s", error->message);
+			sample->failed (err, sample->user_data);
+			g_error_free (err);
+			return;
+		}
+
+		/* Keep going with what we have, the next change retries */
+		g_printerr ("Could not read NetworkManager state: %s\n", error->message);
+	}
+
+	device = sampled_device (sample);
+	if (!device && first) {
+		GError * err = NULL;
+
+		g_set_error (&err, G_FILE_ERROR, G_FILE_ERROR_NODEV,
+				"%s is not a wireless device", sample->iface);
+		sample->failed (err, sample->user_data);
+		g_error_free (err);
+		return;
+	}
+
+	/* The device may come back, it's sampled again then */
+	if (!device && !sample->device_gone)
+		g_printerr ("%s is gone, waiting for it\n", sample->iface);
+	sample->device_gone = !device;
+
+	/* Every access point as read */
+	if (device)
+		record_device (sample, device);
+}
+
+static void
+access_point_added_cb (const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap, gpointer user_data)
+{
+	NMConfigSample * sample = user_data;
+
+	if (device == sampled_device (sample))
+		record_changed (sample, device, ap);
+}
+
+/* A change of an access point records it; a change of the device, its
+ * bitrate or active access point, records the active one.
+ */
+static void
+signal_cb (DBusMessage * message, gpointer user_data)
+{
+	NMConfigSample * sample = user_data;
+	NMConfigSnapshot * snapshot = nm_config_live_snapshot_get (sample->live);
+	const char * path = dbus_message_get_path (message);
+	const NMConfigDeviceInfo * device, * ap_device = NULL;
+	const NMConfigAPInfo * ap = NULL;
+
+	if (!path)
+		return;
+
+	device = sampled_device (sample);
+	ap = nm_config_snapshot_lookup_access_point (snapshot, path, &ap_device);
+
+	if (nm_config_live_snapshot_apply_signal (sample->live, message)
+		!= NM_CONFIG_SNAPSHOT_UPDATED || !device)
+		return;
+
+	if (ap && ap_device == device)
+		record_changed (sample, device, ap);
+	else if (!strcmp (path, device->path) && device->active_ap_path) {
+		ap = nm_config_snapshot_lookup_access_point (snapshot,
+				device->active_ap_path, NULL);
+		if (ap)
+			record_changed (sample, device, ap);
+	}
+}
+
+NMConfigSample *
+nm_config_sample_new (DBusGConnection * bus, const char * iface,
+		const char * history_path, guint slots, gdouble rate,
+		NMConfigSampleFailedFunc failed, gpointer user_data, GError ** error)
+{
+	NMConfigSample * sample;
+	NMConfigHistory * history;
+	GPtrArray * ifnames;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (iface != NULL, NULL);
+	g_return_val_if_fail (history_path != NULL, NULL);
+	g_return_val_if_fail (failed != NULL, NULL);
+
+	history = nm_config_history_open (history_path, iface, slots, error);
+	if (!history)
+		return NULL;
+
+	sample = g_new0 (NMConfigSample, 1);
+	sample->iface = g_strdup (iface);
+	sample->history = history;
+	sample->failed = failed;
+	sample->user_data = user_data;
+
+	ifnames = g_ptr_array_new ();
+	g_ptr_array_add (ifnames, sample->iface);
+	sample->match = nm_config_iface_match_new (ifnames);
+	g_ptr_array_free (ifnames, TRUE);
+
+	if (rate > 0)
+		sample->tick_id = g_timeout_add (MAX (1000 / rate, 1), tick_cb, sample);
+
+	sample->live = nm_config_live_snapshot_new (bus, sample->match,
+			snapshot_fetched_cb, signal_cb, access_point_added_cb, sample);
+
+	return sample;
+}
+
+void
+nm_config_sample_free (NMConfigSample * sample)
+{
+	if (!sample)
+		return;
+
+	if (sample->tick_id)
+		g_source_remove (sample->tick_id);
+
+	nm_config_live_snapshot_free (sample->live);
+	nm_config_history_close (sample->history);
+	nm_config_iface_match_free (sample->match);
+	g_free (sample->iface);
+	g_free (sample);
+}
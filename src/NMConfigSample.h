@@ -0,0 +1,52 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_SAMPLE_H
+#define NM_CONFIG_SAMPLE_H
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+
+/*
+ * Sample mode: records the strength, frequency and bitrate of every
+ * access point seen by a wireless device into a history file (see
+ * NMConfigHistory.h), once for each change NetworkManager announces and,
+ * if a rate is given, that many times a second for all of them.
+ */
+
+typedef struct _NMConfigSample NMConfigSample;
+
+/* Called if the device can't be found, or NetworkManager's state can't
+ * be read when sampling starts; error says which.
+ */
+typedef void (*NMConfigSampleFailedFunc) (GError * error, gpointer user_data);
+
+/* rate is in samples per second, 0 to record changes only. slots is the
+ * size of the history if it has to be created.
+ */
+NMConfigSample * nm_config_sample_new (DBusGConnection * bus, const char * iface,
+		const char * history_path, guint slots, gdouble rate,
+		NMConfigSampleFailedFunc failed, gpointer user_data, GError ** error);
+
+void nm_config_sample_free (NMConfigSample * sample);
+
+#endif /* NM_CONFIG_SAMPLE_H */
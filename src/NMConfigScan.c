@@ -0,0 +1,337 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigScan.h"
+#include "NMConfigIfaceMatch.h"
+#include "NMConfigSnapshot.h"
+#include "NMConfigLiveSnapshot.h"
+#include "NMConfigDevicePrintHelper.h"
+#include "NMConfigPrint.h"
+
+#define DBUS_TYPE_G_MAP_OF_VARIANT \
+	(dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, G_TYPE_VALUE))
+
+struct _NMConfigScan {
+	DBusGConnection * bus;
+	gchar * iface;
+	NMConfigIfaceMatch * match; /* only iface's device is read */
+	GTimer * timer;
+	guint quiet_ms;
+	gint timeout_ms;
+
+	NMConfigLiveSnapshot * live;
+
+	DBusGProxy * proxy;
+	DBusGProxyCall * request; /* RequestScan, until answered */
+	gboolean scanning;        /* requested, what's found is printed */
+	GHashTable * found;       /* access point path, printed or not usable */
+	NMConfigAPSecurityCache * security;
+	guint shown;
+	gdouble first;            /* seconds to the first access point shown */
+	gdouble last;
+	guint quiet_id;
+
+	guint done_id;
+	GError * error;
+
+	NMConfigScanFunc callback;
+	gpointer user_data;
+};
+
+static gboolean
+done_cb (gpointer user_data)
+{
+	NMConfigScan * scan = user_data;
+	GError * error = scan->error;
+
+	scan->done_id = 0;
+	scan->error = NULL;
+
+	/* The callback may free the scan */
+	scan->callback (error, scan->user_data);
+	if (error)
+		g_error_free (error);
+
+	return FALSE;
+}
+
+/* Not from the signal filter or a reply: the callback may free the scan */
+static void
+finish (NMConfigScan * scan, GError * error)
+{
+	if (scan->done_id) {
+		if (error)
+			g_error_free (error);
+		return;
+	}
+
+	if (scan->quiet_id) {
+		g_source_remove (scan->quiet_id);
+		scan->quiet_id = 0;
+	}
+
+	g_timer_stop (scan->timer);
+	scan->error = error;
+	scan->done_id = g_idle_add (done_cb, scan);
+}
+
+static gboolean
+quiet_cb (gpointer user_data)
+{
+	NMConfigScan * scan = user_data;
+
+	scan->quiet_id = 0;
+	finish (scan, NULL);
+
+	return FALSE;
+}
+
+static const NMConfigDeviceInfo *
+scanned_device (NMConfigScan * scan)
+{
+	return nm_config_snapshot_lookup_iface (nm_config_live_snapshot_get (scan->live),
+			scan->iface, NULL);
+}
+
+/* Prints ap unless it was already seen, and waits quiet_ms for the next
+ * one. Access points the device can't use count as seen but aren't
+ * shown, as in the device's full info.
+ */
+static void
+access_point_found (NMConfigScan * scan, const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap)
+{
+	gdouble elapsed;
+
+	if (!scan->scanning || scan->done_id
+		|| g_hash_table_lookup (scan->found, ap->path))
+		return;
+
+	g_hash_table_insert (scan->found, g_strdup (ap->path), GUINT_TO_POINTER (TRUE));
+	if (!nm_config_device_show_access_point (device, ap, scan->security))
+		return;
+	nm_config_print_flush ();
+
+	elapsed = g_timer_elapsed (scan->timer, NULL);
+	if (!scan->shown)
+		scan->first = elapsed;
+	scan->last = elapsed;
+	scan->shown++;
+
+	if (scan->quiet_id)
+		g_source_remove (scan->quiet_id);
+	scan->quiet_id = g_timeout_add (scan->quiet_ms, quiet_cb, scan);
+}
+
+/* Scan request */
+
+static void
+request_scan_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	NMConfigScan * scan = user_data;
+	GError * err = NULL;
+
+	scan->request = NULL;
+
+	if (dbus_g_proxy_end_call (proxy, call, &err, G_TYPE_INVALID))
+		return;
+
+	/* Older NetworkManager scans on its own schedule only; what its
+	 * next scan finds is printed all the same.
+	 */
+	if (g_error_matches (err, DBUS_GERROR, DBUS_GERROR_UNKNOWN_METHOD)
+		|| (g_error_matches (err, DBUS_GERROR, DBUS_GERROR_REMOTE_EXCEPTION)
+			&& dbus_g_error_has_name (err, DBUS_ERROR_UNKNOWN_METHOD))) {
+		g_printerr ("NetworkManager takes no scan requests, waiting for its next scan\n");
+		g_error_free (err);
+		return;
+	}
+
+	finish (scan, err);
+}
+
+static void
+request_scan (NMConfigScan * scan, const NMConfigDeviceInfo * device)
+{
+	GHashTable * options;
+
+	options = g_hash_table_new (g_str_hash, g_str_equal);
+
+	scan->proxy = dbus_g_proxy_new_for_name (scan->bus, NM_DBUS_SERVICE,
+			device->path, NM_DBUS_INTERFACE_DEVICE_WIRELESS);
+	scan->request = dbus_g_proxy_begin_call_with_timeout (scan->proxy,
+			"RequestScan", request_scan_cb, scan, NULL, scan->timeout_ms,
+			DBUS_TYPE_G_MAP_OF_VARIANT, options,
+			G_TYPE_INVALID);
+	scan->scanning = TRUE;
+
+	/* A scan that finds nothing new ends quietly too */
+	scan->quiet_id = g_timeout_add (scan->quiet_ms, quiet_cb, scan);
+
+	g_hash_table_destroy (options);
+
+	nm_config_print ("%-9s Scanning, access points as they're found:\n", device->iface);
+	nm_config_print_flush ();
+}
+
+/* Live snapshot callbacks */
+
+/* The scan is requested once the device was read; changes announced
+ * meanwhile are handed out next and are fresh as well. A refetch later
+ * on only replaces the snapshot.
+ */
+static void
+snapshot_fetched_cb (const NMConfigSnapshot * old, GError * error,
+		gpointer user_data)
+{
+	NMConfigScan * scan = user_data;
+	const NMConfigDeviceInfo * device;
+	GError * err = NULL;
+
+	if (scan->scanning || scan->done_id)
+		return;
+
+	if (error) {
+		finish (scan, g_error_copy (error));
+		return;
+	}
+
+	device = scanned_device (scan);
+	if (!device || device->type != NM_DEVICE_TYPE_WIFI) {
+		g_set_error (&err, G_FILE_ERROR, G_FILE_ERROR_NODEV,
+				"%s is not a wireless device", scan->iface);
+		finish (scan, err);
+		return;
+	}
+
+	request_scan (scan, device);
+}
+
+static void
+access_point_added_cb (const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap, gpointer user_data)
+{
+	NMConfigScan * scan = user_data;
+
+	if (device == scanned_device (scan))
+		access_point_found (scan, device, ap);
+}
+
+static void
+signal_cb (DBusMessage * message, gpointer user_data)
+{
+	NMConfigScan * scan = user_data;
+	const char * path = dbus_message_get_path (message);
+	const NMConfigDeviceInfo * device, * ap_device = NULL;
+	const NMConfigAPInfo * ap;
+
+	if (!path || scan->done_id || !(device = scanned_device (scan)))
+		return;
+
+	/* Known access points are updated by the scan */
+	ap = nm_config_snapshot_lookup_access_point (nm_config_live_snapshot_get (scan->live),
+			path, &ap_device);
+	if (nm_config_live_snapshot_apply_signal (scan->live, message) == NM_CONFIG_SNAPSHOT_UPDATED
+		&& ap && ap_device == device)
+		access_point_found (scan, device, ap);
+}
+
+NMConfigScan *
+nm_config_scan_new (DBusGConnection * bus, const char * iface,
+		guint quiet_ms, gint timeout_ms, NMConfigScanFunc callback,
+		gpointer user_data)
+{
+	NMConfigScan * scan;
+	GPtrArray * names;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (iface != NULL, NULL);
+	g_return_val_if_fail (callback != NULL, NULL);
+
+	scan = g_new0 (NMConfigScan, 1);
+	scan->bus = bus;
+	scan->iface = g_strdup (iface);
+	scan->quiet_ms = quiet_ms;
+	scan->timeout_ms = timeout_ms;
+	scan->callback = callback;
+	scan->user_data = user_data;
+	scan->timer = g_timer_new ();
+	scan->found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	scan->security = nm_config_ap_security_cache_new ();
+
+	names = g_ptr_array_new ();
+	g_ptr_array_add (names, (gpointer) iface);
+	scan->match = nm_config_iface_match_new (names);
+	g_ptr_array_free (names, TRUE);
+
+	scan->live = nm_config_live_snapshot_new (bus, scan->match,
+			snapshot_fetched_cb, signal_cb, access_point_added_cb, scan);
+
+	return scan;
+}
+
+guint
+nm_config_scan_report (const NMConfigScan * scan)
+{
+	g_return_val_if_fail (scan != NULL, 0);
+
+	if (!scan->scanning)
+		return 0;
+
+	if (scan->shown)
+		nm_config_print ("\n%u access points found, the first after %.3fs, "
+				"the last after %.3fs\n", scan->shown, scan->first, scan->last);
+	else
+		nm_config_print ("%-9s No access points found\n", "");
+
+	return scan->shown;
+}
+
+void
+nm_config_scan_free (NMConfigScan * scan)
+{
+	if (!scan)
+		return;
+
+	if (scan->done_id)
+		g_source_remove (scan->done_id);
+	if (scan->error)
+		g_error_free (scan->error);
+	if (scan->quiet_id)
+		g_source_remove (scan->quiet_id);
+
+	if (scan->request)
+		dbus_g_proxy_cancel_call (scan->proxy, scan->request);
+	if (scan->proxy)
+		g_object_unref (scan->proxy);
+
+	nm_config_live_snapshot_free (scan->live);
+	g_hash_table_destroy (scan->found);
+	nm_config_ap_security_cache_free (scan->security);
+	nm_config_iface_match_free (scan->match);
+	g_timer_destroy (scan->timer);
+	g_free (scan->iface);
+	g_free (scan);
+}
@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_SCAN_H
+#define NM_CONFIG_SCAN_H
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+
+/*
+ * `nmconfig scan`: asks NetworkManager for a fresh scan of a wireless
+ * device and prints each access point as soon as the scan finds it:
+ * new ones from the AccessPointAdded signals, known ones from their
+ * property changes. Each access point is printed once.
+ */
+
+typedef struct _NMConfigScan NMConfigScan;
+
+/* Called once, from the main loop: with error NULL when no access point
+ * was shown for quiet_ms since the scan was requested or since the last
+ * one, or with an error if the device can't be read or scanned. The scan
+ * may be freed from the callback.
+ */
+typedef void (*NMConfigScanFunc) (GError * error, gpointer user_data);
+
+NMConfigScan * nm_config_scan_new (DBusGConnection * bus, const char * iface,
+		guint quiet_ms, gint timeout_ms, NMConfigScanFunc callback,
+		gpointer user_data);
+
+/* Prints how many access points were found and when, returns their
+ * number.
+ */
+guint nm_config_scan_report (const NMConfigScan * scan);
+
+void nm_config_scan_free (NMConfigScan * scan);
+
+#endif /* NM_CONFIG_SCAN_H */
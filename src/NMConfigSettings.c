@@ -0,0 +1,165 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <nm-remote-settings.h>
+#include <nm-remote-settings-system.h>
+#include <nm-settings-interface.h>
+#include <nm-connection.h>
+#include <nm-setting-connection.h>
+
+#include "NMConfigSettings.h"
+
+/* libnm-glib backend: NMRemoteSettings keeps its connection list up to
+ * date, it is converted on every nm_config_settings_get_connections().
+ */
+
+struct _NMConfigSettings {
+	NMConnectionScope scope;
+	NMSettingsInterface * service;
+	gulong read_id;
+	gboolean ready;
+
+	GPtrArray * connections; /* NMConfigConnectionInfo */
+
+	NMConfigSettingsFunc callback;
+	gpointer user_data;
+};
+
+static void
+connections_read_cb (NMSettingsInterface * service, gpointer user_data)
+{
+	NMConfigSettings * settings = user_data;
+
+	settings->ready = TRUE;
+	settings->callback (settings, settings->user_data);
+}
+
+NMConfigSettings *
+nm_config_settings_new (DBusGConnection * bus, NMConnectionScope scope,
+		gint timeout_ms, NMConfigSettingsFunc ready, gpointer user_data)
+{
+	NMConfigSettings * settings;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (ready != NULL, NULL);
+
+	settings = g_new0 (NMConfigSettings, 1);
+	settings->scope = scope;
+	settings->callback = ready;
+	settings->user_data = user_data;
+	settings->connections = g_ptr_array_new ();
+
+	if (scope == NM_CONNECTION_SCOPE_SYSTEM)
+		settings->service = NM_SETTINGS_INTERFACE (nm_remote_settings_system_new (bus));
+	else
+		settings->service = NM_SETTINGS_INTERFACE (nm_remote_settings_new (bus, scope));
+
+	settings->read_id = g_signal_connect (settings->service,
+			NM_SETTINGS_INTERFACE_CONNECTIONS_READ,
+			G_CALLBACK (connections_read_cb), settings);
+
+	return settings;
+}
+
+NMConnectionScope
+nm_config_settings_get_scope (NMConfigSettings * settings)
+{
+	g_return_val_if_fail (settings != NULL, NM_CONNECTION_SCOPE_UNKNOWN);
+
+	return settings->scope;
+}
+
+gboolean
+nm_config_settings_is_ready (NMConfigSettings * settings)
+{
+	g_return_val_if_fail (settings != NULL, FALSE);
+
+	return settings->ready;
+}
+
+static void
+clear_connections (NMConfigSettings * settings)
+{
+	g_ptr_array_foreach (settings->connections,
+			(GFunc) nm_config_connection_info_free, NULL);
+	g_ptr_array_set_size (settings->connections, 0);
+}
+
+const GPtrArray *
+nm_config_settings_get_connections (NMConfigSettings * settings)
+{
+	GSList * list, * iter;
+
+	g_return_val_if_fail (settings != NULL, NULL);
+
+	clear_connections (settings);
+
+	list = nm_settings_interface_list_connections (settings->service);
+	for (iter = list; iter; iter = g_slist_next (iter)) {
+		NMConnection * connection = NM_CONNECTION (iter->data);
+		NMSettingConnection * s_con;
+		NMConfigConnectionInfo * info;
+
+		s_con = NM_SETTING_CONNECTION (nm_connection_get_setting (connection,
+				NM_TYPE_SETTING_CONNECTION));
+		if (!s_con)
+			continue;
+
+		info = g_new0 (NMConfigConnectionInfo, 1);
+		info->path = g_strdup (nm_connection_get_path (connection));
+		info->id = g_strdup (nm_setting_connection_get_id (s_con));
+		info->uuid = g_strdup (nm_setting_connection_get_uuid (s_con));
+		info->type = g_strdup (nm_setting_connection_get_connection_type (s_con));
+		g_ptr_array_add (settings->connections, info);
+	}
+	g_slist_free (list);
+
+	return settings->connections;
+}
+
+void
+nm_config_settings_free (NMConfigSettings * settings)
+{
+	if (!settings)
+		return;
+
+	g_signal_handler_disconnect (settings->service, settings->read_id);
+	g_object_unref (settings->service);
+
+	clear_connections (settings);
+	g_ptr_array_free (settings->connections, TRUE);
+	g_free (settings);
+}
+
+void
+nm_config_connection_info_free (NMConfigConnectionInfo * connection)
+{
+	if (!connection)
+		return;
+
+	g_free (connection->path);
+	g_free (connection->id);
+	g_free (connection->uuid);
+	g_free (connection->type);
+	g_free (connection);
+}
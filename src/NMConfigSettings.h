@@ -0,0 +1,75 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_SETTINGS_H
+#define NM_CONFIG_SETTINGS_H
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+#include <NetworkManager.h>
+#include <nm-connection.h>
+
+/*
+ * Connections stored by one settings service, as plain structs. There
+ * are two backends, selected at build time with the
+ * NMCONFIG_DIRECT_SETTINGS CMake option:
+ *
+ *   NMConfigSettings.c       - libnm-glib's NMRemoteSettings objects
+ *   NMConfigSettingsDirect.c - ListConnections and GetSettings calls,
+ *                              without any per connection GObjects
+ */
+
+typedef struct {
+	gchar * path;
+	gchar * id;
+	gchar * uuid;
+	gchar * type;
+} NMConfigConnectionInfo;
+
+typedef struct _NMConfigSettings NMConfigSettings;
+
+/* All connections of the service have been read */
+typedef void (*NMConfigSettingsFunc) (NMConfigSettings * settings, gpointer user_data);
+
+/* ready is called from the main loop once the connections are read. The
+ * direct backend gives up on calls not answered within timeout_ms, and
+ * what was read until then is what ready sees; libnm-glib has its own
+ * timeouts. Both backends follow later changes to the connections.
+ */
+NMConfigSettings * nm_config_settings_new (DBusGConnection * bus,
+		NMConnectionScope scope, gint timeout_ms,
+		NMConfigSettingsFunc ready, gpointer user_data);
+
+NMConnectionScope nm_config_settings_get_scope (NMConfigSettings * settings);
+
+gboolean nm_config_settings_is_ready (NMConfigSettings * settings);
+
+/* NMConfigConnectionInfo read so far, in the service's order. Owned by
+ * settings and valid until the next call or nm_config_settings_free().
+ */
+const GPtrArray * nm_config_settings_get_connections (NMConfigSettings * settings);
+
+void nm_config_settings_free (NMConfigSettings * settings);
+
+void nm_config_connection_info_free (NMConfigConnectionInfo * connection);
+
+#endif /* NM_CONFIG_SETTINGS_H */
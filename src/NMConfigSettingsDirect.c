@@ -0,0 +1,373 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <dbus/dbus-glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigSettings.h"
+#include "NMConfigSnapshot.h"
+#include "NMConfigStats.h"
+
+/* Direct backend: one ListConnections call, then GetSettings for all
+ * connections at once, keeping only what nmconfig prints. Afterwards the
+ * NewConnection, Updated and Removed signals keep the list current, as
+ * NMRemoteSettings does for the libnm-glib backend.
+ */
+
+#define DBUS_TYPE_G_MAP_OF_VARIANT \
+	(dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, G_TYPE_VALUE))
+#define DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT \
+	(dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, DBUS_TYPE_G_MAP_OF_VARIANT))
+#define DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH \
+	(dbus_g_type_get_collection ("GPtrArray", DBUS_TYPE_G_OBJECT_PATH))
+
+typedef struct _Slot Slot;
+
+struct _NMConfigSettings {
+	NMConnectionScope scope;
+	DBusGConnection * bus;
+	const char * service;
+	gint timeout_ms;
+
+	DBusGProxy * proxy;   /* the settings object */
+	gdouble list_started;
+	guint pending;        /* GetSettings calls out */
+	gboolean listed;      /* ListConnections answered */
+	gboolean ready;
+	guint ready_id;
+
+	GQueue * slots;          /* Slot, in ListConnections order */
+	GHashTable * by_path;    /* object path -> Slot */
+	GPtrArray * connections; /* slots read so far */
+
+	NMConfigSettingsFunc callback;
+	gpointer user_data;
+};
+
+/* One connection, for as long as the service has it */
+struct _Slot {
+	NMConfigSettings * settings;
+	NMConfigConnectionInfo * info; /* id NULL until read, or if unnamed */
+	DBusGProxy * proxy;            /* kept for its signals */
+	DBusGProxyCall * call;         /* GetSettings, until answered */
+	gdouble started;
+	GList * link;                  /* in settings->slots */
+};
+
+/* Not from a proxy callback: the callback may free settings */
+static gboolean
+ready_idle (gpointer user_data)
+{
+	NMConfigSettings * settings = user_data;
+
+	settings->ready_id = 0;
+	settings->callback (settings, settings->user_data);
+
+	return FALSE;
+}
+
+static void
+set_ready (NMConfigSettings * settings)
+{
+	settings->ready = TRUE;
+	settings->ready_id = g_idle_add (ready_idle, settings);
+}
+
+/* A GetSettings call was answered or given up */
+static void
+call_done (NMConfigSettings * settings)
+{
+	if (--settings->pending == 0 && settings->listed && !settings->ready)
+		set_ready (settings);
+}
+
+static gchar *
+dup_string (GHashTable * props, const char * key)
+{
+	GValue * value = g_hash_table_lookup (props, key);
+
+	if (!value || !G_VALUE_HOLDS_STRING (value))
+		return NULL;
+
+	return g_value_dup_string (value);
+}
+
+/* A connection without a name is no connection, and isn't listed */
+static void
+read_settings (NMConfigConnectionInfo * info, GHashTable * groups)
+{
+	GHashTable * props = g_hash_table_lookup (groups, "connection");
+
+	g_free (info->id);
+	g_free (info->uuid);
+	g_free (info->type);
+	info->id = props ? dup_string (props, "id") : NULL;
+	info->uuid = props ? dup_string (props, "uuid") : NULL;
+	info->type = props ? dup_string (props, "type") : NULL;
+}
+
+static void
+get_settings_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	Slot * slot = user_data;
+	GHashTable * groups = NULL;
+	GError * err = NULL;
+
+	nm_config_stats_call (NM_DBUS_IFACE_SETTINGS_CONNECTION, "GetSettings",
+			slot->started);
+	slot->call = NULL;
+
+	if (dbus_g_proxy_end_call (proxy, call, &err,
+			DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT, &groups,
+			G_TYPE_INVALID)) {
+		read_settings (slot->info, groups);
+		g_hash_table_destroy (groups);
+	}
+	else {
+		g_printerr ("Could not read connection %s: %s\n", slot->info->path, err->message);
+		g_error_free (err);
+	}
+
+	call_done (slot->settings);
+}
+
+static void
+connection_updated_cb (DBusGProxy * proxy, GHashTable * groups, gpointer user_data)
+{
+	Slot * slot = user_data;
+
+	read_settings (slot->info, groups);
+}
+
+static void
+slot_free (Slot * slot)
+{
+	nm_config_connection_info_free (slot->info);
+	g_free (slot);
+}
+
+static void
+connection_removed_cb (DBusGProxy * proxy, gpointer user_data)
+{
+	Slot * slot = user_data;
+	NMConfigSettings * settings = slot->settings;
+
+	dbus_g_proxy_disconnect_signal (proxy, "Updated",
+			G_CALLBACK (connection_updated_cb), slot);
+	dbus_g_proxy_disconnect_signal (proxy, "Removed",
+			G_CALLBACK (connection_removed_cb), slot);
+	if (slot->call)
+		dbus_g_proxy_cancel_call (proxy, slot->call);
+	nm_config_proxy_unref_later (proxy);
+
+	g_hash_table_remove (settings->by_path, slot->info->path);
+	g_queue_delete_link (settings->slots, slot->link);
+	if (slot->call)
+		call_done (settings);
+	slot_free (slot);
+}
+
+/* Takes path */
+static void
+add_connection (NMConfigSettings * settings, gchar * path)
+{
+	Slot * slot = g_new0 (Slot, 1);
+
+	slot->settings = settings;
+	slot->info = g_new0 (NMConfigConnectionInfo, 1);
+	slot->info->path = path;
+	g_queue_push_tail (settings->slots, slot);
+	slot->link = g_queue_peek_tail_link (settings->slots);
+	g_hash_table_insert (settings->by_path, slot->info->path, slot);
+
+	slot->proxy = dbus_g_proxy_new_for_name (settings->bus, settings->service,
+			path, NM_DBUS_IFACE_SETTINGS_CONNECTION);
+	dbus_g_proxy_add_signal (slot->proxy, "Updated",
+			DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT, G_TYPE_INVALID);
+	dbus_g_proxy_connect_signal (slot->proxy, "Updated",
+			G_CALLBACK (connection_updated_cb), slot, NULL);
+	dbus_g_proxy_add_signal (slot->proxy, "Removed", G_TYPE_INVALID);
+	dbus_g_proxy_connect_signal (slot->proxy, "Removed",
+			G_CALLBACK (connection_removed_cb), slot, NULL);
+
+	slot->started = nm_config_stats_now ();
+	settings->pending++;
+	slot->call = dbus_g_proxy_begin_call_with_timeout (slot->proxy, "GetSettings",
+			get_settings_cb, slot, NULL, settings->timeout_ms,
+			G_TYPE_INVALID);
+}
+
+static void
+new_connection_cb (DBusGProxy * proxy, const char * path, gpointer user_data)
+{
+	NMConfigSettings * settings = user_data;
+
+	if (!g_hash_table_lookup (settings->by_path, path))
+		add_connection (settings, g_strdup (path));
+}
+
+static void
+list_connections_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	NMConfigSettings * settings = user_data;
+	GPtrArray * paths = NULL;
+	GError * err = NULL;
+	int i;
+
+	nm_config_stats_call (NM_DBUS_IFACE_SETTINGS, "ListConnections",
+			settings->list_started);
+	settings->listed = TRUE;
+
+	if (!dbus_g_proxy_end_call (proxy, call, &err,
+			DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH, &paths,
+			G_TYPE_INVALID)) {
+		g_printerr ("Could not list connections of %s: %s\n",
+				settings->service, err->message);
+		g_error_free (err);
+		set_ready (settings);
+		return;
+	}
+
+	/* Some may have been announced by NewConnection already */
+	for (i = 0; i < paths->len; i++) {
+		gchar * path = g_ptr_array_index (paths, i);
+
+		if (g_hash_table_lookup (settings->by_path, path))
+			g_free (path);
+		else
+			add_connection (settings, path);
+	}
+	/* the paths are kept by the slots */
+	g_ptr_array_free (paths, TRUE);
+
+	if (settings->pending == 0)
+		set_ready (settings);
+}
+
+NMConfigSettings *
+nm_config_settings_new (DBusGConnection * bus, NMConnectionScope scope,
+		gint timeout_ms, NMConfigSettingsFunc ready, gpointer user_data)
+{
+	NMConfigSettings * settings;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (ready != NULL, NULL);
+
+	settings = g_new0 (NMConfigSettings, 1);
+	settings->scope = scope;
+	settings->bus = bus;
+	settings->service = scope == NM_CONNECTION_SCOPE_SYSTEM ?
+		NM_DBUS_SERVICE_SYSTEM_SETTINGS : NM_DBUS_SERVICE_USER_SETTINGS;
+	settings->timeout_ms = timeout_ms > 0 ? timeout_ms : -1;
+	settings->slots = g_queue_new ();
+	settings->by_path = g_hash_table_new (g_str_hash, g_str_equal);
+	settings->connections = g_ptr_array_new ();
+	settings->callback = ready;
+	settings->user_data = user_data;
+
+	settings->proxy = dbus_g_proxy_new_for_name (bus, settings->service,
+			NM_DBUS_PATH_SETTINGS, NM_DBUS_IFACE_SETTINGS);
+	dbus_g_proxy_add_signal (settings->proxy, "NewConnection",
+			DBUS_TYPE_G_OBJECT_PATH, G_TYPE_INVALID);
+	dbus_g_proxy_connect_signal (settings->proxy, "NewConnection",
+			G_CALLBACK (new_connection_cb), settings, NULL);
+
+	settings->list_started = nm_config_stats_now ();
+	dbus_g_proxy_begin_call_with_timeout (settings->proxy, "ListConnections",
+			list_connections_cb, settings, NULL, settings->timeout_ms,
+			G_TYPE_INVALID);
+
+	return settings;
+}
+
+NMConnectionScope
+nm_config_settings_get_scope (NMConfigSettings * settings)
+{
+	g_return_val_if_fail (settings != NULL, NM_CONNECTION_SCOPE_UNKNOWN);
+
+	return settings->scope;
+}
+
+gboolean
+nm_config_settings_is_ready (NMConfigSettings * settings)
+{
+	g_return_val_if_fail (settings != NULL, FALSE);
+
+	return settings->ready;
+}
+
+const GPtrArray *
+nm_config_settings_get_connections (NMConfigSettings * settings)
+{
+	GList * iter;
+
+	g_return_val_if_fail (settings != NULL, NULL);
+
+	g_ptr_array_set_size (settings->connections, 0);
+	for (iter = settings->slots->head; iter; iter = iter->next) {
+		Slot * slot = iter->data;
+
+		if (slot->info->id)
+			g_ptr_array_add (settings->connections, slot->info);
+	}
+
+	return settings->connections;
+}
+
+void
+nm_config_settings_free (NMConfigSettings * settings)
+{
+	Slot * slot;
+
+	if (!settings)
+		return;
+
+	if (settings->ready_id)
+		g_source_remove (settings->ready_id);
+
+	/* Pending calls are cancelled with their proxies */
+	g_object_unref (settings->proxy);
+	while ((slot = g_queue_pop_head (settings->slots))) {
+		g_object_unref (slot->proxy);
+		slot_free (slot);
+	}
+	g_queue_free (settings->slots);
+
+	g_hash_table_destroy (settings->by_path);
+	g_ptr_array_free (settings->connections, TRUE);
+	g_free (settings);
+}
+
+void
+nm_config_connection_info_free (NMConfigConnectionInfo * connection)
+{
+	if (!connection)
+		return;
+
+	g_free (connection->path);
+	g_free (connection->id);
+	g_free (connection->uuid);
+	g_free (connection->type);
+	g_free (connection);
+}
@@ -0,0 +1,1500 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#include <string.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <dbus/dbus-glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigSnapshot.h"
+#include "NMConfigStats.h"
+
+#ifndef DBUS_TYPE_G_MAP_OF_VARIANT
+#define DBUS_TYPE_G_MAP_OF_VARIANT (dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, G_TYPE_VALUE))
+#endif
+#ifndef DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH
+#define DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH (dbus_g_type_get_collection ("GPtrArray", DBUS_TYPE_G_OBJECT_PATH))
+#endif
+#ifndef DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT
+#define DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT (dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, DBUS_TYPE_G_MAP_OF_VARIANT))
+#endif
+#ifndef DBUS_TYPE_G_ARRAY_OF_ARRAY_OF_UINT
+#define DBUS_TYPE_G_ARRAY_OF_ARRAY_OF_UINT (dbus_g_type_get_collection ("GPtrArray", DBUS_TYPE_G_UINT_ARRAY))
+#endif
+#ifndef DBUS_TYPE_G_ARRAY_OF_ARRAY_OF_UCHAR
+#define DBUS_TYPE_G_ARRAY_OF_ARRAY_OF_UCHAR (dbus_g_type_get_collection ("GPtrArray", DBUS_TYPE_G_UCHAR_ARRAY))
+#endif
+
+/* IP6Config.Addresses is a(ayu) on NetworkManager 0.8.0 and a(ayuay) later */
+#define NM_CONFIG_TYPE_IP6_ADDRESSES \
+	(dbus_g_type_get_collection ("GPtrArray", \
+		dbus_g_type_get_struct ("GValueArray", DBUS_TYPE_G_UCHAR_ARRAY, G_TYPE_UINT, G_TYPE_INVALID)))
+#define NM_CONFIG_TYPE_IP6_ADDRESSES_WITH_GATEWAY \
+	(dbus_g_type_get_collection ("GPtrArray", \
+		dbus_g_type_get_struct ("GValueArray", DBUS_TYPE_G_UCHAR_ARRAY, G_TYPE_UINT, DBUS_TYPE_G_UCHAR_ARRAY, G_TYPE_INVALID)))
+
+typedef struct {
+	DBusGConnection * bus;
+	const NMConfigIfaceMatch * match;
+	NMConfigFetchPlan plan;
+	NMConfigSnapshot * snapshot;
+
+	GSList * proxies;
+	guint pending;
+	GError * error;
+
+	/* Per device call counts, for streaming devices as they complete */
+	gint current_device;   /* device of the calls being issued, -1 for the manager */
+	guint manager_pending;
+	GArray * device_pending; /* guint, indexed like snapshot->devices */
+	guint next_device;       /* first device not yet streamed */
+
+	/* Active connections, read along with the manager and joined to
+	 * their devices before the first device is handed out.
+	 */
+	GPtrArray * active_connections; /* ActiveConnection */
+	gboolean active_joined;
+
+	NMConfigDeviceFunc device_callback;
+	NMConfigSnapshotFunc callback;
+	gpointer user_data;
+} FetchData;
+
+typedef void (*PropertiesHandler) (FetchData * fetch, gpointer target,
+		GHashTable * props);
+typedef void (*PathsHandler) (FetchData * fetch, gpointer target,
+		GPtrArray * paths);
+
+typedef struct {
+	FetchData * fetch;
+	gpointer target;
+	gint device;
+	PropertiesHandler props_handler;
+	PathsHandler paths_handler;
+
+	/* for --stats */
+	const char * iface;
+	const char * method;
+	gdouble started;
+} CallData;
+
+typedef struct {
+	gchar * service_name;    /* settings service exporting the connection */
+	gchar * connection_path;
+	GPtrArray * devices;     /* device object paths */
+	gchar * id;
+	gchar * uuid;
+	gboolean vpn;            /* runs on top of another one */
+} ActiveConnection;
+
+typedef enum {
+	OBJECT_DEVICE,
+	OBJECT_ACCESS_POINT
+} ObjectKind;
+
+typedef struct {
+	ObjectKind kind;
+	gpointer object;
+	NMConfigDeviceInfo * device; /* owner of an access point */
+} SnapshotObject;
+
+/* Reply timeout of every call, in milliseconds; -1 is the D-Bus default */
+static gint call_timeout = -1;
+
+
+static void
+ip4_info_free (NMConfigIP4Info * ip4)
+{
+	if (!ip4)
+		return;
+
+	g_array_free (ip4->addresses, TRUE);
+	g_array_free (ip4->nameservers, TRUE);
+	g_ptr_array_foreach (ip4->domains, (GFunc) g_free, NULL);
+	g_ptr_array_free (ip4->domains, TRUE);
+	g_free (ip4);
+}
+
+static void
+ip6_info_free (NMConfigIP6Info * ip6)
+{
+	if (!ip6)
+		return;
+
+	g_array_free (ip6->addresses, TRUE);
+	g_array_free (ip6->nameservers, TRUE);
+	g_ptr_array_foreach (ip6->domains, (GFunc) g_free, NULL);
+	g_ptr_array_free (ip6->domains, TRUE);
+	g_free (ip6);
+}
+
+static void
+ap_info_free (NMConfigAPInfo * ap)
+{
+	g_free (ap->path);
+	g_free (ap->bssid);
+	if (ap->ssid)
+		g_byte_array_free (ap->ssid, TRUE);
+	g_free (ap);
+}
+
+static void
+active_connection_free (ActiveConnection * active)
+{
+	g_free (active->service_name);
+	g_free (active->connection_path);
+	g_ptr_array_foreach (active->devices, (GFunc) g_free, NULL);
+	g_ptr_array_free (active->devices, TRUE);
+	g_free (active->id);
+	g_free (active->uuid);
+	g_free (active);
+}
+
+static void
+device_info_free (NMConfigDeviceInfo * device)
+{
+	g_free (device->path);
+	g_free (device->iface);
+	g_free (device->udi);
+	g_free (device->driver);
+	ip4_info_free (device->ip4);
+	ip6_info_free (device->ip6);
+	g_free (device->connection_id);
+	g_free (device->connection_uuid);
+	g_free (device->hw_address);
+	g_free (device->active_ap_path);
+	if (device->aps) {
+		g_ptr_array_foreach (device->aps, (GFunc) ap_info_free, NULL);
+		g_ptr_array_free (device->aps, TRUE);
+	}
+	g_free (device);
+}
+
+void
+nm_config_snapshot_set_timeout (gint timeout_ms)
+{
+	call_timeout = timeout_ms > 0 ? timeout_ms : -1;
+}
+
+void
+nm_config_snapshot_free (NMConfigSnapshot * snapshot)
+{
+	if (!snapshot)
+		return;
+
+	if (snapshot->objects)
+		g_hash_table_destroy (snapshot->objects);
+	if (snapshot->ifaces)
+		g_hash_table_destroy (snapshot->ifaces);
+	g_ptr_array_foreach (snapshot->devices, (GFunc) device_info_free, NULL);
+	g_ptr_array_free (snapshot->devices, TRUE);
+	g_free (snapshot);
+}
+
+/* Property helpers. Properties missing from the table (or of an
+ * unexpected type) leave the current value untouched, so the same
+ * handlers serve both GetAll replies and PropertiesChanged signals.
+ */
+
+static const GValue *
+prop_lookup (GHashTable * props, const char * name, GType type)
+{
+	GValue * value = g_hash_table_lookup (props, name);
+
+	if (value && G_VALUE_HOLDS (value, type))
+		return value;
+
+	return NULL;
+}
+
+static void
+prop_update_string (GHashTable * props, const char * name, gchar ** field)
+{
+	const GValue * value = prop_lookup (props, name, G_TYPE_STRING);
+
+	if (value) {
+		g_free (*field);
+		*field = g_value_dup_string (value);
+	}
+}
+
+static void
+prop_update_path (GHashTable * props, const char * name, gchar ** field)
+{
+	const GValue * value = prop_lookup (props, name, DBUS_TYPE_G_OBJECT_PATH);
+	const char * path;
+
+	if (!value)
+		return;
+
+	g_free (*field);
+	*field = NULL;
+
+	/* NetworkManager uses "/" for "no object" */
+	path = g_value_get_boxed (value);
+	if (path && strcmp (path, "/"))
+		*field = g_strdup (path);
+}
+
+static guint32
+prop_get_uint (GHashTable * props, const char * name, guint32 current)
+{
+	const GValue * value = prop_lookup (props, name, G_TYPE_UINT);
+
+	return value ? g_value_get_uint (value) : current;
+}
+
+static gboolean
+prop_get_boolean (GHashTable * props, const char * name, gboolean current)
+{
+	const GValue * value = prop_lookup (props, name, G_TYPE_BOOLEAN);
+
+	return value ? g_value_get_boolean (value) : current;
+}
+
+static guint8
+prop_get_uchar (GHashTable * props, const char * name, guint8 current)
+{
+	const GValue * value = prop_lookup (props, name, G_TYPE_UCHAR);
+
+	return value ? g_value_get_uchar (value) : current;
+}
+
+static void
+prop_get_domains (GHashTable * props, GPtrArray * domains)
+{
+	const GValue * value = prop_lookup (props, "Domains", G_TYPE_STRV);
+	char ** strv;
+
+	if (!value)
+		return;
+
+	for (strv = g_value_get_boxed (value); strv && *strv; strv++)
+		g_ptr_array_add (domains, g_strdup (*strv));
+}
+
+static void
+index_object (NMConfigSnapshot * snapshot, const char * path,
+		ObjectKind kind, gpointer object, NMConfigDeviceInfo * device)
+{
+	SnapshotObject * entry = g_new (SnapshotObject, 1);
+
+	entry->kind = kind;
+	entry->object = object;
+	entry->device = device;
+	g_hash_table_insert (snapshot->objects, (gpointer) path, entry);
+}
+
+void
+nm_config_snapshot_index (NMConfigSnapshot * snapshot)
+{
+	int i, j;
+
+	g_return_if_fail (snapshot != NULL);
+	g_return_if_fail (snapshot->objects == NULL);
+
+	snapshot->objects = g_hash_table_new_full (g_str_hash, g_str_equal,
+			NULL, g_free);
+	snapshot->ifaces = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < snapshot->devices->len; i++) {
+		NMConfigDeviceInfo * device = g_ptr_array_index (snapshot->devices, i);
+
+		g_hash_table_insert (snapshot->ifaces, device->iface, GUINT_TO_POINTER (i + 1));
+		index_object (snapshot, device->path, OBJECT_DEVICE, device, device);
+		for (j = 0; device->aps && j < device->aps->len; j++) {
+			NMConfigAPInfo * ap = g_ptr_array_index (device->aps, j);
+
+			index_object (snapshot, ap->path, OBJECT_ACCESS_POINT, ap, device);
+		}
+	}
+}
+
+/* Call bookkeeping */
+
+/* Devices which vanished while being fetched, and those not matching
+ * the requested interface name, are dropped.
+ */
+static gboolean
+device_wanted (FetchData * fetch, const NMConfigDeviceInfo * device)
+{
+	return device->iface
+		&& (!fetch->match || nm_config_iface_match_test (fetch->match, device->iface));
+}
+
+static void
+prune_access_points (NMConfigDeviceInfo * device)
+{
+	int i;
+
+	if (!device->aps)
+		return;
+
+	for (i = device->aps->len - 1; i >= 0; i--) {
+		NMConfigAPInfo * ap = g_ptr_array_index (device->aps, i);
+
+		if (!ap->bssid || !ap->ssid) {
+			g_ptr_array_remove_index (device->aps, i);
+			ap_info_free (ap);
+		}
+	}
+}
+
+/* Give every device the id and uuid of its active connection: one pass
+ * over the active connections maps device paths to them, one over the
+ * devices looks each up. Needs all manager level calls to be done.
+ */
+static void
+join_active_connections (FetchData * fetch)
+{
+	GPtrArray * devices = fetch->snapshot->devices;
+	GHashTable * by_device;
+	int i, j;
+
+	if (fetch->active_joined)
+		return;
+	fetch->active_joined = TRUE;
+
+	by_device = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < fetch->active_connections->len; i++) {
+		ActiveConnection * active = g_ptr_array_index (fetch->active_connections, i);
+
+		/* A device shows its own connection, not a VPN on top of it */
+		for (j = 0; j < active->devices->len; j++) {
+			gchar * path = g_ptr_array_index (active->devices, j);
+
+			if (!active->vpn || !g_hash_table_lookup (by_device, path))
+				g_hash_table_insert (by_device, path, active);
+		}
+	}
+
+	for (i = 0; i < devices->len; i++) {
+		NMConfigDeviceInfo * device = g_ptr_array_index (devices, i);
+		ActiveConnection * active = g_hash_table_lookup (by_device, device->path);
+
+		if (active) {
+			device->connection_id = g_strdup (active->id);
+			device->connection_uuid = g_strdup (active->uuid);
+		}
+	}
+
+	g_hash_table_destroy (by_device);
+}
+
+/* Hand out complete devices in NetworkManager's order; a device waits
+ * for the ones before it and for the manager's own calls.
+ */
+static void
+stream_devices (FetchData * fetch)
+{
+	GPtrArray * devices = fetch->snapshot->devices;
+
+	if (!fetch->device_callback || fetch->error || fetch->manager_pending)
+		return;
+
+	join_active_connections (fetch);
+
+	while (fetch->next_device < devices->len
+		&& g_array_index (fetch->device_pending, guint, fetch->next_device) == 0) {
+		NMConfigDeviceInfo * device = g_ptr_array_index (devices, fetch->next_device);
+
+		fetch->next_device++;
+		if (device_wanted (fetch, device)) {
+			prune_access_points (device);
+			fetch->device_callback (fetch->snapshot, device, fetch->user_data);
+		}
+	}
+}
+
+static gboolean
+fetch_finish (gpointer user_data)
+{
+	FetchData * fetch = user_data;
+	NMConfigSnapshot * snapshot = fetch->snapshot;
+	int i;
+
+	join_active_connections (fetch);
+
+	for (i = snapshot->devices->len - 1; i >= 0; i--) {
+		NMConfigDeviceInfo * device = g_ptr_array_index (snapshot->devices, i);
+
+		if (!device_wanted (fetch, device)) {
+			g_ptr_array_remove_index (snapshot->devices, i);
+			device_info_free (device);
+		}
+		else
+			prune_access_points (device);
+	}
+
+	/* Index what is left, so signals can be applied by object path
+	 * and devices looked up by interface name.
+	 */
+	nm_config_snapshot_index (snapshot);
+
+	if (fetch->error) {
+		nm_config_snapshot_free (snapshot);
+		fetch->callback (NULL, fetch->error, fetch->user_data);
+		g_error_free (fetch->error);
+	}
+	else
+		fetch->callback (snapshot, NULL, fetch->user_data);
+
+	g_slist_foreach (fetch->proxies, (GFunc) g_object_unref, NULL);
+	g_slist_free (fetch->proxies);
+	if (fetch->device_pending)
+		g_array_free (fetch->device_pending, TRUE);
+	g_ptr_array_foreach (fetch->active_connections, (GFunc) active_connection_free, NULL);
+	g_ptr_array_free (fetch->active_connections, TRUE);
+	g_free (fetch);
+
+	return FALSE;
+}
+
+static void
+call_done (CallData * data, GError * err)
+{
+	FetchData * fetch = data->fetch;
+
+	/* Only manager level failures are fatal. Devices and access points
+	 * may disappear between listing and reading them; they are dropped.
+	 */
+	if (err) {
+		if (data->target == fetch->snapshot && !fetch->error)
+			fetch->error = err;
+		else
+			g_error_free (err);
+	}
+
+	if (data->device < 0)
+		fetch->manager_pending--;
+	else
+		g_array_index (fetch->device_pending, guint, data->device)--;
+	stream_devices (fetch);
+
+	/* Finish from an idle handler, we are inside a proxy callback here */
+	if (--fetch->pending == 0)
+		g_idle_add (fetch_finish, fetch);
+}
+
+static void
+get_all_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	CallData * data = user_data;
+	GHashTable * props = NULL;
+	GError * err = NULL;
+
+	nm_config_stats_call (data->iface, data->method, data->started);
+
+	if (dbus_g_proxy_end_call (proxy, call, &err,
+			DBUS_TYPE_G_MAP_OF_VARIANT, &props,
+			G_TYPE_INVALID)) {
+		/* Calls the handler issues belong to the same device */
+		data->fetch->current_device = data->device;
+		data->props_handler (data->fetch, data->target, props);
+		data->fetch->current_device = -1;
+		g_hash_table_destroy (props);
+	}
+
+	call_done (data, err);
+}
+
+static void
+get_paths_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	CallData * data = user_data;
+	GPtrArray * paths = NULL;
+	GError * err = NULL;
+
+	nm_config_stats_call (data->iface, data->method, data->started);
+
+	if (dbus_g_proxy_end_call (proxy, call, &err,
+			DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH, &paths,
+			G_TYPE_INVALID)) {
+		data->fetch->current_device = data->device;
+		data->paths_handler (data->fetch, data->target, paths);
+		data->fetch->current_device = -1;
+		g_ptr_array_foreach (paths, (GFunc) g_free, NULL);
+		g_ptr_array_free (paths, TRUE);
+	}
+
+	call_done (data, err);
+}
+
+static void
+get_settings_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	CallData * data = user_data;
+	GHashTable * groups = NULL, * props;
+	GError * err = NULL;
+
+	nm_config_stats_call (data->iface, data->method, data->started);
+
+	if (dbus_g_proxy_end_call (proxy, call, &err,
+			DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT, &groups,
+			G_TYPE_INVALID)) {
+		/* Only the "connection" setting is of interest */
+		props = g_hash_table_lookup (groups, "connection");
+		if (props) {
+			data->fetch->current_device = data->device;
+			data->props_handler (data->fetch, data->target, props);
+			data->fetch->current_device = -1;
+		}
+		g_hash_table_destroy (groups);
+	}
+
+	call_done (data, err);
+}
+
+static CallData *
+call_data_new (FetchData * fetch, gpointer target, const char * iface,
+		const char * method)
+{
+	CallData * data = g_new0 (CallData, 1);
+
+	data->fetch = fetch;
+	data->target = target;
+	data->device = fetch->current_device;
+	data->iface = iface;
+	data->method = method;
+	data->started = nm_config_stats_now ();
+
+	if (data->device < 0)
+		fetch->manager_pending++;
+	else
+		g_array_index (fetch->device_pending, guint, data->device)++;
+	fetch->pending++;
+
+	return data;
+}
+
+static DBusGProxy *
+fetch_proxy (FetchData * fetch, const char * service, const char * path,
+		const char * iface)
+{
+	DBusGProxy * proxy;
+
+	proxy = dbus_g_proxy_new_for_name (fetch->bus, service, path, iface);
+	fetch->proxies = g_slist_prepend (fetch->proxies, proxy);
+
+	return proxy;
+}
+
+static void
+fetch_get_all (FetchData * fetch, const char * path, const char * iface,
+		PropertiesHandler handler, gpointer target)
+{
+	DBusGProxy * proxy;
+	CallData * data;
+
+	proxy = fetch_proxy (fetch, NM_DBUS_SERVICE, path, DBUS_INTERFACE_PROPERTIES);
+
+	data = call_data_new (fetch, target, iface, "GetAll");
+	data->props_handler = handler;
+
+	dbus_g_proxy_begin_call_with_timeout (proxy, "GetAll", get_all_cb, data, g_free,
+			call_timeout, G_TYPE_STRING, iface,
+			G_TYPE_INVALID);
+}
+
+static void
+fetch_get_paths (FetchData * fetch, const char * path, const char * iface,
+		const char * method, PathsHandler handler, gpointer target)
+{
+	DBusGProxy * proxy;
+	CallData * data;
+
+	proxy = fetch_proxy (fetch, NM_DBUS_SERVICE, path, iface);
+
+	data = call_data_new (fetch, target, iface, method);
+	data->paths_handler = handler;
+
+	dbus_g_proxy_begin_call_with_timeout (proxy, method, get_paths_cb, data, g_free,
+			call_timeout, G_TYPE_INVALID);
+}
+
+/* handler is given the connection's "connection" setting */
+static void
+fetch_get_settings (FetchData * fetch, const char * service, const char * path,
+		PropertiesHandler handler, gpointer target)
+{
+	DBusGProxy * proxy;
+	CallData * data;
+
+	proxy = fetch_proxy (fetch, service, path, NM_DBUS_IFACE_SETTINGS_CONNECTION);
+
+	data = call_data_new (fetch, target, NM_DBUS_IFACE_SETTINGS_CONNECTION,
+			"GetSettings");
+	data->props_handler = handler;
+
+	dbus_g_proxy_begin_call_with_timeout (proxy, "GetSettings", get_settings_cb,
+			data, g_free, call_timeout, G_TYPE_INVALID);
+}
+
+/* Per object handlers */
+
+static void
+ap_props_cb (FetchData * fetch, gpointer target, GHashTable * props)
+{
+	NMConfigAPInfo * ap = target;
+	const GValue * value;
+
+	prop_update_string (props, "HwAddress", &ap->bssid);
+	ap->mode = prop_get_uint (props, "Mode", ap->mode);
+	ap->frequency = prop_get_uint (props, "Frequency", ap->frequency);
+	ap->max_bitrate = prop_get_uint (props, "MaxBitrate", ap->max_bitrate);
+	ap->strength = prop_get_uchar (props, "Strength", ap->strength);
+	ap->flags = prop_get_uint (props, "Flags", ap->flags);
+	ap->wpa_flags = prop_get_uint (props, "WpaFlags", ap->wpa_flags);
+	ap->rsn_flags = prop_get_uint (props, "RsnFlags", ap->rsn_flags);
+
+	value = prop_lookup (props, "Ssid", DBUS_TYPE_G_UCHAR_ARRAY);
+	if (value) {
+		GArray * ssid = g_value_get_boxed (value);
+
+		if (ap->ssid)
+			g_byte_array_free (ap->ssid, TRUE);
+		ap->ssid = g_byte_array_sized_new (ssid->len);
+		g_byte_array_append (ap->ssid, (const guint8 *) ssid->data, ssid->len);
+	}
+}
+
+static void
+access_points_cb (FetchData * fetch, gpointer target, GPtrArray * paths)
+{
+	NMConfigDeviceInfo * device = target;
+	int i;
+
+	for (i = 0; i < paths->len; i++) {
+		NMConfigAPInfo * ap = g_new0 (NMConfigAPInfo, 1);
+
+		ap->path = g_strdup (g_ptr_array_index (paths, i));
+		g_ptr_array_add (device->aps, ap);
+
+		fetch_get_all (fetch, ap->path, NM_DBUS_INTERFACE_ACCESS_POINT,
+				ap_props_cb, ap);
+	}
+}
+
+static void
+wired_props_cb (FetchData * fetch, gpointer target, GHashTable * props)
+{
+	NMConfigDeviceInfo * device = target;
+
+	prop_update_string (props, "HwAddress", &device->hw_address);
+	device->speed = prop_get_uint (props, "Speed", device->speed);
+	device->carrier = prop_get_boolean (props, "Carrier", device->carrier);
+}
+
+static void
+wireless_props_cb (FetchData * fetch, gpointer target, GHashTable * props)
+{
+	NMConfigDeviceInfo * device = target;
+
+	prop_update_string (props, "HwAddress", &device->hw_address);
+	device->mode = prop_get_uint (props, "Mode", device->mode);
+	device->bitrate = prop_get_uint (props, "Bitrate", device->bitrate);
+	device->capabilities = prop_get_uint (props, "WirelessCapabilities",
+			device->capabilities);
+	prop_update_path (props, "ActiveAccessPoint", &device->active_ap_path);
+}
+
+static void
+ip4_props_cb (FetchData * fetch, gpointer target, GHashTable * props)
+{
+	NMConfigIP4Info * ip4 = target;
+	const GValue * value;
+	int i;
+
+	value = prop_lookup (props, "Addresses", DBUS_TYPE_G_ARRAY_OF_ARRAY_OF_UINT);
+	if (value) {
+		GPtrArray * addresses = g_value_get_boxed (value);
+
+		for (i = 0; i < addresses->len; i++) {
+			GArray * array = g_ptr_array_index (addresses, i);
+			NMConfigIP4Address address;
+
+			if (array->len < 3)
+				continue;
+
+			address.address = g_array_index (array, guint32, 0);
+			address.prefix = g_array_index (array, guint32, 1);
+			address.gateway = g_array_index (array, guint32, 2);
+			g_array_append_val (ip4->addresses, address);
+		}
+	}
+
+	value = prop_lookup (props, "Nameservers", DBUS_TYPE_G_UINT_ARRAY);
+	if (value) {
+		GArray * nameservers = g_value_get_boxed (value);
+
+		g_array_append_vals (ip4->nameservers, nameservers->data,
+				nameservers->len);
+	}
+
+	prop_get_domains (props, ip4->domains);
+}
+
+static void
+ip6_props_cb (FetchData * fetch, gpointer target, GHashTable * props)
+{
+	NMConfigIP6Info * ip6 = target;
+	const GValue * value;
+	int i;
+
+	value = prop_lookup (props, "Addresses", NM_CONFIG_TYPE_IP6_ADDRESSES);
+	if (!value)
+		value = prop_lookup (props, "Addresses",
+				NM_CONFIG_TYPE_IP6_ADDRESSES_WITH_GATEWAY);
+	if (value) {
+		GPtrArray * addresses = g_value_get_boxed (value);
+
+		for (i = 0; i < addresses->len; i++) {
+			GValueArray * elements = g_ptr_array_index (addresses, i);
+			GArray * bytes;
+			NMConfigIP6Address address;
+
+			bytes = g_value_get_boxed (g_value_array_get_nth (elements, 0));
+			if (!bytes || bytes->len != sizeof (address.address))
+				continue;
+
+			memcpy (&address.address, bytes->data, sizeof (address.address));
+			address.prefix = g_value_get_uint (g_value_array_get_nth (elements, 1));
+			g_array_append_val (ip6->addresses, address);
+		}
+	}
+
+	value = prop_lookup (props, "Nameservers", DBUS_TYPE_G_ARRAY_OF_ARRAY_OF_UCHAR);
+	if (value) {
+		GPtrArray * nameservers = g_value_get_boxed (value);
+
+		for (i = 0; i < nameservers->len; i++) {
+			GArray * bytes = g_ptr_array_index (nameservers, i);
+			struct in6_addr addr;
+
+			if (bytes->len != sizeof (addr))
+				continue;
+
+			memcpy (&addr, bytes->data, sizeof (addr));
+			g_array_append_val (ip6->nameservers, addr);
+		}
+	}
+
+	prop_get_domains (props, ip6->domains);
+}
+
+/* Properties which decide what else is read for a device. A change of
+ * any of them can't be applied in place.
+ */
+static const char * device_structure_props[] = {
+	"Interface", "DeviceType", "Managed", "Ip4Config", "Ip6Config", NULL
+};
+
+static void
+device_props_update (NMConfigDeviceInfo * device, GHashTable * props)
+{
+	prop_update_string (props, "Udi", &device->udi);
+	prop_update_string (props, "Driver", &device->driver);
+	device->state = prop_get_uint (props, "State", device->state);
+}
+
+static void
+device_props_cb (FetchData * fetch, gpointer target, GHashTable * props)
+{
+	NMConfigDeviceInfo * device = target;
+	gchar * ip4_path = NULL, * ip6_path = NULL;
+
+	prop_update_string (props, "Interface", &device->iface);
+
+	/* Don't fetch the details of devices which won't be shown */
+	if (fetch->match && !nm_config_iface_match_test (fetch->match, device->iface))
+		return;
+
+	device->type = prop_get_uint (props, "DeviceType", NM_DEVICE_TYPE_UNKNOWN);
+	device->managed = prop_get_boolean (props, "Managed", FALSE);
+	device_props_update (device, props);
+
+	if (device->managed && (fetch->plan & NM_CONFIG_FETCH_IP4)) {
+		prop_update_path (props, "Ip4Config", &ip4_path);
+		if (ip4_path) {
+			device->ip4 = g_new0 (NMConfigIP4Info, 1);
+			device->ip4->addresses = g_array_new (FALSE, FALSE, sizeof (NMConfigIP4Address));
+			device->ip4->nameservers = g_array_new (FALSE, FALSE, sizeof (guint32));
+			device->ip4->domains = g_ptr_array_new ();
+
+			fetch_get_all (fetch, ip4_path, NM_DBUS_INTERFACE_IP4_CONFIG,
+					ip4_props_cb, device->ip4);
+			g_free (ip4_path);
+		}
+	}
+
+	if (device->managed && (fetch->plan & NM_CONFIG_FETCH_IP6)) {
+		prop_update_path (props, "Ip6Config", &ip6_path);
+		if (ip6_path) {
+			device->ip6 = g_new0 (NMConfigIP6Info, 1);
+			device->ip6->addresses = g_array_new (FALSE, FALSE, sizeof (NMConfigIP6Address));
+			device->ip6->nameservers = g_array_new (FALSE, FALSE, sizeof (struct in6_addr));
+			device->ip6->domains = g_ptr_array_new ();
+
+			fetch_get_all (fetch, ip6_path, NM_DBUS_INTERFACE_IP6_CONFIG,
+					ip6_props_cb, device->ip6);
+			g_free (ip6_path);
+		}
+	}
+
+	switch (device->type) {
+	case NM_DEVICE_TYPE_ETHERNET:
+		if (fetch->plan & NM_CONFIG_FETCH_WIRED)
+			fetch_get_all (fetch, device->path, NM_DBUS_INTERFACE_DEVICE_WIRED,
+					wired_props_cb, device);
+		break;
+	case NM_DEVICE_TYPE_WIFI:
+		if (fetch->plan & NM_CONFIG_FETCH_WIRELESS)
+			fetch_get_all (fetch, device->path, NM_DBUS_INTERFACE_DEVICE_WIRELESS,
+					wireless_props_cb, device);
+		if (fetch->plan & NM_CONFIG_FETCH_ACCESS_POINTS) {
+			device->aps = g_ptr_array_new ();
+			fetch_get_paths (fetch, device->path, NM_DBUS_INTERFACE_DEVICE_WIRELESS,
+					"GetAccessPoints", access_points_cb, device);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+devices_cb (FetchData * fetch, gpointer target, GPtrArray * paths)
+{
+	int i;
+
+	fetch->device_pending = g_array_new (FALSE, TRUE, sizeof (guint));
+	g_array_set_size (fetch->device_pending, paths->len);
+
+	for (i = 0; i < paths->len; i++) {
+		NMConfigDeviceInfo * device = g_new0 (NMConfigDeviceInfo, 1);
+
+		device->path = g_strdup (g_ptr_array_index (paths, i));
+		g_ptr_array_add (fetch->snapshot->devices, device);
+
+		fetch->current_device = i;
+		fetch_get_all (fetch, device->path, NM_DBUS_INTERFACE_DEVICE,
+				device_props_cb, device);
+	}
+	fetch->current_device = -1;
+}
+
+static void
+manager_props_cb (FetchData * fetch, gpointer target, GHashTable * props)
+{
+	NMConfigSnapshot * snapshot = target;
+
+	snapshot->state = prop_get_uint (props, "State", snapshot->state);
+	snapshot->wireless_enabled = prop_get_boolean (props, "WirelessEnabled",
+			snapshot->wireless_enabled);
+	snapshot->wireless_hw_enabled = prop_get_boolean (props, "WirelessHardwareEnabled",
+			snapshot->wireless_hw_enabled);
+}
+
+static void
+connection_props_cb (FetchData * fetch, gpointer target, GHashTable * props)
+{
+	ActiveConnection * active = target;
+
+	prop_update_string (props, "id", &active->id);
+	prop_update_string (props, "uuid", &active->uuid);
+}
+
+static void
+active_connection_props_cb (FetchData * fetch, gpointer target, GHashTable * props)
+{
+	ActiveConnection * active = target;
+	const GValue * value;
+	GPtrArray * paths;
+	int i;
+
+	prop_update_string (props, "ServiceName", &active->service_name);
+	prop_update_path (props, "Connection", &active->connection_path);
+	active->vpn = prop_get_boolean (props, "Vpn", active->vpn);
+
+	value = prop_lookup (props, "Devices", DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH);
+	if (value) {
+		paths = g_value_get_boxed (value);
+		for (i = 0; i < paths->len; i++)
+			g_ptr_array_add (active->devices, g_strdup (g_ptr_array_index (paths, i)));
+	}
+
+	/* The name and uuid are only known to the settings service */
+	if (active->service_name && active->connection_path && active->devices->len)
+		fetch_get_settings (fetch, active->service_name, active->connection_path,
+				connection_props_cb, active);
+}
+
+/* Properties which can't be applied to a snapshot in place */
+static const char * manager_structure_props[] = {
+	"ActiveConnections", NULL
+};
+
+static void
+manager_fetch_cb (FetchData * fetch, gpointer target, GHashTable * props)
+{
+	const GValue * value;
+	GPtrArray * paths;
+	int i;
+
+	manager_props_cb (fetch, target, props);
+
+	if (!(fetch->plan & NM_CONFIG_FETCH_ACTIVE_CONNECTIONS))
+		return;
+
+	value = prop_lookup (props, "ActiveConnections", DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH);
+	if (!value)
+		return;
+
+	paths = g_value_get_boxed (value);
+	for (i = 0; i < paths->len; i++) {
+		ActiveConnection * active = g_new0 (ActiveConnection, 1);
+
+		active->devices = g_ptr_array_new ();
+		g_ptr_array_add (fetch->active_connections, active);
+
+		fetch_get_all (fetch, g_ptr_array_index (paths, i),
+				NM_DBUS_INTERFACE_ACTIVE_CONNECTION,
+				active_connection_props_cb, active);
+	}
+}
+
+/*
+ * Read NetworkManager state into a new snapshot. All calls are issued
+ * asynchronously, so requests for independent objects are in flight at
+ * the same time. If match is given only the devices it matches are
+ * read; it must stay valid until callback is called.
+ *
+ * The active connections are read with the manager, and every device
+ * gets the id and uuid of its own from the settings service exporting
+ * it.
+ *
+ * If device_callback is given, it's called for every device as soon as
+ * it has been read, see NMConfigDeviceFunc.
+ *
+ * Only what plan names is read: a listing of interface names and states
+ * takes the GetDevices call and one GetAll per device.
+ */
+void
+nm_config_snapshot_fetch_streaming (DBusGConnection * bus,
+		const NMConfigIfaceMatch * match, NMConfigFetchPlan plan,
+		NMConfigDeviceFunc device_callback, NMConfigSnapshotFunc callback,
+		gpointer user_data)
+{
+	FetchData * fetch;
+
+	g_return_if_fail (bus != NULL);
+	g_return_if_fail (callback != NULL);
+
+	fetch = g_new0 (FetchData, 1);
+	fetch->bus = bus;
+	fetch->match = match;
+	fetch->plan = plan;
+	fetch->current_device = -1;
+	fetch->device_callback = device_callback;
+	fetch->callback = callback;
+	fetch->user_data = user_data;
+
+	fetch->snapshot = g_new0 (NMConfigSnapshot, 1);
+	fetch->snapshot->devices = g_ptr_array_new ();
+	fetch->active_connections = g_ptr_array_new ();
+
+	if (plan & (NM_CONFIG_FETCH_MANAGER | NM_CONFIG_FETCH_ACTIVE_CONNECTIONS))
+		fetch_get_all (fetch, NM_DBUS_PATH, NM_DBUS_INTERFACE,
+				manager_fetch_cb, fetch->snapshot);
+
+	fetch_get_paths (fetch, NM_DBUS_PATH, NM_DBUS_INTERFACE,
+			"GetDevices", devices_cb, fetch->snapshot);
+}
+
+void
+nm_config_snapshot_fetch (DBusGConnection * bus, const NMConfigIfaceMatch * match,
+		NMConfigSnapshotFunc callback, gpointer user_data)
+{
+	nm_config_snapshot_fetch_streaming (bus, match, NM_CONFIG_FETCH_ALL,
+			NULL, callback, user_data);
+}
+
+/* Signal decoding. Only basic types and byte arrays are decoded, which
+ * covers every property applied in place.
+ */
+
+static void
+value_free (gpointer data)
+{
+	GValue * value = data;
+
+	if (!value)
+		return;
+
+	g_value_unset (value);
+	g_free (value);
+}
+
+static GValue *
+read_variant (DBusMessageIter * iter)
+{
+	GValue * value = g_new0 (GValue, 1);
+
+	switch (dbus_message_iter_get_arg_type (iter)) {
+	case DBUS_TYPE_UINT32: {
+		dbus_uint32_t u;
+
+		dbus_message_iter_get_basic (iter, &u);
+		g_value_init (value, G_TYPE_UINT);
+		g_value_set_uint (value, u);
+		break;
+	}
+	case DBUS_TYPE_BOOLEAN: {
+		dbus_bool_t b;
+
+		dbus_message_iter_get_basic (iter, &b);
+		g_value_init (value, G_TYPE_BOOLEAN);
+		g_value_set_boolean (value, b);
+		break;
+	}
+	case DBUS_TYPE_BYTE: {
+		unsigned char y;
+
+		dbus_message_iter_get_basic (iter, &y);
+		g_value_init (value, G_TYPE_UCHAR);
+		g_value_set_uchar (value, y);
+		break;
+	}
+	case DBUS_TYPE_STRING: {
+		const char * str;
+
+		dbus_message_iter_get_basic (iter, &str);
+		g_value_init (value, G_TYPE_STRING);
+		g_value_set_string (value, str);
+		break;
+	}
+	case DBUS_TYPE_OBJECT_PATH: {
+		const char * path;
+
+		dbus_message_iter_get_basic (iter, &path);
+		g_value_init (value, DBUS_TYPE_G_OBJECT_PATH);
+		g_value_set_boxed (value, path);
+		break;
+	}
+	case DBUS_TYPE_ARRAY: {
+		DBusMessageIter array;
+		const unsigned char * bytes;
+		GArray * garray;
+		int len;
+
+		if (dbus_message_iter_get_element_type (iter) != DBUS_TYPE_BYTE)
+			goto unsupported;
+
+		dbus_message_iter_recurse (iter, &array);
+		dbus_message_iter_get_fixed_array (&array, &bytes, &len);
+
+		garray = g_array_sized_new (FALSE, FALSE, 1, len);
+		g_array_append_vals (garray, bytes, len);
+		g_value_init (value, DBUS_TYPE_G_UCHAR_ARRAY);
+		g_value_take_boxed (value, garray);
+		break;
+	}
+	default:
+		goto unsupported;
+	}
+
+	return value;
+
+unsupported:
+	g_free (value);
+	return NULL;
+}
+
+/* Read an a{sv} argument. Values of unsupported types are left out,
+ * their names are still recorded as keys with a NULL value.
+ */
+static GHashTable *
+read_properties (DBusMessageIter * iter)
+{
+	GHashTable * props;
+	DBusMessageIter dict;
+
+	props = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, value_free);
+
+	if (dbus_message_iter_get_arg_type (iter) != DBUS_TYPE_ARRAY)
+		return props;
+
+	dbus_message_iter_recurse (iter, &dict);
+	while (dbus_message_iter_get_arg_type (&dict) == DBUS_TYPE_DICT_ENTRY) {
+		DBusMessageIter entry, variant;
+		const char * name;
+
+		dbus_message_iter_recurse (&dict, &entry);
+		dbus_message_iter_get_basic (&entry, &name);
+		dbus_message_iter_next (&entry);
+		dbus_message_iter_recurse (&entry, &variant);
+
+		g_hash_table_insert (props, g_strdup (name), read_variant (&variant));
+
+		dbus_message_iter_next (&dict);
+	}
+
+	return props;
+}
+
+static guint32
+read_uint (DBusMessage * message)
+{
+	DBusMessageIter iter;
+	dbus_uint32_t u = 0;
+
+	if (dbus_message_iter_init (message, &iter)
+		&& dbus_message_iter_get_arg_type (&iter) == DBUS_TYPE_UINT32)
+		dbus_message_iter_get_basic (&iter, &u);
+
+	return u;
+}
+
+const char *
+nm_config_signal_read_path (DBusMessage * message)
+{
+	DBusMessageIter iter;
+	const char * path = NULL;
+
+	if (dbus_message_iter_init (message, &iter)
+		&& dbus_message_iter_get_arg_type (&iter) == DBUS_TYPE_OBJECT_PATH)
+		dbus_message_iter_get_basic (&iter, &path);
+
+	return path;
+}
+
+static gboolean
+has_any_prop (GHashTable * props, const char ** names)
+{
+	for (; *names; names++) {
+		if (g_hash_table_lookup_extended (props, *names, NULL, NULL))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static NMConfigSnapshotUpdate
+apply_properties_changed (NMConfigSnapshot * snapshot, SnapshotObject * object,
+		const char * iface, DBusMessage * message)
+{
+	NMConfigSnapshotUpdate result = NM_CONFIG_SNAPSHOT_UPDATED;
+	DBusMessageIter iter;
+	GHashTable * props;
+
+	if (!dbus_message_iter_init (message, &iter))
+		return NM_CONFIG_SNAPSHOT_UNCHANGED;
+
+	props = read_properties (&iter);
+
+	if (!object) {
+		if (strcmp (iface, NM_DBUS_INTERFACE))
+			result = NM_CONFIG_SNAPSHOT_UNCHANGED;
+		else if (has_any_prop (props, manager_structure_props))
+			result = NM_CONFIG_SNAPSHOT_STALE;
+		else
+			manager_props_cb (NULL, snapshot, props);
+	}
+	else if (object->kind == OBJECT_ACCESS_POINT) {
+		if (!strcmp (iface, NM_DBUS_INTERFACE_ACCESS_POINT))
+			ap_props_cb (NULL, object->object, props);
+		else
+			result = NM_CONFIG_SNAPSHOT_UNCHANGED;
+	}
+	else if (!strcmp (iface, NM_DBUS_INTERFACE_DEVICE)) {
+		if (has_any_prop (props, device_structure_props))
+			result = NM_CONFIG_SNAPSHOT_STALE;
+		else
+			device_props_update (object->object, props);
+	}
+	else if (!strcmp (iface, NM_DBUS_INTERFACE_DEVICE_WIRED))
+		wired_props_cb (NULL, object->object, props);
+	else if (!strcmp (iface, NM_DBUS_INTERFACE_DEVICE_WIRELESS))
+		wireless_props_cb (NULL, object->object, props);
+	else
+		result = NM_CONFIG_SNAPSHOT_UNCHANGED;
+
+	g_hash_table_destroy (props);
+
+	return result;
+}
+
+static gboolean
+remove_access_point (NMConfigSnapshot * snapshot, const char * path)
+{
+	SnapshotObject * object;
+	NMConfigAPInfo * ap;
+
+	object = g_hash_table_lookup (snapshot->objects, path);
+	if (!object || object->kind != OBJECT_ACCESS_POINT)
+		return FALSE;
+
+	ap = object->object;
+	g_ptr_array_remove (object->device->aps, ap);
+	g_hash_table_remove (snapshot->objects, path);
+	ap_info_free (ap);
+
+	return TRUE;
+}
+
+/*
+ * Apply a NetworkManager signal to the snapshot. Property and state
+ * changes and removed access points are applied in place; other added or
+ * removed objects, and changes that would need other objects to be read,
+ * leave the snapshot stale. Added access points can be read with
+ * nm_config_snapshot_fetch_access_point() instead.
+ */
+NMConfigSnapshotUpdate
+nm_config_snapshot_apply_signal (NMConfigSnapshot * snapshot,
+		DBusMessage * message)
+{
+	const char * path, * iface, * member;
+	SnapshotObject * object = NULL;
+
+	g_return_val_if_fail (snapshot != NULL, NM_CONFIG_SNAPSHOT_UNCHANGED);
+	g_return_val_if_fail (message != NULL, NM_CONFIG_SNAPSHOT_UNCHANGED);
+
+	if (dbus_message_get_type (message) != DBUS_MESSAGE_TYPE_SIGNAL)
+		return NM_CONFIG_SNAPSHOT_UNCHANGED;
+
+	path = dbus_message_get_path (message);
+	iface = dbus_message_get_interface (message);
+	member = dbus_message_get_member (message);
+	if (!path || !iface || !member)
+		return NM_CONFIG_SNAPSHOT_UNCHANGED;
+
+	if (!strcmp (path, NM_DBUS_PATH)) {
+		if (strcmp (iface, NM_DBUS_INTERFACE))
+			return NM_CONFIG_SNAPSHOT_UNCHANGED;
+
+		if (!strcmp (member, "DeviceAdded") || !strcmp (member, "DeviceRemoved"))
+			return NM_CONFIG_SNAPSHOT_STALE;
+
+		if (!strcmp (member, "StateChanged")) {
+			snapshot->state = read_uint (message);
+			return NM_CONFIG_SNAPSHOT_UPDATED;
+		}
+	}
+	else {
+		object = g_hash_table_lookup (snapshot->objects, path);
+		if (!object)
+			return NM_CONFIG_SNAPSHOT_UNCHANGED;
+
+		if (object->kind == OBJECT_DEVICE) {
+			NMConfigDeviceInfo * device = object->object;
+
+			if (!strcmp (member, "AccessPointAdded"))
+				return NM_CONFIG_SNAPSHOT_STALE;
+
+			if (!strcmp (member, "AccessPointRemoved")) {
+				const char * ap_path = nm_config_signal_read_path (message);
+
+				if (!ap_path || !remove_access_point (snapshot, ap_path))
+					return NM_CONFIG_SNAPSHOT_UNCHANGED;
+				return NM_CONFIG_SNAPSHOT_UPDATED;
+			}
+
+			if (!strcmp (member, "StateChanged")
+				&& !strcmp (iface, NM_DBUS_INTERFACE_DEVICE)) {
+				device->state = read_uint (message);
+				return NM_CONFIG_SNAPSHOT_UPDATED;
+			}
+		}
+	}
+
+	if (!strcmp (member, "PropertiesChanged"))
+		return apply_properties_changed (snapshot, object, iface, message);
+
+	return NM_CONFIG_SNAPSHOT_UNCHANGED;
+}
+
+/* Lookups */
+
+const NMConfigDeviceInfo *
+nm_config_snapshot_lookup_iface (const NMConfigSnapshot * snapshot,
+		const char * iface, guint * position)
+{
+	guint index;
+
+	g_return_val_if_fail (snapshot != NULL, NULL);
+
+	index = GPOINTER_TO_UINT (g_hash_table_lookup (snapshot->ifaces, iface));
+	if (!index)
+		return NULL;
+
+	if (position)
+		*position = index - 1;
+
+	return g_ptr_array_index (snapshot->devices, index - 1);
+}
+
+const NMConfigDeviceInfo *
+nm_config_snapshot_lookup_device (const NMConfigSnapshot * snapshot,
+		const char * path)
+{
+	SnapshotObject * object;
+
+	g_return_val_if_fail (snapshot != NULL, NULL);
+
+	object = path ? g_hash_table_lookup (snapshot->objects, path) : NULL;
+	if (!object || object->kind != OBJECT_DEVICE)
+		return NULL;
+
+	return object->object;
+}
+
+const NMConfigAPInfo *
+nm_config_snapshot_lookup_access_point (const NMConfigSnapshot * snapshot,
+		const char * path, const NMConfigDeviceInfo ** device)
+{
+	SnapshotObject * object;
+
+	g_return_val_if_fail (snapshot != NULL, NULL);
+
+	object = path ? g_hash_table_lookup (snapshot->objects, path) : NULL;
+	if (!object || object->kind != OBJECT_ACCESS_POINT)
+		return NULL;
+
+	if (device)
+		*device = object->device;
+
+	return object->object;
+}
+
+/* Single access points, for AccessPointAdded */
+
+typedef struct {
+	DBusGProxy * proxy;
+	NMConfigAPInfo * ap;
+	NMConfigAccessPointFunc callback;
+	gpointer user_data;
+	gdouble started;
+} APFetchData;
+
+static gboolean
+unref_proxy_idle (gpointer user_data)
+{
+	g_object_unref (user_data);
+	return FALSE;
+}
+
+void
+nm_config_proxy_unref_later (DBusGProxy * proxy)
+{
+	g_idle_add (unref_proxy_idle, proxy);
+}
+
+static void
+ap_fetch_cb (DBusGProxy * proxy, DBusGProxyCall * call, gpointer user_data)
+{
+	APFetchData * data = user_data;
+	NMConfigAPInfo * ap = data->ap;
+	GHashTable * props = NULL;
+
+	nm_config_stats_call (NM_DBUS_INTERFACE_ACCESS_POINT, "GetAll", data->started);
+
+	if (dbus_g_proxy_end_call (proxy, call, NULL,
+			DBUS_TYPE_G_MAP_OF_VARIANT, &props,
+			G_TYPE_INVALID)) {
+		ap_props_cb (NULL, ap, props);
+		g_hash_table_destroy (props);
+	}
+
+	/* Same rule as fetch_finish() */
+	if (!ap->bssid || !ap->ssid) {
+		ap_info_free (ap);
+		ap = NULL;
+	}
+
+	data->callback (ap, data->user_data);
+
+	nm_config_proxy_unref_later (data->proxy);
+}
+
+/*
+ * Read one access point. The callback gets NULL if it couldn't be read,
+ * otherwise it owns the access point; see
+ * nm_config_snapshot_add_access_point().
+ */
+void
+nm_config_snapshot_fetch_access_point (DBusGConnection * bus, const char * path,
+		NMConfigAccessPointFunc callback, gpointer user_data)
+{
+	APFetchData * data;
+
+	g_return_if_fail (bus != NULL);
+	g_return_if_fail (path != NULL);
+	g_return_if_fail (callback != NULL);
+
+	data = g_new0 (APFetchData, 1);
+	data->ap = g_new0 (NMConfigAPInfo, 1);
+	data->ap->path = g_strdup (path);
+	data->callback = callback;
+	data->user_data = user_data;
+	data->proxy = dbus_g_proxy_new_for_name (bus, NM_DBUS_SERVICE,
+			path, DBUS_INTERFACE_PROPERTIES);
+	data->started = nm_config_stats_now ();
+
+	dbus_g_proxy_begin_call_with_timeout (data->proxy, "GetAll", ap_fetch_cb, data, g_free,
+			call_timeout, G_TYPE_STRING, NM_DBUS_INTERFACE_ACCESS_POINT,
+			G_TYPE_INVALID);
+}
+
+void
+nm_config_ap_info_free (NMConfigAPInfo * ap)
+{
+	if (ap)
+		ap_info_free (ap);
+}
+
+/* Takes ownership of ap. Returns FALSE, and frees ap, if the device is
+ * not in the snapshot or already lists the access point.
+ */
+gboolean
+nm_config_snapshot_add_access_point (NMConfigSnapshot * snapshot,
+		const char * device_path, NMConfigAPInfo * ap)
+{
+	SnapshotObject * object;
+	NMConfigDeviceInfo * device;
+
+	g_return_val_if_fail (snapshot != NULL, FALSE);
+	g_return_val_if_fail (ap != NULL, FALSE);
+
+	object = g_hash_table_lookup (snapshot->objects, device_path);
+	if (!object || object->kind != OBJECT_DEVICE
+		|| !((NMConfigDeviceInfo *) object->object)->aps
+		|| g_hash_table_lookup (snapshot->objects, ap->path)) {
+		ap_info_free (ap);
+		return FALSE;
+	}
+
+	device = object->object;
+	g_ptr_array_add (device->aps, ap);
+	index_object (snapshot, ap->path, OBJECT_ACCESS_POINT, ap, device);
+
+	return TRUE;
+}
@@ -0,0 +1,212 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#ifndef NM_CONFIG_SNAPSHOT_H
+#define NM_CONFIG_SNAPSHOT_H
+
+#include <netinet/in.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+#include <dbus/dbus-glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigIfaceMatch.h"
+
+/*
+ * Plain copy of the NetworkManager state printed by nmconfig. It is
+ * filled with one org.freedesktop.DBus.Properties.GetAll call per
+ * D-Bus object, and one GetSettings call per active connection, so
+ * printing it costs no further round trips.
+ */
+
+typedef struct {
+	guint32 address; /* network byte order */
+	guint32 prefix;
+	guint32 gateway; /* network byte order */
+} NMConfigIP4Address;
+
+typedef struct {
+	GArray * addresses;   /* NMConfigIP4Address */
+	GArray * nameservers; /* guint32, network byte order */
+	GPtrArray * domains;  /* gchar * */
+} NMConfigIP4Info;
+
+typedef struct {
+	struct in6_addr address;
+	guint32 prefix;
+} NMConfigIP6Address;
+
+typedef struct {
+	GArray * addresses;   /* NMConfigIP6Address */
+	GArray * nameservers; /* struct in6_addr */
+	GPtrArray * domains;  /* gchar * */
+} NMConfigIP6Info;
+
+typedef struct {
+	gchar * path;
+	gchar * bssid;
+	GByteArray * ssid;
+	NM80211Mode mode;
+	guint32 frequency;
+	guint32 max_bitrate;
+	guint8 strength;
+	guint32 flags;
+	guint32 wpa_flags;
+	guint32 rsn_flags;
+} NMConfigAPInfo;
+
+typedef struct {
+	gchar * path;
+	NMDeviceType type;
+	gchar * iface;
+	gchar * udi;
+	gchar * driver;
+	gboolean managed;
+	NMDeviceState state;
+	NMConfigIP4Info * ip4; /* NULL if not configured */
+	NMConfigIP6Info * ip6; /* NULL if not configured */
+
+	/* the active connection, NULL if the device has none */
+	gchar * connection_id;
+	gchar * connection_uuid;
+
+	/* ethernet and wifi */
+	gchar * hw_address;
+
+	/* ethernet */
+	gboolean carrier;
+	guint32 speed;
+
+	/* wifi */
+	NM80211Mode mode;
+	guint32 bitrate;
+	guint32 capabilities;
+	gchar * active_ap_path;
+	GPtrArray * aps; /* NMConfigAPInfo */
+} NMConfigDeviceInfo;
+
+typedef struct {
+	NMState state;
+	gboolean wireless_enabled;
+	gboolean wireless_hw_enabled;
+	GPtrArray * devices; /* NMConfigDeviceInfo, in NetworkManager's order */
+
+	/* private */
+	GHashTable * objects; /* object path -> device or access point */
+	GHashTable * ifaces;  /* interface name -> position in devices + 1 */
+} NMConfigSnapshot;
+
+typedef enum {
+	NM_CONFIG_SNAPSHOT_UNCHANGED = 0, /* signal doesn't concern the snapshot */
+	NM_CONFIG_SNAPSHOT_UPDATED,       /* snapshot was updated in place */
+	NM_CONFIG_SNAPSHOT_STALE          /* snapshot has to be fetched again */
+} NMConfigSnapshotUpdate;
+
+/* What a fetch reads besides the properties of the manager's devices,
+ * which are always read. See nm_config_fields_to_plan() for the plan of
+ * a --fields selection.
+ */
+typedef enum {
+	NM_CONFIG_FETCH_MANAGER            = 1 << 0, /* state and radio switches */
+	NM_CONFIG_FETCH_ACTIVE_CONNECTIONS = 1 << 1, /* each device's id and uuid */
+	NM_CONFIG_FETCH_IP4                = 1 << 2,
+	NM_CONFIG_FETCH_IP6                = 1 << 3,
+	NM_CONFIG_FETCH_WIRED              = 1 << 4,
+	NM_CONFIG_FETCH_WIRELESS           = 1 << 5,
+	NM_CONFIG_FETCH_ACCESS_POINTS      = 1 << 6,
+	NM_CONFIG_FETCH_ALL                = (1 << 7) - 1
+} NMConfigFetchPlan;
+
+/* On success snapshot is owned by the callee and error is NULL.
+ * On failure snapshot is NULL and error is owned by the caller.
+ */
+typedef void (*NMConfigSnapshotFunc) (NMConfigSnapshot * snapshot,
+		GError * error, gpointer user_data);
+
+void nm_config_snapshot_fetch (DBusGConnection * bus, const NMConfigIfaceMatch * match,
+		NMConfigSnapshotFunc callback, gpointer user_data);
+
+/* Called for each device once it's completely read, in NetworkManager's
+ * order. The snapshot is still being filled: only its manager
+ * properties and the devices handed out so far are complete, and none
+ * of them may be kept past the final NMConfigSnapshotFunc.
+ */
+typedef void (*NMConfigDeviceFunc) (const NMConfigSnapshot * snapshot,
+		const NMConfigDeviceInfo * device, gpointer user_data);
+
+/* A snapshot fetched with less than NM_CONFIG_FETCH_ALL leaves out what
+ * plan doesn't name, e.g. aps is NULL without NM_CONFIG_FETCH_ACCESS_POINTS;
+ * it can be printed, but signals can't be applied to it.
+ */
+void nm_config_snapshot_fetch_streaming (DBusGConnection * bus,
+		const NMConfigIfaceMatch * match, NMConfigFetchPlan plan,
+		NMConfigDeviceFunc device_callback, NMConfigSnapshotFunc callback,
+		gpointer user_data);
+
+/* Calls not answered within timeout_ms fail with DBUS_GERROR_NO_REPLY;
+ * 0 or less restores the D-Bus default of about 25 seconds.
+ */
+void nm_config_snapshot_set_timeout (gint timeout_ms);
+
+void nm_config_snapshot_free (NMConfigSnapshot * snapshot);
+
+/* Builds the private lookup tables of a snapshot whose devices were
+ * filled in by other means than a fetch, e.g. read from a file. Every
+ * device needs an interface name and a path.
+ */
+void nm_config_snapshot_index (NMConfigSnapshot * snapshot);
+
+NMConfigSnapshotUpdate nm_config_snapshot_apply_signal (NMConfigSnapshot * snapshot,
+		DBusMessage * message);
+
+/* The object path a signal carries as its first argument, e.g. the
+ * access point of AccessPointAdded; NULL if there is none.
+ */
+const char * nm_config_signal_read_path (DBusMessage * message);
+
+/* position, if given, is set to the device's index in snapshot->devices */
+const NMConfigDeviceInfo * nm_config_snapshot_lookup_iface (const NMConfigSnapshot * snapshot,
+		const char * iface, guint * position);
+
+const NMConfigDeviceInfo * nm_config_snapshot_lookup_device (const NMConfigSnapshot * snapshot,
+		const char * path);
+
+/* device, if given, is set to the device listing the access point */
+const NMConfigAPInfo * nm_config_snapshot_lookup_access_point (const NMConfigSnapshot * snapshot,
+		const char * path, const NMConfigDeviceInfo ** device);
+
+/* ap is NULL if the access point couldn't be read */
+typedef void (*NMConfigAccessPointFunc) (NMConfigAPInfo * ap, gpointer user_data);
+
+void nm_config_snapshot_fetch_access_point (DBusGConnection * bus, const char * path,
+		NMConfigAccessPointFunc callback, gpointer user_data);
+
+void nm_config_ap_info_free (NMConfigAPInfo * ap);
+
+/* Unreferences proxy from the main loop: a proxy isn't finalized from
+ * inside its own reply callback.
+ */
+void nm_config_proxy_unref_later (DBusGProxy * proxy);
+
+gboolean nm_config_snapshot_add_access_point (NMConfigSnapshot * snapshot,
+		const char * device_path, NMConfigAPInfo * ap);
+
+#endif /* NM_CONFIG_SNAPSHOT_H */
@@ -0,0 +1,419 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#include <string.h>
+#include <glib.h>
+#include <arpa/inet.h>
+#include <NetworkManager.h>
+#include <nm-utils.h>
+
+#include "NMConfigSnapshotFile.h"
+#include "NMConfigDevicePrintHelper.h"
+#include "NMConfigPrint.h"
+
+/*
+ * Differences between two saved states. Devices are matched by
+ * interface name, access points by BSSID and connections by UUID, since
+ * D-Bus object paths change whenever NetworkManager restarts. Every
+ * object is looked up in a hash table, so the diff takes time linear in
+ * the size of both snapshots.
+ *
+ * Signal strength changes all the time and is left out.
+ */
+
+static const char *
+yes_no (gboolean value)
+{
+	return value ? "Yes" : "No";
+}
+
+static void
+diff_value (guint * changes, const char * object, const char * field,
+		const char * old_value, const char * new_value)
+{
+	if (!g_strcmp0 (old_value, new_value))
+		return;
+
+	if (object)
+		nm_config_print ("%s ", object);
+	nm_config_print ("%s: %s -> %s\n", field,
+			old_value ? old_value : "(none)", new_value ? new_value : "(none)");
+	(*changes)++;
+}
+
+static void
+diff_uint (guint * changes, const char * object, const char * field,
+		guint32 old_value, guint32 new_value)
+{
+	gchar old_str[16], new_str[16];
+
+	if (old_value == new_value)
+		return;
+
+	g_snprintf (old_str, sizeof (old_str), "%u", old_value);
+	g_snprintf (new_str, sizeof (new_str), "%u", new_value);
+	diff_value (changes, object, field, old_str, new_str);
+}
+
+static void
+append_domains (GString * string, const GPtrArray * domains)
+{
+	int i;
+
+	for (i = 0; i < domains->len; i++)
+		g_string_append_printf (string, "%s %s", i ? "," : " Domains",
+				(const char *) g_ptr_array_index (domains, i));
+}
+
+/* One line describing the whole configuration, NULL if there is none */
+static gchar *
+ip4_to_string (const NMConfigIP4Info * ip4)
+{
+	GString * string;
+	char buf[INET_ADDRSTRLEN + 1];
+	int i;
+
+	if (!ip4)
+		return NULL;
+
+	string = g_string_new (NULL);
+	for (i = 0; i < ip4->addresses->len; i++) {
+		const NMConfigIP4Address * address = &g_array_index (ip4->addresses,
+				NMConfigIP4Address, i);
+
+		inet_ntop (AF_INET, &address->address, buf, sizeof (buf));
+		g_string_append_printf (string, "%s%s/%u", i ? " " : "", buf, address->prefix);
+		inet_ntop (AF_INET, &address->gateway, buf, sizeof (buf));
+		g_string_append_printf (string, " via %s", buf);
+	}
+
+	for (i = 0; i < ip4->nameservers->len; i++) {
+		inet_ntop (AF_INET, &g_array_index (ip4->nameservers, guint32, i),
+				buf, sizeof (buf));
+		g_string_append_printf (string, "%s %s", i ? "," : " DNS", buf);
+	}
+
+	append_domains (string, ip4->domains);
+
+	return g_string_free (string, FALSE);
+}
+
+static gchar *
+ip6_to_string (const NMConfigIP6Info * ip6)
+{
+	GString * string;
+	char buf[INET6_ADDRSTRLEN + 1];
+	int i;
+
+	if (!ip6)
+		return NULL;
+
+	string = g_string_new (NULL);
+	for (i = 0; i < ip6->addresses->len; i++) {
+		const NMConfigIP6Address * address = &g_array_index (ip6->addresses,
+				NMConfigIP6Address, i);
+
+		inet_ntop (AF_INET6, &address->address, buf, sizeof (buf));
+		g_string_append_printf (string, "%s%s/%u", i ? " " : "", buf, address->prefix);
+	}
+
+	for (i = 0; i < ip6->nameservers->len; i++) {
+		inet_ntop (AF_INET6, &g_array_index (ip6->nameservers, struct in6_addr, i),
+				buf, sizeof (buf));
+		g_string_append_printf (string, "%s %s", i ? "," : " DNS", buf);
+	}
+
+	append_domains (string, ip6->domains);
+
+	return g_string_free (string, FALSE);
+}
+
+static void
+diff_ip (guint * changes, const char * iface, const char * field,
+		gchar * old_value, gchar * new_value)
+{
+	diff_value (changes, iface, field, old_value, new_value);
+	g_free (old_value);
+	g_free (new_value);
+}
+
+static void
+print_access_point (char sign, const char * iface, const NMConfigAPInfo * ap)
+{
+	gchar * ssid = ap->ssid ?
+		nm_utils_ssid_to_utf8 ((const char *) ap->ssid->data, ap->ssid->len) : NULL;
+
+	nm_config_print ("%c %s access point %s SSID:%s\n", sign, iface, ap->bssid,
+			ssid ? ssid : "");
+	g_free (ssid);
+}
+
+static void
+diff_access_point (guint * changes, const char * iface,
+		const NMConfigAPInfo * old_ap, const NMConfigAPInfo * new_ap)
+{
+	gchar * object = g_strdup_printf ("%s access point %s", iface, new_ap->bssid);
+	gchar * old_ssid = NULL, * new_ssid = NULL;
+
+	if (old_ap->ssid)
+		old_ssid = nm_utils_ssid_to_utf8 ((const char *) old_ap->ssid->data,
+				old_ap->ssid->len);
+	if (new_ap->ssid)
+		new_ssid = nm_utils_ssid_to_utf8 ((const char *) new_ap->ssid->data,
+				new_ap->ssid->len);
+	diff_value (changes, object, "SSID", old_ssid, new_ssid);
+	g_free (old_ssid);
+	g_free (new_ssid);
+
+	diff_uint (changes, object, "Mode", old_ap->mode, new_ap->mode);
+	diff_uint (changes, object, "Frequency", old_ap->frequency, new_ap->frequency);
+	diff_uint (changes, object, "MaxBitrate", old_ap->max_bitrate, new_ap->max_bitrate);
+	diff_uint (changes, object, "Flags", old_ap->flags, new_ap->flags);
+	diff_uint (changes, object, "WpaFlags", old_ap->wpa_flags, new_ap->wpa_flags);
+	diff_uint (changes, object, "RsnFlags", old_ap->rsn_flags, new_ap->rsn_flags);
+
+	g_free (object);
+}
+
+static void
+diff_access_points (guint * changes, const char * iface,
+		const GPtrArray * old_aps, const GPtrArray * new_aps)
+{
+	GHashTable * unseen;
+	int i;
+
+	if (!old_aps || !new_aps)
+		return;
+
+	/* New access points by BSSID; what is left afterwards appeared */
+	unseen = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < new_aps->len; i++) {
+		NMConfigAPInfo * ap = g_ptr_array_index (new_aps, i);
+
+		g_hash_table_insert (unseen, ap->bssid, ap);
+	}
+
+	for (i = 0; i < old_aps->len; i++) {
+		const NMConfigAPInfo * old_ap = g_ptr_array_index (old_aps, i);
+		const NMConfigAPInfo * new_ap = g_hash_table_lookup (unseen, old_ap->bssid);
+
+		if (new_ap) {
+			diff_access_point (changes, iface, old_ap, new_ap);
+			g_hash_table_remove (unseen, old_ap->bssid);
+		}
+		else {
+			print_access_point ('-', iface, old_ap);
+			(*changes)++;
+		}
+	}
+
+	for (i = 0; i < new_aps->len; i++) {
+		const NMConfigAPInfo * ap = g_ptr_array_index (new_aps, i);
+
+		if (g_hash_table_lookup (unseen, ap->bssid) == ap) {
+			print_access_point ('+', iface, ap);
+			(*changes)++;
+		}
+	}
+
+	g_hash_table_destroy (unseen);
+}
+
+static const char *
+active_bssid (const NMConfigSnapshot * snapshot, const NMConfigDeviceInfo * device)
+{
+	const NMConfigAPInfo * ap = NULL;
+
+	if (device->active_ap_path)
+		ap = nm_config_snapshot_lookup_access_point (snapshot, device->active_ap_path, NULL);
+
+	return ap ? ap->bssid : NULL;
+}
+
+static void
+diff_device (guint * changes,
+		const NMConfigSnapshot * old_snapshot, const NMConfigDeviceInfo * old_device,
+		const NMConfigSnapshot * new_snapshot, const NMConfigDeviceInfo * new_device)
+{
+	const char * iface = new_device->iface;
+
+	diff_uint (changes, iface, "Type", old_device->type, new_device->type);
+	diff_value (changes, iface, "State",
+			nm_config_device_state_to_string (old_device->state),
+			nm_config_device_state_to_string (new_device->state));
+	diff_value (changes, iface, "Managed",
+			yes_no (old_device->managed), yes_no (new_device->managed));
+	diff_value (changes, iface, "Connection",
+			old_device->connection_id, new_device->connection_id);
+	diff_value (changes, iface, "Connection UUID",
+			old_device->connection_uuid, new_device->connection_uuid);
+	diff_value (changes, iface, "Driver", old_device->driver, new_device->driver);
+	diff_value (changes, iface, "UDI", old_device->udi, new_device->udi);
+	diff_value (changes, iface, "HWaddr", old_device->hw_address, new_device->hw_address);
+	diff_value (changes, iface, "Carrier",
+			yes_no (old_device->carrier), yes_no (new_device->carrier));
+	diff_uint (changes, iface, "Speed", old_device->speed, new_device->speed);
+	diff_uint (changes, iface, "Mode", old_device->mode, new_device->mode);
+	diff_uint (changes, iface, "Bitrate", old_device->bitrate, new_device->bitrate);
+	diff_uint (changes, iface, "Capabilities",
+			old_device->capabilities, new_device->capabilities);
+	diff_ip (changes, iface, "IPv4",
+			ip4_to_string (old_device->ip4), ip4_to_string (new_device->ip4));
+	diff_ip (changes, iface, "IPv6",
+			ip6_to_string (old_device->ip6), ip6_to_string (new_device->ip6));
+	diff_value (changes, iface, "Active access point",
+			active_bssid (old_snapshot, old_device),
+			active_bssid (new_snapshot, new_device));
+
+	diff_access_points (changes, iface, old_device->aps, new_device->aps);
+}
+
+static void
+diff_devices (guint * changes,
+		const NMConfigSnapshot * old_snapshot, const NMConfigSnapshot * new_snapshot)
+{
+	int i;
+
+	for (i = 0; i < old_snapshot->devices->len; i++) {
+		const NMConfigDeviceInfo * old_device = g_ptr_array_index (old_snapshot->devices, i);
+		const NMConfigDeviceInfo * new_device;
+
+		new_device = nm_config_snapshot_lookup_iface (new_snapshot, old_device->iface, NULL);
+		if (new_device)
+			diff_device (changes, old_snapshot, old_device, new_snapshot, new_device);
+		else {
+			nm_config_print ("- device %s\n", old_device->iface);
+			(*changes)++;
+		}
+	}
+
+	for (i = 0; i < new_snapshot->devices->len; i++) {
+		const NMConfigDeviceInfo * new_device = g_ptr_array_index (new_snapshot->devices, i);
+
+		if (!nm_config_snapshot_lookup_iface (old_snapshot, new_device->iface, NULL)) {
+			nm_config_print ("+ device %s\n", new_device->iface);
+			(*changes)++;
+		}
+	}
+}
+
+/* Connections without a UUID are told apart by their object path */
+static const char *
+connection_key (const NMConfigConnectionInfo * connection)
+{
+	return connection->uuid ? connection->uuid : connection->path;
+}
+
+static void
+print_connection (char sign, const char * scope,
+		const NMConfigConnectionInfo * connection)
+{
+	nm_config_print ("%c %s connection %s (%s)\n", sign, scope,
+			connection->id ? connection->id : "", connection_key (connection));
+}
+
+static void
+diff_connections (guint * changes, const char * scope,
+		const GPtrArray * old_connections, const GPtrArray * new_connections)
+{
+	GHashTable * unseen;
+	int i;
+
+	if (!old_connections || !new_connections) {
+		if (old_connections || new_connections) {
+			nm_config_print ("%s settings service: %s -> %s\n", scope,
+					old_connections ? "running" : "not running",
+					new_connections ? "running" : "not running");
+			(*changes)++;
+		}
+		return;
+	}
+
+	unseen = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < new_connections->len; i++) {
+		NMConfigConnectionInfo * connection = g_ptr_array_index (new_connections, i);
+
+		if (connection_key (connection))
+			g_hash_table_insert (unseen, (gpointer) connection_key (connection), connection);
+	}
+
+	for (i = 0; i < old_connections->len; i++) {
+		const NMConfigConnectionInfo * old_connection = g_ptr_array_index (old_connections, i);
+		const NMConfigConnectionInfo * new_connection;
+		const char * key = connection_key (old_connection);
+		gchar * object;
+
+		new_connection = key ? g_hash_table_lookup (unseen, key) : NULL;
+		if (!new_connection) {
+			print_connection ('-', scope, old_connection);
+			(*changes)++;
+			continue;
+		}
+
+		object = g_strdup_printf ("%s connection %s", scope, key);
+		diff_value (changes, object, "Id", old_connection->id, new_connection->id);
+		diff_value (changes, object, "Type", old_connection->type, new_connection->type);
+		g_free (object);
+
+		g_hash_table_remove (unseen, key);
+	}
+
+	for (i = 0; i < new_connections->len; i++) {
+		const NMConfigConnectionInfo * connection = g_ptr_array_index (new_connections, i);
+		const char * key = connection_key (connection);
+
+		if (!key || g_hash_table_lookup (unseen, key) == connection) {
+			print_connection ('+', scope, connection);
+			(*changes)++;
+		}
+	}
+
+	g_hash_table_destroy (unseen);
+}
+
+guint
+nm_config_snapshot_file_diff (const NMConfigSnapshotFile * old_file,
+		const NMConfigSnapshotFile * new_file)
+{
+	const NMConfigSnapshot * old_snapshot = old_file->snapshot;
+	const NMConfigSnapshot * new_snapshot = new_file->snapshot;
+	guint changes = 0;
+
+	diff_value (&changes, NULL, "NetworkManager state",
+			nm_config_state_to_string (old_snapshot->state),
+			nm_config_state_to_string (new_snapshot->state));
+	diff_value (&changes, NULL, "Wireless enabled",
+			yes_no (old_snapshot->wireless_enabled),
+			yes_no (new_snapshot->wireless_enabled));
+	diff_value (&changes, NULL, "Wireless hardware enabled",
+			yes_no (old_snapshot->wireless_hw_enabled),
+			yes_no (new_snapshot->wireless_hw_enabled));
+
+	diff_devices (&changes, old_snapshot, new_snapshot);
+
+	diff_connections (&changes, "system",
+			old_file->system_connections, new_file->system_connections);
+	diff_connections (&changes, "user",
+			old_file->user_connections, new_file->user_connections);
+
+	return changes;
+}
@@ -0,0 +1,801 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#include <string.h>
+#include <glib.h>
+
+#include "NMConfigSnapshotFile.h"
+
+/*
+ * Snapshot file format, version 2. All integers are little-endian
+ * guint32, except IP addresses which keep NetworkManager's network byte
+ * order. The file starts with a FileHeader; its sections follow in
+ * enum order, each an array of fixed size records, and the string
+ * table comes last.
+ *
+ * Strings are byte offsets into the string table, which holds every
+ * distinct string once, NUL terminated; NO_STRING stands for NULL.
+ * Records refer to records of other sections by index, NO_INDEX for
+ * none. Since every record is a multiple of 4 bytes, all of them are
+ * aligned when the file is mapped.
+ */
+
+#define FILE_MAGIC "NMCSNAP"
+#define FILE_VERSION 2
+
+#define NO_STRING G_MAXUINT32
+#define NO_INDEX G_MAXUINT32
+
+/* FileHeader flags */
+#define FILE_USER_SETTINGS (1 << 0) /* the user settings service was running */
+
+enum {
+	SECTION_DEVICES,
+	SECTION_ACCESS_POINTS,
+	SECTION_IP4,
+	SECTION_IP6,
+	SECTION_IP4_ADDRESSES,
+	SECTION_IP6_ADDRESSES,
+	SECTION_IP4_NAMESERVERS, /* guint32 */
+	SECTION_IP6_NAMESERVERS, /* struct in6_addr */
+	SECTION_DOMAINS,         /* guint32 string */
+	SECTION_CONNECTIONS,
+	SECTION_STRINGS,         /* count is in bytes */
+
+	N_SECTIONS
+};
+
+typedef struct {
+	guint32 offset;
+	guint32 count;
+} FileSection;
+
+typedef struct {
+	gchar magic[8];
+	guint32 version;
+	guint32 flags;
+	guint32 state;
+	guint32 wireless_enabled;
+	guint32 wireless_hw_enabled;
+	guint32 reserved;
+	FileSection sections[N_SECTIONS];
+} FileHeader;
+
+typedef struct {
+	guint32 path;
+	guint32 type;
+	guint32 iface;
+	guint32 udi;
+	guint32 driver;
+	guint32 managed;
+	guint32 state;
+	guint32 ip4;        /* index, NO_INDEX if not configured */
+	guint32 ip6;
+	guint32 connection_id;   /* active connection */
+	guint32 connection_uuid;
+	guint32 hw_address;
+	guint32 carrier;
+	guint32 speed;
+	guint32 mode;
+	guint32 bitrate;
+	guint32 capabilities;
+	guint32 active_ap_path;
+	guint32 first_ap;
+	guint32 n_aps;      /* NO_INDEX if not a wireless device */
+} FileDevice;
+
+typedef struct {
+	guint32 path;
+	guint32 bssid;
+	guint32 ssid;       /* may contain NUL bytes, see ssid_len */
+	guint32 ssid_len;
+	guint32 mode;
+	guint32 frequency;
+	guint32 max_bitrate;
+	guint32 strength;
+	guint32 flags;
+	guint32 wpa_flags;
+	guint32 rsn_flags;
+} FileAccessPoint;
+
+typedef struct {
+	guint32 first_address;
+	guint32 n_addresses;
+	guint32 first_nameserver;
+	guint32 n_nameservers;
+	guint32 first_domain;
+	guint32 n_domains;
+} FileIPConfig;
+
+typedef struct {
+	guint32 address;    /* network byte order */
+	guint32 prefix;
+	guint32 gateway;    /* network byte order */
+} FileIP4Address;
+
+typedef struct {
+	guint8 address[16];
+	guint32 prefix;
+} FileIP6Address;
+
+typedef struct {
+	guint32 scope;
+	guint32 path;
+	guint32 id;
+	guint32 uuid;
+	guint32 type;
+} FileConnection;
+
+static const gsize record_sizes[N_SECTIONS] = {
+	sizeof (FileDevice),
+	sizeof (FileAccessPoint),
+	sizeof (FileIPConfig),
+	sizeof (FileIPConfig),
+	sizeof (FileIP4Address),
+	sizeof (FileIP6Address),
+	sizeof (guint32),
+	sizeof (struct in6_addr),
+	sizeof (guint32),
+	sizeof (FileConnection),
+	1
+};
+
+#define LE(value) GUINT32_TO_LE (value)
+#define FROM_LE(value) GUINT32_FROM_LE (value)
+
+/* Writing */
+
+typedef struct {
+	GArray * sections[N_SECTIONS]; /* all but SECTION_STRINGS */
+	GString * strings;
+	GHashTable * interned;         /* string -> offset + 1 */
+} Writer;
+
+static guint32
+write_string (Writer * writer, const char * string)
+{
+	gpointer offset;
+
+	if (!string)
+		return LE (NO_STRING);
+
+	offset = g_hash_table_lookup (writer->interned, string);
+	if (!offset) {
+		offset = GUINT_TO_POINTER (writer->strings->len + 1);
+		g_string_append_len (writer->strings, string, strlen (string) + 1);
+		g_hash_table_insert (writer->interned, g_strdup (string), offset);
+	}
+
+	return LE (GPOINTER_TO_UINT (offset) - 1);
+}
+
+/* SSIDs are interned too, unless they contain NUL bytes */
+static guint32
+write_bytes (Writer * writer, const guint8 * data, guint len)
+{
+	guint32 offset;
+	gchar * string;
+
+	if (memchr (data, '\0', len)) {
+		offset = writer->strings->len;
+		g_string_append_len (writer->strings, (const gchar *) data, len);
+		g_string_append_c (writer->strings, '\0');
+		return LE (offset);
+	}
+
+	string = g_strndup ((const gchar *) data, len);
+	offset = write_string (writer, string);
+	g_free (string);
+
+	return offset;
+}
+
+static guint32
+write_domains (Writer * writer, const GPtrArray * domains)
+{
+	GArray * section = writer->sections[SECTION_DOMAINS];
+	guint32 first = section->len;
+	int i;
+
+	for (i = 0; i < domains->len; i++) {
+		guint32 domain = write_string (writer, g_ptr_array_index (domains, i));
+
+		g_array_append_val (section, domain);
+	}
+
+	return LE (first);
+}
+
+static guint32
+write_ip4 (Writer * writer, const NMConfigIP4Info * ip4)
+{
+	GArray * section = writer->sections[SECTION_IP4];
+	GArray * addresses = writer->sections[SECTION_IP4_ADDRESSES];
+	FileIPConfig record;
+	int i;
+
+	if (!ip4)
+		return LE (NO_INDEX);
+
+	record.first_address = LE (addresses->len);
+	record.n_addresses = LE (ip4->addresses->len);
+	for (i = 0; i < ip4->addresses->len; i++) {
+		const NMConfigIP4Address * address = &g_array_index (ip4->addresses,
+				NMConfigIP4Address, i);
+		FileIP4Address file_address;
+
+		file_address.address = address->address;
+		file_address.prefix = LE (address->prefix);
+		file_address.gateway = address->gateway;
+		g_array_append_val (addresses, file_address);
+	}
+
+	record.first_nameserver = LE (writer->sections[SECTION_IP4_NAMESERVERS]->len);
+	record.n_nameservers = LE (ip4->nameservers->len);
+	g_array_append_vals (writer->sections[SECTION_IP4_NAMESERVERS],
+			ip4->nameservers->data, ip4->nameservers->len);
+
+	record.first_domain = write_domains (writer, ip4->domains);
+	record.n_domains = LE (ip4->domains->len);
+
+	g_array_append_val (section, record);
+	return LE (section->len - 1);
+}
+
+static guint32
+write_ip6 (Writer * writer, const NMConfigIP6Info * ip6)
+{
+	GArray * section = writer->sections[SECTION_IP6];
+	GArray * addresses = writer->sections[SECTION_IP6_ADDRESSES];
+	FileIPConfig record;
+	int i;
+
+	if (!ip6)
+		return LE (NO_INDEX);
+
+	record.first_address = LE (addresses->len);
+	record.n_addresses = LE (ip6->addresses->len);
+	for (i = 0; i < ip6->addresses->len; i++) {
+		const NMConfigIP6Address * address = &g_array_index (ip6->addresses,
+				NMConfigIP6Address, i);
+		FileIP6Address file_address;
+
+		memcpy (file_address.address, &address->address, sizeof (file_address.address));
+		file_address.prefix = LE (address->prefix);
+		g_array_append_val (addresses, file_address);
+	}
+
+	record.first_nameserver = LE (writer->sections[SECTION_IP6_NAMESERVERS]->len);
+	record.n_nameservers = LE (ip6->nameservers->len);
+	g_array_append_vals (writer->sections[SECTION_IP6_NAMESERVERS],
+			ip6->nameservers->data, ip6->nameservers->len);
+
+	record.first_domain = write_domains (writer, ip6->domains);
+	record.n_domains = LE (ip6->domains->len);
+
+	g_array_append_val (section, record);
+	return LE (section->len - 1);
+}
+
+static void
+write_access_point (Writer * writer, const NMConfigAPInfo * ap)
+{
+	FileAccessPoint record;
+
+	record.path = write_string (writer, ap->path);
+	record.bssid = write_string (writer, ap->bssid);
+	if (ap->ssid) {
+		record.ssid = write_bytes (writer, ap->ssid->data, ap->ssid->len);
+		record.ssid_len = LE (ap->ssid->len);
+	}
+	else {
+		record.ssid = write_string (writer, "");
+		record.ssid_len = 0;
+	}
+	record.mode = LE (ap->mode);
+	record.frequency = LE (ap->frequency);
+	record.max_bitrate = LE (ap->max_bitrate);
+	record.strength = LE (ap->strength);
+	record.flags = LE (ap->flags);
+	record.wpa_flags = LE (ap->wpa_flags);
+	record.rsn_flags = LE (ap->rsn_flags);
+
+	g_array_append_val (writer->sections[SECTION_ACCESS_POINTS], record);
+}
+
+static void
+write_device (Writer * writer, const NMConfigDeviceInfo * device)
+{
+	FileDevice record;
+	int i;
+
+	record.path = write_string (writer, device->path);
+	record.type = LE (device->type);
+	record.iface = write_string (writer, device->iface);
+	record.udi = write_string (writer, device->udi);
+	record.driver = write_string (writer, device->driver);
+	record.managed = LE (device->managed);
+	record.state = LE (device->state);
+	record.ip4 = write_ip4 (writer, device->ip4);
+	record.ip6 = write_ip6 (writer, device->ip6);
+	record.connection_id = write_string (writer, device->connection_id);
+	record.connection_uuid = write_string (writer, device->connection_uuid);
+	record.hw_address = write_string (writer, device->hw_address);
+	record.carrier = LE (device->carrier);
+	record.speed = LE (device->speed);
+	record.mode = LE (device->mode);
+	record.bitrate = LE (device->bitrate);
+	record.capabilities = LE (device->capabilities);
+	record.active_ap_path = write_string (writer, device->active_ap_path);
+	record.first_ap = LE (writer->sections[SECTION_ACCESS_POINTS]->len);
+	record.n_aps = LE (device->aps ? device->aps->len : NO_INDEX);
+
+	for (i = 0; device->aps && i < device->aps->len; i++)
+		write_access_point (writer, g_ptr_array_index (device->aps, i));
+
+	g_array_append_val (writer->sections[SECTION_DEVICES], record);
+}
+
+static void
+write_connections (Writer * writer, NMConnectionScope scope,
+		const GPtrArray * connections)
+{
+	int i;
+
+	for (i = 0; connections && i < connections->len; i++) {
+		const NMConfigConnectionInfo * connection = g_ptr_array_index (connections, i);
+		FileConnection record;
+
+		record.scope = LE (scope);
+		record.path = write_string (writer, connection->path);
+		record.id = write_string (writer, connection->id);
+		record.uuid = write_string (writer, connection->uuid);
+		record.type = write_string (writer, connection->type);
+
+		g_array_append_val (writer->sections[SECTION_CONNECTIONS], record);
+	}
+}
+
+gboolean
+nm_config_snapshot_file_save (const char * path,
+		const NMConfigSnapshot * snapshot, const GPtrArray * system_connections,
+		const GPtrArray * user_connections, GError ** error)
+{
+	Writer writer;
+	FileHeader header;
+	GString * contents;
+	gboolean saved;
+	int i;
+
+	g_return_val_if_fail (path != NULL, FALSE);
+	g_return_val_if_fail (snapshot != NULL, FALSE);
+
+	for (i = 0; i < SECTION_STRINGS; i++)
+		writer.sections[i] = g_array_new (FALSE, FALSE, record_sizes[i]);
+	writer.strings = g_string_new (NULL);
+	writer.interned = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (i = 0; i < snapshot->devices->len; i++)
+		write_device (&writer, g_ptr_array_index (snapshot->devices, i));
+	write_connections (&writer, NM_CONNECTION_SCOPE_SYSTEM, system_connections);
+	write_connections (&writer, NM_CONNECTION_SCOPE_USER, user_connections);
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, FILE_MAGIC, sizeof (header.magic));
+	header.version = LE (FILE_VERSION);
+	header.flags = LE (user_connections ? FILE_USER_SETTINGS : 0);
+	header.state = LE (snapshot->state);
+	header.wireless_enabled = LE (snapshot->wireless_enabled);
+	header.wireless_hw_enabled = LE (snapshot->wireless_hw_enabled);
+
+	contents = g_string_sized_new (sizeof (header));
+	g_string_append_len (contents, (const gchar *) &header, sizeof (header));
+
+	for (i = 0; i < SECTION_STRINGS; i++) {
+		header.sections[i].offset = LE (contents->len);
+		header.sections[i].count = LE (writer.sections[i]->len);
+		g_string_append_len (contents, writer.sections[i]->data,
+				writer.sections[i]->len * record_sizes[i]);
+		g_array_free (writer.sections[i], TRUE);
+	}
+	header.sections[SECTION_STRINGS].offset = LE (contents->len);
+	header.sections[SECTION_STRINGS].count = LE (writer.strings->len);
+	g_string_append_len (contents, writer.strings->str, writer.strings->len);
+
+	/* Now that the offsets are known */
+	memcpy (contents->str, &header, sizeof (header));
+
+	saved = g_file_set_contents (path, contents->str, contents->len, error);
+
+	g_string_free (contents, TRUE);
+	g_string_free (writer.strings, TRUE);
+	g_hash_table_destroy (writer.interned);
+
+	return saved;
+}
+
+/* Reading. Every offset, index and count is checked against the size
+ * of the file before it's used, a file failing any check is rejected.
+ */
+
+typedef struct {
+	const gchar * data;
+	const FileHeader * header;
+	const gchar * strings;
+	guint32 strings_len;
+	gboolean damaged;
+} Reader;
+
+static gboolean
+check_sections (const gchar * data, gsize length)
+{
+	const FileHeader * header = (const FileHeader *) data;
+	int i;
+
+	for (i = 0; i < N_SECTIONS; i++) {
+		guint32 offset = FROM_LE (header->sections[i].offset);
+		guint32 count = FROM_LE (header->sections[i].count);
+
+		if (offset < sizeof (FileHeader) || offset > length || offset % 4
+			|| count > (length - offset) / record_sizes[i])
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Records first to first + count - 1 of section, NULL if out of bounds */
+static gconstpointer
+read_records (Reader * reader, guint section, guint32 first, guint32 count)
+{
+	const FileSection * file_section = &reader->header->sections[section];
+	guint32 len = FROM_LE (file_section->count);
+
+	if (first > len || count > len - first) {
+		reader->damaged = TRUE;
+		return NULL;
+	}
+
+	return reader->data + FROM_LE (file_section->offset) + first * record_sizes[section];
+}
+
+static gchar *
+read_string (Reader * reader, guint32 string)
+{
+	guint32 offset = FROM_LE (string);
+
+	if (offset == NO_STRING)
+		return NULL;
+
+	if (offset >= reader->strings_len
+		|| !memchr (reader->strings + offset, '\0', reader->strings_len - offset)) {
+		reader->damaged = TRUE;
+		return NULL;
+	}
+
+	return g_strdup (reader->strings + offset);
+}
+
+static void
+read_domains (Reader * reader, GPtrArray * domains, guint32 first, guint32 count)
+{
+	const guint32 * records = read_records (reader, SECTION_DOMAINS,
+			FROM_LE (first), FROM_LE (count));
+	int i;
+
+	for (i = 0; records && i < FROM_LE (count); i++) {
+		gchar * domain = read_string (reader, records[i]);
+
+		if (domain)
+			g_ptr_array_add (domains, domain);
+	}
+}
+
+static NMConfigIP4Info *
+read_ip4 (Reader * reader, guint32 index)
+{
+	const FileIPConfig * record;
+	const FileIP4Address * addresses;
+	gconstpointer nameservers;
+	NMConfigIP4Info * ip4;
+	int i;
+
+	if (FROM_LE (index) == NO_INDEX)
+		return NULL;
+
+	record = read_records (reader, SECTION_IP4, FROM_LE (index), 1);
+	if (!record)
+		return NULL;
+
+	ip4 = g_new0 (NMConfigIP4Info, 1);
+	ip4->addresses = g_array_new (FALSE, FALSE, sizeof (NMConfigIP4Address));
+	ip4->nameservers = g_array_new (FALSE, FALSE, sizeof (guint32));
+	ip4->domains = g_ptr_array_new ();
+
+	addresses = read_records (reader, SECTION_IP4_ADDRESSES,
+			FROM_LE (record->first_address), FROM_LE (record->n_addresses));
+	for (i = 0; addresses && i < FROM_LE (record->n_addresses); i++) {
+		NMConfigIP4Address address;
+
+		address.address = addresses[i].address;
+		address.prefix = FROM_LE (addresses[i].prefix);
+		address.gateway = addresses[i].gateway;
+		g_array_append_val (ip4->addresses, address);
+	}
+
+	nameservers = read_records (reader, SECTION_IP4_NAMESERVERS,
+			FROM_LE (record->first_nameserver), FROM_LE (record->n_nameservers));
+	if (nameservers)
+		g_array_append_vals (ip4->nameservers, nameservers,
+				FROM_LE (record->n_nameservers));
+
+	read_domains (reader, ip4->domains, record->first_domain, record->n_domains);
+
+	return ip4;
+}
+
+static NMConfigIP6Info *
+read_ip6 (Reader * reader, guint32 index)
+{
+	const FileIPConfig * record;
+	const FileIP6Address * addresses;
+	gconstpointer nameservers;
+	NMConfigIP6Info * ip6;
+	int i;
+
+	if (FROM_LE (index) == NO_INDEX)
+		return NULL;
+
+	record = read_records (reader, SECTION_IP6, FROM_LE (index), 1);
+	if (!record)
+		return NULL;
+
+	ip6 = g_new0 (NMConfigIP6Info, 1);
+	ip6->addresses = g_array_new (FALSE, FALSE, sizeof (NMConfigIP6Address));
+	ip6->nameservers = g_array_new (FALSE, FALSE, sizeof (struct in6_addr));
+	ip6->domains = g_ptr_array_new ();
+
+	addresses = read_records (reader, SECTION_IP6_ADDRESSES,
+			FROM_LE (record->first_address), FROM_LE (record->n_addresses));
+	for (i = 0; addresses && i < FROM_LE (record->n_addresses); i++) {
+		NMConfigIP6Address address;
+
+		memcpy (&address.address, addresses[i].address, sizeof (address.address));
+		address.prefix = FROM_LE (addresses[i].prefix);
+		g_array_append_val (ip6->addresses, address);
+	}
+
+	nameservers = read_records (reader, SECTION_IP6_NAMESERVERS,
+			FROM_LE (record->first_nameserver), FROM_LE (record->n_nameservers));
+	if (nameservers)
+		g_array_append_vals (ip6->nameservers, nameservers,
+				FROM_LE (record->n_nameservers));
+
+	read_domains (reader, ip6->domains, record->first_domain, record->n_domains);
+
+	return ip6;
+}
+
+static NMConfigAPInfo *
+read_access_point (Reader * reader, const FileAccessPoint * record)
+{
+	NMConfigAPInfo * ap = g_new0 (NMConfigAPInfo, 1);
+	guint32 ssid = FROM_LE (record->ssid);
+	guint32 ssid_len = FROM_LE (record->ssid_len);
+
+	ap->path = read_string (reader, record->path);
+	ap->bssid = read_string (reader, record->bssid);
+	ap->mode = FROM_LE (record->mode);
+	ap->frequency = FROM_LE (record->frequency);
+	ap->max_bitrate = FROM_LE (record->max_bitrate);
+	ap->strength = FROM_LE (record->strength);
+	ap->flags = FROM_LE (record->flags);
+	ap->wpa_flags = FROM_LE (record->wpa_flags);
+	ap->rsn_flags = FROM_LE (record->rsn_flags);
+
+	if (ssid >= reader->strings_len || ssid_len > reader->strings_len - ssid)
+		reader->damaged = TRUE;
+	else {
+		ap->ssid = g_byte_array_sized_new (ssid_len);
+		g_byte_array_append (ap->ssid, (const guint8 *) reader->strings + ssid, ssid_len);
+	}
+
+	/* Saved access points always have these */
+	if (!ap->path || !ap->bssid)
+		reader->damaged = TRUE;
+
+	return ap;
+}
+
+static NMConfigDeviceInfo *
+read_device (Reader * reader, const FileDevice * record)
+{
+	NMConfigDeviceInfo * device = g_new0 (NMConfigDeviceInfo, 1);
+	const FileAccessPoint * aps;
+	guint32 n_aps = FROM_LE (record->n_aps);
+	int i;
+
+	device->path = read_string (reader, record->path);
+	device->type = FROM_LE (record->type);
+	device->iface = read_string (reader, record->iface);
+	device->udi = read_string (reader, record->udi);
+	device->driver = read_string (reader, record->driver);
+	device->managed = FROM_LE (record->managed);
+	device->state = FROM_LE (record->state);
+	device->ip4 = read_ip4 (reader, record->ip4);
+	device->ip6 = read_ip6 (reader, record->ip6);
+	device->connection_id = read_string (reader, record->connection_id);
+	device->connection_uuid = read_string (reader, record->connection_uuid);
+	device->hw_address = read_string (reader, record->hw_address);
+	device->carrier = FROM_LE (record->carrier);
+	device->speed = FROM_LE (record->speed);
+	device->mode = FROM_LE (record->mode);
+	device->bitrate = FROM_LE (record->bitrate);
+	device->capabilities = FROM_LE (record->capabilities);
+	device->active_ap_path = read_string (reader, record->active_ap_path);
+
+	if (n_aps != NO_INDEX) {
+		/* n_aps is only trusted once read_records() checked it */
+		aps = read_records (reader, SECTION_ACCESS_POINTS,
+				FROM_LE (record->first_ap), n_aps);
+		device->aps = g_ptr_array_sized_new (aps ? n_aps : 0);
+		for (i = 0; aps && i < n_aps; i++)
+			g_ptr_array_add (device->aps, read_access_point (reader, &aps[i]));
+	}
+
+	/* Needed to index the snapshot */
+	if (!device->path || !device->iface)
+		reader->damaged = TRUE;
+
+	return device;
+}
+
+static void
+read_connections (Reader * reader, NMConfigSnapshotFile * file)
+{
+	const FileSection * section = &reader->header->sections[SECTION_CONNECTIONS];
+	const FileConnection * records;
+	guint32 count = FROM_LE (section->count);
+	int i;
+
+	records = read_records (reader, SECTION_CONNECTIONS, 0, count);
+	for (i = 0; records && i < count; i++) {
+		NMConfigConnectionInfo * connection = g_new0 (NMConfigConnectionInfo, 1);
+
+		connection->path = read_string (reader, records[i].path);
+		connection->id = read_string (reader, records[i].id);
+		connection->uuid = read_string (reader, records[i].uuid);
+		connection->type = read_string (reader, records[i].type);
+
+		if (FROM_LE (records[i].scope) == NM_CONNECTION_SCOPE_USER && file->user_connections)
+			g_ptr_array_add (file->user_connections, connection);
+		else if (FROM_LE (records[i].scope) == NM_CONNECTION_SCOPE_SYSTEM)
+			g_ptr_array_add (file->system_connections, connection);
+		else {
+			nm_config_connection_info_free (connection);
+			reader->damaged = TRUE;
+		}
+	}
+}
+
+NMConfigSnapshotFile *
+nm_config_snapshot_file_load (const char * path, GError ** error)
+{
+	NMConfigSnapshotFile * file;
+	NMConfigSnapshot * snapshot;
+	GMappedFile * mapped;
+	Reader reader;
+	const FileDevice * devices;
+	gsize length;
+	guint32 n_devices;
+	int i;
+
+	g_return_val_if_fail (path != NULL, NULL);
+
+	mapped = g_mapped_file_new (path, FALSE, error);
+	if (!mapped)
+		return NULL;
+
+	reader.data = g_mapped_file_get_contents (mapped);
+	length = g_mapped_file_get_length (mapped);
+	reader.header = (const FileHeader *) reader.data;
+	reader.damaged = FALSE;
+
+	if (length < sizeof (FileHeader)
+		|| memcmp (reader.header->magic, FILE_MAGIC, sizeof (reader.header->magic))) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				"%s is not an nmconfig snapshot", path);
+		g_mapped_file_free (mapped);
+		return NULL;
+	}
+
+	if (FROM_LE (reader.header->version) != FILE_VERSION) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				"%s: unsupported snapshot version %u", path,
+				FROM_LE (reader.header->version));
+		g_mapped_file_free (mapped);
+		return NULL;
+	}
+
+	if (!check_sections (reader.data, length)) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				"%s: snapshot is damaged", path);
+		g_mapped_file_free (mapped);
+		return NULL;
+	}
+
+	reader.strings = reader.data + FROM_LE (reader.header->sections[SECTION_STRINGS].offset);
+	reader.strings_len = FROM_LE (reader.header->sections[SECTION_STRINGS].count);
+
+	snapshot = g_new0 (NMConfigSnapshot, 1);
+	snapshot->state = FROM_LE (reader.header->state);
+	snapshot->wireless_enabled = FROM_LE (reader.header->wireless_enabled);
+	snapshot->wireless_hw_enabled = FROM_LE (reader.header->wireless_hw_enabled);
+
+	n_devices = FROM_LE (reader.header->sections[SECTION_DEVICES].count);
+	snapshot->devices = g_ptr_array_sized_new (n_devices);
+	devices = read_records (&reader, SECTION_DEVICES, 0, n_devices);
+	for (i = 0; devices && i < n_devices; i++)
+		g_ptr_array_add (snapshot->devices, read_device (&reader, &devices[i]));
+
+	file = g_new0 (NMConfigSnapshotFile, 1);
+	file->snapshot = snapshot;
+	file->system_connections = g_ptr_array_new ();
+	if (FROM_LE (reader.header->flags) & FILE_USER_SETTINGS)
+		file->user_connections = g_ptr_array_new ();
+	read_connections (&reader, file);
+
+	g_mapped_file_free (mapped);
+
+	if (reader.damaged) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				"%s: snapshot is damaged", path);
+		nm_config_snapshot_file_free (file);
+		return NULL;
+	}
+
+	nm_config_snapshot_index (snapshot);
+
+	return file;
+}
+
+static void
+free_connections (GPtrArray * connections)
+{
+	if (!connections)
+		return;
+
+	g_ptr_array_foreach (connections, (GFunc) nm_config_connection_info_free, NULL);
+	g_ptr_array_free (connections, TRUE);
+}
+
+void
+nm_config_snapshot_file_free (NMConfigSnapshotFile * file)
+{
+	if (!file)
+		return;
+
+	nm_config_snapshot_free (file->snapshot);
+	free_connections (file->system_connections);
+	free_connections (file->user_connections);
+	g_free (file);
+}
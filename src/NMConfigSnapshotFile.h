@@ -0,0 +1,62 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_SNAPSHOT_FILE_H
+#define NM_CONFIG_SNAPSHOT_FILE_H
+
+#include <glib.h>
+
+#include "NMConfigSnapshot.h"
+#include "NMConfigSettings.h"
+
+/*
+ * Saved state, as written by --dump-snapshot: the NetworkManager
+ * snapshot and the connections of both settings services. The file is
+ * memory-mapped on load and decoded in one pass; see
+ * NMConfigSnapshotFile.c for the format.
+ */
+
+typedef struct {
+	NMConfigSnapshot * snapshot;
+	GPtrArray * system_connections; /* NMConfigConnectionInfo */
+	GPtrArray * user_connections;   /* NULL if the service wasn't running */
+} NMConfigSnapshotFile;
+
+/* connections are NMConfigConnectionInfo; user_connections is NULL if
+ * the user settings service isn't running.
+ */
+gboolean nm_config_snapshot_file_save (const char * path,
+		const NMConfigSnapshot * snapshot, const GPtrArray * system_connections,
+		const GPtrArray * user_connections, GError ** error);
+
+NMConfigSnapshotFile * nm_config_snapshot_file_load (const char * path,
+		GError ** error);
+
+void nm_config_snapshot_file_free (NMConfigSnapshotFile * file);
+
+/* Prints what changed from old to new, one line per change, and
+ * returns the number of changes.
+ */
+guint nm_config_snapshot_file_diff (const NMConfigSnapshotFile * old_file,
+		const NMConfigSnapshotFile * new_file);
+
+#endif /* NM_CONFIG_SNAPSHOT_FILE_H */
@@ -0,0 +1,263 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+
+#include "NMConfigStats.h"
+
+static const char * phase_names[NM_CONFIG_N_PHASES] = {
+	"bootstrap",
+	"settings read",
+	"parse_command_line",
+	"render"
+};
+
+static GTimer * timer = NULL;
+
+static GArray * phase_times[NM_CONFIG_N_PHASES];   /* gdouble, seconds */
+static gdouble phase_started[NM_CONFIG_N_PHASES];
+static gboolean phase_running[NM_CONFIG_N_PHASES];
+
+/* Kept until exit */
+static GHashTable * call_times = NULL;  /* "iface method" -> GArray of gdouble */
+static GHashTable * signal_counts = NULL; /* "iface.member" -> count */
+static guint replies_received = 0;
+static guint errors_received = 0;
+
+void
+nm_config_stats_enable (void)
+{
+	int i;
+
+	if (timer)
+		return;
+
+	timer = g_timer_new ();
+	for (i = 0; i < NM_CONFIG_N_PHASES; i++)
+		phase_times[i] = g_array_new (FALSE, FALSE, sizeof (gdouble));
+	call_times = g_hash_table_new_full (g_str_hash, g_str_equal,
+			g_free, NULL);
+	signal_counts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+gdouble
+nm_config_stats_now (void)
+{
+	return timer ? g_timer_elapsed (timer, NULL) : 0.0;
+}
+
+void
+nm_config_stats_call (const char * iface, const char * method, gdouble started)
+{
+	gchar * key;
+	GArray * times;
+	gdouble elapsed;
+
+	if (!timer)
+		return;
+
+	elapsed = nm_config_stats_now () - started;
+	key = g_strdup_printf ("%s %s", iface, method);
+	times = g_hash_table_lookup (call_times, key);
+	if (!times) {
+		times = g_array_new (FALSE, FALSE, sizeof (gdouble));
+		g_hash_table_insert (call_times, key, times);
+	}
+	else
+		g_free (key);
+
+	g_array_append_val (times, elapsed);
+}
+
+static DBusHandlerResult
+stats_filter (DBusConnection * connection, DBusMessage * message, void * user_data)
+{
+	gchar * key;
+	gpointer count;
+
+	switch (dbus_message_get_type (message)) {
+	case DBUS_MESSAGE_TYPE_METHOD_RETURN:
+		replies_received++;
+		break;
+	case DBUS_MESSAGE_TYPE_ERROR:
+		errors_received++;
+		break;
+	case DBUS_MESSAGE_TYPE_SIGNAL:
+		key = g_strdup_printf ("%s.%s", dbus_message_get_interface (message),
+				dbus_message_get_member (message));
+		count = g_hash_table_lookup (signal_counts, key);
+		g_hash_table_replace (signal_counts, key,
+				GUINT_TO_POINTER (GPOINTER_TO_UINT (count) + 1));
+		break;
+	default:
+		break;
+	}
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+void
+nm_config_stats_watch_connection (DBusConnection * connection)
+{
+	if (!timer || !connection)
+		return;
+
+	dbus_connection_add_filter (connection, stats_filter, NULL, NULL);
+}
+
+void
+nm_config_stats_phase_begin (NMConfigPhase phase)
+{
+	if (!timer || phase_running[phase])
+		return;
+
+	phase_running[phase] = TRUE;
+	phase_started[phase] = nm_config_stats_now ();
+}
+
+void
+nm_config_stats_phase_end (NMConfigPhase phase)
+{
+	gdouble elapsed;
+
+	if (!timer || !phase_running[phase])
+		return;
+
+	phase_running[phase] = FALSE;
+	elapsed = nm_config_stats_now () - phase_started[phase];
+	g_array_append_val (phase_times[phase], elapsed);
+}
+
+/* Reporting */
+
+static int
+compare_doubles (const void * a, const void * b)
+{
+	gdouble x = *(const gdouble *) a;
+	gdouble y = *(const gdouble *) b;
+
+	return x < y ? -1 : (x > y);
+}
+
+/* Nearest rank percentile of sorted times */
+static gdouble
+percentile (const GArray * times, guint percent)
+{
+	guint rank = (times->len * percent + 99) / 100;
+
+	return g_array_index (times, gdouble, rank > 0 ? rank - 1 : 0);
+}
+
+static void
+report_times (const char * name, GArray * times)
+{
+	gdouble total = 0.0;
+	int i;
+
+	if (times->len == 0) {
+		g_printerr ("  %-52s %6s\n", name, "-");
+		return;
+	}
+
+	qsort (times->data, times->len, sizeof (gdouble), compare_doubles);
+	for (i = 0; i < times->len; i++)
+		total += g_array_index (times, gdouble, i);
+
+	g_printerr ("  %-52s %6u %10.3f %9.3f %9.3f %9.3f\n", name, times->len,
+			total * 1000.0,
+			percentile (times, 50) * 1000.0,
+			percentile (times, 99) * 1000.0,
+			g_array_index (times, gdouble, times->len - 1) * 1000.0);
+}
+
+static gint
+compare_keys (gconstpointer a, gconstpointer b)
+{
+	return strcmp (*(const char * const *) a, *(const char * const *) b);
+}
+
+static GPtrArray *
+sorted_keys (GHashTable * table)
+{
+	GPtrArray * keys = g_ptr_array_sized_new (g_hash_table_size (table));
+	GHashTableIter iter;
+	gpointer key;
+
+	g_hash_table_iter_init (&iter, table);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		g_ptr_array_add (keys, key);
+	g_ptr_array_sort (keys, compare_keys);
+
+	return keys;
+}
+
+void
+nm_config_stats_report (void)
+{
+	GPtrArray * keys;
+	guint calls = 0;
+	int i;
+
+	if (!timer)
+		return;
+
+	g_printerr ("\nOnly the D-Bus calls nmconfig makes itself are timed. Calls made\n"
+	            "inside libnm-glib and waits for signals are counted as replies and\n"
+	            "signals below, without their latency; such waits show up only in\n"
+	            "the phase that contains them.\n");
+
+	g_printerr ("\n%-54s %6s %10s %9s %9s %9s\n", "Phases (ms)",
+			"count", "total", "p50", "p99", "max");
+	for (i = 0; i < NM_CONFIG_N_PHASES; i++) {
+		if (phase_running[i])
+			g_printerr ("  %-52s unfinished\n", phase_names[i]);
+		else
+			report_times (phase_names[i], phase_times[i]);
+	}
+
+	g_printerr ("\n%-54s %6s %10s %9s %9s %9s\n", "D-Bus calls (ms)",
+			"count", "total", "p50", "p99", "max");
+	keys = sorted_keys (call_times);
+	for (i = 0; i < keys->len; i++) {
+		GArray * times = g_hash_table_lookup (call_times, g_ptr_array_index (keys, i));
+
+		report_times (g_ptr_array_index (keys, i), times);
+		calls += times->len;
+	}
+	g_ptr_array_free (keys, TRUE);
+
+	g_printerr ("\n%u calls timed; received %u replies, %u errors (untimed ones included)\n",
+			calls, replies_received, errors_received);
+
+	keys = sorted_keys (signal_counts);
+	for (i = 0; i < keys->len; i++) {
+		const char * key = g_ptr_array_index (keys, i);
+
+		g_printerr ("  signal %-45s %6u\n", key,
+				GPOINTER_TO_UINT (g_hash_table_lookup (signal_counts, key)));
+	}
+	g_ptr_array_free (keys, TRUE);
+
+	g_printerr ("Total %.3f ms\n", nm_config_stats_now () * 1000.0);
+}
@@ -0,0 +1,63 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_STATS_H
+#define NM_CONFIG_STATS_H
+
+#include <glib.h>
+#include <dbus/dbus.h>
+
+/*
+ * Timings collected for --stats and printed to stderr at exit: the
+ * D-Bus calls nmconfig makes itself, the messages arriving on the bus
+ * connection and the phases of a run. Everything is a no-op until
+ * nm_config_stats_enable() is called.
+ */
+
+typedef enum {
+	NM_CONFIG_PHASE_BOOTSTRAP,  /* NMClient and the bus connection */
+	NM_CONFIG_PHASE_SETTINGS,   /* until the settings services listed connections */
+	NM_CONFIG_PHASE_COMMAND,    /* parse_command_line() until devices are read */
+	NM_CONFIG_PHASE_RENDER,     /* formatting and writing output */
+	NM_CONFIG_N_PHASES
+} NMConfigPhase;
+
+void nm_config_stats_enable (void);
+
+/* Seconds since nm_config_stats_enable(), 0 if disabled */
+gdouble nm_config_stats_now (void);
+
+/* A call started at time started (see nm_config_stats_now()) has
+ * returned. For GetAll, iface is the interface whose properties were read.
+ */
+void nm_config_stats_call (const char * iface, const char * method,
+		gdouble started);
+
+/* Count signals, replies and errors arriving on connection */
+void nm_config_stats_watch_connection (DBusConnection * connection);
+
+void nm_config_stats_phase_begin (NMConfigPhase phase);
+void nm_config_stats_phase_end (NMConfigPhase phase);
+
+void nm_config_stats_report (void);
+
+#endif /* NM_CONFIG_STATS_H */
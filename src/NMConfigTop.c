@@ -0,0 +1,496 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigTop.h"
+#include "NMConfigIfaceMatch.h"
+#include "NMConfigSnapshot.h"
+#include "NMConfigLiveSnapshot.h"
+#include "NMConfigPrint.h"
+
+/* Redraws are delayed a bit, so a burst of changes costs one */
+#define REDRAW_DELAY 100
+
+/* Access points shown per device unless --max-aps is given */
+#define DEFAULT_MAX_APS 3
+
+/* Seconds between checks of the terminal size */
+#define RESIZE_CHECK_INTERVAL 1
+
+#define ESC "\033"
+
+struct _NMConfigTop {
+	NMConfigIfaceMatch * match; /* NULL to show every device */
+	NMConfigDevicePrintOptions options;
+
+	NMConfigLiveSnapshot * live;
+	gchar * status;           /* why the view may be out of date */
+
+	/* Terminal */
+	gboolean screen_active;
+	guint rows;
+	guint cols;
+	GPtrArray * lines;        /* gchar *, as shown on the terminal */
+	gboolean clear;           /* nothing shown can be relied on */
+	GString * frame;          /* reused for every frame */
+	GString * output;         /* what is sent for a frame */
+	guint redraw_id;
+	guint resize_id;
+
+	GIOChannel * input;
+	guint input_id;
+	struct termios saved_termios;
+	gboolean termios_saved;
+
+	NMConfigTopFunc done;
+	gpointer user_data;
+};
+
+static gboolean
+is_shown (NMConfigTop * top, const NMConfigDeviceInfo * device)
+{
+	return !top->match || nm_config_iface_match_test (top->match, device->iface);
+}
+
+/* Terminal */
+
+static void
+terminal_send (const char * data)
+{
+	nm_config_print_write (data, strlen (data));
+	nm_config_print_flush ();
+}
+
+static void
+terminal_read_size (NMConfigTop * top, guint * rows, guint * cols)
+{
+	struct winsize size;
+
+	if (ioctl (STDOUT_FILENO, TIOCGWINSZ, &size) < 0
+		|| size.ws_row == 0 || size.ws_col == 0) {
+		*rows = 24;
+		*cols = 80;
+		return;
+	}
+
+	*rows = size.ws_row;
+	*cols = size.ws_col;
+}
+
+/* Alternate screen, cursor hidden, keys read as they're pressed. ^C is
+ * read as a key too, so quitting always goes through terminal_leave().
+ */
+static void
+terminal_enter (NMConfigTop * top)
+{
+	struct termios raw;
+
+	if (isatty (STDIN_FILENO) && tcgetattr (STDIN_FILENO, &top->saved_termios) == 0) {
+		top->termios_saved = TRUE;
+		raw = top->saved_termios;
+		raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+		raw.c_cc[VMIN] = 1;
+		raw.c_cc[VTIME] = 0;
+		tcsetattr (STDIN_FILENO, TCSANOW, &raw);
+	}
+
+	terminal_send (ESC "[?1049h" ESC "[?25l");
+	top->screen_active = TRUE;
+	top->clear = TRUE;
+}
+
+static void
+terminal_leave (NMConfigTop * top)
+{
+	if (top->screen_active) {
+		terminal_send (ESC "[?25h" ESC "[?1049l");
+		top->screen_active = FALSE;
+	}
+
+	if (top->termios_saved) {
+		tcsetattr (STDIN_FILENO, TCSANOW, &top->saved_termios);
+		top->termios_saved = FALSE;
+	}
+}
+
+/* Drawing */
+
+static void
+render_frame (NMConfigTop * top)
+{
+	const NMConfigSnapshot * snapshot = nm_config_live_snapshot_get (top->live);
+	const char * wireless;
+	guint i, shown = 0;
+
+	for (i = 0; i < snapshot->devices->len; i++) {
+		if (is_shown (top, g_ptr_array_index (snapshot->devices, i)))
+			shown++;
+	}
+
+	if (!snapshot->wireless_hw_enabled)
+		wireless = "Off (hardware)";
+	else
+		wireless = snapshot->wireless_enabled ? "Yes" : "No";
+
+	g_string_truncate (top->frame, 0);
+	nm_config_print_capture (top->frame);
+
+	nm_config_print ("NetworkManager state:%s  Wireless enabled:%s  Devices:%u  (q quits)\n",
+			nm_config_state_to_string (snapshot->state), wireless, shown);
+	nm_config_print ("%s\n", top->status ? top->status : "");
+
+	for (i = 0; i < snapshot->devices->len; i++) {
+		const NMConfigDeviceInfo * device = g_ptr_array_index (snapshot->devices, i);
+
+		if (is_shown (top, device))
+			nm_config_device_show_summary (device, &top->options);
+	}
+
+	nm_config_print_capture (NULL);
+}
+
+/* Splits the frame into the lines that fit on the terminal, each cut
+ * to its width. Control characters, which an SSID may hold, are shown
+ * as '?' so they can't move the cursor.
+ */
+static GPtrArray *
+frame_to_lines (const GString * frame, guint rows, guint cols)
+{
+	GPtrArray * lines = g_ptr_array_sized_new (rows);
+	const gchar * line = frame->str;
+
+	while (*line && lines->len < rows) {
+		const gchar * end = strchr (line, '\n');
+		const gchar * cut = line;
+		gchar * copy, * p;
+		guint width = 0;
+
+		if (!end)
+			end = line + strlen (line);
+
+		while (cut < end && width < cols) {
+			cut = g_utf8_next_char (cut);
+			width++;
+		}
+		if (cut > end)
+			cut = end;
+
+		copy = g_strndup (line, cut - line);
+		for (p = copy; *p; p++) {
+			if ((guchar) *p < 0x20 || *p == 0x7f)
+				*p = '?';
+		}
+		g_ptr_array_add (lines, copy);
+
+		line = *end ? end + 1 : end;
+	}
+
+	return lines;
+}
+
+static void
+free_lines (GPtrArray * lines)
+{
+	g_ptr_array_foreach (lines, (GFunc) g_free, NULL);
+	g_ptr_array_free (lines, TRUE);
+}
+
+/* Bytes the lines start with in common, not splitting a character */
+static gsize
+common_prefix (const gchar * a, const gchar * b)
+{
+	const gchar * p = a, * q = b;
+
+	while (*p && *p == *q) {
+		p++;
+		q++;
+	}
+	while (p > a && ((guchar) *p & 0xc0) == 0x80)
+		p--;
+
+	return p - a;
+}
+
+/* Every line that differs from the one on the terminal is rewritten
+ * from its first differing character; what's left of a longer old line
+ * is erased.
+ */
+static void
+top_draw (NMConfigTop * top)
+{
+	GString * output = top->output;
+	GPtrArray * lines;
+	guint i, count;
+
+	if (!nm_config_live_snapshot_get (top->live) || !top->screen_active)
+		return;
+
+	render_frame (top);
+	lines = frame_to_lines (top->frame, top->rows, top->cols);
+
+	g_string_truncate (output, 0);
+	if (top->clear) {
+		g_string_append (output, ESC "[H" ESC "[2J");
+		g_ptr_array_foreach (top->lines, (GFunc) g_free, NULL);
+		g_ptr_array_set_size (top->lines, 0);
+		top->clear = FALSE;
+	}
+
+	count = MAX (lines->len, top->lines->len);
+	for (i = 0; i < count; i++) {
+		const gchar * old_line = i < top->lines->len ? g_ptr_array_index (top->lines, i) : "";
+		const gchar * new_line = i < lines->len ? g_ptr_array_index (lines, i) : "";
+		gsize prefix;
+
+		if (!strcmp (old_line, new_line))
+			continue;
+
+		prefix = common_prefix (old_line, new_line);
+		g_string_append_printf (output, ESC "[%u;%ldH%s", i + 1,
+				g_utf8_strlen (new_line, prefix) + 1, new_line + prefix);
+		if (g_utf8_strlen (old_line, -1) > g_utf8_strlen (new_line, -1))
+			g_string_append (output, ESC "[K");
+	}
+
+	free_lines (top->lines);
+	top->lines = lines;
+
+	if (output->len > 0) {
+		nm_config_print_write (output->str, output->len);
+		nm_config_print_flush ();
+	}
+}
+
+static gboolean
+redraw_cb (gpointer user_data)
+{
+	NMConfigTop * top = user_data;
+
+	top->redraw_id = 0;
+	top_draw (top);
+
+	return FALSE;
+}
+
+static void
+schedule_redraw (NMConfigTop * top)
+{
+	if (!top->redraw_id)
+		top->redraw_id = g_timeout_add (REDRAW_DELAY, redraw_cb, top);
+}
+
+/* Without SIGWINCH handling in GLib 2.18, the size is polled */
+static gboolean
+resize_cb (gpointer user_data)
+{
+	NMConfigTop * top = user_data;
+	guint rows, cols;
+
+	terminal_read_size (top, &rows, &cols);
+	if (rows != top->rows || cols != top->cols) {
+		top->rows = rows;
+		top->cols = cols;
+		top->clear = TRUE;
+		top_draw (top);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+input_cb (GIOChannel * source, GIOCondition condition, gpointer user_data)
+{
+	NMConfigTop * top = user_data;
+	gchar keys[64];
+	ssize_t len, i;
+
+	len = read (STDIN_FILENO, keys, sizeof (keys));
+	if (len <= 0) {
+		top->input_id = 0;
+		return FALSE;
+	}
+
+	for (i = 0; i < len; i++) {
+		switch (keys[i]) {
+		case 'q':
+		case 'Q':
+		case '\003': /* ^C */
+			top->input_id = 0;
+			top->done (NULL, top->user_data);
+			return FALSE;
+		case '\f': /* ^L */
+			top->clear = TRUE;
+			top_draw (top);
+			break;
+		default:
+			break;
+		}
+	}
+
+	return TRUE;
+}
+
+/* Live snapshot callbacks */
+
+static void
+snapshot_fetched_cb (const NMConfigSnapshot * old, GError * error,
+		gpointer user_data)
+{
+	NMConfigTop * top = user_data;
+
+	if (error) {
+		if (!nm_config_live_snapshot_get (top->live)) {
+			/* Let the error be read on the normal screen */
+			terminal_leave (top);
+			top->done (error, top->user_data);
+			return;
+		}
+
+		/* Keep showing what we have, the next change retries */
+		g_free (top->status);
+		top->status = g_strdup_printf ("Could not read NetworkManager state: %s",
+				error->message);
+	}
+	else {
+		g_free (top->status);
+		top->status = NULL;
+	}
+
+	if (top->redraw_id) {
+		g_source_remove (top->redraw_id);
+		top->redraw_id = 0;
+	}
+	top_draw (top);
+}
+
+static void
+access_point_added_cb (const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap, gpointer user_data)
+{
+	schedule_redraw (user_data);
+}
+
+/* The frame is printed again from the updated snapshot; what the
+ * change touched is found by the comparison with the previous frame.
+ */
+static void
+signal_cb (DBusMessage * message, gpointer user_data)
+{
+	NMConfigTop * top = user_data;
+	const char * path = dbus_message_get_path (message);
+	const char * member = dbus_message_get_member (message);
+	const NMConfigDeviceInfo * device;
+
+	if (!path || !member)
+		return;
+
+	/* Access points of devices not shown aren't read */
+	if (!strcmp (member, "AccessPointAdded")) {
+		device = nm_config_snapshot_lookup_device (nm_config_live_snapshot_get (top->live),
+				path);
+		if (!device || !is_shown (top, device))
+			return;
+	}
+
+	if (nm_config_live_snapshot_apply_signal (top->live, message)
+		== NM_CONFIG_SNAPSHOT_UPDATED)
+		schedule_redraw (top);
+}
+
+NMConfigTop *
+nm_config_top_new (DBusGConnection * bus, const GPtrArray * ifnames,
+		const NMConfigDevicePrintOptions * options,
+		NMConfigTopFunc done, gpointer user_data, GError ** error)
+{
+	NMConfigTop * top;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (ifnames != NULL, NULL);
+	g_return_val_if_fail (options != NULL, NULL);
+	g_return_val_if_fail (done != NULL, NULL);
+
+	if (!isatty (STDOUT_FILENO)) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+				"top needs a terminal as standard output");
+		return NULL;
+	}
+
+	top = g_new0 (NMConfigTop, 1);
+	top->options = *options;
+	if (!top->options.max_aps)
+		top->options.max_aps = DEFAULT_MAX_APS;
+	top->done = done;
+	top->user_data = user_data;
+
+	if (ifnames->len > 0)
+		top->match = nm_config_iface_match_new (ifnames);
+
+	top->lines = g_ptr_array_new ();
+	top->frame = g_string_sized_new (4096);
+	top->output = g_string_sized_new (4096);
+	terminal_read_size (top, &top->rows, &top->cols);
+	terminal_enter (top);
+
+	top->resize_id = g_timeout_add_seconds (RESIZE_CHECK_INTERVAL, resize_cb, top);
+	if (top->termios_saved) {
+		top->input = g_io_channel_unix_new (STDIN_FILENO);
+		top->input_id = g_io_add_watch (top->input, G_IO_IN | G_IO_HUP | G_IO_ERR,
+				input_cb, top);
+	}
+
+	top->live = nm_config_live_snapshot_new (bus, NULL, snapshot_fetched_cb,
+			signal_cb, access_point_added_cb, top);
+
+	return top;
+}
+
+void
+nm_config_top_free (NMConfigTop * top)
+{
+	if (!top)
+		return;
+
+	if (top->redraw_id)
+		g_source_remove (top->redraw_id);
+	if (top->resize_id)
+		g_source_remove (top->resize_id);
+	if (top->input_id)
+		g_source_remove (top->input_id);
+	if (top->input)
+		g_io_channel_unref (top->input);
+
+	terminal_leave (top);
+
+	free_lines (top->lines);
+	g_string_free (top->frame, TRUE);
+	g_string_free (top->output, TRUE);
+	g_free (top->status);
+
+	nm_config_live_snapshot_free (top->live);
+	nm_config_iface_match_free (top->match);
+	g_free (top);
+}
@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_TOP_H
+#define NM_CONFIG_TOP_H
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+
+#include "NMConfigDevicePrintHelper.h"
+
+/*
+ * Top mode: a full screen view of the devices, kept up to date from
+ * NetworkManager's signals. Every frame is printed as the listing would
+ * be, then compared line by line with the frame on the terminal: only
+ * the changed part of each changed line is sent.
+ */
+
+typedef struct _NMConfigTop NMConfigTop;
+
+/* error is NULL if the view was closed with 'q', else it says why the
+ * view couldn't be started or NetworkManager's state couldn't be read.
+ */
+typedef void (*NMConfigTopFunc) (GError * error, gpointer user_data);
+
+/* ifnames lists the interfaces, or glob patterns, to show; every
+ * device is shown if it's empty. Fails if the standard output isn't a
+ * terminal.
+ */
+NMConfigTop * nm_config_top_new (DBusGConnection * bus, const GPtrArray * ifnames,
+		const NMConfigDevicePrintOptions * options,
+		NMConfigTopFunc done, gpointer user_data, GError ** error);
+
+/* Restores the terminal */
+void nm_config_top_free (NMConfigTop * top);
+
+#endif /* NM_CONFIG_TOP_H */
@@ -0,0 +1,174 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#include <glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigWaitOnline.h"
+#include "NMConfigIfaceMatch.h"
+#include "NMConfigSnapshot.h"
+#include "NMConfigLiveSnapshot.h"
+
+struct _NMConfigWaitOnline {
+	gchar * iface;
+	NMConfigIfaceMatch * match; /* only iface's device is read */
+	GTimer * timer;
+
+	NMConfigLiveSnapshot * live;
+
+	guint done_id;
+	GError * error;
+
+	NMConfigWaitOnlineFunc callback;
+	gpointer user_data;
+};
+
+static gboolean
+reached (NMConfigWaitOnline * wait)
+{
+	const NMConfigSnapshot * snapshot = nm_config_live_snapshot_get (wait->live);
+	const NMConfigDeviceInfo * device;
+
+	if (!wait->iface)
+		return snapshot->state == NM_STATE_CONNECTED;
+
+	device = nm_config_snapshot_lookup_iface (snapshot, wait->iface, NULL);
+	return device && device->state == NM_DEVICE_STATE_ACTIVATED;
+}
+
+static gboolean
+done_cb (gpointer user_data)
+{
+	NMConfigWaitOnline * wait = user_data;
+	GError * error = wait->error;
+
+	wait->done_id = 0;
+	wait->error = NULL;
+
+	/* The callback may free the wait */
+	wait->callback (g_timer_elapsed (wait->timer, NULL), error, wait->user_data);
+	if (error)
+		g_error_free (error);
+
+	return FALSE;
+}
+
+/* Not from the signal filter or a reply: the callback may free the wait */
+static void
+finish (NMConfigWaitOnline * wait, GError * error)
+{
+	if (wait->done_id)
+		return;
+
+	g_timer_stop (wait->timer);
+	wait->error = error;
+	wait->done_id = g_idle_add (done_cb, wait);
+}
+
+/* Live snapshot callbacks */
+
+static void
+snapshot_fetched_cb (const NMConfigSnapshot * old, GError * error,
+		gpointer user_data)
+{
+	NMConfigWaitOnline * wait = user_data;
+
+	if (wait->done_id)
+		return;
+
+	if (error)
+		finish (wait, g_error_copy (error));
+	else if (reached (wait))
+		finish (wait, NULL);
+}
+
+static void
+signal_cb (DBusMessage * message, gpointer user_data)
+{
+	NMConfigWaitOnline * wait = user_data;
+
+	if (wait->done_id)
+		return;
+
+	/* Any structural change is read again: a device may come back under
+	 * a new object path, e.g. a USB adapter replugged, while the snapshot
+	 * still holds the old one.
+	 */
+	if (nm_config_live_snapshot_apply_signal (wait->live, message)
+		== NM_CONFIG_SNAPSHOT_UPDATED && reached (wait))
+		finish (wait, NULL);
+}
+
+NMConfigWaitOnline *
+nm_config_wait_online_new (DBusGConnection * bus, const char * iface,
+		NMConfigWaitOnlineFunc callback, gpointer user_data)
+{
+	NMConfigWaitOnline * wait;
+	GPtrArray * names;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (callback != NULL, NULL);
+
+	wait = g_new0 (NMConfigWaitOnline, 1);
+	wait->iface = g_strdup (iface);
+	wait->callback = callback;
+	wait->user_data = user_data;
+	wait->timer = g_timer_new ();
+
+	if (iface) {
+		names = g_ptr_array_new ();
+		g_ptr_array_add (names, (gpointer) iface);
+		wait->match = nm_config_iface_match_new (names);
+		g_ptr_array_free (names, TRUE);
+	}
+
+	wait->live = nm_config_live_snapshot_new (bus, wait->match,
+			snapshot_fetched_cb, signal_cb, NULL, wait);
+
+	return wait;
+}
+
+gdouble
+nm_config_wait_online_elapsed (const NMConfigWaitOnline * wait)
+{
+	g_return_val_if_fail (wait != NULL, 0);
+
+	return g_timer_elapsed (wait->timer, NULL);
+}
+
+void
+nm_config_wait_online_free (NMConfigWaitOnline * wait)
+{
+	if (!wait)
+		return;
+
+	if (wait->done_id)
+		g_source_remove (wait->done_id);
+	if (wait->error)
+		g_error_free (wait->error);
+
+	nm_config_live_snapshot_free (wait->live);
+	nm_config_iface_match_free (wait->match);
+	g_timer_destroy (wait->timer);
+	g_free (wait->iface);
+	g_free (wait);
+}
@@ -0,0 +1,54 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_WAIT_ONLINE_H
+#define NM_CONFIG_WAIT_ONLINE_H
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+
+/*
+ * `nmconfig wait-online`: waits until NetworkManager is connected, or a
+ * device is activated, as announced by NetworkManager's signals. The
+ * state is read once; nothing is polled.
+ */
+
+typedef struct _NMConfigWaitOnline NMConfigWaitOnline;
+
+/* Called once, from the main loop: with error NULL when the state is
+ * reached, waited being the seconds since nm_config_wait_online_new(),
+ * or with an error if NetworkManager's state can't be read. The wait
+ * may be freed from the callback.
+ */
+typedef void (*NMConfigWaitOnlineFunc) (gdouble waited, GError * error,
+		gpointer user_data);
+
+/* iface is the device to wait for, NULL to wait for NetworkManager */
+NMConfigWaitOnline * nm_config_wait_online_new (DBusGConnection * bus,
+		const char * iface, NMConfigWaitOnlineFunc callback, gpointer user_data);
+
+/* Seconds waited so far */
+gdouble nm_config_wait_online_elapsed (const NMConfigWaitOnline * wait);
+
+void nm_config_wait_online_free (NMConfigWaitOnline * wait);
+
+#endif /* NM_CONFIG_WAIT_ONLINE_H */
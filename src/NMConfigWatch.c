@@ -0,0 +1,453 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <glib.h>
+#include <NetworkManager.h>
+#include <nm-utils.h>
+
+#include "NMConfigWatch.h"
+#include "NMConfigIfaceMatch.h"
+#include "NMConfigSnapshot.h"
+#include "NMConfigLiveSnapshot.h"
+#include "NMConfigDevicePrintHelper.h"
+#include "NMConfigPrint.h"
+
+struct _NMConfigWatch {
+	NMConfigIfaceMatch * match; /* NULL to watch every device */
+	NMConfigLiveSnapshot * live;
+
+	NMConfigWatchFailedFunc failed;
+	gpointer user_data;
+};
+
+/* The values a change line is printed for */
+typedef struct {
+	NMState state;
+	gboolean wireless_enabled;
+	gboolean wireless_hw_enabled;
+} ManagerState;
+
+typedef struct {
+	NMDeviceState state;
+	gboolean carrier;
+	guint32 speed;
+	guint32 bitrate;
+	gchar * active_ap_path;
+	gchar * ip4;
+} DeviceState;
+
+
+static void
+print_change (const char * subject, const char * format, ...) G_GNUC_PRINTF (2, 3);
+
+static void
+print_change (const char * subject, const char * format, ...)
+{
+	GTimeVal now;
+	time_t seconds;
+	struct tm tm;
+	char stamp[32];
+	gchar * text;
+	va_list args;
+
+	g_get_current_time (&now);
+	seconds = now.tv_sec;
+	localtime_r (&seconds, &tm);
+	strftime (stamp, sizeof (stamp), "%Y-%m-%d %H:%M:%S", &tm);
+
+	va_start (args, format);
+	text = g_strdup_vprintf (format, args);
+	va_end (args);
+
+	nm_config_print ("%s.%03ld %s: %s\n", stamp, now.tv_usec / 1000, subject, text);
+	nm_config_print_flush ();
+	g_free (text);
+}
+
+static gchar *
+describe_access_point (const NMConfigAPInfo * ap)
+{
+	gchar * ssid, * description;
+
+	ssid = nm_utils_ssid_to_utf8 ((const char *) ap->ssid->data, ap->ssid->len);
+	description = g_strdup_printf ("'%s' (%s)", ssid, ap->bssid);
+	g_free (ssid);
+
+	return description;
+}
+
+static gboolean
+is_watched (NMConfigWatch * watch, const NMConfigDeviceInfo * device)
+{
+	return !watch->match || nm_config_iface_match_test (watch->match, device->iface);
+}
+
+/* Capture and compare */
+
+static void
+manager_state_capture (const NMConfigSnapshot * snapshot, ManagerState * state)
+{
+	state->state = snapshot->state;
+	state->wireless_enabled = snapshot->wireless_enabled;
+	state->wireless_hw_enabled = snapshot->wireless_hw_enabled;
+}
+
+static void
+manager_state_report (const ManagerState * old, const ManagerState * new)
+{
+	if (old->state != new->state)
+		print_change ("NetworkManager", "state %s",
+				nm_config_state_to_string (new->state));
+	if (old->wireless_enabled != new->wireless_enabled)
+		print_change ("NetworkManager", "wireless %s",
+				new->wireless_enabled ? "enabled" : "disabled");
+	if (old->wireless_hw_enabled != new->wireless_hw_enabled)
+		print_change ("NetworkManager", "wireless hardware %s",
+				new->wireless_hw_enabled ? "enabled" : "disabled");
+}
+
+static void
+device_state_capture (const NMConfigDeviceInfo * device, DeviceState * state)
+{
+	state->state = device->state;
+	state->carrier = device->carrier;
+	state->speed = device->speed;
+	state->bitrate = device->bitrate;
+	state->active_ap_path = g_strdup (device->active_ap_path);
+	state->ip4 = NULL;
+
+	if (device->ip4 && device->ip4->addresses->len > 0) {
+		const NMConfigIP4Address * address;
+		char buf[INET_ADDRSTRLEN];
+		struct in_addr addr;
+
+		address = &g_array_index (device->ip4->addresses, NMConfigIP4Address, 0);
+		addr.s_addr = address->address;
+		if (inet_ntop (AF_INET, &addr, buf, sizeof (buf)))
+			state->ip4 = g_strdup_printf ("%s/%u", buf, address->prefix);
+	}
+}
+
+static void
+device_state_clear (DeviceState * state)
+{
+	g_free (state->active_ap_path);
+	g_free (state->ip4);
+}
+
+static void
+device_state_report (const NMConfigSnapshot * snapshot,
+		const NMConfigDeviceInfo * device,
+		const DeviceState * old, const DeviceState * new)
+{
+	const char * iface = device->iface;
+
+	if (old->state != new->state)
+		print_change (iface, "state %s",
+				nm_config_device_state_to_string (new->state));
+
+	if (old->carrier != new->carrier)
+		print_change (iface, "carrier %s", new->carrier ? "on" : "off");
+
+	if (old->speed != new->speed)
+		print_change (iface, "speed %uMb/s", new->speed);
+
+	if (old->bitrate != new->bitrate)
+		print_change (iface, "bitrate %.1fMb/s", new->bitrate / 1000.0);
+
+	if (g_strcmp0 (old->active_ap_path, new->active_ap_path)) {
+		const NMConfigAPInfo * ap;
+
+		ap = nm_config_snapshot_lookup_access_point (snapshot,
+				new->active_ap_path, NULL);
+		if (ap) {
+			gchar * description = describe_access_point (ap);
+
+			print_change (iface, "access point %s", description);
+			g_free (description);
+		}
+		else
+			print_change (iface, "no access point");
+	}
+
+	if (g_strcmp0 (old->ip4, new->ip4))
+		print_change (iface, "ip4 %s", new->ip4 ? new->ip4 : "none");
+}
+
+static void
+access_point_report (const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap, guint8 old_strength)
+{
+	gchar * description;
+
+	if (old_strength == ap->strength)
+		return;
+
+	description = describe_access_point (ap);
+	print_change (device->iface, "access point %s strength %d",
+			description, ap->strength);
+	g_free (description);
+}
+
+static void
+access_point_added (const NMConfigDeviceInfo * device, const NMConfigAPInfo * ap)
+{
+	gchar * description = describe_access_point (ap);
+
+	print_change (device->iface, "access point added %s strength %d",
+			description, ap->strength);
+	g_free (description);
+}
+
+static void
+access_point_removed (const NMConfigDeviceInfo * device, const NMConfigAPInfo * ap)
+{
+	gchar * description = describe_access_point (ap);
+
+	print_change (device->iface, "access point removed %s", description);
+	g_free (description);
+}
+
+/* Compare two whole snapshots. Only used after a refetch, that is when
+ * devices come and go or change their configuration.
+ */
+static void
+snapshot_report (NMConfigWatch * watch, const NMConfigSnapshot * old,
+		const NMConfigSnapshot * new)
+{
+	ManagerState old_manager, new_manager;
+	int i, j;
+
+	if (!watch->match) {
+		manager_state_capture (old, &old_manager);
+		manager_state_capture (new, &new_manager);
+		manager_state_report (&old_manager, &new_manager);
+	}
+
+	for (i = 0; i < old->devices->len; i++) {
+		const NMConfigDeviceInfo * device = g_ptr_array_index (old->devices, i);
+
+		if (is_watched (watch, device)
+			&& !nm_config_snapshot_lookup_device (new, device->path))
+			print_change (device->iface, "device removed");
+	}
+
+	for (i = 0; i < new->devices->len; i++) {
+		const NMConfigDeviceInfo * device = g_ptr_array_index (new->devices, i);
+		const NMConfigDeviceInfo * old_device;
+		DeviceState old_state, new_state;
+
+		if (!is_watched (watch, device))
+			continue;
+
+		old_device = nm_config_snapshot_lookup_device (old, device->path);
+		if (!old_device) {
+			print_change (device->iface, "device added, state %s",
+					nm_config_device_state_to_string (device->state));
+			continue;
+		}
+
+		device_state_capture (old_device, &old_state);
+		device_state_capture (device, &new_state);
+		device_state_report (new, device, &old_state, &new_state);
+		device_state_clear (&old_state);
+		device_state_clear (&new_state);
+
+		for (j = 0; old_device->aps && j < old_device->aps->len; j++) {
+			const NMConfigAPInfo * ap = g_ptr_array_index (old_device->aps, j);
+
+			if (!nm_config_snapshot_lookup_access_point (new, ap->path, NULL))
+				access_point_removed (device, ap);
+		}
+
+		for (j = 0; device->aps && j < device->aps->len; j++) {
+			const NMConfigAPInfo * ap = g_ptr_array_index (device->aps, j);
+			const NMConfigAPInfo * old_ap;
+
+			old_ap = nm_config_snapshot_lookup_access_point (old, ap->path, NULL);
+			if (old_ap)
+				access_point_report (device, ap, old_ap->strength);
+			else
+				access_point_added (device, ap);
+		}
+	}
+}
+
+static void
+snapshot_report_initial (NMConfigWatch * watch, const NMConfigSnapshot * snapshot)
+{
+	int i;
+
+	if (!watch->match)
+		print_change ("NetworkManager", "state %s",
+				nm_config_state_to_string (snapshot->state));
+
+	for (i = 0; i < snapshot->devices->len; i++) {
+		const NMConfigDeviceInfo * device = g_ptr_array_index (snapshot->devices, i);
+
+		if (is_watched (watch, device))
+			print_change (device->iface, "state %s",
+					nm_config_device_state_to_string (device->state));
+	}
+}
+
+/* Live snapshot callbacks */
+
+static void
+snapshot_fetched_cb (const NMConfigSnapshot * old, GError * error,
+		gpointer user_data)
+{
+	NMConfigWatch * watch = user_data;
+	const NMConfigSnapshot * snapshot = nm_config_live_snapshot_get (watch->live);
+
+	if (error) {
+		if (!snapshot) {
+			watch->failed (error, watch->user_data);
+			return;
+		}
+
+		/* Keep going with what we have, the next change retries */
+		g_printerr ("Could not read NetworkManager state: %s\n", error->message);
+	}
+	else if (old)
+		snapshot_report (watch, old, snapshot);
+	else
+		snapshot_report_initial (watch, snapshot);
+}
+
+static void
+access_point_added_cb (const NMConfigDeviceInfo * device,
+		const NMConfigAPInfo * ap, gpointer user_data)
+{
+	access_point_added (device, ap);
+}
+
+/* Every change touches one object, looked up by its path; what is
+ * printed comes from comparing the object before and after the change.
+ */
+static void
+signal_cb (DBusMessage * message, gpointer user_data)
+{
+	NMConfigWatch * watch = user_data;
+	NMConfigSnapshot * snapshot = nm_config_live_snapshot_get (watch->live);
+	const char * path = dbus_message_get_path (message);
+	const char * member = dbus_message_get_member (message);
+	const NMConfigDeviceInfo * device = NULL;
+	const NMConfigAPInfo * ap = NULL;
+	ManagerState old_manager, new_manager;
+	DeviceState old_state, new_state;
+	guint8 old_strength = 0;
+	gchar * removed = NULL;
+	NMConfigSnapshotUpdate update;
+
+	if (!path || !member)
+		return;
+
+	if (!strcmp (path, NM_DBUS_PATH))
+		manager_state_capture (snapshot, &old_manager);
+	else if ((device = nm_config_snapshot_lookup_device (snapshot, path))) {
+		if (!is_watched (watch, device))
+			return;
+
+		if (!strcmp (member, "AccessPointAdded")) {
+			nm_config_live_snapshot_apply_signal (watch->live, message);
+			return;
+		}
+
+		if (!strcmp (member, "AccessPointRemoved")) {
+			const NMConfigAPInfo * removed_ap;
+
+			removed_ap = nm_config_snapshot_lookup_access_point (snapshot,
+					nm_config_signal_read_path (message), NULL);
+			if (removed_ap)
+				removed = describe_access_point (removed_ap);
+		}
+
+		device_state_capture (device, &old_state);
+	}
+	else if ((ap = nm_config_snapshot_lookup_access_point (snapshot, path, &device))) {
+		if (!is_watched (watch, device))
+			return;
+
+		old_strength = ap->strength;
+	}
+
+	update = nm_config_live_snapshot_apply_signal (watch->live, message);
+
+	if (ap) {
+		if (update == NM_CONFIG_SNAPSHOT_UPDATED)
+			access_point_report (device, ap, old_strength);
+	}
+	else if (device) {
+		if (update == NM_CONFIG_SNAPSHOT_UPDATED) {
+			if (removed)
+				print_change (device->iface, "access point removed %s", removed);
+
+			device_state_capture (device, &new_state);
+			device_state_report (snapshot, device, &old_state, &new_state);
+			device_state_clear (&new_state);
+		}
+		device_state_clear (&old_state);
+	}
+	else if (update == NM_CONFIG_SNAPSHOT_UPDATED && !watch->match) {
+		manager_state_capture (snapshot, &new_manager);
+		manager_state_report (&old_manager, &new_manager);
+	}
+
+	g_free (removed);
+}
+
+NMConfigWatch *
+nm_config_watch_new (DBusGConnection * bus, const GPtrArray * ifnames,
+		NMConfigWatchFailedFunc failed, gpointer user_data)
+{
+	NMConfigWatch * watch;
+
+	g_return_val_if_fail (bus != NULL, NULL);
+	g_return_val_if_fail (ifnames != NULL, NULL);
+	g_return_val_if_fail (failed != NULL, NULL);
+
+	watch = g_new0 (NMConfigWatch, 1);
+	watch->failed = failed;
+	watch->user_data = user_data;
+
+	if (ifnames->len > 0)
+		watch->match = nm_config_iface_match_new (ifnames);
+
+	watch->live = nm_config_live_snapshot_new (bus, NULL, snapshot_fetched_cb,
+			signal_cb, access_point_added_cb, watch);
+
+	return watch;
+}
+
+void
+nm_config_watch_free (NMConfigWatch * watch)
+{
+	if (!watch)
+		return;
+
+	nm_config_live_snapshot_free (watch->live);
+	nm_config_iface_match_free (watch->match);
+	g_free (watch);
+}
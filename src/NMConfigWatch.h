@@ -0,0 +1,48 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+
+#ifndef NM_CONFIG_WATCH_H
+#define NM_CONFIG_WATCH_H
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+
+/*
+ * Watch mode: prints one timestamped line for each change of
+ * NetworkManager, its devices and their access points, as announced by
+ * NetworkManager's signals.
+ */
+
+typedef struct _NMConfigWatch NMConfigWatch;
+
+/* Called if NetworkManager's state can't be read when the watch starts */
+typedef void (*NMConfigWatchFailedFunc) (GError * error, gpointer user_data);
+
+/* ifnames lists the interfaces, or glob patterns, to watch; every
+ * device is watched if it's empty.
+ */
+NMConfigWatch * nm_config_watch_new (DBusGConnection * bus, const GPtrArray * ifnames,
+		NMConfigWatchFailedFunc failed, gpointer user_data);
+
+void nm_config_watch_free (NMConfigWatch * watch);
+
+#endif /* NM_CONFIG_WATCH_H */
@@ -0,0 +1,772 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+/*
+ * Stand-in for the NetworkManager 0.8 D-Bus service, used by
+ * nmconfig-bench. It owns org.freedesktop.NetworkManager and
+ * org.freedesktop.NetworkManagerSystemSettings on the system bus (point
+ * DBUS_SYSTEM_BUS_ADDRESS at a private dbus-daemon) and exports
+ *
+ *   - the manager, with --devices devices, alternately wired (ethN) and
+ *     wireless (wlanN), all activated with an IPv4 configuration,
+ *   - --aps access points on every wireless device,
+ *   - --connections system connections, a mix of ethernet, wifi and vpn,
+ *     the first --devices of them active on a device each.
+ *
+ * Only what nmconfig and libnm-glib read is implemented: the objects'
+ * properties through org.freedesktop.DBus.Properties, GetDevices,
+ * GetAccessPoints, ListConnections and GetSettings. "ready" is printed on
+ * stdout once both names are owned.
+ *
+ * The org.nmconfig.MockNM.TakeStats method at /org/nmconfig/MockNM
+ * returns the number of messages received and sent since the previous
+ * call, not counting itself, and resets the counters.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+#include <NetworkManager.h>
+
+#define MOCK_PATH "/org/nmconfig/MockNM"
+#define MOCK_INTERFACE "org.nmconfig.MockNM"
+
+#define NO_OBJECT "/"
+
+typedef enum {
+	PROP_UINT,
+	PROP_BOOLEAN,
+	PROP_BYTE,
+	PROP_STRING,
+	PROP_PATH,
+	PROP_BYTES,      /* GByteArray */
+	PROP_PATHS,      /* GPtrArray of gchar * */
+	PROP_STRINGS,    /* GPtrArray of gchar * */
+	PROP_UINTS,      /* GArray of guint32 */
+	PROP_UINT_ARRAYS /* GPtrArray of GArray of guint32 */
+} PropType;
+
+typedef struct {
+	const char * iface;
+	const char * name;
+	PropType type;
+	guint32 uint_value;
+	gchar * string_value;
+	gpointer array_value;
+} Property;
+
+typedef struct {
+	gchar * path;
+	GPtrArray * props; /* Property */
+
+	/* objects listed by list_method of list_iface, if any */
+	const char * list_iface;
+	const char * list_method;
+	GPtrArray * children;
+
+	/* connections */
+	gchar * id;
+	gchar * uuid;
+	const char * type;
+} Object;
+
+static gint opt_devices = 4;
+static gint opt_aps = 20;
+static gint opt_connections = 10;
+
+static GOptionEntry option_entries[] = {
+	{ "devices", 0, 0, G_OPTION_ARG_INT, &opt_devices,
+	  "Number of devices (default 4)", "N" },
+	{ "aps", 0, 0, G_OPTION_ARG_INT, &opt_aps,
+	  "Number of access points of each wireless device (default 20)", "M" },
+	{ "connections", 0, 0, G_OPTION_ARG_INT, &opt_connections,
+	  "Number of system connections (default 10)", "K" },
+	{ NULL }
+};
+
+static GHashTable * objects;  /* path -> Object */
+static guint32 messages_received;
+static guint32 messages_sent;
+
+static Object *
+object_new (const char * path)
+{
+	Object * object = g_new0 (Object, 1);
+
+	object->path = g_strdup (path);
+	object->props = g_ptr_array_new ();
+	g_hash_table_insert (objects, object->path, object);
+
+	return object;
+}
+
+static void
+object_set_list (Object * object, const char * iface, const char * method)
+{
+	object->list_iface = iface;
+	object->list_method = method;
+	object->children = g_ptr_array_new ();
+}
+
+static Property *
+object_add (Object * object, const char * iface, const char * name, PropType type)
+{
+	Property * prop = g_new0 (Property, 1);
+
+	prop->iface = iface;
+	prop->name = name;
+	prop->type = type;
+	g_ptr_array_add (object->props, prop);
+
+	return prop;
+}
+
+static void
+object_add_uint (Object * object, const char * iface, const char * name,
+		PropType type, guint32 value)
+{
+	object_add (object, iface, name, type)->uint_value = value;
+}
+
+static void
+object_add_string (Object * object, const char * iface, const char * name,
+		PropType type, const char * value)
+{
+	object_add (object, iface, name, type)->string_value = g_strdup (value);
+}
+
+static void
+object_add_array (Object * object, const char * iface, const char * name,
+		PropType type, gpointer value)
+{
+	object_add (object, iface, name, type)->array_value = value;
+}
+
+/* Building the mock objects */
+
+static void
+add_ip4_config (guint index)
+{
+	gchar * path = g_strdup_printf (NM_DBUS_PATH "/IP4Config/%u", index);
+	Object * config = object_new (path);
+	GPtrArray * addresses = g_ptr_array_new ();
+	GArray * address = g_array_new (FALSE, FALSE, sizeof (guint32));
+	GArray * nameservers = g_array_new (FALSE, FALSE, sizeof (guint32));
+	GPtrArray * domains = g_ptr_array_new ();
+	guint32 value;
+
+	/* 10.<index>.0.2/24 via 10.<index>.0.1, in network byte order */
+	value = htonl (0x0a000002 | ((index & 0xff) << 16));
+	g_array_append_val (address, value);
+	value = 24;
+	g_array_append_val (address, value);
+	value = htonl (0x0a000001 | ((index & 0xff) << 16));
+	g_array_append_val (address, value);
+	g_ptr_array_add (addresses, address);
+
+	g_array_append_val (nameservers, value);
+	g_ptr_array_add (domains, g_strdup ("example.com"));
+
+	object_add_array (config, NM_DBUS_INTERFACE_IP4_CONFIG, "Addresses",
+			PROP_UINT_ARRAYS, addresses);
+	object_add_array (config, NM_DBUS_INTERFACE_IP4_CONFIG, "Nameservers",
+			PROP_UINTS, nameservers);
+	object_add_array (config, NM_DBUS_INTERFACE_IP4_CONFIG, "WinsServers",
+			PROP_UINTS, g_array_new (FALSE, FALSE, sizeof (guint32)));
+	object_add_array (config, NM_DBUS_INTERFACE_IP4_CONFIG, "Domains",
+			PROP_STRINGS, domains);
+	object_add_array (config, NM_DBUS_INTERFACE_IP4_CONFIG, "Routes",
+			PROP_UINT_ARRAYS, g_ptr_array_new ());
+
+	g_free (path);
+}
+
+static gchar *
+add_access_point (guint index)
+{
+	gchar * path = g_strdup_printf (NM_DBUS_PATH "/AccessPoint/%u", index);
+	Object * ap = object_new (path);
+	gchar * ssid = g_strdup_printf ("network-%u", index % 37);
+	gchar * bssid = g_strdup_printf ("00:16:%02X:%02X:%02X:%02X",
+			(index >> 24) & 0xff, (index >> 16) & 0xff,
+			(index >> 8) & 0xff, index & 0xff);
+	GByteArray * ssid_bytes = g_byte_array_new ();
+	guint32 flags = 0, wpa_flags = 0, rsn_flags = 0;
+
+	g_byte_array_append (ssid_bytes, (const guint8 *) ssid, strlen (ssid));
+
+	/* a mix of open, WEP, WPA and WPA2 networks */
+	switch (index % 4) {
+	case 1:
+		flags = NM_802_11_AP_FLAGS_PRIVACY;
+		break;
+	case 2:
+		flags = NM_802_11_AP_FLAGS_PRIVACY;
+		wpa_flags = NM_802_11_AP_SEC_PAIR_TKIP | NM_802_11_AP_SEC_GROUP_TKIP
+			| NM_802_11_AP_SEC_KEY_MGMT_PSK;
+		break;
+	case 3:
+		flags = NM_802_11_AP_FLAGS_PRIVACY;
+		rsn_flags = NM_802_11_AP_SEC_PAIR_CCMP | NM_802_11_AP_SEC_GROUP_CCMP
+			| NM_802_11_AP_SEC_KEY_MGMT_PSK;
+		break;
+	default:
+		break;
+	}
+
+	object_add_uint (ap, NM_DBUS_INTERFACE_ACCESS_POINT, "Flags", PROP_UINT, flags);
+	object_add_uint (ap, NM_DBUS_INTERFACE_ACCESS_POINT, "WpaFlags", PROP_UINT, wpa_flags);
+	object_add_uint (ap, NM_DBUS_INTERFACE_ACCESS_POINT, "RsnFlags", PROP_UINT, rsn_flags);
+	object_add_array (ap, NM_DBUS_INTERFACE_ACCESS_POINT, "Ssid", PROP_BYTES, ssid_bytes);
+	object_add_uint (ap, NM_DBUS_INTERFACE_ACCESS_POINT, "Frequency", PROP_UINT,
+			2412 + 5 * (index % 13));
+	object_add_string (ap, NM_DBUS_INTERFACE_ACCESS_POINT, "HwAddress", PROP_STRING, bssid);
+	object_add_uint (ap, NM_DBUS_INTERFACE_ACCESS_POINT, "Mode", PROP_UINT,
+			NM_802_11_MODE_INFRA);
+	object_add_uint (ap, NM_DBUS_INTERFACE_ACCESS_POINT, "MaxBitrate", PROP_UINT, 54000);
+	object_add_uint (ap, NM_DBUS_INTERFACE_ACCESS_POINT, "Strength", PROP_BYTE,
+			(index * 7) % 100);
+
+	g_free (ssid);
+	g_free (bssid);
+	return path;
+}
+
+static gchar *
+add_device (guint index, guint n_aps, guint * next_ap)
+{
+	gchar * path = g_strdup_printf (NM_DBUS_PATH "/Devices/%u", index);
+	gchar * ip4_path = g_strdup_printf (NM_DBUS_PATH "/IP4Config/%u", index);
+	gboolean wireless = index % 2;
+	gchar * iface = g_strdup_printf ("%s%u", wireless ? "wlan" : "eth", index / 2);
+	gchar * udi = g_strdup_printf ("/sys/devices/virtual/net/%s", iface);
+	gchar * hw_address = g_strdup_printf ("00:11:22:33:%02X:%02X",
+			(index >> 8) & 0xff, index & 0xff);
+	Object * device = object_new (path);
+	guint i;
+
+	object_add_string (device, NM_DBUS_INTERFACE_DEVICE, "Udi", PROP_STRING, udi);
+	object_add_string (device, NM_DBUS_INTERFACE_DEVICE, "Interface", PROP_STRING, iface);
+	object_add_string (device, NM_DBUS_INTERFACE_DEVICE, "Driver", PROP_STRING,
+			wireless ? "iwlagn" : "e1000e");
+	object_add_uint (device, NM_DBUS_INTERFACE_DEVICE, "Capabilities", PROP_UINT, 3);
+	object_add_uint (device, NM_DBUS_INTERFACE_DEVICE, "Ip4Address", PROP_UINT, 0);
+	object_add_uint (device, NM_DBUS_INTERFACE_DEVICE, "State", PROP_UINT,
+			NM_DEVICE_STATE_ACTIVATED);
+	object_add_string (device, NM_DBUS_INTERFACE_DEVICE, "Ip4Config", PROP_PATH, ip4_path);
+	object_add_string (device, NM_DBUS_INTERFACE_DEVICE, "Dhcp4Config", PROP_PATH, NO_OBJECT);
+	object_add_string (device, NM_DBUS_INTERFACE_DEVICE, "Ip6Config", PROP_PATH, NO_OBJECT);
+	object_add_uint (device, NM_DBUS_INTERFACE_DEVICE, "Managed", PROP_BOOLEAN, TRUE);
+	object_add_uint (device, NM_DBUS_INTERFACE_DEVICE, "DeviceType", PROP_UINT,
+			wireless ? NM_DEVICE_TYPE_WIFI : NM_DEVICE_TYPE_ETHERNET);
+	add_ip4_config (index);
+
+	if (!wireless) {
+		object_add_string (device, NM_DBUS_INTERFACE_DEVICE_WIRED, "HwAddress",
+				PROP_STRING, hw_address);
+		object_add_uint (device, NM_DBUS_INTERFACE_DEVICE_WIRED, "Speed", PROP_UINT, 1000);
+		object_add_uint (device, NM_DBUS_INTERFACE_DEVICE_WIRED, "Carrier",
+				PROP_BOOLEAN, TRUE);
+	} else {
+		object_set_list (device, NM_DBUS_INTERFACE_DEVICE_WIRELESS, "GetAccessPoints");
+		for (i = 0; i < n_aps; i++)
+			g_ptr_array_add (device->children, add_access_point ((*next_ap)++));
+
+		object_add_string (device, NM_DBUS_INTERFACE_DEVICE_WIRELESS, "HwAddress",
+				PROP_STRING, hw_address);
+		object_add_uint (device, NM_DBUS_INTERFACE_DEVICE_WIRELESS, "Mode", PROP_UINT,
+				NM_802_11_MODE_INFRA);
+		object_add_uint (device, NM_DBUS_INTERFACE_DEVICE_WIRELESS, "Bitrate",
+				PROP_UINT, 54000);
+		object_add_string (device, NM_DBUS_INTERFACE_DEVICE_WIRELESS, "ActiveAccessPoint",
+				PROP_PATH, n_aps ? g_ptr_array_index (device->children, 0) : NO_OBJECT);
+		object_add_uint (device, NM_DBUS_INTERFACE_DEVICE_WIRELESS, "WirelessCapabilities",
+				PROP_UINT, NM_WIFI_DEVICE_CAP_CIPHER_WEP40
+				| NM_WIFI_DEVICE_CAP_CIPHER_WEP104 | NM_WIFI_DEVICE_CAP_CIPHER_TKIP
+				| NM_WIFI_DEVICE_CAP_CIPHER_CCMP | NM_WIFI_DEVICE_CAP_WPA
+				| NM_WIFI_DEVICE_CAP_RSN);
+	}
+
+	g_free (ip4_path);
+	g_free (iface);
+	g_free (udi);
+	g_free (hw_address);
+	return path;
+}
+
+static gchar *
+add_connection (guint index)
+{
+	static const char * types[] = { "802-3-ethernet", "802-11-wireless", "vpn" };
+	gchar * path = g_strdup_printf (NM_DBUS_PATH_SETTINGS "/%u", index);
+	Object * connection = object_new (path);
+
+	connection->type = types[index % G_N_ELEMENTS (types)];
+	connection->id = g_strdup_printf ("%s %u",
+			index % 3 == 2 ? "corp-vpn" : "connection", index);
+	connection->uuid = g_strdup_printf ("%08x-0000-4000-8000-%012x", index, index);
+
+	return path;
+}
+
+static gchar *
+add_active_connection (guint index, const char * device_path)
+{
+	gchar * path = g_strdup_printf (NM_DBUS_PATH "/ActiveConnection/%u", index);
+	gchar * connection_path = g_strdup_printf (NM_DBUS_PATH_SETTINGS "/%u", index);
+	Object * active = object_new (path);
+	GPtrArray * devices = g_ptr_array_new ();
+
+	g_ptr_array_add (devices, g_strdup (device_path));
+
+	object_add_string (active, NM_DBUS_INTERFACE_ACTIVE_CONNECTION, "ServiceName",
+			PROP_STRING, NM_DBUS_SERVICE_SYSTEM_SETTINGS);
+	object_add_string (active, NM_DBUS_INTERFACE_ACTIVE_CONNECTION, "Connection",
+			PROP_PATH, connection_path);
+	object_add_string (active, NM_DBUS_INTERFACE_ACTIVE_CONNECTION, "SpecificObject",
+			PROP_PATH, NO_OBJECT);
+	object_add_array (active, NM_DBUS_INTERFACE_ACTIVE_CONNECTION, "Devices",
+			PROP_PATHS, devices);
+	object_add_uint (active, NM_DBUS_INTERFACE_ACTIVE_CONNECTION, "State", PROP_UINT,
+			NM_ACTIVE_CONNECTION_STATE_ACTIVATED);
+	object_add_uint (active, NM_DBUS_INTERFACE_ACTIVE_CONNECTION, "Default",
+			PROP_BOOLEAN, index == 0);
+	object_add_uint (active, NM_DBUS_INTERFACE_ACTIVE_CONNECTION, "Vpn",
+			PROP_BOOLEAN, FALSE);
+
+	g_free (connection_path);
+	return path;
+}
+
+static void
+build_objects (guint n_devices, guint n_aps, guint n_connections)
+{
+	Object * manager, * settings;
+	GPtrArray * active_connections = g_ptr_array_new ();
+	guint i, next_ap = 0;
+
+	objects = g_hash_table_new (g_str_hash, g_str_equal);
+
+	manager = object_new (NM_DBUS_PATH);
+	object_set_list (manager, NM_DBUS_INTERFACE, "GetDevices");
+	for (i = 0; i < n_devices; i++)
+		g_ptr_array_add (manager->children, add_device (i, n_aps, &next_ap));
+	for (i = 0; i < n_devices && i < n_connections; i++)
+		g_ptr_array_add (active_connections,
+				add_active_connection (i, g_ptr_array_index (manager->children, i)));
+
+	object_add_uint (manager, NM_DBUS_INTERFACE, "State", PROP_UINT, NM_STATE_CONNECTED);
+	object_add_uint (manager, NM_DBUS_INTERFACE, "NetworkingEnabled", PROP_BOOLEAN, TRUE);
+	object_add_uint (manager, NM_DBUS_INTERFACE, "WirelessEnabled", PROP_BOOLEAN, TRUE);
+	object_add_uint (manager, NM_DBUS_INTERFACE, "WirelessHardwareEnabled",
+			PROP_BOOLEAN, TRUE);
+	object_add_uint (manager, NM_DBUS_INTERFACE, "WwanEnabled", PROP_BOOLEAN, FALSE);
+	object_add_uint (manager, NM_DBUS_INTERFACE, "WwanHardwareEnabled", PROP_BOOLEAN, FALSE);
+	object_add_array (manager, NM_DBUS_INTERFACE, "ActiveConnections",
+			PROP_PATHS, active_connections);
+
+	settings = object_new (NM_DBUS_PATH_SETTINGS);
+	object_set_list (settings, NM_DBUS_IFACE_SETTINGS, "ListConnections");
+	for (i = 0; i < n_connections; i++)
+		g_ptr_array_add (settings->children, add_connection (i));
+
+	object_add_string (settings, NM_DBUS_IFACE_SETTINGS_SYSTEM, "Hostname",
+			PROP_STRING, "mock");
+	object_add_uint (settings, NM_DBUS_IFACE_SETTINGS_SYSTEM, "CanModify",
+			PROP_BOOLEAN, FALSE);
+	object_add_array (settings, NM_DBUS_IFACE_SETTINGS_SYSTEM, "UnmanagedDevices",
+			PROP_PATHS, g_ptr_array_new ());
+}
+
+/* Marshalling */
+
+static const char *
+prop_signature (PropType type)
+{
+	switch (type) {
+	case PROP_UINT: return DBUS_TYPE_UINT32_AS_STRING;
+	case PROP_BOOLEAN: return DBUS_TYPE_BOOLEAN_AS_STRING;
+	case PROP_BYTE: return DBUS_TYPE_BYTE_AS_STRING;
+	case PROP_STRING: return DBUS_TYPE_STRING_AS_STRING;
+	case PROP_PATH: return DBUS_TYPE_OBJECT_PATH_AS_STRING;
+	case PROP_BYTES: return "ay";
+	case PROP_PATHS: return "ao";
+	case PROP_STRINGS: return "as";
+	case PROP_UINTS: return "au";
+	case PROP_UINT_ARRAYS: return "aau";
+	}
+	g_assert_not_reached ();
+	return NULL;
+}
+
+static void
+append_uints (DBusMessageIter * iter, GArray * values)
+{
+	DBusMessageIter array;
+	const guint32 * data = (const guint32 *) values->data;
+
+	dbus_message_iter_open_container (iter, DBUS_TYPE_ARRAY,
+			DBUS_TYPE_UINT32_AS_STRING, &array);
+	dbus_message_iter_append_fixed_array (&array, DBUS_TYPE_UINT32, &data, values->len);
+	dbus_message_iter_close_container (iter, &array);
+}
+
+static void
+append_strings (DBusMessageIter * iter, int type, GPtrArray * values)
+{
+	DBusMessageIter array;
+	char signature[2] = { type, '\0' };
+	int i;
+
+	dbus_message_iter_open_container (iter, DBUS_TYPE_ARRAY, signature, &array);
+	for (i = 0; i < values->len; i++) {
+		const char * value = g_ptr_array_index (values, i);
+
+		dbus_message_iter_append_basic (&array, type, &value);
+	}
+	dbus_message_iter_close_container (iter, &array);
+}
+
+static void
+append_property (DBusMessageIter * iter, const Property * prop)
+{
+	DBusMessageIter variant, array;
+	dbus_bool_t boolean;
+	guint8 byte;
+	const guint8 * bytes;
+	int i;
+
+	dbus_message_iter_open_container (iter, DBUS_TYPE_VARIANT,
+			prop_signature (prop->type), &variant);
+
+	switch (prop->type) {
+	case PROP_UINT:
+		dbus_message_iter_append_basic (&variant, DBUS_TYPE_UINT32, &prop->uint_value);
+		break;
+	case PROP_BOOLEAN:
+		boolean = prop->uint_value;
+		dbus_message_iter_append_basic (&variant, DBUS_TYPE_BOOLEAN, &boolean);
+		break;
+	case PROP_BYTE:
+		byte = prop->uint_value;
+		dbus_message_iter_append_basic (&variant, DBUS_TYPE_BYTE, &byte);
+		break;
+	case PROP_STRING:
+		dbus_message_iter_append_basic (&variant, DBUS_TYPE_STRING, &prop->string_value);
+		break;
+	case PROP_PATH:
+		dbus_message_iter_append_basic (&variant, DBUS_TYPE_OBJECT_PATH, &prop->string_value);
+		break;
+	case PROP_BYTES:
+		bytes = ((GByteArray *) prop->array_value)->data;
+		dbus_message_iter_open_container (&variant, DBUS_TYPE_ARRAY,
+				DBUS_TYPE_BYTE_AS_STRING, &array);
+		dbus_message_iter_append_fixed_array (&array, DBUS_TYPE_BYTE, &bytes,
+				((GByteArray *) prop->array_value)->len);
+		dbus_message_iter_close_container (&variant, &array);
+		break;
+	case PROP_PATHS:
+		append_strings (&variant, DBUS_TYPE_OBJECT_PATH, prop->array_value);
+		break;
+	case PROP_STRINGS:
+		append_strings (&variant, DBUS_TYPE_STRING, prop->array_value);
+		break;
+	case PROP_UINTS:
+		append_uints (&variant, prop->array_value);
+		break;
+	case PROP_UINT_ARRAYS:
+		dbus_message_iter_open_container (&variant, DBUS_TYPE_ARRAY, "au", &array);
+		for (i = 0; i < ((GPtrArray *) prop->array_value)->len; i++)
+			append_uints (&array, g_ptr_array_index ((GPtrArray *) prop->array_value, i));
+		dbus_message_iter_close_container (&variant, &array);
+		break;
+	}
+
+	dbus_message_iter_close_container (iter, &variant);
+}
+
+static void
+append_dict_entry (DBusMessageIter * dict, const char * key, int type, gconstpointer value)
+{
+	DBusMessageIter entry, variant;
+	char signature[2] = { type, '\0' };
+
+	dbus_message_iter_open_container (dict, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
+	dbus_message_iter_append_basic (&entry, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_open_container (&entry, DBUS_TYPE_VARIANT, signature, &variant);
+	dbus_message_iter_append_basic (&variant, type, value);
+	dbus_message_iter_close_container (&entry, &variant);
+	dbus_message_iter_close_container (dict, &entry);
+}
+
+/* "a{sa{sv}}" as libnm-glib expects from GetSettings */
+static void
+append_settings (DBusMessageIter * iter, const Object * connection)
+{
+	DBusMessageIter settings, group, props, variant, array;
+	const char * name;
+	const char * mode = "infrastructure";
+	const char * service = "org.freedesktop.NetworkManager.openvpn";
+	const guint8 * ssid = (const guint8 *) connection->id;
+	dbus_bool_t autoconnect = !strcmp (connection->type, "802-3-ethernet");
+
+	dbus_message_iter_open_container (iter, DBUS_TYPE_ARRAY, "{sa{sv}}", &settings);
+
+	dbus_message_iter_open_container (&settings, DBUS_TYPE_DICT_ENTRY, NULL, &group);
+	name = "connection";
+	dbus_message_iter_append_basic (&group, DBUS_TYPE_STRING, &name);
+	dbus_message_iter_open_container (&group, DBUS_TYPE_ARRAY, "{sv}", &props);
+	append_dict_entry (&props, "id", DBUS_TYPE_STRING, &connection->id);
+	append_dict_entry (&props, "uuid", DBUS_TYPE_STRING, &connection->uuid);
+	append_dict_entry (&props, "type", DBUS_TYPE_STRING, &connection->type);
+	append_dict_entry (&props, "autoconnect", DBUS_TYPE_BOOLEAN, &autoconnect);
+	dbus_message_iter_close_container (&group, &props);
+	dbus_message_iter_close_container (&settings, &group);
+
+	/* the setting named by the connection type, with what it requires */
+	dbus_message_iter_open_container (&settings, DBUS_TYPE_DICT_ENTRY, NULL, &group);
+	dbus_message_iter_append_basic (&group, DBUS_TYPE_STRING, &connection->type);
+	dbus_message_iter_open_container (&group, DBUS_TYPE_ARRAY, "{sv}", &props);
+	if (!strcmp (connection->type, "802-11-wireless")) {
+		DBusMessageIter entry;
+
+		name = "ssid";
+		dbus_message_iter_open_container (&props, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
+		dbus_message_iter_append_basic (&entry, DBUS_TYPE_STRING, &name);
+		dbus_message_iter_open_container (&entry, DBUS_TYPE_VARIANT, "ay", &variant);
+		dbus_message_iter_open_container (&variant, DBUS_TYPE_ARRAY,
+				DBUS_TYPE_BYTE_AS_STRING, &array);
+		dbus_message_iter_append_fixed_array (&array, DBUS_TYPE_BYTE, &ssid,
+				strlen (connection->id));
+		dbus_message_iter_close_container (&variant, &array);
+		dbus_message_iter_close_container (&entry, &variant);
+		dbus_message_iter_close_container (&props, &entry);
+
+		append_dict_entry (&props, "mode", DBUS_TYPE_STRING, &mode);
+	} else if (!strcmp (connection->type, "vpn"))
+		append_dict_entry (&props, "service-type", DBUS_TYPE_STRING, &service);
+	dbus_message_iter_close_container (&group, &props);
+	dbus_message_iter_close_container (&settings, &group);
+
+	dbus_message_iter_close_container (iter, &settings);
+}
+
+/* Method calls */
+
+static const Property *
+object_find_property (const Object * object, const char * iface, const char * name)
+{
+	int i;
+
+	for (i = 0; i < object->props->len; i++) {
+		const Property * prop = g_ptr_array_index (object->props, i);
+
+		if (!strcmp (prop->iface, iface) && !strcmp (prop->name, name))
+			return prop;
+	}
+	return NULL;
+}
+
+static DBusMessage *
+handle_properties (DBusMessage * call, const Object * object, const char * member)
+{
+	DBusMessage * reply;
+	DBusMessageIter iter, dict, entry;
+	const char * iface = NULL;
+	const char * name = NULL;
+	const Property * prop;
+	int i;
+
+	if (!strcmp (member, "Get")) {
+		if (!dbus_message_get_args (call, NULL, DBUS_TYPE_STRING, &iface,
+				DBUS_TYPE_STRING, &name, DBUS_TYPE_INVALID))
+			return dbus_message_new_error (call, DBUS_ERROR_INVALID_ARGS, "Expected (ss)");
+
+		prop = object_find_property (object, iface, name);
+		if (!prop)
+			return dbus_message_new_error_printf (call, DBUS_ERROR_INVALID_ARGS,
+					"No such property %s.%s", iface, name);
+
+		reply = dbus_message_new_method_return (call);
+		dbus_message_iter_init_append (reply, &iter);
+		append_property (&iter, prop);
+		return reply;
+	}
+
+	if (!strcmp (member, "GetAll")) {
+		if (!dbus_message_get_args (call, NULL, DBUS_TYPE_STRING, &iface,
+				DBUS_TYPE_INVALID))
+			return dbus_message_new_error (call, DBUS_ERROR_INVALID_ARGS, "Expected (s)");
+
+		reply = dbus_message_new_method_return (call);
+		dbus_message_iter_init_append (reply, &iter);
+		dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY, "{sv}", &dict);
+		for (i = 0; i < object->props->len; i++) {
+			prop = g_ptr_array_index (object->props, i);
+			if (strcmp (prop->iface, iface))
+				continue;
+
+			dbus_message_iter_open_container (&dict, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
+			dbus_message_iter_append_basic (&entry, DBUS_TYPE_STRING, &prop->name);
+			append_property (&entry, prop);
+			dbus_message_iter_close_container (&dict, &entry);
+		}
+		dbus_message_iter_close_container (&iter, &dict);
+		return reply;
+	}
+
+	return NULL;
+}
+
+static DBusMessage *
+handle_call (DBusMessage * call)
+{
+	const char * path = dbus_message_get_path (call);
+	const char * iface = dbus_message_get_interface (call);
+	const char * member = dbus_message_get_member (call);
+	const Object * object;
+	DBusMessage * reply = NULL;
+	DBusMessageIter iter;
+	guint32 permissions = 0;
+
+	if (!path || !member)
+		return NULL;
+
+	object = g_hash_table_lookup (objects, path);
+	if (!object)
+		return dbus_message_new_error_printf (call, DBUS_ERROR_UNKNOWN_METHOD,
+				"No object at %s", path);
+
+	if (iface && !strcmp (iface, DBUS_INTERFACE_PROPERTIES))
+		reply = handle_properties (call, object, member);
+	else if (object->list_method && !strcmp (member, object->list_method)
+			&& (!iface || !strcmp (iface, object->list_iface))) {
+		reply = dbus_message_new_method_return (call);
+		dbus_message_iter_init_append (reply, &iter);
+		append_strings (&iter, DBUS_TYPE_OBJECT_PATH, object->children);
+	}
+	else if (object->id && !strcmp (member, "GetSettings")) {
+		reply = dbus_message_new_method_return (call);
+		dbus_message_iter_init_append (reply, &iter);
+		append_settings (&iter, object);
+	}
+	else if (!strcmp (path, NM_DBUS_PATH_SETTINGS) && !strcmp (member, "GetPermissions")) {
+		reply = dbus_message_new_method_return (call);
+		dbus_message_append_args (reply, DBUS_TYPE_UINT32, &permissions,
+				DBUS_TYPE_INVALID);
+	}
+
+	if (!reply)
+		reply = dbus_message_new_error_printf (call, DBUS_ERROR_UNKNOWN_METHOD,
+				"No method %s.%s at %s", iface ? iface : "", member, path);
+	return reply;
+}
+
+static DBusHandlerResult
+message_filter (DBusConnection * connection, DBusMessage * message, void * user_data)
+{
+	DBusMessage * reply;
+
+	if (dbus_message_get_type (message) != DBUS_MESSAGE_TYPE_METHOD_CALL)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	if (dbus_message_is_method_call (message, MOCK_INTERFACE, "TakeStats")) {
+		reply = dbus_message_new_method_return (message);
+		dbus_message_append_args (reply, DBUS_TYPE_UINT32, &messages_received,
+				DBUS_TYPE_UINT32, &messages_sent, DBUS_TYPE_INVALID);
+		messages_received = messages_sent = 0;
+	} else {
+		messages_received++;
+		reply = handle_call (message);
+		if (reply)
+			messages_sent++;
+	}
+
+	if (reply) {
+		if (!dbus_message_get_no_reply (message))
+			dbus_connection_send (connection, reply, NULL);
+		dbus_message_unref (reply);
+	}
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+static gboolean
+request_name (DBusConnection * connection, const char * name)
+{
+	DBusError error;
+	int result;
+
+	dbus_error_init (&error);
+	result = dbus_bus_request_name (connection, name, DBUS_NAME_FLAG_DO_NOT_QUEUE, &error);
+	if (dbus_error_is_set (&error)) {
+		g_printerr ("Couldn't own %s: %s\n", name, error.message);
+		dbus_error_free (&error);
+		return FALSE;
+	}
+	if (result != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
+		g_printerr ("%s is already owned\n", name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+int main (int argc, char *argv[])
+{
+	GOptionContext * context;
+	GError * err = NULL;
+	DBusConnection * connection;
+	DBusError error;
+
+	context = g_option_context_new (NULL);
+	g_option_context_add_main_entries (context, option_entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &err)) {
+		g_printerr ("%s\n", err->message);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	build_objects (MAX (opt_devices, 0), MAX (opt_aps, 0), MAX (opt_connections, 0));
+
+	dbus_error_init (&error);
+	connection = dbus_bus_get (DBUS_BUS_SYSTEM, &error);
+	if (!connection) {
+		g_printerr ("Couldn't connect to the system bus: %s\n", error.message);
+		dbus_error_free (&error);
+		return 1;
+	}
+	dbus_connection_set_exit_on_disconnect (connection, FALSE);
+	dbus_connection_add_filter (connection, message_filter, NULL, NULL);
+
+	if (!request_name (connection, NM_DBUS_SERVICE)
+			|| !request_name (connection, NM_DBUS_SERVICE_SYSTEM_SETTINGS))
+		return 1;
+
+	printf ("ready\n");
+	fflush (stdout);
+
+	while (dbus_connection_read_write_dispatch (connection, -1))
+		;
+
+	/* the objects are left to the end of the process */
+	return 0;
+}
@@ -0,0 +1,442 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+/*
+ * End-to-end benchmark: starts a private dbus-daemon, loads it with
+ * nmconfig-mock-nm at several scales and runs nmconfig's main commands
+ * against it. For every scale and command it prints the median wall
+ * time, the number of D-Bus messages exchanged with the mock service
+ * and the peak RSS of nmconfig. Usually run as `make nmconfig-bench`;
+ * by hand, for example
+ *
+ *   nmconfig-bench-run --scale 8:50:20 --scale 64:500:200 --runs 10
+ *
+ * A scale is DEVICES:APS:CONNECTIONS, see bench/mock-nm.c. nmconfig
+ * and nmconfig-mock-nm are looked up next to this program unless given
+ * with --nmconfig and --mock. --nmconfig may be repeated to compare
+ * builds, e.g. the two connection backends (see NMConfigSettings.h).
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+
+#define MOCK_SERVICE "org.freedesktop.NetworkManager"
+#define MOCK_PATH "/org/nmconfig/MockNM"
+#define MOCK_INTERFACE "org.nmconfig.MockNM"
+
+#define MAX_ARGS 8
+
+typedef struct {
+	const char * label;
+	const char * args[MAX_ARGS];
+} BenchCommand;
+
+/* arguments after `nmconfig --no-daemon`; the --fields ones read only
+ * what they show, compare their messages with "all"
+ */
+static const BenchCommand commands[] = {
+	{ "all",    { NULL } },
+	{ "json",   { "--output", "json", NULL } },
+	{ "wlan0",  { "wlan0", NULL } },
+	{ "eth*",   { "eth*", NULL } },
+	{ "state",  { "--fields", "iface,state", NULL } },
+	{ "ip4",    { "--fields", "iface,state,ip4", NULL } },
+	{ "signal", { "--fields", "iface,ap.ssid,ap.strength", NULL } },
+};
+
+static const char * default_scales[] = { "4:20:10", "16:100:50", "64:500:200", NULL };
+
+static const char bus_config[] =
+	"<!DOCTYPE busconfig PUBLIC \"-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN\"\n"
+	" \"http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd\">\n"
+	"<busconfig>\n"
+	"  <type>session</type>\n"
+	"  <listen>unix:tmpdir=/tmp</listen>\n"
+	"  <policy context=\"default\">\n"
+	"    <allow send_destination=\"*\"/>\n"
+	"    <allow own=\"*\"/>\n"
+	"  </policy>\n"
+	"</busconfig>\n";
+
+static gchar ** opt_nmconfig = NULL;
+static gchar * opt_mock = NULL;
+static gchar * opt_dbus_daemon = "dbus-daemon";
+static gchar ** opt_scales = NULL;
+static gint opt_runs = 5;
+
+static GOptionEntry option_entries[] = {
+	{ "nmconfig", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &opt_nmconfig,
+	  "nmconfig binary to measure, may be repeated", "PATH" },
+	{ "mock", 0, 0, G_OPTION_ARG_FILENAME, &opt_mock,
+	  "nmconfig-mock-nm binary", "PATH" },
+	{ "dbus-daemon", 0, 0, G_OPTION_ARG_FILENAME, &opt_dbus_daemon,
+	  "dbus-daemon binary (default dbus-daemon)", "PATH" },
+	{ "scale", 0, 0, G_OPTION_ARG_STRING_ARRAY, &opt_scales,
+	  "Mock size, may be repeated (default 4:20:10 16:100:50 64:500:200)",
+	  "DEVICES:APS:CONNECTIONS" },
+	{ "runs", 0, 0, G_OPTION_ARG_INT, &opt_runs,
+	  "Runs of each command, the median time is reported (default 5)", "N" },
+	{ NULL }
+};
+
+/* Reads one line from a child's stdout, without the newline */
+static gchar *
+read_line (int fd)
+{
+	GString * line = g_string_new (NULL);
+	char c;
+	ssize_t n;
+
+	while ((n = read (fd, &c, 1)) != 0) {
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (c == '\n')
+			return g_string_free (line, FALSE);
+		g_string_append_c (line, c);
+	}
+
+	g_string_free (line, TRUE);
+	return NULL;
+}
+
+/* Spawns argv and waits for its first line of output */
+static GPid
+spawn_and_read (gchar ** argv, gchar ** line)
+{
+	GError * err = NULL;
+	GPid pid;
+	int out_fd;
+
+	if (!g_spawn_async_with_pipes (NULL, argv, NULL,
+			G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+			NULL, NULL, &pid, NULL, &out_fd, NULL, &err)) {
+		g_printerr ("Couldn't run %s: %s\n", argv[0], err->message);
+		g_error_free (err);
+		return 0;
+	}
+
+	*line = read_line (out_fd);
+	close (out_fd);
+	if (!*line) {
+		g_printerr ("%s exited without output\n", argv[0]);
+		waitpid (pid, NULL, 0);
+		g_spawn_close_pid (pid);
+		return 0;
+	}
+	return pid;
+}
+
+static void
+stop (GPid pid)
+{
+	kill (pid, SIGTERM);
+	waitpid (pid, NULL, 0);
+	g_spawn_close_pid (pid);
+}
+
+static GPid
+start_bus (const char * config_path, gchar ** address)
+{
+	gchar * config_arg = g_strdup_printf ("--config-file=%s", config_path);
+	gchar * argv[] = { opt_dbus_daemon, config_arg, "--print-address", "--nofork", NULL };
+	GPid pid;
+
+	pid = spawn_and_read (argv, address);
+	g_free (config_arg);
+	return pid;
+}
+
+static GPid
+start_mock (guint devices, guint aps, guint connections)
+{
+	gchar * args[3];
+	gchar * argv[5];
+	gchar * line = NULL;
+	GPid pid;
+	int i;
+
+	args[0] = g_strdup_printf ("--devices=%u", devices);
+	args[1] = g_strdup_printf ("--aps=%u", aps);
+	args[2] = g_strdup_printf ("--connections=%u", connections);
+	argv[0] = opt_mock;
+	for (i = 0; i < 3; i++)
+		argv[i + 1] = args[i];
+	argv[4] = NULL;
+
+	pid = spawn_and_read (argv, &line);
+	if (pid && strcmp (line, "ready")) {
+		g_printerr ("Unexpected output from %s: %s\n", opt_mock, line);
+		stop (pid);
+		pid = 0;
+	}
+
+	for (i = 0; i < 3; i++)
+		g_free (args[i]);
+	g_free (line);
+	return pid;
+}
+
+/* Messages the mock service received and sent since the last call */
+static gboolean
+take_stats (DBusConnection * connection, guint * messages)
+{
+	DBusMessage * call, * reply;
+	DBusError error;
+	dbus_uint32_t received = 0, sent = 0;
+
+	dbus_error_init (&error);
+	call = dbus_message_new_method_call (MOCK_SERVICE, MOCK_PATH,
+			MOCK_INTERFACE, "TakeStats");
+	reply = dbus_connection_send_with_reply_and_block (connection, call, -1, &error);
+	dbus_message_unref (call);
+
+	if (reply && !dbus_message_get_args (reply, &error, DBUS_TYPE_UINT32, &received,
+			DBUS_TYPE_UINT32, &sent, DBUS_TYPE_INVALID)) {
+		dbus_message_unref (reply);
+		reply = NULL;
+	}
+	if (!reply) {
+		g_printerr ("Couldn't read the mock's statistics: %s\n", error.message);
+		dbus_error_free (&error);
+		return FALSE;
+	}
+
+	dbus_message_unref (reply);
+	if (messages)
+		*messages = received + sent;
+	return TRUE;
+}
+
+/* Runs nmconfig once, returns its wait status or -1 */
+static int
+run_once (gchar ** argv, gdouble * wall_ms, glong * max_rss_kib)
+{
+	GError * err = NULL;
+	GTimer * timer;
+	struct rusage usage;
+	GPid pid;
+	int status;
+
+	timer = g_timer_new ();
+	if (!g_spawn_async (NULL, argv, NULL,
+			G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_STDOUT_TO_DEV_NULL,
+			NULL, NULL, &pid, &err)) {
+		g_printerr ("Couldn't run %s: %s\n", argv[0], err->message);
+		g_error_free (err);
+		g_timer_destroy (timer);
+		return -1;
+	}
+
+	while (wait4 (pid, &status, 0, &usage) < 0) {
+		if (errno != EINTR) {
+			g_timer_destroy (timer);
+			return -1;
+		}
+	}
+	g_timer_stop (timer);
+	g_spawn_close_pid (pid);
+
+	*wall_ms = g_timer_elapsed (timer, NULL) * 1000.0;
+	*max_rss_kib = MAX (*max_rss_kib, usage.ru_maxrss); /* KiB on Linux */
+	g_timer_destroy (timer);
+	return status;
+}
+
+static gint
+compare_doubles (gconstpointer a, gconstpointer b)
+{
+	gdouble x = *(const gdouble *) a;
+	gdouble y = *(const gdouble *) b;
+
+	return x < y ? -1 : (x > y);
+}
+
+static gboolean
+bench_command (DBusConnection * connection, const char * nmconfig,
+		const char * scale, const BenchCommand * command)
+{
+	gchar * name = g_path_get_basename (nmconfig);
+	gchar * argv[MAX_ARGS + 3];
+	gdouble * times = g_new0 (gdouble, opt_runs);
+	glong max_rss_kib = 0;
+	guint messages = 0;
+	int i, status = 0;
+
+	argv[0] = (gchar *) nmconfig;
+	argv[1] = "--no-daemon";
+	for (i = 0; command->args[i]; i++)
+		argv[i + 2] = (gchar *) command->args[i];
+	argv[i + 2] = NULL;
+
+	for (i = 0; i < opt_runs; i++) {
+		if (!take_stats (connection, NULL))
+			break;
+		status = run_once (argv, &times[i], &max_rss_kib);
+		if (status != 0 || !take_stats (connection, &messages))
+			break;
+	}
+
+	if (i < opt_runs) {
+		if (status > 0)
+			g_printerr ("%-16s %-12s %-8s failed, status %d\n", name, scale,
+					command->label,
+					WIFEXITED (status) ? WEXITSTATUS (status) : status);
+		g_free (times);
+		g_free (name);
+		return FALSE;
+	}
+
+	qsort (times, opt_runs, sizeof (gdouble), compare_doubles);
+	printf ("%-16s %-12s %-8s %10.2f %10u %10ld\n", name, scale, command->label,
+			times[opt_runs / 2], messages, max_rss_kib);
+	fflush (stdout);
+
+	g_free (times);
+	g_free (name);
+	return TRUE;
+}
+
+static gboolean
+bench_scale (DBusConnection * connection, const char * scale)
+{
+	guint devices, aps, connections;
+	gboolean ok = TRUE;
+	GPid mock;
+	int i, j;
+
+	if (sscanf (scale, "%u:%u:%u", &devices, &aps, &connections) != 3) {
+		g_printerr ("Invalid scale %s, expected DEVICES:APS:CONNECTIONS\n", scale);
+		return FALSE;
+	}
+
+	mock = start_mock (devices, aps, connections);
+	if (!mock)
+		return FALSE;
+
+	for (i = 0; i < G_N_ELEMENTS (commands); i++) {
+		for (j = 0; opt_nmconfig[j]; j++)
+			ok = bench_command (connection, opt_nmconfig[j], scale, &commands[i]) && ok;
+	}
+
+	stop (mock);
+	return ok;
+}
+
+static gchar *
+sibling_path (const char * argv0, const char * name)
+{
+	gchar * dir = g_path_get_dirname (argv0);
+	gchar * path = g_build_filename (dir, name, NULL);
+
+	g_free (dir);
+	return path;
+}
+
+int main (int argc, char *argv[])
+{
+	GOptionContext * context;
+	GError * err = NULL;
+	DBusConnection * connection;
+	DBusError error;
+	gchar * config_path = NULL;
+	gchar * address = NULL;
+	const char * const * scales;
+	GPid bus;
+	int fd, i, rc = 0;
+
+	context = g_option_context_new (NULL);
+	g_option_context_add_main_entries (context, option_entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &err)) {
+		g_printerr ("%s\n", err->message);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	if (opt_runs < 1)
+		opt_runs = 1;
+	if (!opt_nmconfig) {
+		opt_nmconfig = g_new0 (gchar *, 2);
+		opt_nmconfig[0] = sibling_path (argv[0], "nmconfig");
+	}
+	if (!opt_mock)
+		opt_mock = sibling_path (argv[0], "nmconfig-mock-nm");
+	scales = opt_scales ? (const char * const *) opt_scales : default_scales;
+
+	fd = g_file_open_tmp ("nmconfig-bench-XXXXXX.conf", &config_path, &err);
+	if (fd < 0) {
+		g_printerr ("%s\n", err->message);
+		return 1;
+	}
+	close (fd);
+	if (!g_file_set_contents (config_path, bus_config, -1, &err)) {
+		g_printerr ("%s\n", err->message);
+		unlink (config_path);
+		return 1;
+	}
+
+	bus = start_bus (config_path, &address);
+	if (!bus) {
+		unlink (config_path);
+		return 1;
+	}
+
+	/* nmconfig and the mock both talk to it as to the system bus */
+	g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", address, TRUE);
+
+	dbus_error_init (&error);
+	connection = dbus_connection_open_private (address, &error);
+	if (!connection || !dbus_bus_register (connection, &error)) {
+		g_printerr ("Couldn't connect to %s: %s\n", address, error.message);
+		dbus_error_free (&error);
+		rc = 1;
+		goto out;
+	}
+	dbus_connection_set_exit_on_disconnect (connection, FALSE);
+
+	printf ("%-16s %-12s %-8s %10s %10s %10s\n", "binary", "scale", "command",
+			"wall ms", "messages", "RSS KiB");
+	for (i = 0; scales[i]; i++) {
+		if (!bench_scale (connection, scales[i]))
+			rc = 1;
+	}
+
+	dbus_connection_close (connection);
+	dbus_connection_unref (connection);
+
+out:
+	stop (bus);
+	unlink (config_path);
+	g_free (config_path);
+	g_free (address);
+	return rc;
+}
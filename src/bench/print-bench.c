@@ -0,0 +1,180 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * nmconfig -- NetworkManager CLI controlling utility
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2009 Witold Sowa <witold.sowa@gmail.com>
+ */
+
+/*
+ * Prints a synthetic wifi device with many access points, as
+ * `nmconfig wlan0` would, and reports the time taken and the number of
+ * write calls on stderr. Run it with stdout redirected, for example
+ *
+ *   nmconfig-print-bench > /dev/null
+ *   nmconfig-print-bench --unbuffered > /dev/null
+ *
+ * --unbuffered prints through g_print() call by call, like nmconfig did
+ * before NMConfigPrint; each such call costs a write(2) since GLib's
+ * default handler flushes stdout.
+ *
+ * With the defaults (500 access points, 20 dumps), g_print makes 40700
+ * write calls and the buffered output 40.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <glib.h>
+#include <NetworkManager.h>
+
+#include "NMConfigDevicePrintHelper.h"
+#include "NMConfigPrint.h"
+
+static gint opt_aps = 500;
+static gint opt_iterations = 20;
+static gboolean opt_unbuffered = FALSE;
+
+static GOptionEntry option_entries[] = {
+	{ "aps", 0, 0, G_OPTION_ARG_INT, &opt_aps,
+	  "Number of access points (default 500)", "N" },
+	{ "iterations", 0, 0, G_OPTION_ARG_INT, &opt_iterations,
+	  "Number of dumps (default 20)", "N" },
+	{ "unbuffered", 0, 0, G_OPTION_ARG_NONE, &opt_unbuffered,
+	  "Print every piece through g_print()", NULL },
+	{ NULL }
+};
+
+static NMConfigDeviceInfo *
+synthetic_device (guint n_aps)
+{
+	NMConfigDeviceInfo * device = g_new0 (NMConfigDeviceInfo, 1);
+	NMConfigIP4Address address;
+	guint32 nameserver = htonl (0x0a000001);
+	guint i;
+
+	device->path = g_strdup ("/org/freedesktop/NetworkManager/Devices/0");
+	device->type = NM_DEVICE_TYPE_WIFI;
+	device->iface = g_strdup ("wlan0");
+	device->udi = g_strdup ("/sys/devices/pci0000:00/0000:00:1c.1/net/wlan0");
+	device->driver = g_strdup ("iwlagn");
+	device->managed = TRUE;
+	device->state = NM_DEVICE_STATE_ACTIVATED;
+
+	device->ip4 = g_new0 (NMConfigIP4Info, 1);
+	device->ip4->addresses = g_array_new (FALSE, FALSE, sizeof (NMConfigIP4Address));
+	device->ip4->nameservers = g_array_new (FALSE, FALSE, sizeof (guint32));
+	device->ip4->domains = g_ptr_array_new ();
+	address.address = htonl (0x0a000042);
+	address.prefix = 24;
+	address.gateway = htonl (0x0a000001);
+	g_array_append_val (device->ip4->addresses, address);
+	g_array_append_val (device->ip4->nameservers, nameserver);
+	g_ptr_array_add (device->ip4->domains, g_strdup ("example.com"));
+
+	device->hw_address = g_strdup ("00:11:22:33:44:55");
+	device->mode = NM_802_11_MODE_INFRA;
+	device->bitrate = 54000;
+	device->capabilities = NM_WIFI_DEVICE_CAP_CIPHER_WEP40
+		| NM_WIFI_DEVICE_CAP_CIPHER_WEP104
+		| NM_WIFI_DEVICE_CAP_CIPHER_TKIP
+		| NM_WIFI_DEVICE_CAP_CIPHER_CCMP
+		| NM_WIFI_DEVICE_CAP_WPA
+		| NM_WIFI_DEVICE_CAP_RSN;
+
+	device->aps = g_ptr_array_sized_new (n_aps);
+	for (i = 0; i < n_aps; i++) {
+		NMConfigAPInfo * ap = g_new0 (NMConfigAPInfo, 1);
+		gchar * ssid = g_strdup_printf ("network-%u", i % 37);
+
+		ap->path = g_strdup_printf ("/org/freedesktop/NetworkManager/AccessPoint/%u", i);
+		ap->bssid = g_strdup_printf ("00:16:%02X:%02X:%02X:%02X",
+				(i >> 24) & 0xff, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+		ap->ssid = g_byte_array_new ();
+		g_byte_array_append (ap->ssid, (const guint8 *) ssid, strlen (ssid));
+		ap->mode = NM_802_11_MODE_INFRA;
+		ap->frequency = 2412 + 5 * (i % 13);
+		ap->max_bitrate = 54000;
+		ap->strength = (i * 7) % 100;
+
+		/* a mix of open, WEP, WPA and WPA2 networks */
+		switch (i % 4) {
+		case 1:
+			ap->flags = NM_802_11_AP_FLAGS_PRIVACY;
+			break;
+		case 2:
+			ap->flags = NM_802_11_AP_FLAGS_PRIVACY;
+			ap->wpa_flags = NM_802_11_AP_SEC_PAIR_TKIP
+				| NM_802_11_AP_SEC_GROUP_TKIP | NM_802_11_AP_SEC_KEY_MGMT_PSK;
+			break;
+		case 3:
+			ap->flags = NM_802_11_AP_FLAGS_PRIVACY;
+			ap->rsn_flags = NM_802_11_AP_SEC_PAIR_CCMP
+				| NM_802_11_AP_SEC_GROUP_CCMP | NM_802_11_AP_SEC_KEY_MGMT_PSK;
+			break;
+		default:
+			break;
+		}
+
+		g_ptr_array_add (device->aps, ap);
+		g_free (ssid);
+	}
+	device->active_ap_path = g_strdup (((NMConfigAPInfo *)
+			g_ptr_array_index (device->aps, 0))->path);
+
+	return device;
+}
+
+int main (int argc, char *argv[])
+{
+	GOptionContext * context;
+	GError * err = NULL;
+	NMConfigDeviceInfo * device;
+	NMConfigDevicePrintOptions options = { 0 };
+	GTimer * timer;
+	gint i;
+
+	g_type_init ();
+
+	context = g_option_context_new (NULL);
+	g_option_context_add_main_entries (context, option_entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &err)) {
+		g_printerr ("%s\n", err->message);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	device = synthetic_device (MAX (opt_aps, 0));
+	nm_config_print_set_unbuffered (opt_unbuffered);
+
+	timer = g_timer_new ();
+	for (i = 0; i < opt_iterations; i++) {
+		nm_config_device_show_full_info (device, &options);
+		nm_config_print_flush ();
+	}
+	g_timer_stop (timer);
+
+	g_printerr ("%s: %d dumps of %d access points in %.3f ms, %u write calls\n",
+			opt_unbuffered ? "g_print" : "buffered",
+			opt_iterations, opt_aps,
+			g_timer_elapsed (timer, NULL) * 1000.0,
+			nm_config_print_get_write_calls ());
+
+	g_timer_destroy (timer);
+
+	/* the device is left to the end of the process */
+	return 0;
+}
@@ -24,6 +24,10 @@
 #include <glib.h>
 
 #include "NMConfig.h"
+#include "NMConfigCommand.h"
+#include "NMConfigDaemon.h"
+#include "NMConfigPrint.h"
+#include "NMConfigStats.h"
 
 static GMainLoop *loop = NULL;
 gint return_value = 0;
@@ -62,12 +66,42 @@ setup_signals (void)
 int main (int argc, char *argv[])
 {
 	NMConfig * nm_config;
+	NMConfigCommand * command;
+	GError * err = NULL;
 
 	g_type_init ();
 
+	command = nm_config_command_parse (argc, argv, FALSE, &err);
+	if (!command) {
+		g_printerr ("%s\n", err->message);
+		g_error_free (err);
+		return 1;
+	}
+
+	if (command->stats)
+		nm_config_stats_enable ();
+
+	/* Saved snapshots are read without D-Bus */
+	if (nm_config_command_is_offline (command)) {
+		return_value = nm_config_run_offline (command);
+		nm_config_print_flush ();
+		nm_config_stats_report ();
+		return return_value;
+	}
+
+	/* Let a running daemon answer from its up to date state */
+	if (command->action == NM_CONFIG_ACTION_SHOW &&
+		!command->daemon && !command->no_daemon && !command->watch && !command->stats &&
+		!command->dump_path && !command->details && !command->buses &&
+		nm_config_daemon_forward (command->socket_path, command->argv,
+				&return_value)) {
+		nm_config_command_free (command);
+		return return_value;
+	}
+
 	loop = g_main_loop_new (NULL, FALSE);
 
-	nm_config = nm_config_new (argc, argv);
+	nm_config = nm_config_new (command);
 	if (nm_config == NULL)
 		return 1;
 
@@ -77,6 +111,8 @@ int main (int argc, char *argv[])
 
 	setup_signals ();
 	g_main_loop_run (loop);
+	nm_config_print_flush ();
+	nm_config_stats_report ();
 
 	g_object_unref (G_OBJECT (nm_config));
 